@@ -58,7 +58,7 @@ bool compress_string(const std::string& str, std::string *dest, int compressionl
 }
 
 /** Decompress an STL string using zlib and return the original data. */
-bool decompress_string(const std::string& str, std::string *dest) {
+bool decompress_string(const std::string& str, std::string *dest, size_t maxSize) {
 	if (!str.size())
 		return false;
 
@@ -90,6 +90,11 @@ bool decompress_string(const std::string& str, std::string *dest) {
 				zs.total_out - outstring.size());
 		}
 
+		if (maxSize != 0 && outstring.size() > maxSize) {
+			inflateEnd(&zs);
+			ERROR_LOG(IO, "Decompressed data larger than %d bytes, giving up", (int)maxSize);
+			return false;
+		}
 	} while (ret == Z_OK);
 
 	inflateEnd(&zs);
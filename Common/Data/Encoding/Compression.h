@@ -4,4 +4,5 @@
 
 // inflate/deflate convenience wrapper. Uses zlib.
 bool compress_string(const std::string& str, std::string *dest, int compressionlevel = 9);
-bool decompress_string(const std::string& str, std::string *dest);
+// If maxSize is non-zero, fails instead of inflating to more than that many bytes.
+bool decompress_string(const std::string& str, std::string *dest, size_t maxSize = 0);
@@ -17,6 +17,8 @@
 #endif
 
 #if HOST_IS_CASE_SENSITIVE
+#include <atomic>
+#include <ctime>
 #include <dirent.h>
 #include <unistd.h>
 #include <sys/stat.h>
@@ -467,7 +469,87 @@ static bool FixFilenameCase(const std::string &path, std::string &filename) {
 	return retValue;
 }
 
-bool FixPathCase(const Path &realBasePath, std::string &path, FixPathCaseBehavior behavior) {
+static std::atomic<int> g_pathCaseCacheHits;
+static std::atomic<int> g_pathCaseCacheScans;
+
+// Directories modified this recently might change again within the mtime granularity.
+static const int64_t PATH_CASE_RACY_SECONDS = 2;
+
+static std::string LowerCaseName(const std::string &name) {
+	std::string lower = name;
+	for (char &c : lower)
+		c = tolower(c);
+	return lower;
+}
+
+bool PathCaseCache::Scan(const std::string &dirPath, Dir &dir) {
+	g_pathCaseCacheScans++;
+	dir.names.clear();
+	dir.hasCollisions = false;
+
+	DIR *dirp = opendir(dirPath.c_str());
+	if (!dirp)
+		return false;
+
+	struct dirent *result = nullptr;
+	while ((result = readdir(dirp))) {
+		std::string name = result->d_name;
+		// Like FixFilenameCase, the last match wins.
+		std::string &mapped = dir.names[LowerCaseName(name)];
+		if (!mapped.empty())
+			dir.hasCollisions = true;
+		mapped = std::move(name);
+	}
+	closedir(dirp);
+	return true;
+}
+
+bool PathCaseCache::Lookup(const std::string &dirPath, std::string &filename) {
+	struct stat st;
+	if (stat(dirPath.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+		return false;
+
+#if defined(__APPLE__)
+	int64_t mtimeNsec = st.st_mtimespec.tv_nsec;
+#else
+	int64_t mtimeNsec = st.st_mtim.tv_nsec;
+#endif
+
+	std::lock_guard<std::mutex> guard(lock_);
+	Dir &dir = dirs_[dirPath];
+	if (dir.racy || dir.mtimeSec != (int64_t)st.st_mtime || dir.mtimeNsec != mtimeNsec) {
+		if (!Scan(dirPath, dir)) {
+			dirs_.erase(dirPath);
+			return false;
+		}
+		dir.mtimeSec = (int64_t)st.st_mtime;
+		dir.mtimeNsec = mtimeNsec;
+		dir.racy = (int64_t)time(nullptr) - dir.mtimeSec < PATH_CASE_RACY_SECONDS;
+	} else {
+		g_pathCaseCacheHits++;
+	}
+
+	auto it = dir.names.find(LowerCaseName(filename));
+	if (it == dir.names.end())
+		return false;
+	// With names differing only by case, an exact match should win.
+	if (it->second != filename && dir.hasCollisions && File::Exists(Path(dirPath + "/" + filename)))
+		return true;
+	filename = it->second;
+	return true;
+}
+
+void PathCaseCache::Clear() {
+	std::lock_guard<std::mutex> guard(lock_);
+	dirs_.clear();
+}
+
+void GetPathCaseCacheStats(int *hits, int *scans) {
+	*hits = g_pathCaseCacheHits;
+	*scans = g_pathCaseCacheScans;
+}
+
+bool FixPathCase(const Path &realBasePath, std::string &path, FixPathCaseBehavior behavior, PathCaseCache *cache) {
 	if (realBasePath.Type() == PathType::CONTENT_URI) {
 		// Nothing to do. These are already case insensitive, I think.
 		return true;
@@ -504,7 +586,8 @@ bool FixPathCase(const Path &realBasePath, std::string &path, FixPathCaseBehavio
 			std::string component = path.substr(start, i - start);
 
 			// Fix case and stop on nonexistant path component
-			if (FixFilenameCase(fullPath, component) == false) {
+			bool found = cache ? cache->Lookup(fullPath, component) : FixFilenameCase(fullPath, component);
+			if (!found) {
 				// Still counts as success if partial matches allowed or if this
 				// is the last component and only the ones before it are required
 				return (behavior == FPC_PARTIAL_ALLOWED || (behavior == FPC_PATH_MUST_EXIST && i >= len));
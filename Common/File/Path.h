@@ -25,6 +25,12 @@
 
 #endif
 
+#if HOST_IS_CASE_SENSITIVE
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#endif
+
 enum class PathType {
 	UNDEFINED = 0,
 	NATIVE = 1,  // Can be relative.
@@ -152,6 +158,34 @@ enum FixPathCaseBehavior {
 	FPC_PARTIAL_ALLOWED,  // don't care how many exist (mkdir recursive)
 };
 
-bool FixPathCase(const Path &basePath, std::string &path, FixPathCaseBehavior behavior);
+// Remembers directory contents by lowercased name, so FixPathCase doesn't have to readdir()
+// on every call.  A directory is re-read only when its mtime changes (or is too recent to trust.)
+class PathCaseCache {
+public:
+	// Sets filename to its on-disk case if dirPath has a case-insensitive match.
+	bool Lookup(const std::string &dirPath, std::string &filename);
+	// Call after creating, removing, or renaming entries ourselves.
+	void Clear();
+
+private:
+	struct Dir {
+		std::unordered_map<std::string, std::string> names;
+		int64_t mtimeSec = 0;
+		int64_t mtimeNsec = 0;
+		bool hasCollisions = false;
+		bool racy = false;
+	};
+
+	bool Scan(const std::string &dirPath, Dir &dir);
+
+	std::mutex lock_;
+	std::unordered_map<std::string, Dir> dirs_;
+};
+
+// Passing a cache is optional, it only avoids re-reading directories.
+bool FixPathCase(const Path &basePath, std::string &path, FixPathCaseBehavior behavior, PathCaseCache *cache = nullptr);
+
+// Totals across all PathCaseCaches, for the debug stats.
+void GetPathCaseCacheStats(int *hits, int *scans);
 
 #endif
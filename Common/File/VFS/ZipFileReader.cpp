@@ -10,12 +10,158 @@
 #include "ext/libzip/zip.h"
 #endif
 
+#include <zlib.h>
+
+#include "ppsspp_config.h"
+
+#if PPSSPP_PLATFORM(WINDOWS)
+#include "Common/CommonWindows.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "Common/Common.h"
 #include "Common/Log.h"
 #include "Common/File/VFS/ZipFileReader.h"
 #include "Common/StringUtils.h"
 
-ZipFileReader *ZipFileReader::Create(const Path &zipFile, const char *inZipPath, bool logErrors) {
+// Deflated entries are inflated and cached in blocks of this size.
+static const size_t ZIP_BLOCK_SIZE = 64 * 1024;
+static const size_t ZIP_BLOCK_CACHE_BUDGET = 4 * 1024 * 1024;
+
+static const uint32_t ZIP_LOCAL_HEADER_SIG = 0x04034b50;
+static const uint32_t ZIP_CENTRAL_HEADER_SIG = 0x02014b50;
+static const uint32_t ZIP_EOCD_SIG = 0x06054b50;
+static const uint32_t ZIP64_EOCD_SIG = 0x06064b50;
+static const uint32_t ZIP64_LOCATOR_SIG = 0x07064b50;
+
+static const uint16_t ZIP_METHOD_STORED = 0;
+static const uint16_t ZIP_METHOD_DEFLATED = 8;
+
+static inline uint16_t ReadLE16(const uint8_t *p) {
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t ReadLE32(const uint8_t *p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t ReadLE64(const uint8_t *p) {
+	return (uint64_t)ReadLE32(p) | ((uint64_t)ReadLE32(p + 4) << 32);
+}
+
+static std::string LowerName(const std::string &name) {
+	std::string lower = name;
+	for (char &c : lower) {
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+	}
+	return lower;
+}
+
+// Maps the whole file read-only. Returns nullptr if that's not possible, in which case we use libzip.
+static const uint8_t *MapZipFile(const Path &zipFile, size_t *size) {
+#if PPSSPP_PLATFORM(UWP)
+	return nullptr;
+#elif PPSSPP_PLATFORM(WINDOWS)
+	HANDLE file = CreateFileW(zipFile.ToWString().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return nullptr;
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || (uint64_t)fileSize.QuadPart > (uint64_t)SIZE_MAX) {
+		CloseHandle(file);
+		return nullptr;
+	}
+	HANDLE mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping)
+		return nullptr;
+	// The view keeps the mapping alive.
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view)
+		return nullptr;
+	*size = (size_t)fileSize.QuadPart;
+	return (const uint8_t *)view;
+#else
+	int fd;
+	if (zipFile.Type() == PathType::CONTENT_URI) {
+		fd = File::OpenFD(zipFile, File::OPEN_READ);
+	} else {
+		fd = open(zipFile.c_str(), O_RDONLY);
+	}
+	if (fd < 0)
+		return nullptr;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0 || (uint64_t)st.st_size > (uint64_t)SIZE_MAX) {
+		close(fd);
+		return nullptr;
+	}
+	void *view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping stays valid after closing the descriptor.
+	close(fd);
+	if (view == MAP_FAILED)
+		return nullptr;
+	*size = (size_t)st.st_size;
+	return (const uint8_t *)view;
+#endif
+}
+
+static void UnmapZipFile(const uint8_t *mapped, size_t size) {
+#if PPSSPP_PLATFORM(WINDOWS)
+	UnmapViewOfFile(mapped);
+#else
+	munmap((void *)mapped, size);
+#endif
+}
+
+// Inflates a complete raw deflate stream. Only used for whole-file reads.
+static bool InflateRaw(const uint8_t *src, uint64_t srcSize, uint8_t *dest, uint64_t destSize) {
+	z_stream stream{};
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+		return false;
+
+	const uint8_t *srcEnd = src + srcSize;
+	uint8_t *destEnd = dest + destSize;
+	stream.next_in = (Bytef *)src;
+	stream.next_out = dest;
+	int result = Z_OK;
+	while (result == Z_OK) {
+		if (stream.avail_in == 0)
+			stream.avail_in = (uInt)std::min<uint64_t>(srcEnd - stream.next_in, 0x40000000);
+		if (stream.avail_out == 0)
+			stream.avail_out = (uInt)std::min<uint64_t>(destEnd - stream.next_out, 0x40000000);
+		if (stream.avail_out == 0)
+			break;
+		result = inflate(&stream, Z_NO_FLUSH);
+	}
+	inflateEnd(&stream);
+	return stream.next_out == destEnd && (result == Z_OK || result == Z_STREAM_END);
+}
+
+ZipFileReader *ZipFileReader::Create(const Path &zipFile, const char *inZipPath, bool logErrors, bool allowMapping) {
+	// The inZipPath is supposed to be a folder, and internally in this class, we suffix
+	// folder paths with '/', matching how the zip library works.
+	std::string path = inZipPath;
+	if (!path.empty() && path.back() != '/') {
+		path.push_back('/');
+	}
+
+	if (allowMapping) {
+		size_t mappedSize = 0;
+		const uint8_t *mapped = MapZipFile(zipFile, &mappedSize);
+		if (mapped) {
+			ZipFileReader *reader = new ZipFileReader(mapped, mappedSize, path);
+			if (reader->BuildIndex())
+				return reader;
+			// Something we don't handle natively, let libzip deal with it (or report the error.)
+			delete reader;
+		}
+	}
+
 	int error = 0;
 	zip *zip_file;
 	if (zipFile.Type() == PathType::CONTENT_URI) {
@@ -38,23 +184,185 @@ ZipFileReader *ZipFileReader::Create(const Path &zipFile, const char *inZipPath,
 		return nullptr;
 	}
 
-	// The inZipPath is supposed to be a folder, and internally in this class, we suffix
-	// folder paths with '/', matching how the zip library works.
-	std::string path = inZipPath;
-	if (!path.empty() && path.back() != '/') {
-		path.push_back('/');
-	}
 	return new ZipFileReader(zip_file, path);
 }
 
 ZipFileReader::~ZipFileReader() {
 	std::lock_guard<std::mutex> guard(lock_);
-	zip_close(zip_file_);
+	if (zip_file_)
+		zip_close(zip_file_);
+	if (mapped_)
+		UnmapZipFile(mapped_, mappedSize_);
+}
+
+bool ZipFileReader::BuildIndex() {
+	// The end of central directory record is at least 22 bytes, followed by a comment of up to 64KB.
+	const size_t eocdSize = 22;
+	if (mappedSize_ < eocdSize)
+		return false;
+	const uint8_t *eocd = nullptr;
+	size_t searchEnd = mappedSize_ > eocdSize + 0xFFFF ? mappedSize_ - eocdSize - 0xFFFF : 0;
+	for (size_t pos = mappedSize_ - eocdSize + 1; pos-- > searchEnd; ) {
+		if (ReadLE32(mapped_ + pos) == ZIP_EOCD_SIG) {
+			eocd = mapped_ + pos;
+			break;
+		}
+	}
+	if (!eocd)
+		return false;
+
+	uint64_t numEntries = ReadLE16(eocd + 10);
+	uint64_t cdSize = ReadLE32(eocd + 12);
+	uint64_t cdOffset = ReadLE32(eocd + 16);
+	if (numEntries == 0xFFFF || cdSize == 0xFFFFFFFF || cdOffset == 0xFFFFFFFF) {
+		// Zip64, the real values are in another record pointed to by a locator just before.
+		if (eocd - mapped_ < 20)
+			return false;
+		const uint8_t *locator = eocd - 20;
+		if (ReadLE32(locator) != ZIP64_LOCATOR_SIG)
+			return false;
+		uint64_t zip64EocdOffset = ReadLE64(locator + 8);
+		if (mappedSize_ < 56 || zip64EocdOffset > mappedSize_ - 56)
+			return false;
+		const uint8_t *zip64Eocd = mapped_ + zip64EocdOffset;
+		if (ReadLE32(zip64Eocd) != ZIP64_EOCD_SIG)
+			return false;
+		numEntries = ReadLE64(zip64Eocd + 32);
+		cdSize = ReadLE64(zip64Eocd + 40);
+		cdOffset = ReadLE64(zip64Eocd + 48);
+	}
+	if (cdOffset > mappedSize_ || cdSize > mappedSize_ - cdOffset)
+		return false;
+	// Each central directory header is at least 46 bytes, so this also bounds a bogus count.
+	if (numEntries > cdSize / 46)
+		return false;
+
+	entries_.reserve((size_t)numEntries);
+	entryIndex_.reserve((size_t)numEntries);
+	const uint8_t *p = mapped_ + cdOffset;
+	const uint8_t *cdEnd = p + cdSize;
+	for (uint64_t i = 0; i < numEntries; ++i) {
+		if (cdEnd - p < 46 || ReadLE32(p) != ZIP_CENTRAL_HEADER_SIG)
+			return false;
+		uint16_t flags = ReadLE16(p + 8);
+		uint16_t method = ReadLE16(p + 10);
+		uint16_t nameLen = ReadLE16(p + 28);
+		uint16_t extraLen = ReadLE16(p + 30);
+		uint16_t commentLen = ReadLE16(p + 32);
+		if (cdEnd - p < 46 + nameLen + extraLen + commentLen)
+			return false;
+		// Encrypted entries, or compression we don't handle natively.
+		if ((flags & 1) != 0 || (method != ZIP_METHOD_STORED && method != ZIP_METHOD_DEFLATED))
+			return false;
+
+		Entry entry;
+		entry.name.assign((const char *)p + 46, nameLen);
+		entry.method = method;
+		entry.compressedSize = ReadLE32(p + 20);
+		entry.size = ReadLE32(p + 24);
+		entry.localHeaderOffset = ReadLE32(p + 42);
+
+		// Zip64 sizes and offsets live in an extra field, in this order, only when the 32-bit field overflowed.
+		const uint8_t *extra = p + 46 + nameLen;
+		const uint8_t *extraEnd = extra + extraLen;
+		while (extraEnd - extra >= 4) {
+			uint16_t id = ReadLE16(extra);
+			uint16_t len = ReadLE16(extra + 2);
+			const uint8_t *field = extra + 4;
+			if (extraEnd - field < len)
+				break;
+			if (id == 0x0001) {
+				const uint8_t *fieldEnd = field + len;
+				uint64_t *values[3] = { &entry.size, &entry.compressedSize, &entry.localHeaderOffset };
+				for (uint64_t *value : values) {
+					if (*value != 0xFFFFFFFF)
+						continue;
+					if (fieldEnd - field < 8)
+						return false;
+					*value = ReadLE64(field);
+					field += 8;
+				}
+			}
+			extra = field + len;
+		}
+		if (entry.method == ZIP_METHOD_STORED && entry.compressedSize != entry.size)
+			return false;
+		if (entry.localHeaderOffset >= mappedSize_ || entry.compressedSize > mappedSize_)
+			return false;
+
+		entryIndex_.emplace(LowerName(entry.name), (uint32_t)entries_.size());
+		entries_.push_back(std::move(entry));
+		p += 46 + nameLen + extraLen + commentLen;
+	}
+
+	// Precompute the listing of every directory, same rules as GetZipListings().
+	for (const Entry &entry : entries_) {
+		const std::string &name = entry.name;
+		size_t prefixLen = 0;
+		while (true) {
+			if (name.size() > prefixLen) {
+				DirListing &dir = dirIndex_[name.substr(0, prefixLen)];
+				size_t slashPos = name.find('/', prefixLen);
+				if (slashPos != std::string::npos) {
+					dir.directories.insert(name.substr(prefixLen, slashPos - prefixLen));
+				} else {
+					dir.files.insert(name.substr(prefixLen));
+				}
+			}
+			size_t nextSlash = name.find('/', prefixLen);
+			if (nextSlash == std::string::npos)
+				break;
+			prefixLen = nextSlash + 1;
+		}
+	}
+
+	return true;
+}
+
+const ZipFileReader::Entry *ZipFileReader::FindEntry(const std::string &name) const {
+	auto it = entryIndex_.find(LowerName(name));
+	if (it == entryIndex_.end())
+		return nullptr;
+	return &entries_[it->second];
+}
+
+const uint8_t *ZipFileReader::EntryData(const Entry &entry) const {
+	// The local header can have a different extra field than the central directory, so we check it here.
+	const size_t localHeaderSize = 30;
+	if (mappedSize_ < localHeaderSize || entry.localHeaderOffset > mappedSize_ - localHeaderSize)
+		return nullptr;
+	const uint8_t *header = mapped_ + entry.localHeaderOffset;
+	if (ReadLE32(header) != ZIP_LOCAL_HEADER_SIG)
+		return nullptr;
+	uint64_t dataOffset = entry.localHeaderOffset + localHeaderSize + ReadLE16(header + 26) + ReadLE16(header + 28);
+	if (dataOffset > mappedSize_ || entry.compressedSize > mappedSize_ - dataOffset)
+		return nullptr;
+	return mapped_ + dataOffset;
 }
 
 uint8_t *ZipFileReader::ReadFile(const char *path, size_t *size) {
 	std::string temp_path = inZipPath_ + path;
 
+	if (mapped_) {
+		const Entry *entry = FindEntry(temp_path);
+		const uint8_t *data = entry ? EntryData(*entry) : nullptr;
+		if (!data) {
+			ERROR_LOG(IO, "Error opening %s from ZIP", temp_path.c_str());
+			return 0;
+		}
+		uint8_t *contents = new uint8_t[entry->size + 1];
+		if (entry->method == ZIP_METHOD_STORED) {
+			memcpy(contents, data, entry->size);
+		} else if (!InflateRaw(data, entry->compressedSize, contents, entry->size)) {
+			ERROR_LOG(IO, "Error decompressing %s from ZIP", temp_path.c_str());
+			delete[] contents;
+			return 0;
+		}
+		contents[entry->size] = 0;
+		*size = entry->size;
+		return contents;
+	}
+
 	std::lock_guard<std::mutex> guard(lock_);
 	// Figure out the file size first.
 	struct zip_stat zstat;
@@ -96,21 +404,32 @@ bool ZipFileReader::GetFileListing(const char *orig_path, std::vector<File::File
 	if (tmp.size())
 		filters.emplace("." + tmp);
 
-	// We just loop through the whole ZIP file and deduce what files are in this directory, and what subdirectories there are.
-	std::set<std::string> files;
-	std::set<std::string> directories;
-	bool success = GetZipListings(path, files, directories);
-	if (!success) {
-		// This means that no file prefix matched the path.
-		return false;
+	std::set<std::string> zipFiles;
+	std::set<std::string> zipDirectories;
+	const std::set<std::string> *files = &zipFiles;
+	const std::set<std::string> *directories = &zipDirectories;
+	if (mapped_) {
+		auto it = dirIndex_.find(path);
+		if (it == dirIndex_.end()) {
+			return false;
+		}
+		files = &it->second.files;
+		directories = &it->second.directories;
+	} else {
+		// We just loop through the whole ZIP file and deduce what files are in this directory, and what subdirectories there are.
+		bool success = GetZipListings(path, zipFiles, zipDirectories);
+		if (!success) {
+			// This means that no file prefix matched the path.
+			return false;
+		}
 	}
 
 	listing->clear();
 
 	// INFO_LOG(SYSTEM, "Zip: Listing '%s'", orig_path);
 
-	listing->reserve(directories.size() + files.size());
-	for (auto diter = directories.begin(); diter != directories.end(); ++diter) {
+	listing->reserve(directories->size() + files->size());
+	for (auto diter = directories->begin(); diter != directories->end(); ++diter) {
 		File::FileInfo info;
 		info.name = *diter;
 
@@ -124,7 +443,7 @@ bool ZipFileReader::GetFileListing(const char *orig_path, std::vector<File::File
 		listing->push_back(info);
 	}
 
-	for (auto fiter = files.begin(); fiter != files.end(); ++fiter) {
+	for (auto fiter = files->begin(); fiter != files->end(); ++fiter) {
 		std::string fpath = path;
 		File::FileInfo info;
 		info.name = *fiter;
@@ -191,6 +510,19 @@ bool ZipFileReader::GetFileInfo(const char *path, File::FileInfo *info) {
 	info->isWritable = false;
 	info->size = 0;
 
+	if (mapped_) {
+		const Entry *entry = FindEntry(temp_path);
+		if (!entry) {
+			info->exists = false;
+			return false;
+		}
+		info->isDirectory = !entry->name.empty() && entry->name.back() == '/';
+		info->size = entry->size;
+		info->fullName = Path(path);
+		info->exists = true;
+		return true;
+	}
+
 	{
 		std::lock_guard<std::mutex> guard(lock_);
 		if (0 != zip_stat(zip_file_, temp_path.c_str(), ZIP_FL_NOCASE | ZIP_FL_UNCHANGED, &zstat)) {
@@ -224,14 +556,32 @@ class ZipFileReaderOpenFile : public VFSOpenFile {
 	~ZipFileReaderOpenFile() {
 		// Needs to be closed properly and unlocked.
 		_dbg_assert_(zf == nullptr);
+		_dbg_assert_(!streamActive);
 	}
 	ZipFileReaderFileReference *reference;
 	zip_file_t *zf = nullptr;
+
+	// Mapped mode only. Each open file has its own position and inflate stream, so no locking is needed.
+	const uint8_t *data = nullptr;
+	uint64_t compressedSize = 0;
+	uint64_t size = 0;
+	bool deflated = false;
+	uint64_t pos = 0;
+	z_stream stream{};
+	bool streamActive = false;
+	// How far into the uncompressed data the stream has gotten. Always a multiple of ZIP_BLOCK_SIZE.
+	uint64_t streamPos = 0;
 };
 
 VFSFileReference *ZipFileReader::GetFile(const char *path) {
-	std::lock_guard<std::mutex> guard(lock_);
-	int zi = zip_name_locate(zip_file_, path, ZIP_FL_NOCASE);
+	int zi;
+	if (mapped_) {
+		auto it = entryIndex_.find(LowerName(path));
+		zi = it == entryIndex_.end() ? -1 : (int)it->second;
+	} else {
+		std::lock_guard<std::mutex> guard(lock_);
+		zi = zip_name_locate(zip_file_, path, ZIP_FL_NOCASE);
+	}
 	if (zi < 0) {
 		// Not found.
 		return nullptr;
@@ -243,6 +593,12 @@ VFSFileReference *ZipFileReader::GetFile(const char *path) {
 
 bool ZipFileReader::GetFileInfo(VFSFileReference *vfsReference, File::FileInfo *fileInfo) {
 	ZipFileReaderFileReference *reference = (ZipFileReaderFileReference *)vfsReference;
+	if (mapped_) {
+		*fileInfo = File::FileInfo{};
+		fileInfo->size = entries_[reference->zi].size;
+		return fileInfo->size;
+	}
+
 	// If you crash here, you called this while having the lock held by having the file open.
 	// Don't do that, check the info before you open the file.
 	std::lock_guard<std::mutex> guard(lock_);
@@ -267,8 +623,23 @@ VFSOpenFile *ZipFileReader::OpenFileForRead(VFSFileReference *vfsReference, size
 	ZipFileReaderOpenFile *openFile = new ZipFileReaderOpenFile();
 	openFile->reference = reference;
 	*size = 0;
-	// We only allow one file to be open for read concurrently. It's possible that this can be improved,
-	// especially if we only access by index like this.
+
+	if (mapped_) {
+		const Entry &entry = entries_[reference->zi];
+		openFile->data = EntryData(entry);
+		if (!openFile->data) {
+			WARN_LOG(G3D, "File with index %d has a bad header in zip", reference->zi);
+			delete openFile;
+			return nullptr;
+		}
+		openFile->compressedSize = entry.compressedSize;
+		openFile->size = entry.size;
+		openFile->deflated = entry.method == ZIP_METHOD_DEFLATED;
+		*size = entry.size;
+		return openFile;
+	}
+
+	// We only allow one file to be open for read concurrently through libzip.
 	lock_.lock();
 	zip_stat_t zstat;
 	if (zip_stat_index(zip_file_, reference->zi, 0, &zstat) != 0) {
@@ -292,6 +663,11 @@ VFSOpenFile *ZipFileReader::OpenFileForRead(VFSFileReference *vfsReference, size
 
 void ZipFileReader::Rewind(VFSOpenFile *vfsOpenFile) {
 	ZipFileReaderOpenFile *openFile = (ZipFileReaderOpenFile *)vfsOpenFile;
+	if (mapped_) {
+		// The inflate stream is only restarted if the first blocks have dropped out of the cache.
+		openFile->pos = 0;
+		return;
+	}
 	// Close and re-open.
 	zip_fclose(openFile->zf);
 	openFile->zf = zip_fopen_index(zip_file_, openFile->reference->zi, 0);
@@ -299,11 +675,119 @@ void ZipFileReader::Rewind(VFSOpenFile *vfsOpenFile) {
 
 size_t ZipFileReader::Read(VFSOpenFile *vfsOpenFile, void *buffer, size_t length) {
 	ZipFileReaderOpenFile *file = (ZipFileReaderOpenFile *)vfsOpenFile;
+	if (mapped_) {
+		if (file->deflated)
+			return ReadDeflated(file, (uint8_t *)buffer, length);
+		size_t count = (size_t)std::min<uint64_t>(length, file->size - file->pos);
+		memcpy(buffer, file->data + file->pos, count);
+		file->pos += count;
+		return count;
+	}
 	return zip_fread(file->zf, buffer, length);
 }
 
+size_t ZipFileReader::ReadDeflated(ZipFileReaderOpenFile *file, uint8_t *buffer, size_t length) {
+	const uint64_t entryKey = (uint64_t)file->reference->zi << 32;
+	size_t total = 0;
+	while (total < length && file->pos < file->size) {
+		uint32_t block = (uint32_t)(file->pos / ZIP_BLOCK_SIZE);
+		size_t blockOffset = (size_t)(file->pos % ZIP_BLOCK_SIZE);
+		Block data = LookupBlock(entryKey | block);
+		if (!data) {
+			data = InflateToBlock(file, block);
+			if (!data) {
+				ERROR_LOG(IO, "Error decompressing entry %d from ZIP", file->reference->zi);
+				break;
+			}
+		}
+
+		size_t count = std::min(length - total, data->size() - blockOffset);
+		memcpy(buffer + total, data->data() + blockOffset, count);
+		total += count;
+		file->pos += count;
+	}
+	return total;
+}
+
+ZipFileReader::Block ZipFileReader::InflateToBlock(ZipFileReaderOpenFile *file, uint32_t block) {
+	const uint64_t target = (uint64_t)block * ZIP_BLOCK_SIZE;
+	if (!file->streamActive || file->streamPos > target) {
+		// Deflate can't seek backwards, so start over from the beginning.
+		int result = file->streamActive ? inflateReset(&file->stream) : inflateInit2(&file->stream, -MAX_WBITS);
+		if (result != Z_OK) {
+			file->streamActive = false;
+			return nullptr;
+		}
+		file->streamActive = true;
+		file->stream.next_in = (Bytef *)file->data;
+		file->stream.avail_in = 0;
+		file->streamPos = 0;
+	}
+
+	const uint8_t *inEnd = file->data + file->compressedSize;
+	const uint64_t entryKey = (uint64_t)file->reference->zi << 32;
+	while (true) {
+		uint32_t current = (uint32_t)(file->streamPos / ZIP_BLOCK_SIZE);
+		size_t blockSize = (size_t)std::min<uint64_t>(ZIP_BLOCK_SIZE, file->size - file->streamPos);
+		Block data = std::make_shared<std::vector<uint8_t>>(blockSize);
+
+		file->stream.next_out = data->data();
+		file->stream.avail_out = (uInt)blockSize;
+		while (file->stream.avail_out != 0) {
+			if (file->stream.avail_in == 0)
+				file->stream.avail_in = (uInt)std::min<uint64_t>(inEnd - file->stream.next_in, 0x40000000);
+			int result = inflate(&file->stream, Z_NO_FLUSH);
+			if (result != Z_OK && !(result == Z_STREAM_END && file->stream.avail_out == 0)) {
+				// Corrupt or truncated, start over next time.
+				inflateEnd(&file->stream);
+				file->streamActive = false;
+				return nullptr;
+			}
+		}
+
+		file->streamPos += blockSize;
+		// Blocks we skip over on the way are cached too, they're likely to be wanted soon.
+		InsertBlock(entryKey | current, data);
+		if (current == block)
+			return data;
+	}
+}
+
+ZipFileReader::Block ZipFileReader::LookupBlock(uint64_t key) {
+	std::lock_guard<std::mutex> guard(blockCacheLock_);
+	auto it = blockMap_.find(key);
+	if (it == blockMap_.end())
+		return nullptr;
+	// Move to the front, it's now the most recently used.
+	blockLRU_.splice(blockLRU_.begin(), blockLRU_, it->second);
+	return it->second->second;
+}
+
+void ZipFileReader::InsertBlock(uint64_t key, const Block &data) {
+	std::lock_guard<std::mutex> guard(blockCacheLock_);
+	if (blockMap_.find(key) != blockMap_.end())
+		return;
+	blockLRU_.emplace_front(key, data);
+	blockMap_[key] = blockLRU_.begin();
+	blockCacheBytes_ += data->size();
+	while (blockCacheBytes_ > ZIP_BLOCK_CACHE_BUDGET && blockLRU_.size() > 1) {
+		auto &oldest = blockLRU_.back();
+		blockCacheBytes_ -= oldest.second->size();
+		blockMap_.erase(oldest.first);
+		blockLRU_.pop_back();
+	}
+}
+
 void ZipFileReader::CloseFile(VFSOpenFile *vfsOpenFile) {
 	ZipFileReaderOpenFile *file = (ZipFileReaderOpenFile *)vfsOpenFile;
+	if (mapped_) {
+		if (file->streamActive) {
+			inflateEnd(&file->stream);
+			file->streamActive = false;
+		}
+		delete file;
+		return;
+	}
 	_dbg_assert_(file->zf != nullptr);
 	zip_fclose(file->zf);
 	file->zf = nullptr;
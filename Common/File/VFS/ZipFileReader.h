@@ -6,20 +6,35 @@
 #include "ext/libzip/zip.h"
 #endif
 
+#include <cstdint>
+#include <list>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "Common/File/VFS/VFS.h"
 #include "Common/File/FileUtil.h"
 #include "Common/File/Path.h"
 
+class ZipFileReaderOpenFile;
+
+// Reads files from a zip archive. When possible, the archive is memory mapped and its
+// central directory indexed once up front, so lookups and listings don't need to go
+// through libzip, stored entries are copied straight out of the mapping, and deflated
+// entries are inflated in blocks shared through a small LRU cache. Several files may
+// be open concurrently in that mode. Archives that can't be mapped or that use features
+// the native reader doesn't handle (encryption, unusual compression) go through libzip.
 class ZipFileReader : public VFSBackend {
 public:
-	static ZipFileReader *Create(const Path &zipFile, const char *inZipPath, bool logErrors = true);
+	// If allowMapping is false, always uses libzip. Mostly useful for testing.
+	static ZipFileReader *Create(const Path &zipFile, const char *inZipPath, bool logErrors = true, bool allowMapping = true);
 	~ZipFileReader();
 
-	bool IsValid() const { return zip_file_ != nullptr; }
+	bool IsValid() const { return zip_file_ != nullptr || mapped_ != nullptr; }
+	bool IsMapped() const { return mapped_ != nullptr; }
 
 	// use delete[] on the returned value.
 	uint8_t *ReadFile(const char *path, size_t *size) override;
@@ -40,11 +55,48 @@ class ZipFileReader : public VFSBackend {
 	}
 
 private:
+	struct Entry {
+		std::string name;
+		uint64_t localHeaderOffset;
+		uint64_t compressedSize;
+		uint64_t size;
+		uint16_t method;
+	};
+	struct DirListing {
+		std::set<std::string> files;
+		std::set<std::string> directories;
+	};
+	typedef std::shared_ptr<std::vector<uint8_t>> Block;
+
 	ZipFileReader(zip *zip_file, const std::string &inZipPath) : zip_file_(zip_file), inZipPath_(inZipPath) {}
+	ZipFileReader(const uint8_t *mapped, size_t mappedSize, const std::string &inZipPath) : inZipPath_(inZipPath), mapped_(mapped), mappedSize_(mappedSize) {}
 	// Path has to be either an empty string, or a string ending with a /.
 	bool GetZipListings(const std::string &path, std::set<std::string> &files, std::set<std::string> &directories);
 
+	// Native (mapped) mode.
+	bool BuildIndex();
+	const Entry *FindEntry(const std::string &name) const;
+	const uint8_t *EntryData(const Entry &entry) const;
+	size_t ReadDeflated(ZipFileReaderOpenFile *file, uint8_t *buffer, size_t length);
+	Block InflateToBlock(ZipFileReaderOpenFile *file, uint32_t block);
+	Block LookupBlock(uint64_t key);
+	void InsertBlock(uint64_t key, const Block &data);
+
 	zip *zip_file_ = nullptr;
 	std::mutex lock_;
 	std::string inZipPath_;
+
+	const uint8_t *mapped_ = nullptr;
+	size_t mappedSize_ = 0;
+	std::vector<Entry> entries_;
+	// Lowercased name -> index into entries_, to match libzip's ZIP_FL_NOCASE lookups.
+	std::unordered_map<std::string, uint32_t> entryIndex_;
+	// Directory path (empty or ending with /) -> its immediate children.
+	std::unordered_map<std::string, DirListing> dirIndex_;
+
+	// Inflated blocks of deflated entries, keyed by (entry index << 32) | block number.
+	std::mutex blockCacheLock_;
+	std::list<std::pair<uint64_t, Block>> blockLRU_;
+	std::unordered_map<uint64_t, std::list<std::pair<uint64_t, Block>>::iterator> blockMap_;
+	size_t blockCacheBytes_ = 0;
 };
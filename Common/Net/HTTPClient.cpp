@@ -106,7 +106,7 @@ static void FormatAddr(char *addrbuf, size_t bufsize, const addrinfo *info) {
 	}
 }
 
-bool Connection::Connect(int maxTries, double timeout, bool *cancelConnect) {
+bool Connection::Connect(int maxTries, double timeout, std::atomic<bool> *cancelConnect) {
 	if (port_ <= 0) {
 		ERROR_LOG(IO, "Bad port");
 		return false;
@@ -363,7 +363,7 @@ int Client::SendRequestWithData(const char *method, const RequestParams &req, co
 		"Host: %s\r\n"
 		"User-Agent: %s\r\n"
 		"Accept: %s\r\n"
-		"Connection: close\r\n"
+		"Connection: %s\r\n"
 		"%s"
 		"\r\n";
 
@@ -372,6 +372,7 @@ int Client::SendRequestWithData(const char *method, const RequestParams &req, co
 		host_.c_str(),
 		userAgent_.c_str(),
 		req.acceptMime,
+		keepAlive_ ? "keep-alive" : "close",
 		otherHeaders ? otherHeaders : "");
 	buffer.Append(data);
 	bool flushed = buffer.FlushSocket(sock(), dataTimeout_, progress->cancelled);
@@ -439,6 +440,7 @@ int Client::ReadResponseEntity(net::Buffer *readbuf, const std::vector<std::stri
 
 	bool gzip = false;
 	bool chunked = false;
+	bool hasContentLength = false;
 	int contentLength = 0;
 	for (std::string line : responseHeaders) {
 		if (startsWithNoCase(line, "Content-Length:")) {
@@ -448,6 +450,7 @@ int Client::ReadResponseEntity(net::Buffer *readbuf, const std::vector<std::stri
 			}
 			if (size_pos != line.npos) {
 				contentLength = atoi(&line[size_pos]);
+				hasContentLength = true;
 				chunked = false;
 			}
 		} else if (startsWithNoCase(line, "Content-Encoding:")) {
@@ -469,8 +472,13 @@ int Client::ReadResponseEntity(net::Buffer *readbuf, const std::vector<std::stri
 		contentLength = 0;
 	}
 
-	if (!readbuf->ReadAllWithProgress(sock(), contentLength, progress))
+	if (keepAlive_ && hasContentLength && !chunked) {
+		// The connection stays open, so we can't just read until it closes.
+		if (!readbuf->ReadExactWithProgress(sock(), contentLength, progress))
+			return -1;
+	} else if (!readbuf->ReadAllWithProgress(sock(), contentLength, progress)) {
 		return -1;
+	}
 
 	// output now contains the rest of the reply. Dechunk it.
 	if (!output->IsVoid()) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <thread>
@@ -20,7 +21,7 @@ class Connection {
 	// Inits the sockaddr_in.
 	bool Resolve(const char *host, int port, DNSType type = DNSType::ANY);
 
-	bool Connect(int maxTries = 2, double timeout = 20.0f, bool *cancelConnect = nullptr);
+	bool Connect(int maxTries = 2, double timeout = 20.0f, std::atomic<bool> *cancelConnect = nullptr);
 	void Disconnect();
 
 	// Only to be used for bring-up and debugging.
@@ -84,9 +85,16 @@ class Client : public net::Connection {
 		userAgent_ = value;
 	}
 
+	// Asks the server to keep the connection open between requests.  Check the response's
+	// Connection header to see if it agreed.
+	void SetKeepAlive(bool keepAlive) {
+		keepAlive_ = keepAlive;
+	}
+
 protected:
 	std::string userAgent_;
 	double dataTimeout_ = 900.0;
+	bool keepAlive_ = false;
 };
 
 // Really an asynchronous request.
@@ -133,7 +141,7 @@ class HTTPRequest : public Request {
 	int resultCode_ = 0;
 	bool completed_ = false;
 	bool failed_ = false;
-	bool cancelled_ = false;
+	std::atomic<bool> cancelled_{};
 	bool joined_ = false;
 };
 
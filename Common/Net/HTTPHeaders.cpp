@@ -93,10 +93,12 @@ int RequestHeader::ParseHttpHeader(const char *buffer) {
 			memcpy(params, q_ptr + 1, param_length);
 			params[param_length] = '\0';
 		}
-		if (strstr(buffer, "HTTP/"))
+		if (strstr(buffer, "HTTP/")) {
 			type = FULL;
-		else
+			http11 = strstr(buffer, "HTTP/1.1") != nullptr;
+		} else {
 			type = SIMPLE;
+		}
 		return 0;
 	}
 
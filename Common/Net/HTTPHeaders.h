@@ -30,6 +30,8 @@ class RequestHeader {
 		SIMPLE, FULL,
 	};
 	RequestType type = SIMPLE;
+	// HTTP/1.1 requests default to keep-alive.
+	bool http11 = false;
 	enum Method {
 		GET,
 		HEAD,
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <thread>
 #include <string_view>
 
@@ -51,7 +52,7 @@ class HTTPSRequest : public Request {
 	int resultCode_ = 0;
 	bool completed_ = false;
 	bool failed_ = false;
-	bool cancelled_ = false;
+	std::atomic<bool> cancelled_{};
 	bool joined_ = false;
 
 	// Naett state
@@ -24,12 +24,22 @@
 
 #endif
 
+#if PPSSPP_PLATFORM(LINUX)
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#endif
+
 #if PPSSPP_PLATFORM(UWP)
 #define in6addr_any IN6ADDR_ANY_INIT
 #endif
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <set>
 
 #include <cstdio>
 #include <cstdlib>
@@ -39,12 +49,16 @@
 #include "Common/Net/NetBuffer.h"
 #include "Common/Net/Sinks.h"
 #include "Common/File/FileDescriptor.h"
+#include "Common/File/FileUtil.h"
+#include "Common/File/Path.h"
+#include "Common/Thread/ThreadUtil.h"
 
 #include "Common/Buffer.h"
 #include "Common/Log.h"
 
 
 void NewThreadExecutor::Run(std::function<void()> func) {
+	std::lock_guard<std::mutex> guard(lock_);
 	threads_.push_back(std::thread(func));
 }
 
@@ -60,10 +74,46 @@ namespace http {
 // Note: charset here helps prevent XSS.
 const char *const DEFAULT_MIME_TYPE = "text/html; charset=utf-8";
 
-ServerRequest::ServerRequest(int fd)
-	: fd_(fd) {
+// Handlers run on this many threads when using the event loop.  Data transfer doesn't count.
+static const int EVENT_WORKER_COUNT = 4;
+static const int MAX_EVENTS_PER_SLICE = 64;
+// Idle keep-alive connections are closed after this many seconds.
+static const double KEEPALIVE_TIMEOUT = 30.0;
+// Max bytes sent to one connection before giving the others a turn.
+static const int64_t SEND_SLICE_BYTES = 4 * 1024 * 1024;
+// Requests with a larger header are dropped by the event loop.  Must fit in an InputSink.
+static const size_t MAX_HEADER_BYTES = 16 * 1024;
+
+#if PPSSPP_PLATFORM(LINUX)
+// Returns bytes sent, 0 if the socket would block, or -1 on error.
+static int64_t SendFileChunk(int sock, int fileFD, int64_t *offset, int64_t count) {
+	off64_t off = (off64_t)*offset;
+	ssize_t sent = sendfile64(sock, fileFD, &off, (size_t)count);
+	if (sent < 0 && (errno == EINVAL || errno == ENOSYS)) {
+		// Some files (like those from content providers) can't be used with sendfile.
+		char buf[16384];
+		ssize_t readBytes = pread64(fileFD, buf, (size_t)std::min(count, (int64_t)sizeof(buf)), (off64_t)*offset);
+		if (readBytes <= 0)
+			return -1;
+		sent = send(sock, buf, readBytes, MSG_NOSIGNAL);
+	}
+
+	if (sent < 0)
+		return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+	// The file ended before the range did.
+	if (sent == 0)
+		return -1;
+	*offset += sent;
+	return sent;
+}
+#endif
+
+ServerRequest::ServerRequest(int fd, bool fromEventLoop, const std::string &alreadyRead)
+	: fd_(fd), fromEventLoop_(fromEventLoop) {
 	in_ = new net::InputSink(fd);
 	out_ = new net::OutputSink(fd);
+	if (!alreadyRead.empty())
+		in_->Prefill(alreadyRead.data(), alreadyRead.size());
 	header_.ParseHeaders(in_);
 
 	if (header_.ok) {
@@ -75,6 +125,10 @@ ServerRequest::ServerRequest(int fd)
 
 ServerRequest::~ServerRequest() {
 	Close();
+#if PPSSPP_PLATFORM(LINUX)
+	if (pendingFileFD_ >= 0)
+		close(pendingFileFD_);
+#endif
 
 	if (!in_->Empty()) {
 		ERROR_LOG(IO, "Input not empty - invalid request?");
@@ -112,7 +166,9 @@ void ServerRequest::WriteHttpResponseHeader(const char *ver, int status, int64_t
 	buffer->Push("Server: PPSSPPServer v0.1\r\n");
 	if (!mimeType || strcmp(mimeType, "websocket") != 0) {
 		buffer->Printf("Content-Type: %s\r\n", mimeType ? mimeType : DEFAULT_MIME_TYPE);
-		buffer->Push("Connection: close\r\n");
+		// Without a length, the client can only find the end of the body when we close.
+		keepAlive_ = size >= 0 && WantsKeepAlive();
+		buffer->Push(keepAlive_ ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
 	}
 	if (size >= 0) {
 		buffer->Printf("Content-Length: %llu\r\n", size);
@@ -123,6 +179,87 @@ void ServerRequest::WriteHttpResponseHeader(const char *ver, int status, int64_t
 	buffer->Push("\r\n");
 }
 
+bool ServerRequest::WantsKeepAlive() const {
+	if (!fromEventLoop_ || header_.type != RequestHeader::FULL)
+		return false;
+
+	std::string connection;
+	if (header_.GetOther("connection", &connection)) {
+		std::transform(connection.begin(), connection.end(), connection.begin(), tolower);
+		if (connection.find("close") != connection.npos)
+			return false;
+		if (connection.find("keep-alive") != connection.npos)
+			return true;
+	}
+	return header_.http11;
+}
+
+bool ServerRequest::SendFileRange(const Path &filename, int64_t offset, int64_t length) const {
+#if PPSSPP_PLATFORM(LINUX)
+	int fileFD;
+	if (filename.Type() == PathType::CONTENT_URI) {
+		fileFD = File::OpenFD(filename, File::OPEN_READ);
+	} else {
+		fileFD = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	}
+	if (fileFD < 0) {
+		ERROR_LOG(IO, "Unable to open %s to send range", filename.c_str());
+		keepAlive_ = false;
+		return false;
+	}
+
+	if (fromEventLoop_) {
+		// The server loop sends this after the handler returns, without tying up a worker.
+		pendingFileFD_ = fileFD;
+		pendingFileOffset_ = offset;
+		pendingFileLength_ = length;
+		return true;
+	}
+
+	bool success = out_->Flush();
+	while (success && length > 0) {
+		int64_t sent = SendFileChunk(fd_, fileFD, &offset, length);
+		if (sent == 0) {
+			success = fd_util::WaitUntilReady(fd_, 5.0, true);
+		} else if (sent < 0) {
+			success = false;
+		} else {
+			length -= sent;
+		}
+	}
+	close(fileFD);
+#else
+	FILE *fp = File::OpenCFile(filename, "rb");
+	if (!fp || fseek(fp, offset, SEEK_SET) != 0) {
+		ERROR_LOG(IO, "Unable to open %s to send range", filename.c_str());
+		if (fp) {
+			fclose(fp);
+		}
+		keepAlive_ = false;
+		return false;
+	}
+
+	const size_t CHUNK_SIZE = 16 * 1024;
+	char *buf = new char[CHUNK_SIZE];
+	bool success = true;
+	for (int64_t pos = 0; pos < length; pos += CHUNK_SIZE) {
+		int64_t chunklen = std::min(length - pos, (int64_t)CHUNK_SIZE);
+		if (fread(buf, chunklen, 1, fp) != 1) {
+			success = false;
+			break;
+		}
+		out_->Push(buf, chunklen);
+	}
+	fclose(fp);
+	delete[] buf;
+	success = out_->Flush() && success;
+#endif
+
+	if (!success)
+		keepAlive_ = false;
+	return success;
+}
+
 void ServerRequest::WritePartial() const {
 	_assert_(fd_);
 	out_->Flush();
@@ -148,6 +285,7 @@ Server::Server(NewThreadExecutor *executor)
 }
 
 Server::~Server() {
+	StopEventLoop();
 	delete executor_;
 }
 
@@ -167,6 +305,9 @@ bool Server::Listen(int port, net::DNSType type) {
 	if (!success && (type == net::DNSType::ANY || type == net::DNSType::IPV4)) {
 		success = Listen4(port);
 	}
+	if (success && !StartEventLoop()) {
+		INFO_LOG(IO, "HTTP server using a thread per connection");
+	}
 	return success;
 }
 
@@ -276,6 +417,9 @@ bool Server::RunSlice(double timeout) {
 	if (timeout <= 0.0) {
 		timeout = 86400.0;
 	}
+	if (events_) {
+		return RunEventSlice(timeout);
+	}
 	if (!fd_util::WaitUntilReady(listener_, timeout, false)) {
 		return false;
 	}
@@ -313,6 +457,7 @@ bool Server::Run(int port) {
 }
 
 void Server::Stop() {
+	StopEventLoop();
 	closesocket(listener_);
 }
 
@@ -331,6 +476,366 @@ void Server::HandleConnection(int conn_fd) {
 	request.Write();
 }
 
+#if PPSSPP_PLATFORM(LINUX)
+
+struct Server::EventConnection {
+	int fd;
+	bool registered = false;
+	// Set when handed back to the loop, so whoever picks it up sees the previous owner's writes.
+	std::atomic<bool> armed{};
+	// Protected by the event loop lock.  Idle connections are waiting for another request.
+	bool idle = false;
+	double lastActive = 0.0;
+
+	// Owned by whoever is handling the connection (a worker, or the loop while reading or sending.)
+	// Bytes of the next request, collected until the header is complete.
+	std::string pending;
+	int fileFD = -1;
+	int64_t fileOffset = 0;
+	int64_t fileRemaining = 0;
+	bool keepAlive = false;
+};
+
+struct Server::EventLoop {
+	int epollFD = -1;
+	std::vector<std::thread> workers;
+
+	std::mutex lock;
+	std::condition_variable workCond;
+	std::deque<EventConnection *> work;
+	std::set<EventConnection *> connections;
+	bool stopping = false;
+
+	double lastIdleCheck = 0.0;
+};
+
+bool Server::StartEventLoop() {
+	if (events_)
+		return true;
+
+	int epollFD = epoll_create1(EPOLL_CLOEXEC);
+	if (epollFD < 0) {
+		WARN_LOG(IO, "Unable to create epoll instance: %d", errno);
+		return false;
+	}
+
+	epoll_event ev{};
+	ev.events = EPOLLIN;
+	ev.data.ptr = nullptr;
+	if (epoll_ctl(epollFD, EPOLL_CTL_ADD, listener_, &ev) < 0) {
+		WARN_LOG(IO, "Unable to watch listener: %d", errno);
+		close(epollFD);
+		return false;
+	}
+
+	events_ = new EventLoop();
+	events_->epollFD = epollFD;
+	for (int i = 0; i < EVENT_WORKER_COUNT; ++i) {
+		events_->workers.push_back(std::thread(std::bind(&Server::EventWorkerLoop, this)));
+	}
+	return true;
+}
+
+void Server::StopEventLoop() {
+	if (!events_)
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(events_->lock);
+		events_->stopping = true;
+	}
+	events_->workCond.notify_all();
+	for (auto &thread : events_->workers)
+		thread.join();
+
+	// Nothing else can touch the connections now, including those still queued.
+	for (EventConnection *conn : events_->connections) {
+		if (conn->fileFD >= 0)
+			close(conn->fileFD);
+		closesocket(conn->fd);
+		delete conn;
+	}
+	close(events_->epollFD);
+	delete events_;
+	events_ = nullptr;
+}
+
+bool Server::RunEventSlice(double timeout) {
+	epoll_event events[MAX_EVENTS_PER_SLICE];
+	int count = epoll_wait(events_->epollFD, events, MAX_EVENTS_PER_SLICE, (int)(timeout * 1000.0));
+	if (count < 0) {
+		if (errno != EINTR)
+			ERROR_LOG(IO, "epoll_wait failed: %d", errno);
+		return false;
+	}
+
+	for (int i = 0; i < count; ++i) {
+		EventConnection *conn = (EventConnection *)events[i].data.ptr;
+		if (!conn) {
+			AcceptEventConnections();
+			continue;
+		}
+		// Pairs with the release in ArmEventConnection(), since epoll doesn't order memory for us.
+		conn->armed.exchange(false, std::memory_order_acquire);
+
+		if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+			CloseEventConnection(conn);
+		} else if (conn->fileFD >= 0) {
+			ContinueSending(conn);
+		} else {
+			ContinueReading(conn);
+		}
+	}
+
+	CloseIdleEventConnections();
+	return count > 0;
+}
+
+void Server::AcceptEventConnections() {
+	while (true) {
+		int conn_fd = accept(listener_, nullptr, nullptr);
+		if (conn_fd < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				ERROR_LOG(IO, "socket accept failed: %d", errno);
+			break;
+		}
+
+		fd_util::SetNonBlocking(conn_fd, true);
+		EventConnection *conn = new EventConnection();
+		conn->fd = conn_fd;
+		{
+			std::lock_guard<std::mutex> guard(events_->lock);
+			events_->connections.insert(conn);
+		}
+		ArmEventConnection(conn, false);
+	}
+}
+
+// Whether buf holds a whole request header, by the same rules as RequestHeader::ParseHeaders().
+static bool IsHeaderComplete(const std::string &buf) {
+	size_t firstLine = buf.find('\n');
+	if (firstLine == buf.npos)
+		return false;
+	// Simple requests are only the request line.
+	if (buf.substr(0, firstLine).find("HTTP/") == buf.npos)
+		return true;
+	return buf.find("\n\n", firstLine) != buf.npos || buf.find("\n\r\n", firstLine) != buf.npos;
+}
+
+void Server::ContinueReading(EventConnection *conn) {
+	// Collect the header here, so workers never wait on a slow client.
+	char buf[4096];
+	while (!IsHeaderComplete(conn->pending)) {
+		if (conn->pending.size() >= MAX_HEADER_BYTES) {
+			WARN_LOG(IO, "Request header too large, closing connection.");
+			CloseEventConnection(conn);
+			return;
+		}
+
+		size_t wanted = std::min(sizeof(buf), MAX_HEADER_BYTES - conn->pending.size());
+		ssize_t received = recv(conn->fd, buf, wanted, 0);
+		if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			ArmEventConnection(conn, false);
+			return;
+		} else if (received <= 0) {
+			// The client closed the connection (possibly a kept alive one), or it failed.
+			CloseEventConnection(conn);
+			return;
+		}
+		conn->pending.append(buf, received);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(events_->lock);
+		conn->idle = false;
+		events_->work.push_back(conn);
+	}
+	events_->workCond.notify_one();
+}
+
+void Server::EventWorkerLoop() {
+	SetCurrentThreadName("HTTPWorker");
+
+	while (true) {
+		EventConnection *conn;
+		{
+			std::unique_lock<std::mutex> guard(events_->lock);
+			events_->workCond.wait(guard, [&] { return events_->stopping || !events_->work.empty(); });
+			if (events_->stopping)
+				return;
+			conn = events_->work.front();
+			events_->work.pop_front();
+		}
+		HandleEventConnection(conn);
+	}
+}
+
+void Server::HandleEventConnection(EventConnection *conn) {
+	// The loop already read the whole header, so this won't block.
+	ServerRequest *request = new ServerRequest(conn->fd, true, conn->pending);
+	conn->pending.clear();
+	if (!request->IsOK()) {
+		WARN_LOG(IO, "Bad request, ignoring.");
+		// The request already closed the socket.
+		conn->fd = -1;
+		delete request;
+		CloseEventConnection(conn);
+		return;
+	}
+
+	std::string upgrade;
+	if (request->GetHeader("upgrade", &upgrade)) {
+		// Upgraded connections (like websockets) stay open for a long time, so they get their own thread.
+		// The sinks expect the socket to stay non-blocking, so leave it that way.
+		epoll_ctl(events_->epollFD, EPOLL_CTL_DEL, conn->fd, nullptr);
+		request->fromEventLoop_ = false;
+		conn->fd = -1;
+		CloseEventConnection(conn);
+
+		executor_->Run([this, request] {
+			HandleRequest(*request);
+			request->Write();
+			delete request;
+		});
+		return;
+	}
+
+	HandleRequest(*request);
+	request->WritePartial();
+
+	// If anything is left unread or unsent, we can't safely reuse the connection.
+	if (!request->Out()->Empty()) {
+		conn->fd = -1;
+		delete request;
+		CloseEventConnection(conn);
+		return;
+	}
+	conn->keepAlive = request->keepAlive_ && request->In()->Empty();
+	if (request->pendingFileFD_ >= 0) {
+		conn->fileFD = request->pendingFileFD_;
+		conn->fileOffset = request->pendingFileOffset_;
+		conn->fileRemaining = request->pendingFileLength_;
+		request->pendingFileFD_ = -1;
+	}
+	// We keep the socket, it's ours to close.
+	request->fd_ = 0;
+	delete request;
+
+	if (conn->fileFD >= 0) {
+		ArmEventConnection(conn, true);
+	} else if (conn->keepAlive) {
+		ArmEventConnection(conn, false);
+	} else {
+		CloseEventConnection(conn);
+	}
+}
+
+void Server::ContinueSending(EventConnection *conn) {
+	int64_t budget = SEND_SLICE_BYTES;
+	while (conn->fileRemaining > 0 && budget > 0) {
+		int64_t sent = SendFileChunk(conn->fd, conn->fileFD, &conn->fileOffset, std::min(conn->fileRemaining, budget));
+		if (sent < 0) {
+			CloseEventConnection(conn);
+			return;
+		} else if (sent == 0) {
+			break;
+		}
+		conn->fileRemaining -= sent;
+		budget -= sent;
+	}
+
+	if (conn->fileRemaining > 0) {
+		ArmEventConnection(conn, true);
+		return;
+	}
+
+	close(conn->fileFD);
+	conn->fileFD = -1;
+	if (conn->keepAlive) {
+		ArmEventConnection(conn, false);
+	} else {
+		CloseEventConnection(conn);
+	}
+}
+
+void Server::ArmEventConnection(EventConnection *conn, bool forWrite) {
+	epoll_event ev{};
+	ev.events = (forWrite ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+	ev.data.ptr = conn;
+
+	int result;
+	{
+		// Once armed, the loop may hand the connection to another thread, so don't touch it after.
+		std::lock_guard<std::mutex> guard(events_->lock);
+		conn->idle = !forWrite;
+		if (!forWrite)
+			conn->lastActive = time_now_d();
+		conn->armed.store(true, std::memory_order_release);
+		result = epoll_ctl(events_->epollFD, conn->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, conn->fd, &ev);
+		if (result == 0)
+			conn->registered = true;
+		else
+			conn->idle = false;
+	}
+
+	if (result < 0) {
+		ERROR_LOG(IO, "Unable to watch connection: %d", errno);
+		CloseEventConnection(conn);
+	}
+}
+
+void Server::CloseEventConnection(EventConnection *conn) {
+	{
+		std::lock_guard<std::mutex> guard(events_->lock);
+		events_->connections.erase(conn);
+	}
+
+	if (conn->fileFD >= 0)
+		close(conn->fileFD);
+	// This also removes it from the epoll set.
+	if (conn->fd >= 0)
+		closesocket(conn->fd);
+	delete conn;
+}
+
+void Server::CloseIdleEventConnections() {
+	double now = time_now_d();
+	if (now < events_->lastIdleCheck + 1.0)
+		return;
+	events_->lastIdleCheck = now;
+
+	// Idle connections are only handed out by this thread, so they can't go busy under us.
+	std::vector<EventConnection *> expired;
+	{
+		std::lock_guard<std::mutex> guard(events_->lock);
+		for (EventConnection *conn : events_->connections) {
+			if (conn->idle && now > conn->lastActive + KEEPALIVE_TIMEOUT)
+				expired.push_back(conn);
+		}
+	}
+
+	for (EventConnection *conn : expired) {
+		CloseEventConnection(conn);
+	}
+}
+
+#else
+
+struct Server::EventLoop {};
+
+bool Server::StartEventLoop() {
+	return false;
+}
+
+void Server::StopEventLoop() {
+}
+
+bool Server::RunEventSlice(double timeout) {
+	return false;
+}
+
+#endif
+
 void Server::HandleRequest(const ServerRequest &request) {
 	HandleRequestDefault(request);
 }
@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <map>
+#include <mutex>
 #include <thread>
 
 #include "Common/Net/HTTPHeaders.h"
@@ -13,9 +14,12 @@ class NewThreadExecutor {
 	void Run(std::function<void()> func);
 
 private:
+	std::mutex lock_;
 	std::vector<std::thread> threads_;
 };
 
+class Path;
+
 namespace net {
 
 class InputSink;
@@ -27,7 +31,9 @@ namespace http {
 
 class ServerRequest {
 public:
-	ServerRequest(int fd);
+	// If fromEventLoop is set, the connection may be kept alive, and file ranges are sent by the server loop.
+	// alreadyRead holds request bytes the caller has already taken from the socket, if any.
+	ServerRequest(int fd, bool fromEventLoop = false, const std::string &alreadyRead = std::string());
 	~ServerRequest();
 
 	const char *resource() const {
@@ -61,11 +67,27 @@ class ServerRequest {
 	// If size is negative, no Content-Length: line is written.
 	void WriteHttpResponseHeader(const char *ver, int status, int64_t size = -1, const char *mimeType = nullptr, const char *otherHeaders = nullptr) const;
 
+	// Sends part of a file as the body, after the response header.  Avoids copying through
+	// userspace where the platform allows (sendfile.)  Must be the last thing written.
+	// Returns false if the file couldn't be opened, in which case the connection is closed.
+	bool SendFileRange(const Path &filename, int64_t offset, int64_t length) const;
+
 private:
+	friend class Server;
+
+	bool WantsKeepAlive() const;
+
 	net::InputSink *in_;
 	net::OutputSink *out_;
 	RequestHeader header_;
 	int fd_;
+	bool fromEventLoop_;
+	mutable bool keepAlive_ = false;
+
+	// Set by SendFileRange when the server loop is going to send the body.
+	mutable int pendingFileFD_ = -1;
+	mutable int64_t pendingFileOffset_ = 0;
+	mutable int64_t pendingFileLength_ = 0;
 };
 
 // Register handlers on this class to serve stuff.
@@ -106,6 +128,22 @@ class Server {
 
 	void HandleConnection(int conn_fd);
 
+	// Where supported, connections are kept alive and multiplexed on the RunSlice() thread,
+	// with handlers running on a small fixed set of worker threads.
+	struct EventLoop;
+	struct EventConnection;
+	bool StartEventLoop();
+	void StopEventLoop();
+	bool RunEventSlice(double timeout);
+	void AcceptEventConnections();
+	void EventWorkerLoop();
+	void HandleEventConnection(EventConnection *conn);
+	void ContinueReading(EventConnection *conn);
+	void ContinueSending(EventConnection *conn);
+	void ArmEventConnection(EventConnection *conn, bool forWrite);
+	void CloseEventConnection(EventConnection *conn);
+	void CloseIdleEventConnections();
+
 	// Things like default 404, etc.
 	void HandleRequestDefault(const ServerRequest &request);
 
@@ -120,6 +158,7 @@ class Server {
 	UrlHandlerFunc fallback_;
 
 	NewThreadExecutor *executor_;
+	EventLoop *events_ = nullptr;
 };
 
 }  // namespace http
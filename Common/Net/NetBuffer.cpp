@@ -34,7 +34,7 @@ void RequestProgress::Update(int64_t downloaded, int64_t totalBytes, bool done)
 	}
 }
 
-bool Buffer::FlushSocket(uintptr_t sock, double timeout, bool *cancelled) {
+bool Buffer::FlushSocket(uintptr_t sock, double timeout, std::atomic<bool> *cancelled) {
 	static constexpr float CANCEL_INTERVAL = 0.25f;
 	for (size_t pos = 0, end = data_.size(); pos < end; ) {
 		bool ready = false;
@@ -112,6 +112,47 @@ bool Buffer::ReadAllWithProgress(int fd, int knownSize, RequestProgress *progres
 	return true;
 }
 
+bool Buffer::ReadExactWithProgress(int fd, size_t totalSize, RequestProgress *progress) {
+	static constexpr float CANCEL_INTERVAL = 0.25f;
+	std::vector<char> buf;
+	buf.resize(std::min(totalSize, (size_t)65536));
+
+	double st = time_now_d();
+	size_t startSize = size();
+	while (size() < totalSize) {
+		bool ready = false;
+		while (!ready) {
+			if (progress && progress->cancelled && *progress->cancelled)
+				return false;
+			ready = fd_util::WaitUntilReady(fd, CANCEL_INTERVAL, false);
+		}
+
+		size_t wanted = std::min(totalSize - size(), buf.size());
+		int retval = recv(fd, &buf[0], (int)wanted, MSG_NOSIGNAL);
+		if (retval == 0) {
+			ERROR_LOG(IO, "Connection closed with %d bytes left to read", (int)(totalSize - size()));
+			return false;
+		} else if (retval < 0) {
+#if PPSSPP_PLATFORM(WINDOWS)
+			if (WSAGetLastError() != WSAEWOULDBLOCK) {
+#else
+			if (errno != EWOULDBLOCK && errno != EAGAIN) {
+#endif
+				ERROR_LOG(IO, "Error reading from buffer: %i", retval);
+				return false;
+			}
+			continue;
+		}
+		char *p = Append((size_t)retval);
+		memcpy(p, &buf[0], retval);
+		if (progress) {
+			progress->Update(size() - startSize, totalSize - startSize, false);
+			progress->kBps = (float)((size() - startSize) / (time_now_d() - st)) / 1024.0f;
+		}
+	}
+	return true;
+}
+
 int Buffer::Read(int fd, size_t sz) {
 	char buf[1024];
 	int retval;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 
@@ -9,21 +10,23 @@ namespace net {
 
 class RequestProgress {
 public:
-	explicit RequestProgress(bool *c) : cancelled(c) {}
+	explicit RequestProgress(std::atomic<bool> *c) : cancelled(c) {}
 
 	void Update(int64_t downloaded, int64_t totalBytes, bool done);
 
 	float progress = 0.0f;
 	float kBps = 0.0f;
-	bool *cancelled = nullptr;
+	std::atomic<bool> *cancelled = nullptr;
 	std::function<void(int64_t, int64_t, bool)> callback;
 };
 
 class Buffer : public ::Buffer {
 public:
-	bool FlushSocket(uintptr_t sock, double timeout, bool *cancelled = nullptr);
+	bool FlushSocket(uintptr_t sock, double timeout, std::atomic<bool> *cancelled = nullptr);
 
 	bool ReadAllWithProgress(int fd, int knownSize, RequestProgress *progress);
+	// Reads until the buffer holds totalSize bytes, without waiting for the connection to close.
+	bool ReadExactWithProgress(int fd, size_t totalSize, RequestProgress *progress);
 
 	// < 0: error
 	// >= 0: number of bytes read
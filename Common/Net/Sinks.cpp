@@ -229,6 +229,17 @@ bool InputSink::TryFill() {
 	return !Empty();
 }
 
+bool InputSink::Prefill(const char *buf, size_t bytes) {
+	if (bytes > BUFFER_SIZE - valid_)
+		return false;
+
+	size_t chunk1 = std::min(bytes, BUFFER_SIZE - write_);
+	memcpy(buf_ + write_, buf, chunk1);
+	memcpy(buf_, buf + chunk1, bytes - chunk1);
+	AccountFill((int)bytes);
+	return true;
+}
+
 OutputSink::OutputSink(size_t fd) : fd_(fd), read_(0), write_(0), valid_(0) {
 	fd_util::SetNonBlocking((int)fd_, true);
 }
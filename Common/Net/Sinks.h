@@ -23,6 +23,8 @@ class InputSink {
 
 	bool Empty() const;
 	bool TryFill();
+	// Adds bytes that were already read from the socket elsewhere.  Fails if they don't fit.
+	bool Prefill(const char *buf, size_t bytes);
 
 private:
 	void Fill();
@@ -16,6 +16,7 @@
 #endif
 
 #include "Common/Data/Encoding/Base64.h"
+#include "Common/Data/Encoding/Compression.h"
 #include "Common/Net/HTTPServer.h"
 #include "Common/Net/Sinks.h"
 #include "Common/Net/WebsocketServer.h"
@@ -128,19 +129,37 @@ WebSocketServer *WebSocketServer::CreateAsUpgrade(const http::ServerRequest &req
 void WebSocketServer::Send(const std::string &str) {
 	_assert_(open_);
 	_assert_(fragmentOpcode_ == -1);
+	if (batching_) {
+		BatchAppend(true, true, BatchRecordType::TEXT, str.c_str(), str.size());
+		return;
+	}
 	SendHeader(true, (int)Opcode::TEXT, str.size());
 	SendBytes(str.c_str(), str.size());
 }
 
 void WebSocketServer::Send(const std::vector<uint8_t> &payload) {
+	Send(payload.data(), payload.size());
+}
+
+void WebSocketServer::Send(const void *data, size_t sz) {
 	_assert_(open_);
 	_assert_(fragmentOpcode_ == -1);
-	SendHeader(true, (int)Opcode::BINARY, payload.size());
-	SendBytes((const char *)&payload[0], payload.size());
+	if (batching_) {
+		BatchAppend(true, true, BatchRecordType::BINARY, data, sz);
+		return;
+	}
+	SendHeader(true, (int)Opcode::BINARY, sz);
+	SendBytes(data, sz);
 }
 
 void WebSocketServer::AddFragment(bool finish, const std::string &str) {
 	_assert_(open_);
+	if (batching_) {
+		_assert_(fragmentOpcode_ == (int)Opcode::TEXT || fragmentOpcode_ == -1);
+		BatchAppend(fragmentOpcode_ == -1, finish, BatchRecordType::TEXT, str.c_str(), str.size());
+		fragmentOpcode_ = finish ? -1 : (int)Opcode::TEXT;
+		return;
+	}
 	if (fragmentOpcode_ == -1) {
 		SendHeader(finish, (int)Opcode::TEXT, str.size());
 		fragmentOpcode_ = (int)Opcode::TEXT;
@@ -157,6 +176,12 @@ void WebSocketServer::AddFragment(bool finish, const std::string &str) {
 
 void WebSocketServer::AddFragment(bool finish, const std::vector<uint8_t> &payload) {
 	_assert_(open_);
+	if (batching_) {
+		_assert_(fragmentOpcode_ == (int)Opcode::BINARY || fragmentOpcode_ == -1);
+		BatchAppend(fragmentOpcode_ == -1, finish, BatchRecordType::BINARY, payload.data(), payload.size());
+		fragmentOpcode_ = finish ? -1 : (int)Opcode::BINARY;
+		return;
+	}
 	if (fragmentOpcode_ == -1) {
 		SendHeader(finish, (int)Opcode::BINARY, payload.size());
 		fragmentOpcode_ = (int)Opcode::BINARY;
@@ -171,6 +196,91 @@ void WebSocketServer::AddFragment(bool finish, const std::vector<uint8_t> &paylo
 	}
 }
 
+void WebSocketServer::BeginBatch() {
+	_assert_(!batching_);
+	_assert_(fragmentOpcode_ == -1);
+	batching_ = true;
+	batchBuf_.clear();
+}
+
+void WebSocketServer::EndBatch(bool compress) {
+	_assert_(batching_);
+	_assert_(fragmentOpcode_ == -1);
+	batching_ = false;
+	if (batchBuf_.empty() || !open_)
+		return;
+
+	uint8_t flags = 0;
+	std::string deflated;
+	if (compress && compress_string(std::string((const char *)batchBuf_.data(), batchBuf_.size()), &deflated, 1) && deflated.size() < batchBuf_.size()) {
+		flags |= BATCH_FLAG_ZLIB;
+	}
+
+	const void *data = flags & BATCH_FLAG_ZLIB ? (const void *)deflated.data() : (const void *)batchBuf_.data();
+	size_t sz = flags & BATCH_FLAG_ZLIB ? deflated.size() : batchBuf_.size();
+	SendHeader(true, (int)Opcode::BINARY, 1 + sz);
+	SendBytes(&flags, 1);
+	SendBytes(data, sz);
+	batchBuf_.clear();
+}
+
+void WebSocketServer::BatchAppend(bool start, bool finish, BatchRecordType type, const void *p, size_t sz) {
+	if (start) {
+		batchBuf_.push_back((uint8_t)type);
+		batchRecordPos_ = batchBuf_.size();
+		batchBuf_.resize(batchRecordPos_ + 4);
+	}
+
+	const uint8_t *data = (const uint8_t *)p;
+	batchBuf_.insert(batchBuf_.end(), data, data + sz);
+
+	if (finish) {
+		size_t len = batchBuf_.size() - batchRecordPos_ - 4;
+		_assert_(len <= 0xFFFFFFFF);
+		for (int i = 0; i < 4; ++i)
+			batchBuf_[batchRecordPos_ + i] = (uint8_t)(len >> (i * 8));
+	}
+}
+
+// Way more than any reasonable batch of requests, but stops a tiny deflated message from eating all memory.
+static const size_t BATCH_MAX_INFLATED_SIZE = 64 * 1024 * 1024;
+
+bool WebSocketServer::ParseBatch(const std::vector<uint8_t> &payload, std::vector<std::pair<BatchRecordType, std::string>> *records) {
+	if (payload.empty())
+		return false;
+
+	std::string inflated;
+	const uint8_t *p = payload.data() + 1;
+	size_t left = payload.size() - 1;
+	if (payload[0] & BATCH_FLAG_ZLIB) {
+		if (!decompress_string(std::string((const char *)p, left), &inflated, BATCH_MAX_INFLATED_SIZE))
+			return false;
+		p = (const uint8_t *)inflated.data();
+		left = inflated.size();
+	} else if (payload[0] != 0) {
+		return false;
+	}
+
+	while (left != 0) {
+		if (left < 5)
+			return false;
+		BatchRecordType type = (BatchRecordType)p[0];
+		if (type != BatchRecordType::TEXT && type != BatchRecordType::BINARY)
+			return false;
+		size_t len = (size_t)p[1] | ((size_t)p[2] << 8) | ((size_t)p[3] << 16) | ((size_t)p[4] << 24);
+		p += 5;
+		left -= 5;
+		if (len > left)
+			return false;
+
+		records->emplace_back(type, std::string((const char *)p, len));
+		p += len;
+		left -= len;
+	}
+
+	return true;
+}
+
 void WebSocketServer::Ping(const std::vector<uint8_t> &payload) {
 	_assert_(open_);
 	_assert_(payload.size() <= 125);
@@ -2,6 +2,8 @@
 
 #include <functional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "Common/Net/HTTPServer.h"
 #include "Common/Net/Sinks.h"
@@ -26,6 +28,17 @@ enum class WebSocketClose : uint16_t {
 	ABNORMAL = 1006,
 };
 
+// A batch is a binary message with a flags byte (BATCH_FLAG_*), then records, each a type byte,
+// a little endian u32 length, and that many bytes.  With BATCH_FLAG_ZLIB, the records are deflated.
+enum class BatchRecordType : uint8_t {
+	TEXT = 1,
+	BINARY = 2,
+};
+
+enum {
+	BATCH_FLAG_ZLIB = 1,
+};
+
 // RFC 6455
 class WebSocketServer {
 public:
@@ -33,12 +46,29 @@ class WebSocketServer {
 
 	void Send(const std::string &str);
 	void Send(const std::vector<uint8_t> &payload);
+	// Sends a binary message straight from the caller's memory, without an intermediate copy.
+	void Send(const void *data, size_t sz);
 
 	// Call with finish = false to start and continue, then finally with finish = true to complete.
 	// Note: Fragmented data cannot be interleaved, per protocol.
 	void AddFragment(bool finish, const std::string &str);
 	void AddFragment(bool finish, const std::vector<uint8_t> &payload);
 
+	// While batching, messages are packed into a single binary message instead of being sent
+	// individually.  See BatchRecordType for the layout.  Optionally zlib compressed.
+	void BeginBatch();
+	void EndBatch(bool compress = false);
+	bool IsBatching() const {
+		return batching_;
+	}
+	// Parses a batch (in the same layout) into its records.  Returns false if malformed.
+	static bool ParseBatch(const std::vector<uint8_t> &payload, std::vector<std::pair<BatchRecordType, std::string>> *records);
+
+	// Bytes queued for this socket that could not yet be pushed out.
+	size_t PendingOutput() const {
+		return outBuf_.size();
+	}
+
 	void Ping(const std::vector<uint8_t> &payload = {});
 	void Pong(const std::vector<uint8_t> &payload = {});
 	void Close(WebSocketClose reason = WebSocketClose::GOING_AWAY);
@@ -74,6 +104,7 @@ class WebSocketServer {
 	void SendHeader(bool fin, int opcode, size_t sz);
 	void SendBytes(const void *p, size_t sz);
 	void SendFlush();
+	void BatchAppend(bool start, bool finish, BatchRecordType type, const void *p, size_t sz);
 	bool ReadFrames();
 	bool ReadFrame();
 	bool ReadPending();
@@ -89,6 +120,11 @@ class WebSocketServer {
 	std::vector<uint8_t> outBuf_;
 	size_t lastPressure_ = 0;
 
+	bool batching_ = false;
+	std::vector<uint8_t> batchBuf_;
+	// Offset of the length field of the record being built from fragments.
+	size_t batchRecordPos_ = 0;
+
 	std::vector<uint8_t> pendingBuf_;
 	uint8_t pendingMask_[4]{};
 	// Bytes left to read in the frame (in case of a partial frame read.)
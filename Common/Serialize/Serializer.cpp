@@ -15,6 +15,8 @@
 // Official SVN repository and contact information can be found at
 // http://code.google.com/p/dolphin-emu/
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <snappy-c.h>
@@ -24,6 +26,8 @@
 #include "Common/Serialize/SerializeFuncs.h"
 #include "Common/File/FileUtil.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ParallelLoop.h"
+#include "Common/TimeUtil.h"
 
 enum class SerializeCompressType {
 	NONE = 0,
@@ -33,6 +37,109 @@ enum class SerializeCompressType {
 
 static constexpr SerializeCompressType SAVE_TYPE = SerializeCompressType::ZSTD;
 
+// States are compressed as a series of independent zstd frames, so both compression and
+// decompression can be spread over threads.  Concatenated frames are still a valid zstd stream,
+// so older versions load these states fine.
+static constexpr size_t ZSTD_FRAME_SIZE = 4 * 1024 * 1024;
+
+static void ForEachFrame(size_t count, const std::function<void(int, int)> &loop) {
+	// The thread manager might not be running, for example in tools.
+	if (g_threadManager.IsInitialized())
+		ParallelRangeLoop(&g_threadManager, loop, 0, (int)count, 1);
+	else
+		loop(0, (int)count);
+}
+
+struct CompressedFrame {
+	size_t offset;
+	size_t size;
+};
+
+static size_t ZstdFrameCount(size_t sz) {
+	return std::max((size_t)1, (sz + ZSTD_FRAME_SIZE - 1) / ZSTD_FRAME_SIZE);
+}
+
+// Each frame compresses into its own slot of the output buffer, sized for the worst case.
+static size_t ZstdFramesBound(size_t sz) {
+	size_t count = ZstdFrameCount(sz);
+	return (count - 1) * ZSTD_compressBound(ZSTD_FRAME_SIZE) + ZSTD_compressBound(sz - (count - 1) * ZSTD_FRAME_SIZE);
+}
+
+// dest must hold ZstdFramesBound(sz) bytes.
+static bool CompressZstdFrames(const u8 *buffer, size_t sz, u8 *dest, std::vector<CompressedFrame> *frames) {
+	const size_t slotSize = ZSTD_compressBound(ZSTD_FRAME_SIZE);
+	frames->resize(ZstdFrameCount(sz));
+	std::atomic<bool> success(true);
+	ForEachFrame(frames->size(), [&](int l, int h) {
+		ZSTD_CCtx *ctx = ZSTD_createCCtx();
+		if (!ctx) {
+			success = false;
+			return;
+		}
+		// TODO: If free disk space is low, we could max this out to 22?
+		ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT);
+		ZSTD_CCtx_setParameter(ctx, ZSTD_c_checksumFlag, 1);
+		for (int i = l; i < h && success; ++i) {
+			size_t offset = (size_t)i * ZSTD_FRAME_SIZE;
+			size_t len = std::min(ZSTD_FRAME_SIZE, sz - offset);
+			CompressedFrame &frame = (*frames)[i];
+			frame.offset = (size_t)i * slotSize;
+			frame.size = ZSTD_compress2(ctx, dest + frame.offset, ZSTD_compressBound(len), buffer + offset, len);
+			if (ZSTD_isError(frame.size))
+				success = false;
+		}
+		ZSTD_freeCCtx(ctx);
+	});
+	return success;
+}
+
+size_t CChunkFileReader::DecompressZstdFrames(u8 *dest, size_t destSize, const u8 *src, size_t sz) {
+	struct Frame {
+		size_t offset;
+		size_t size;
+		size_t destOffset;
+		size_t destSize;
+	};
+
+	// Find the frames first.  States from older versions are a single frame.
+	std::vector<Frame> frames;
+	size_t offset = 0;
+	size_t destOffset = 0;
+	while (offset < sz) {
+		size_t frameSize = ZSTD_findFrameCompressedSize(src + offset, sz - offset);
+		unsigned long long contentSize = ZSTD_isError(frameSize) ? ZSTD_CONTENTSIZE_ERROR : ZSTD_getFrameContentSize(src + offset, frameSize);
+		if (contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize > destSize - destOffset) {
+			ERROR_LOG(SAVESTATE, "ChunkReader: Bad zstd frame at %d", (int)offset);
+			return 0;
+		}
+		if (contentSize == ZSTD_CONTENTSIZE_UNKNOWN) {
+			// Can't split this up, so just decompress it all in one go.
+			size_t status = ZSTD_decompress(dest, destSize, src, sz);
+			return ZSTD_isError(status) ? 0 : status;
+		}
+		frames.push_back(Frame{ offset, frameSize, destOffset, (size_t)contentSize });
+		offset += frameSize;
+		destOffset += (size_t)contentSize;
+	}
+
+	std::atomic<bool> success(true);
+	ForEachFrame(frames.size(), [&](int l, int h) {
+		ZSTD_DCtx *ctx = ZSTD_createDCtx();
+		if (!ctx) {
+			success = false;
+			return;
+		}
+		for (int i = l; i < h && success; ++i) {
+			const Frame &frame = frames[i];
+			size_t status = ZSTD_decompressDCtx(ctx, dest + frame.destOffset, frame.destSize, src + frame.offset, frame.size);
+			if (ZSTD_isError(status) || status != frame.destSize)
+				success = false;
+		}
+		ZSTD_freeDCtx(ctx);
+	});
+	return success ? destOffset : 0;
+}
+
 void PointerWrap::RewindForWrite(u8 *writePtr) {
 	_assert_(mode == MODE_MEASURE);
 	// Switch to writing mode, save the size for later checking and start again.
@@ -356,6 +463,7 @@ CChunkFileReader::Error CChunkFileReader::LoadFile(const Path &filename, std::st
 	}
 
 	// read the state
+	double startTime = time_now_d();
 	sz = header.ExpectedSize;
 	u8 *buffer = new u8[sz];
 	if (!pFile.ReadBytes(buffer, sz))
@@ -373,11 +481,10 @@ CChunkFileReader::Error CChunkFileReader::LoadFile(const Path &filename, std::st
 			auto status = snappy_uncompress((const char *)buffer, sz, (char *)uncomp_buffer, &uncomp_size);
 			success = status == SNAPPY_OK;
 		} else if (SerializeCompressType(header.Compress) == SerializeCompressType::ZSTD) {
-			size_t status = ZSTD_decompress((char *)uncomp_buffer, uncomp_size, (const char *)buffer, sz);
-			success = !ZSTD_isError(status);
-			if (success) {
-				uncomp_size = status;
-			}
+			double readTime = time_now_d();
+			uncomp_size = DecompressZstdFrames(uncomp_buffer, uncomp_size, buffer, sz);
+			success = uncomp_size != 0;
+			INFO_LOG(SAVESTATE, "ChunkReader: Read %d bytes in %0.1f ms, decompressed in %0.1f ms", (int)sz, (readTime - startTime) * 1000.0, (time_now_d() - readTime) * 1000.0);
 		} else {
 			ERROR_LOG(SAVESTATE, "ChunkReader: Unexpected compression type %d", header.Compress);
 		}
@@ -410,7 +517,7 @@ CChunkFileReader::Error CChunkFileReader::LoadFile(const Path &filename, std::st
 }
 
 // Takes ownership of buffer.
-CChunkFileReader::Error CChunkFileReader::SaveFile(const Path &filename, const std::string &title, const char *gitVersion, u8 *buffer, size_t sz) {
+CChunkFileReader::Error CChunkFileReader::SaveFile(const Path &filename, const std::string &title, const char *gitVersion, u8 *buffer, size_t sz, SaveStats *stats) {
 	INFO_LOG(SAVESTATE, "ChunkReader: Writing %s", filename.c_str());
 
 	File::IOFile pFile(filename, "wb");
@@ -420,6 +527,8 @@ CChunkFileReader::Error CChunkFileReader::SaveFile(const Path &filename, const s
 		return ERROR_BAD_FILE;
 	}
 
+	double startTime = time_now_d();
+
 	// Make sure we can allocate a buffer to compress before compressing.
 	size_t write_len;
 	SerializeCompressType usedType = SAVE_TYPE;
@@ -431,11 +540,11 @@ CChunkFileReader::Error CChunkFileReader::SaveFile(const Path &filename, const s
 		write_len = snappy_max_compressed_length(sz);
 		break;
 	case SerializeCompressType::ZSTD:
-		write_len = ZSTD_compressBound(sz);
+		write_len = ZstdFramesBound(sz);
 		break;
 	}
 	u8 *compressed_buffer = write_len == 0 ? nullptr : (u8 *)malloc(write_len);
-	u8 *write_buffer = buffer;
+	std::vector<CompressedFrame> frames;
 	if (!compressed_buffer) {
 		if (write_len != 0)
 			ERROR_LOG(SAVESTATE, "ChunkReader: Unable to allocate compressed buffer");
@@ -450,37 +559,32 @@ CChunkFileReader::Error CChunkFileReader::SaveFile(const Path &filename, const s
 			break;
 		case SerializeCompressType::SNAPPY:
 			success = snappy_compress((const char *)buffer, sz, (char *)compressed_buffer, &write_len) == SNAPPY_OK;
+			frames.push_back(CompressedFrame{ 0, write_len });
 			break;
 		case SerializeCompressType::ZSTD:
-			{
-				auto ctx = ZSTD_createCCtx();
-				if (!ctx) {
-					success = false;
-				} else {
-					// TODO: If free disk space is low, we could max this out to 22?
-					ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT);
-					ZSTD_CCtx_setParameter(ctx, ZSTD_c_checksumFlag, 1);
-					ZSTD_CCtx_setPledgedSrcSize(ctx, sz);
-					write_len = ZSTD_compress2(ctx, compressed_buffer, write_len, buffer, sz);
-					success = !ZSTD_isError(write_len);
-				}
-				ZSTD_freeCCtx(ctx);
-			}
+			success = CompressZstdFrames(buffer, sz, compressed_buffer, &frames);
 			break;
 		}
 
 		if (success) {
+			write_len = 0;
+			for (const auto &frame : frames)
+				write_len += frame.size;
+			// Don't need the uncompressed state anymore.
 			free(buffer);
-			write_buffer = compressed_buffer;
+			buffer = nullptr;
 		} else {
 			ERROR_LOG(SAVESTATE, "ChunkReader: Compression failed");
 			free(compressed_buffer);
+			compressed_buffer = nullptr;
+			frames.clear();
 
 			// We can still save uncompressed.
 			write_len = sz;
 			usedType = SerializeCompressType::NONE;
 		}
 	}
+	double compressedTime = time_now_d();
 
 	// Create header
 	SChunkHeader header{};
@@ -497,23 +601,40 @@ CChunkFileReader::Error CChunkFileReader::SaveFile(const Path &filename, const s
 	// Now let's start writing out the file...
 	if (!pFile.WriteArray(&header, 1)) {
 		ERROR_LOG(SAVESTATE, "ChunkReader: Failed writing header");
-		free(write_buffer);
+		free(buffer);
+		free(compressed_buffer);
 		return ERROR_BAD_FILE;
 	}
 	if (!pFile.WriteArray(titleFixed, sizeof(titleFixed))) {
 		ERROR_LOG(SAVESTATE, "ChunkReader: Failed writing title");
-		free(write_buffer);
+		free(buffer);
+		free(compressed_buffer);
 		return ERROR_BAD_FILE;
 	}
 
-	if (!pFile.WriteBytes(write_buffer, write_len)) {
+	bool written = true;
+	if (buffer) {
+		written = pFile.WriteBytes(buffer, write_len);
+		free(buffer);
+	} else {
+		for (const auto &frame : frames)
+			written = written && pFile.WriteBytes(compressed_buffer + frame.offset, frame.size);
+		free(compressed_buffer);
+	}
+	if (!written) {
 		ERROR_LOG(SAVESTATE, "ChunkReader: Failed writing compressed data");
-		free(write_buffer);
 		return ERROR_BAD_FILE;
 	} else if (sz != write_len) {
-		INFO_LOG(SAVESTATE, "Savestate: Compressed %i bytes into %i", (int)sz, (int)write_len);
+		INFO_LOG(SAVESTATE, "Savestate: Compressed %i bytes into %i in %d frames", (int)sz, (int)write_len, (int)frames.size());
+	}
+	pFile.Close();
+
+	if (stats) {
+		stats->size = sz;
+		stats->compressedSize = write_len;
+		stats->compressSeconds = compressedTime - startTime;
+		stats->writeSeconds = time_now_d() - compressedTime;
 	}
-	free(write_buffer);
 
 	INFO_LOG(SAVESTATE, "ChunkReader: Done writing %s", filename.c_str());
 	return ERROR_NONE;
@@ -172,6 +172,13 @@ class CChunkFileReader
 		ERROR_BAD_ALLOC,
 	};
 
+	struct SaveStats {
+		size_t size = 0;
+		size_t compressedSize = 0;
+		double compressSeconds = 0.0;
+		double writeSeconds = 0.0;
+	};
+
 	// May fail badly if ptr doesn't point to valid data.
 	template<class T>
 	static Error LoadPtr(u8 *ptr, T &_class, std::string *errorString)
@@ -232,6 +239,10 @@ class CChunkFileReader
 		}
 	}
 
+	// Decompresses a zstd state made of one or more frames, in parallel when possible.
+	// Returns the decompressed size, or 0 on failure (including frames that don't fit in dest.)
+	static size_t DecompressZstdFrames(u8 *dest, size_t destSize, const u8 *src, size_t sz);
+
 	// Duplicate of the above but takes and modifies a vector. Less invasive
 	// than modifying the rewind manager to keep things in something else than vectors.
 	template<class T>
@@ -316,6 +327,10 @@ class CChunkFileReader
 
 	static Error GetFileTitle(const Path &filename, std::string *title);
 
+	// Compresses and writes out a state from MeasureAndSavePtr, taking ownership of buffer (malloc/free.)
+	// Doesn't touch emulator state, so this can run on a worker thread.
+	static Error SaveFile(const Path &filename, const std::string &title, const char *gitVersion, u8 *buffer, size_t sz, SaveStats *stats = nullptr);
+
 private:
 	struct SChunkHeader
 	{
@@ -333,6 +348,5 @@ class CChunkFileReader
 	};
 
 	static Error LoadFile(const Path &filename, std::string *gitVersion, u8 *&buffer, size_t &sz, std::string *failureReason);
-	static Error SaveFile(const Path &filename, const std::string &title, const char *gitVersion, u8 *buffer, size_t sz);
 	static Error LoadFileHeader(File::IOFile &pFile, SChunkHeader &header, std::string *title);
 };
@@ -17,6 +17,10 @@ class LoopRangeTask : public Task {
 		return priority_;
 	}
 
+	const char *Kind() const override {
+		return "ParallelRangeLoop";
+	}
+
 	void Run() override {
 		loop_(lower_, upper_);
 		counter_->Count();
@@ -30,12 +34,15 @@ class LoopRangeTask : public Task {
 	const TaskPriority priority_;
 };
 
+// A few tasks per thread, so that threads that finish early can steal work from the slower ones.
+static const int TASKS_PER_LOOPER_THREAD = 4;
+
 WaitableCounter *ParallelRangeLoopWaitable(ThreadManager *threadMan, const std::function<void(int, int)> &loop, int lower, int upper, int minSize, TaskPriority priority) {
 	if (minSize == -1) {
 		minSize = 1;
 	}
 
-	int numTasks = threadMan->GetNumLooperThreads();
+	int numTasks = threadMan->GetNumLooperThreads() * TASKS_PER_LOOPER_THREAD;
 	int range = upper - lower;
 	if (range <= 0) {
 		// Nothing to do. A finished counter allocated to keep the API.
@@ -43,10 +50,10 @@ WaitableCounter *ParallelRangeLoopWaitable(ThreadManager *threadMan, const std::
 	} else if (range <= minSize) {
 		// Single background task.
 		WaitableCounter *waitableCounter = new WaitableCounter(1);
-		threadMan->EnqueueTaskOnThread(0, new LoopRangeTask(waitableCounter, loop, lower, upper, priority));
+		threadMan->EnqueueTask(new LoopRangeTask(waitableCounter, loop, lower, upper, priority));
 		return waitableCounter;
 	} else {
-		// Split the range between threads. Allow for some fractional bits.
+		// Split the range into tasks. Allow for some fractional bits.
 		const int fractionalBits = 8;
 
 		int64_t totalFrac = (int64_t)range << fractionalBits;
@@ -70,7 +77,7 @@ WaitableCounter *ParallelRangeLoopWaitable(ThreadManager *threadMan, const std::
 				// Let's do the stragglers on the current thread.
 				break;
 			}
-			threadMan->EnqueueTaskOnThread(i, new LoopRangeTask(waitableCounter, loop, start, end, priority));
+			threadMan->EnqueueTask(new LoopRangeTask(waitableCounter, loop, start, end, priority));
 			counter += delta;
 			if ((counter >> fractionalBits) >= upper) {
 				break;
@@ -8,6 +8,7 @@
 #include <atomic>
 
 #include "Common/Log.h"
+#include "Common/TimeUtil.h"
 #include "Common/Thread/ThreadUtil.h"
 #include "Common/Thread/ThreadManager.h"
 
@@ -24,7 +25,158 @@ const int MAX_CORES_TO_USE = 16;
 const int MIN_IO_BLOCKING_THREADS = 4;
 static constexpr size_t TASK_PRIORITY_COUNT = (size_t)TaskPriority::COUNT;
 
+// Chase-Lev work stealing deque, in the C11 form from Le et al. Only the owning worker pushes and
+// pops, at the bottom, so it runs its newest task first while its data is still warm. Other workers
+// steal the oldest from the top with a CAS. Nothing here locks.
+class TaskDeque {
+public:
+	TaskDeque() {
+		ring_ = new Ring(INITIAL_SIZE);
+	}
+	~TaskDeque() {
+		delete ring_.load();
+		for (Ring *ring : retired_)
+			delete ring;
+	}
+
+	// Owner only.
+	void Push(Task *task) {
+		int64_t b = bottom_.load(std::memory_order_relaxed);
+		int64_t t = top_.load(std::memory_order_acquire);
+		Ring *ring = ring_.load(std::memory_order_relaxed);
+		if (b - t >= ring->size) {
+			ring = Grow(ring, t, b);
+		}
+		ring->Put(b, task);
+		bottom_.store(b + 1, std::memory_order_release);
+	}
+
+	// Owner only.
+	Task *Pop() {
+		int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+		Ring *ring = ring_.load(std::memory_order_relaxed);
+		bottom_.store(b, std::memory_order_seq_cst);
+		int64_t t = top_.load(std::memory_order_seq_cst);
+		if (t > b) {
+			// Was empty.
+			bottom_.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Task *task = ring->Get(b);
+		if (t == b) {
+			// The last one, thieves may be racing us for it.
+			if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				task = nullptr;
+			bottom_.store(b + 1, std::memory_order_relaxed);
+		}
+		return task;
+	}
+
+	Task *Steal() {
+		while (true) {
+			int64_t t = top_.load(std::memory_order_seq_cst);
+			int64_t b = bottom_.load(std::memory_order_seq_cst);
+			if (t >= b)
+				return nullptr;
+
+			// Old rings are kept alive until we're destroyed, so this is safe even if the owner grows it now.
+			Ring *ring = ring_.load(std::memory_order_acquire);
+			Task *task = ring->Get(t);
+			if (top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				return task;
+			// Someone else took it, try the next one.
+		}
+	}
+
+	bool Empty() const {
+		return top_.load(std::memory_order_acquire) >= bottom_.load(std::memory_order_acquire);
+	}
+
+private:
+	struct Ring {
+		explicit Ring(int64_t sz) : size(sz), mask(sz - 1), tasks(new std::atomic<Task *>[sz]) {}
+		~Ring() {
+			delete[] tasks;
+		}
+		Task *Get(int64_t i) const {
+			return tasks[i & mask].load(std::memory_order_relaxed);
+		}
+		void Put(int64_t i, Task *task) {
+			tasks[i & mask].store(task, std::memory_order_relaxed);
+		}
+
+		const int64_t size;
+		const int64_t mask;
+		std::atomic<Task *> *tasks;
+	};
+
+	Ring *Grow(Ring *ring, int64_t t, int64_t b) {
+		Ring *bigger = new Ring(ring->size * 2);
+		for (int64_t i = t; i < b; ++i)
+			bigger->Put(i, ring->Get(i));
+		retired_.push_back(ring);
+		ring_.store(bigger, std::memory_order_release);
+		return bigger;
+	}
+
+	static constexpr int64_t INITIAL_SIZE = 64;
+
+	std::atomic<int64_t> top_{ 0 };
+	std::atomic<int64_t> bottom_{ 0 };
+	std::atomic<Ring *> ring_;
+	// Only touched by the owner.
+	std::vector<Ring *> retired_;
+};
+
+// Tasks handed to a worker by other threads, which can't push to its deque. Taken oldest first.
+class TaskLane {
+public:
+	void Push(Task *task) {
+		std::lock_guard<std::mutex> guard(lock_);
+		tasks_.push_back(task);
+		size_++;
+	}
+
+	Task *Pop() {
+		if (size_.load() == 0)
+			return nullptr;
+		std::lock_guard<std::mutex> guard(lock_);
+		if (tasks_.empty())
+			return nullptr;
+		Task *task = tasks_.front();
+		tasks_.pop_front();
+		size_--;
+		return task;
+	}
+
+	// For the owner: returns the oldest task and moves the rest to its deque, where they can be stolen without locking.
+	Task *PopAll(TaskDeque &dest) {
+		if (size_.load() == 0)
+			return nullptr;
+		std::lock_guard<std::mutex> guard(lock_);
+		if (tasks_.empty())
+			return nullptr;
+		Task *task = tasks_.front();
+		for (size_t i = 1; i < tasks_.size(); ++i)
+			dest.Push(tasks_[i]);
+		tasks_.clear();
+		size_ = 0;
+		return task;
+	}
+
+	bool Empty() const {
+		return size_.load() == 0;
+	}
+
+private:
+	std::mutex lock_;
+	std::deque<Task *> tasks_;
+	std::atomic<int> size_{ 0 };
+};
+
 struct GlobalThreadContext {
+	// Only used for tasks left over from a previous Teardown(), the fast path doesn't touch these.
 	std::mutex mutex;
 	std::deque<Task *> compute_queue[TASK_PRIORITY_COUNT];
 	std::atomic<int> compute_queue_size;
@@ -32,28 +184,46 @@ struct GlobalThreadContext {
 	std::atomic<int> io_queue_size;
 	std::vector<TaskThreadContext *> threads_;
 
-	std::atomic<int> roundRobin;
+	std::atomic<unsigned int> roundRobin;
+	std::atomic<bool> tracing;
 };
 
 struct TaskThreadContext {
+	GlobalThreadContext *global;
+	// Tasks queued here or stolen by this thread, plus the one running.
 	std::atomic<int> queue_size;
-	std::deque<Task *> private_queue[TASK_PRIORITY_COUNT];
+	// Tasks this thread queued itself, or moved from its inbox. Siblings steal from these.
+	TaskDeque queue[TASK_PRIORITY_COUNT];
+	// From EnqueueTask() on other threads. Siblings can take these too, if we're busy.
+	TaskLane inbox[TASK_PRIORITY_COUNT];
+	// From EnqueueTaskOnThread(). Only this thread takes from these, callers rely on that.
+	TaskLane pinned[TASK_PRIORITY_COUNT];
 	std::thread thread; // the worker thread
 	std::condition_variable cond; // used to signal new work
-	std::mutex mutex; // protects the local queue.
+	std::mutex mutex; // only used for sleeping.
+	std::atomic<bool> sleeping;
 	int index;
+	int firstSibling;  // Range of threads of the same type, that we can steal from.
+	int endSibling;
 	TaskType type;
 	std::atomic<bool> cancelled;
 	char name[16];
+
+	std::mutex traceLock;
+	std::vector<TaskTraceEvent> trace;
 };
 
 ThreadManager::ThreadManager() : global_(new GlobalThreadContext()) {
 	global_->compute_queue_size = 0;
 	global_->io_queue_size = 0;
 	global_->roundRobin = 0;
+	global_->tracing = false;
 }
 
 ThreadManager::~ThreadManager() {
+	// Idle workers look at each other's queues, so they must be gone before the contexts are.
+	if (IsInitialized())
+		Teardown();
 	delete global_;
 }
 
@@ -90,7 +260,13 @@ void ThreadManager::Teardown() {
 		threadCtx->thread.join();
 		// TODO: Is it better to just delete these?
 		for (size_t i = 0; i < TASK_PRIORITY_COUNT; ++i) {
-			for (Task *task : threadCtx->private_queue[i]) {
+			while (Task *task = threadCtx->pinned[i].Pop()) {
+				TeardownTask(task, true);
+			}
+			while (Task *task = threadCtx->inbox[i].Pop()) {
+				TeardownTask(task, true);
+			}
+			while (Task *task = threadCtx->queue[i].Steal()) {
 				TeardownTask(task, true);
 			}
 		}
@@ -114,6 +290,7 @@ bool ThreadManager::TeardownTask(Task *task, bool enqueue) {
 	}
 
 	if (enqueue) {
+		std::unique_lock<std::mutex> lock(global_->mutex);
 		size_t queueIndex = (size_t)task->Priority();
 		if (task->Type() == TaskType::CPU_COMPUTE) {
 			global_->compute_queue[queueIndex].push_back(task);
@@ -128,7 +305,93 @@ bool ThreadManager::TeardownTask(Task *task, bool enqueue) {
 	return false;
 }
 
+static Task *TakeGlobalTask(GlobalThreadContext *global, bool isCompute, size_t priority) {
+	std::atomic<int> &queue_size = isCompute ? global->compute_queue_size : global->io_queue_size;
+	if (queue_size.load() == 0)
+		return nullptr;
+
+	std::unique_lock<std::mutex> lock(global->mutex);
+	std::deque<Task *> &queue = isCompute ? global->compute_queue[priority] : global->io_queue[priority];
+	if (queue.empty())
+		return nullptr;
+	Task *task = queue.front();
+	queue.pop_front();
+	queue_size--;
+	return task;
+}
+
+// Goes through the priorities in order, and for each checks our pinned tasks, our own deque (newest first),
+// our inbox, then leftovers, then tries to steal from siblings. So a HIGH task anywhere beats a NORMAL task of our own.
+static Task *FindTask(GlobalThreadContext *global, TaskThreadContext *thread, bool *stolen) {
+	const bool isCompute = thread->type == TaskType::CPU_COMPUTE;
+	const int siblings = thread->endSibling - thread->firstSibling;
+
+	for (size_t p = 0; p < TASK_PRIORITY_COUNT; ++p) {
+		*stolen = false;
+		if (Task *task = thread->pinned[p].Pop())
+			return task;
+		if (Task *task = thread->queue[p].Pop())
+			return task;
+		if (Task *task = thread->inbox[p].PopAll(thread->queue[p]))
+			return task;
+
+		if (Task *task = TakeGlobalTask(global, isCompute, p)) {
+			thread->queue_size++;
+			return task;
+		}
+
+		// Start with the next thread, so that not everyone hammers thread 0.
+		*stolen = true;
+		for (int i = 1; i < siblings; ++i) {
+			int victimIndex = thread->firstSibling + (thread->index - thread->firstSibling + i) % siblings;
+			TaskThreadContext *victim = global->threads_[victimIndex];
+			Task *task = victim->queue[p].Steal();
+			if (!task)
+				task = victim->inbox[p].Pop();
+			if (task) {
+				victim->queue_size--;
+				thread->queue_size++;
+				return task;
+			}
+		}
+	}
+	*stolen = false;
+	return nullptr;
+}
+
+static bool HasWork(GlobalThreadContext *global, TaskThreadContext *thread) {
+	if ((thread->type == TaskType::CPU_COMPUTE ? global->compute_queue_size : global->io_queue_size).load() > 0)
+		return true;
+	for (size_t p = 0; p < TASK_PRIORITY_COUNT; ++p) {
+		if (!thread->pinned[p].Empty())
+			return true;
+	}
+	for (int i = thread->firstSibling; i < thread->endSibling; ++i) {
+		for (size_t p = 0; p < TASK_PRIORITY_COUNT; ++p) {
+			if (!global->threads_[i]->queue[p].Empty() || !global->threads_[i]->inbox[p].Empty())
+				return true;
+		}
+	}
+	return false;
+}
+
+static bool WakeThread(TaskThreadContext *thread) {
+	if (!thread->sleeping.load())
+		return false;
+	// If it's still flagged once we have the lock, it's waiting. Clear the flag so that the
+	// next wakeup goes to some other thread.
+	std::unique_lock<std::mutex> lock(thread->mutex);
+	if (!thread->sleeping.exchange(false))
+		return false;
+	thread->cond.notify_one();
+	return true;
+}
+
+// The worker running on this thread, if any. Lets EnqueueTask() push to its own deque.
+static thread_local TaskThreadContext *t_currentWorker;
+
 static void WorkerThreadFunc(GlobalThreadContext *global, TaskThreadContext *thread) {
+	t_currentWorker = thread;
 	if (thread->type == TaskType::CPU_COMPUTE) {
 		snprintf(thread->name, sizeof(thread->name), "PoolWorker %d", thread->index);
 	} else {
@@ -141,69 +404,43 @@ static void WorkerThreadFunc(GlobalThreadContext *global, TaskThreadContext *thr
 		AttachThreadToJNI();
 	}
 
-	const bool isCompute = thread->type == TaskType::CPU_COMPUTE;
-	const auto global_queue_size = [isCompute, &global]() -> int {
-		return isCompute ? global->compute_queue_size.load() : global->io_queue_size.load();
-	};
-
 	while (!thread->cancelled) {
-		Task *task = nullptr;
-
-		// Check the global queue first, then check the private queue and wait if there's nothing to do.
-		if (global_queue_size() > 0) {
-			// Grab one from the global queue if there is any.
-			std::unique_lock<std::mutex> lock(global->mutex);
-			auto queue = isCompute ? global->compute_queue : global->io_queue;
-			auto &queue_size = isCompute ? global->compute_queue_size : global->io_queue_size;
-
-			for (size_t p = 0; p < TASK_PRIORITY_COUNT; ++p) {
-				if (!queue[p].empty()) {
-					task = queue[p].front();
-					queue[p].pop_front();
-					queue_size--;
-
-					// We are processing one now, so mark that.
-					thread->queue_size++;
-					break;
-				} else if (thread->queue_size != 0) {
-					// Check the thread, as we prefer a HIGH thread task to a global NORMAL task.
-					std::unique_lock<std::mutex> lock(thread->mutex);
-					if (!thread->private_queue[p].empty()) {
-						task = thread->private_queue[p].front();
-						thread->private_queue[p].pop_front();
-						break;
-					}
-				}
-			}
-		}
+		bool stolen = false;
+		Task *task = FindTask(global, thread, &stolen);
 
 		if (!task) {
-			// We didn't have any global, do we have anything on the thread?
 			std::unique_lock<std::mutex> lock(thread->mutex);
-			for (size_t p = 0; p < TASK_PRIORITY_COUNT; ++p) {
-				if (thread->private_queue[p].empty())
-					continue;
-
-				task = thread->private_queue[p].front();
-				thread->private_queue[p].pop_front();
-				break;
-			}
-
-			// We must check both queue and single again, while locked.
-			bool wait = !thread->cancelled && !task && global_queue_size() == 0;
-
-			if (wait)
+			thread->sleeping = true;
+			// Pairs with the fence in EnqueueTask: either we see the new task, or it sees us sleeping.
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!thread->cancelled && !HasWork(global, thread))
 				thread->cond.wait(lock);
+			thread->sleeping = false;
+			continue;
 		}
+
 		// The task itself takes care of notifying anyone waiting on it. Not the
 		// responsibility of the ThreadManager (although it could be!).
-		if (task) {
+		if (global->tracing.load(std::memory_order_relaxed)) {
+			TaskTraceEvent ev;
+			// Can't touch the task after Release(), grab what we need first.
+			ev.kind = task->Kind();
+			ev.priority = task->Priority();
+			ev.thread = thread->index;
+			ev.stolen = stolen;
+			ev.start = time_now_d();
+			task->Run();
+			task->Release();
+			ev.end = time_now_d();
+
+			std::lock_guard<std::mutex> guard(thread->traceLock);
+			thread->trace.push_back(ev);
+		} else {
 			task->Run();
 			task->Release();
-			// Reduce the queue size once complete.
-			thread->queue_size--;
-			// _dbg_assert_(thread->queue_size == thread->private_queue[0].size() + thread->private_queue[1].size() + thread->private_queue[2].size());
 		}
+		// Reduce the queue size once complete.
+		thread->queue_size--;
 	}
 
 	// In case it got attached to JNI, detach it. Don't think this has any side effects if called redundantly.
@@ -224,14 +461,22 @@ void ThreadManager::Init(int numRealCores, int numLogicalCoresPerCpu) {
 
 	INFO_LOG(SYSTEM, "ThreadManager::Init(compute threads: %d, all: %d)", numComputeThreads_, numThreads_);
 
+	// Create all the contexts first, since the threads look at each other's queues.
 	for (int i = 0; i < numThreads; i++) {
 		TaskThreadContext *thread = new TaskThreadContext();
+		thread->global = global_;
 		thread->cancelled.store(false);
+		thread->sleeping.store(false);
+		thread->queue_size.store(0);
 		thread->type = i < numComputeThreads_ ? TaskType::CPU_COMPUTE : TaskType::IO_BLOCKING;
 		thread->index = i;
-		thread->thread = std::thread(&WorkerThreadFunc, global_, thread);
+		thread->firstSibling = i < numComputeThreads_ ? 0 : numComputeThreads_;
+		thread->endSibling = i < numComputeThreads_ ? numComputeThreads_ : numThreads;
 		global_->threads_.push_back(thread);
 	}
+	for (TaskThreadContext *thread : global_->threads_) {
+		thread->thread = std::thread(&WorkerThreadFunc, global_, thread);
+	}
 }
 
 void ThreadManager::EnqueueTask(Task *task) {
@@ -247,55 +492,56 @@ void ThreadManager::EnqueueTask(Task *task) {
 
 	_assert_msg_(IsInitialized(), "ThreadManager not initialized");
 
-	size_t queueIndex = (size_t)task->Priority();
-	int minThread;
-	int maxThread;
-	if (task->Type() == TaskType::CPU_COMPUTE) {
-		// only the threads reserved for heavy compute.
-		minThread = 0;
-		maxThread = numComputeThreads_;
+	const size_t priority = (size_t)task->Priority();
+	TaskThreadContext *self = t_currentWorker;
+	TaskThreadContext *thread;
+	if (self && self->global == global_ && self->type == task->Type()) {
+		// Queued from one of our own workers, so it can go on its deque. Idle siblings will steal it.
+		thread = self;
+		thread->queue_size++;
+		thread->queue[priority].Push(task);
 	} else {
-		// Only IO blocking threads (to avoid starving compute threads.)
-		minThread = numComputeThreads_;
-		maxThread = numThreads_;
-	}
-
-	// Find a thread with no outstanding work.
-	_assert_(maxThread <= (int)global_->threads_.size());
-	for (int threadNum = minThread; threadNum < maxThread; threadNum++) {
-		TaskThreadContext *thread = global_->threads_[threadNum];
-		if (thread->queue_size.load() == 0) {
-			std::unique_lock<std::mutex> lock(thread->mutex);
-			thread->private_queue[queueIndex].push_back(task);
-			thread->queue_size++;
-			thread->cond.notify_one();
-			// Found it - done.
-			return;
-		}
-	}
-
-	// Still not scheduled? Put it on the global queue and notify a thread chosen by round-robin.
-	// Not particularly scientific, but hopefully we should not run into this too much.
-	{
-		std::unique_lock<std::mutex> lock(global_->mutex);
+		int minThread;
+		int maxThread;
 		if (task->Type() == TaskType::CPU_COMPUTE) {
-			global_->compute_queue[queueIndex].push_back(task);
-			global_->compute_queue_size++;
-		} else if (task->Type() == TaskType::IO_BLOCKING) {
-			global_->io_queue[queueIndex].push_back(task);
-			global_->io_queue_size++;
+			// only the threads reserved for heavy compute.
+			minThread = 0;
+			maxThread = numComputeThreads_;
 		} else {
-			_assert_(false);
+			// Only IO blocking threads (to avoid starving compute threads.)
+			minThread = numComputeThreads_;
+			maxThread = numThreads_;
 		}
+
+		// Find a thread with no outstanding work, starting from a round-robin position.
+		// If they're all busy, it doesn't matter much where it goes - idle threads will steal it.
+		_assert_(maxThread <= (int)global_->threads_.size());
+		const int count = maxThread - minThread;
+		const int first = (int)(global_->roundRobin++ % (unsigned int)count);
+		int chosen = minThread + first;
+		for (int i = 0; i < count; i++) {
+			int threadNum = minThread + (first + i) % count;
+			if (global_->threads_[threadNum]->queue_size.load() == 0) {
+				chosen = threadNum;
+				break;
+			}
+		}
+
+		thread = global_->threads_[chosen];
+		thread->queue_size++;
+		thread->inbox[priority].Push(task);
 	}
 
-	int chosenIndex = global_->roundRobin++;
-	chosenIndex = minThread + (chosenIndex % (maxThread - minThread));
-	TaskThreadContext *&chosenThread = global_->threads_[chosenIndex];
+	// Pairs with the fence before a worker goes to sleep.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (thread != self && WakeThread(thread) && thread->queue_size.load() <= 1)
+		return;
 
-	// Lock the thread to ensure it gets the message.
-	std::unique_lock<std::mutex> lock(chosenThread->mutex);
-	chosenThread->cond.notify_one();
+	// More than it can start right away, so wake a sleeping sibling to steal some. One per task is enough.
+	for (int i = thread->firstSibling; i < thread->endSibling; i++) {
+		if (i != thread->index && WakeThread(global_->threads_[i]))
+			break;
+	}
 }
 
 void ThreadManager::EnqueueTaskOnThread(int threadNum, Task *task) {
@@ -303,13 +549,13 @@ void ThreadManager::EnqueueTaskOnThread(int threadNum, Task *task) {
 
 	_assert_msg_(threadNum >= 0 && threadNum < (int)global_->threads_.size(), "Bad threadnum or not initialized");
 	TaskThreadContext *thread = global_->threads_[threadNum];
-	size_t queueIndex = (size_t)task->Priority();
 
 	thread->queue_size++;
+	thread->pinned[(size_t)task->Priority()].Push(task);
 
-	std::unique_lock<std::mutex> lock(thread->mutex);
-	thread->private_queue[queueIndex].push_back(task);
-	thread->cond.notify_one();
+	// Pairs with the fence before a worker goes to sleep.  Nobody else can take it, so only wake this one.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	WakeThread(thread);
 }
 
 int ThreadManager::GetNumLooperThreads() const {
@@ -320,6 +566,29 @@ void ThreadManager::TryCancelTask(uint64_t taskID) {
 	// Do nothing for now, just let it finish.
 }
 
+void ThreadManager::StartTracing() {
+	for (TaskThreadContext *thread : global_->threads_) {
+		std::lock_guard<std::mutex> guard(thread->traceLock);
+		thread->trace.clear();
+	}
+	global_->tracing = true;
+}
+
+std::vector<TaskTraceEvent> ThreadManager::StopTracing() {
+	global_->tracing = false;
+
+	std::vector<TaskTraceEvent> events;
+	for (TaskThreadContext *thread : global_->threads_) {
+		std::lock_guard<std::mutex> guard(thread->traceLock);
+		events.insert(events.end(), thread->trace.begin(), thread->trace.end());
+		thread->trace.clear();
+	}
+	std::sort(events.begin(), events.end(), [](const TaskTraceEvent &a, const TaskTraceEvent &b) {
+		return a.start < b.start;
+	});
+	return events;
+}
+
 bool ThreadManager::IsInitialized() const {
 	return !global_->threads_.empty();
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
 // The new threadpool.
 
@@ -45,6 +46,16 @@ class Waitable {
 	}
 };
 
+// One task run, recorded while tracing is on.
+struct TaskTraceEvent {
+	const char *kind;  // Task::Kind(), may be null.
+	TaskPriority priority;
+	int thread;
+	bool stolen;  // Ran on a different thread than EnqueueTask() put it on.
+	double start;
+	double end;
+};
+
 struct TaskThreadContext;
 struct GlobalThreadContext;
 
@@ -57,8 +68,12 @@ class ThreadManager {
 	// It gets even trickier when you think about mobile chips with BIG/LITTLE, but we'll
 	// just ignore it and let the OS handle it.
 	void Init(int numCores, int numLogicalCoresPerCpu);
+	// From a worker, the task goes on that worker's own deque, otherwise on an idle worker.
+	// Either way, other idle workers of the same type may steal it.
 	void EnqueueTask(Task *task);
-	// Use enforceSequence if this must run after all previously queued tasks.
+	// Queues on a specific thread, and it will run there - other threads never steal these.
+	// Tasks on one thread start in the order they were queued. Only use this when the task needs
+	// that thread, EnqueueTask() balances load better.
 	void EnqueueTaskOnThread(int threadNum, Task *task);
 	void Teardown();
 
@@ -73,6 +88,11 @@ class ThreadManager {
 	// for I/O bounds tasks, that can be run concurrently with those.
 	int GetNumLooperThreads() const;
 
+	// Records every task run until StopTracing(), which returns them sorted by start time.
+	// Only meant for debugging and benchmarks, it adds a bit of overhead per task.
+	void StartTracing();
+	std::vector<TaskTraceEvent> StopTracing();
+
 private:
 	bool TeardownTask(Task *task, bool enqueue);
 
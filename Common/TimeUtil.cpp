@@ -25,6 +25,11 @@
 // for _mm_pause
 #if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
 #include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
 #endif
 
 #include <ctime>
@@ -166,6 +171,43 @@ double time_now_unix_utc() {
 
 #endif
 
+uint64_t time_now_ticks() {
+#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+	return __rdtsc();
+#elif PPSSPP_ARCH(ARM64) && !defined(_MSC_VER)
+	uint64_t ticks;
+	asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+	return ticks;
+#else
+	return time_now_raw();
+#endif
+}
+
+static double CalibrateTicksPerSecond() {
+#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+	// Invariant TSC on anything recent, so measuring it once is enough.
+	double startTime = time_now_d();
+	uint64_t startTicks = time_now_ticks();
+	double elapsed;
+	do {
+		elapsed = time_now_d() - startTime;
+	} while (elapsed < 0.005);
+	return (double)(time_now_ticks() - startTicks) / elapsed;
+#elif PPSSPP_ARCH(ARM64) && !defined(_MSC_VER)
+	uint64_t freq;
+	asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+	return (double)freq;
+#else
+	// time_now_raw() is in nanoseconds.
+	return 1000000000.0;
+#endif
+}
+
+double time_ticks_per_second() {
+	static const double ticksPerSecond = CalibrateTicksPerSecond();
+	return ticksPerSecond;
+}
+
 void sleep_ms(int ms) {
 #ifdef _WIN32
 	Sleep(ms);
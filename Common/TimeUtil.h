@@ -16,6 +16,11 @@ double from_time_raw_relative(uint64_t raw_time);
 // Seconds, Unix UTC time
 double time_now_unix_utc();
 
+// Cheap timestamp for profiling hot paths: the TSC on x86, the virtual counter on ARM64.
+// Only differences are meaningful, convert them with time_ticks_per_second().
+uint64_t time_now_ticks();
+double time_ticks_per_second();
+
 // Sleep. Does not necessarily have millisecond granularity, especially on Windows.
 void sleep_ms(int ms);
 
@@ -106,6 +106,7 @@ struct Config {
 	bool bIgnoreBadMemAccess;
 
 	bool bFastMemory;
+	bool bProtectJitCodePages;
 	int iCpuCore;
 	bool bCheckForNewVersion;
 	bool bForceLagSync;
@@ -165,6 +166,7 @@ struct Config {
 	bool bSoftwareRenderingJit;
 	bool bHardwareTransform; // only used in the GLES backend
 	bool bSoftwareSkinning;
+	bool bVertexCache;
 	bool bVendorBugChecksEnabled;
 	bool bUseGeometryShader;
 
@@ -28,6 +28,8 @@ enum GPUCore {
 	GPUCORE_DIRECTX9,
 	GPUCORE_DIRECTX11,
 	GPUCORE_VULKAN,
+	// Software GE emulation without rasterization, for headless CPU benchmarking.
+	GPUCORE_NULL,
 };
 
 enum class FPSLimit {
@@ -30,6 +30,7 @@
 #include "Core/CoreTiming.h"
 #include "Core/Core.h"
 #include "Core/Config.h"
+#include "Core/MemFault.h"
 #include "Core/HLE/sceKernelThread.h"
 #include "Core/MIPS/MIPS.h"
 
@@ -402,6 +403,8 @@ void Advance() {
 	globalTimer += cyclesExecuted;
 	currentMIPS->downcount = slicelength;
 
+	// Guest writes to protected code pages (from any thread) are only queued, we drop the blocks here.
+	Memory::MemFault_ProcessPendingCodeClears();
 	ProcessEvents();
 
 	if (!first) {
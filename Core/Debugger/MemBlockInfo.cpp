@@ -30,13 +30,13 @@
 #include "Core/CoreTiming.h"
 #include "Core/Debugger/Breakpoints.h"
 #include "Core/Debugger/MemBlockInfo.h"
+#include "Core/MemFault.h"
 #include "Core/MIPS/MIPS.h"
 #include "Common/StringUtils.h"
 
 class MemSlabMap {
 public:
 	MemSlabMap();
-	~MemSlabMap();
 
 	bool Mark(uint32_t addr, uint32_t size, uint64_t ticks, uint32_t pc, bool allocated, const char *tag);
 	bool Find(MemBlockFlags flags, uint32_t addr, uint32_t size, std::vector<MemBlockInfo> &results);
@@ -52,32 +52,41 @@ class MemSlabMap {
 		uint64_t ticks = 0;
 		uint32_t pc = 0;
 		bool allocated = false;
-		// Intentionally not save stated.
-		bool bulkStorage = false;
 		char tag[128]{};
-		Slab *prev = nullptr;
-		Slab *next = nullptr;
+		// Indexes into slabs_, not save stated.
+		uint32_t prev = NO_SLAB;
+		uint32_t next = NO_SLAB;
 
 		void DoState(PointerWrap &p);
 	};
 
+	static constexpr uint32_t NO_SLAB = 0xFFFFFFFF;
 	static constexpr uint32_t MAX_SIZE = 0x40000000;
-	static constexpr uint32_t SLICES = 65536;
+	static constexpr uint32_t SLICES = 262144;
 	static constexpr uint32_t SLICE_SIZE = MAX_SIZE / SLICES;
 
-	Slab *FindSlab(uint32_t addr);
-	void Clear();
-	// Returns the new slab after size.
-	Slab *Split(Slab *slab, uint32_t size);
-	void MergeAdjacent(Slab *slab);
-	static inline bool Same(const Slab *a, const Slab *b);
-	void Merge(Slab *a, Slab *b);
-	void FillHeads(Slab *slab);
-
-	Slab *first_ = nullptr;
-	Slab *lastFind_ = nullptr;
-	std::vector<Slab *> heads_;
-	Slab *bulkStorage_ = nullptr;
+	uint32_t FindSlab(uint32_t addr);
+	uint32_t NewSlab();
+	// Returns the slab after size, and updates index to the one before.
+	uint32_t Split(uint32_t &index, uint32_t size);
+	void MergeAdjacent(uint32_t index);
+	static inline bool Same(const Slab &a, const Slab &b);
+	// Updates a to whichever slab survives.
+	void Merge(uint32_t &a, uint32_t b);
+	// Points heads for slices starting within [start, end) at index.
+	void FillHeads(uint32_t index, uint32_t start, uint32_t end);
+	static inline uint32_t CountSlices(uint32_t start, uint32_t end) {
+		return (end + SLICE_SIZE - 1) / SLICE_SIZE - (start + SLICE_SIZE - 1) / SLICE_SIZE;
+	}
+
+	// All slabs live in one array, linked in address order by index.  Removed ones are reused,
+	// so marking memory doesn't allocate once the map has warmed up.
+	std::vector<Slab> slabs_;
+	std::vector<uint32_t> freeSlabs_;
+	uint32_t first_ = NO_SLAB;
+	uint32_t lastFind_ = NO_SLAB;
+	// The slab covering the start of each slice.
+	std::vector<uint32_t> heads_;
 };
 
 struct PendingNotifyMem {
@@ -86,24 +95,46 @@ struct PendingNotifyMem {
 	uint32_t size;
 	uint32_t copySrc;
 	uint64_t ticks;
+	// Keeps notifications from different threads in order.
+	uint64_t seq;
 	uint32_t pc;
 	char tag[128];
 };
 
-// 160 KB.
-static constexpr size_t MAX_PENDING_NOTIFIES = 1024;
-static constexpr size_t MAX_PENDING_NOTIFIES_THREAD = 1000;
+// Each notifying thread gets its own ring, so notifying never takes a lock.
+// Single producer (the owning thread), single consumer (whoever holds pendingReadMutex.)
+static constexpr uint32_t PENDING_RING_SIZE = 1024;
+static constexpr uint32_t PENDING_RING_FLUSH_THRESHOLD = 768;
+struct PendingNotifyRing {
+	PendingNotifyMem entries[PENDING_RING_SIZE];
+	std::atomic<uint32_t> head{};
+	std::atomic<uint32_t> tail{};
+	// Set when the owning thread exits, the ring is freed once drained.
+	std::atomic<bool> abandoned{};
+};
+
+struct PendingNotifyRingOwner {
+	~PendingNotifyRingOwner() {
+		if (ring)
+			ring->abandoned = true;
+	}
+	PendingNotifyRing *ring = nullptr;
+};
+
 static MemSlabMap allocMap;
 static MemSlabMap suballocMap;
 static MemSlabMap writeMap;
 static MemSlabMap textureMap;
-static std::vector<PendingNotifyMem> pendingNotifies;
+static thread_local PendingNotifyRingOwner localPendingRing;
+static std::vector<PendingNotifyRing *> pendingRings;
+// Only taken to add or remove rings.
+static std::mutex pendingRingsMutex;
+static std::atomic<uint64_t> pendingNotifySeq;
 static std::atomic<uint32_t> pendingNotifyMinAddr1;
 static std::atomic<uint32_t> pendingNotifyMaxAddr1;
 static std::atomic<uint32_t> pendingNotifyMinAddr2;
 static std::atomic<uint32_t> pendingNotifyMaxAddr2;
-// To prevent deadlocks, acquire Read before Write if you're going to acquire both.
-static std::mutex pendingWriteMutex;
+// Held while flushing or reading the maps.
 static std::mutex pendingReadMutex;
 static int detailedOverride;
 
@@ -117,37 +148,45 @@ MemSlabMap::MemSlabMap() {
 	Reset();
 }
 
-MemSlabMap::~MemSlabMap() {
-	Clear();
-}
-
 bool MemSlabMap::Mark(uint32_t addr, uint32_t size, uint64_t ticks, uint32_t pc, bool allocated, const char *tag) {
 	uint32_t end = addr + size;
-	Slab *slab = FindSlab(addr);
-	Slab *firstMatch = nullptr;
-	while (slab != nullptr && slab->start < end) {
-		if (slab->start < addr)
-			slab = Split(slab, addr - slab->start);
-		// Don't replace slab, the return is the after part.
-		if (slab->end > end) {
-			Split(slab, end - slab->start);
+	uint32_t index = FindSlab(addr);
+	if (index != NO_SLAB && slabs_[index].end >= end) {
+		// If it wouldn't change anything, skip splitting and merging right back (e.g. freeing free memory.)
+		Slab &slab = slabs_[index];
+		if (slab.allocated == allocated && (pc == 0 || slab.pc == pc) && (!tag || strcmp(slab.tag, tag) == 0)) {
+			if (pc != 0)
+				slab.ticks = std::max(slab.ticks, ticks);
+			MergeAdjacent(index);
+			return true;
 		}
+	}
 
-		slab->allocated = allocated;
+	uint32_t firstMatch = NO_SLAB;
+	while (index != NO_SLAB && slabs_[index].start < end) {
+		if (slabs_[index].start < addr)
+			index = Split(index, addr - slabs_[index].start);
+		// Don't replace index with the return, that's the after part.
+		if (slabs_[index].end > end) {
+			Split(index, end - slabs_[index].start);
+		}
+
+		Slab &slab = slabs_[index];
+		slab.allocated = allocated;
 		if (pc != 0) {
-			slab->ticks = ticks;
-			slab->pc = pc;
+			slab.ticks = ticks;
+			slab.pc = pc;
 		}
 		if (tag)
-			truncate_cpy(slab->tag, tag);
+			truncate_cpy(slab.tag, tag);
 
 		// Move on to the next one.
-		if (firstMatch == nullptr)
-			firstMatch = slab;
-		slab = slab->next;
+		if (firstMatch == NO_SLAB)
+			firstMatch = index;
+		index = slab.next;
 	}
 
-	if (firstMatch != nullptr) {
+	if (firstMatch != NO_SLAB) {
 		// This will merge all those blocks to one.
 		MergeAdjacent(firstMatch);
 		return true;
@@ -157,38 +196,41 @@ bool MemSlabMap::Mark(uint32_t addr, uint32_t size, uint64_t ticks, uint32_t pc,
 
 bool MemSlabMap::Find(MemBlockFlags flags, uint32_t addr, uint32_t size, std::vector<MemBlockInfo> &results) {
 	uint32_t end = addr + size;
-	Slab *slab = FindSlab(addr);
+	uint32_t index = FindSlab(addr);
 	bool found = false;
-	while (slab != nullptr && slab->start < end) {
-		if (slab->pc != 0 || slab->tag[0] != '\0') {
-			results.push_back({ flags, slab->start, slab->end - slab->start, slab->ticks, slab->pc, slab->tag, slab->allocated });
+	while (index != NO_SLAB && slabs_[index].start < end) {
+		const Slab &slab = slabs_[index];
+		if (slab.pc != 0 || slab.tag[0] != '\0') {
+			results.push_back({ flags, slab.start, slab.end - slab.start, slab.ticks, slab.pc, slab.tag, slab.allocated });
 			found = true;
 		}
-		slab = slab->next;
+		index = slab.next;
 	}
 	return found;
 }
 
 const char *MemSlabMap::FastFindWriteTag(MemBlockFlags flags, uint32_t addr, uint32_t size) {
 	uint32_t end = addr + size;
-	Slab *slab = FindSlab(addr);
-	while (slab != nullptr && slab->start < end) {
-		if (slab->pc != 0 || slab->tag[0] != '\0') {
-			return slab->tag;
+	uint32_t index = FindSlab(addr);
+	while (index != NO_SLAB && slabs_[index].start < end) {
+		const Slab &slab = slabs_[index];
+		if (slab.pc != 0 || slab.tag[0] != '\0') {
+			return slab.tag;
 		}
-		slab = slab->next;
+		index = slab.next;
 	}
 	return nullptr;
 }
 
 void MemSlabMap::Reset() {
-	Clear();
+	slabs_.clear();
+	freeSlabs_.clear();
 
-	first_ = new Slab();
-	first_->end = MAX_SIZE;
+	first_ = NewSlab();
+	slabs_[first_].end = MAX_SIZE;
 	lastFind_ = first_;
 
-	heads_.resize(SLICES, first_);
+	heads_.assign(SLICES, first_);
 }
 
 void MemSlabMap::DoState(PointerWrap &p) {
@@ -198,54 +240,30 @@ void MemSlabMap::DoState(PointerWrap &p) {
 
 	int count = 0;
 	if (p.mode == p.MODE_READ) {
-		// Since heads_ is a static size, let's avoid clearing it.
-		// This helps in case a debugger call happens concurrently.
-		Slab *old = first_;
-		Slab *oldBulk = bulkStorage_;
 		Do(p, count);
-
-		first_ = new Slab();
-		first_->DoState(p);
-		lastFind_ = first_;
-		--count;
-
-		FillHeads(first_);
-
-		bulkStorage_ = new Slab[count];
-
-		Slab *slab = first_;
-		for (int i = 0; i < count; ++i) {
-			slab->next = &bulkStorage_[i];
-			slab->next->bulkStorage = true;
-			slab->next->DoState(p);
-
-			slab->next->prev = slab;
-			slab = slab->next;
-
-			FillHeads(slab);
+		if (count <= 0) {
+			Reset();
+			return;
 		}
 
-		// Now that it's entirely disconnected, delete the old slabs.
-		while (old != nullptr) {
-			Slab *next = old->next;
-			if (!old->bulkStorage)
-				delete old;
-			old = next;
+		slabs_.clear();
+		freeSlabs_.clear();
+		slabs_.resize(count);
+		for (int i = 0; i < count; ++i) {
+			Slab &slab = slabs_[i];
+			slab.DoState(p);
+			slab.prev = i == 0 ? NO_SLAB : i - 1;
+			slab.next = i == count - 1 ? NO_SLAB : i + 1;
+			FillHeads(i, slab.start, slab.end);
 		}
-		delete [] oldBulk;
+		first_ = 0;
+		lastFind_ = 0;
 	} else {
-		for (Slab *slab = first_; slab != nullptr; slab = slab->next)
-			++count;
+		count = (int)(slabs_.size() - freeSlabs_.size());
 		Do(p, count);
 
-		first_->DoState(p);
-		--count;
-
-		Slab *slab = first_;
-		for (int i = 0; i < count; ++i) {
-			slab->next->DoState(p);
-			slab = slab->next;
-		}
+		for (uint32_t index = first_; index != NO_SLAB; index = slabs_[index].next)
+			slabs_[index].DoState(p);
 	}
 }
 
@@ -272,211 +290,306 @@ void MemSlabMap::Slab::DoState(PointerWrap &p) {
 	}
 }
 
-void MemSlabMap::Clear() {
-	Slab *s = first_;
-	while (s != nullptr) {
-		Slab *next = s->next;
-		if (!s->bulkStorage)
-			delete s;
-		s = next;
-	}
-	delete bulkStorage_;
-	bulkStorage_ = nullptr;
-	first_ = nullptr;
-	lastFind_ = nullptr;
-	heads_.clear();
-}
-
-MemSlabMap::Slab *MemSlabMap::FindSlab(uint32_t addr) {
+uint32_t MemSlabMap::FindSlab(uint32_t addr) {
 	// Jump ahead using our index.
-	Slab *slab = heads_[addr / SLICE_SIZE];
+	uint32_t index = heads_[addr / SLICE_SIZE];
 	// We often move forward, so check the last find.
-	if (lastFind_->start > slab->start && lastFind_->start <= addr)
-		slab = lastFind_;
-
-	while (slab != nullptr && slab->start <= addr) {
-		if (slab->end > addr) {
-			lastFind_ = slab;
-			return slab;
+	const Slab &last = slabs_[lastFind_];
+	if (last.start > slabs_[index].start && last.start <= addr)
+		index = lastFind_;
+
+	while (index != NO_SLAB && slabs_[index].start <= addr) {
+		if (slabs_[index].end > addr) {
+			lastFind_ = index;
+			return index;
 		}
-		slab = slab->next;
-	}
-	return nullptr;
-}
-
-MemSlabMap::Slab *MemSlabMap::Split(Slab *slab, uint32_t size) {
-	Slab *next = new Slab();
-	next->start = slab->start + size;
-	next->end = slab->end;
-	next->ticks = slab->ticks;
-	next->pc = slab->pc;
-	next->allocated = slab->allocated;
-	truncate_cpy(next->tag, slab->tag);
-	next->prev = slab;
-	next->next = slab->next;
-
-	slab->next = next;
-	if (next->next)
-		next->next->prev = next;
-
-	// If the split is big, we might have to update our index.
-	FillHeads(next);
-
-	slab->end = slab->start + size;
-	return next;
-}
-
-bool MemSlabMap::Same(const Slab *a, const Slab *b) {
-	if (a->allocated != b->allocated)
+		index = slabs_[index].next;
+	}
+	return NO_SLAB;
+}
+
+uint32_t MemSlabMap::NewSlab() {
+	if (!freeSlabs_.empty()) {
+		uint32_t index = freeSlabs_.back();
+		freeSlabs_.pop_back();
+		slabs_[index] = Slab();
+		return index;
+	}
+	slabs_.emplace_back();
+	return (uint32_t)slabs_.size() - 1;
+}
+
+uint32_t MemSlabMap::Split(uint32_t &index, uint32_t size) {
+	// Might grow slabs_, so grab references after.
+	uint32_t addedIndex = NewSlab();
+	Slab &slab = slabs_[index];
+	Slab &added = slabs_[addedIndex];
+	uint32_t mid = slab.start + size;
+	added.ticks = slab.ticks;
+	added.pc = slab.pc;
+	added.allocated = slab.allocated;
+	truncate_cpy(added.tag, slab.tag);
+
+	// The new slab takes whichever side covers fewer slices, so splitting a huge slab
+	// doesn't have to update the whole index.
+	if (CountSlices(slab.start, mid) < CountSlices(mid, slab.end)) {
+		added.start = slab.start;
+		added.end = mid;
+		added.prev = slab.prev;
+		added.next = index;
+		if (added.prev != NO_SLAB)
+			slabs_[added.prev].next = addedIndex;
+		else
+			first_ = addedIndex;
+		slab.prev = addedIndex;
+		slab.start = mid;
+
+		FillHeads(addedIndex, added.start, added.end);
+		uint32_t after = index;
+		index = addedIndex;
+		return after;
+	}
+
+	added.start = mid;
+	added.end = slab.end;
+	added.prev = index;
+	added.next = slab.next;
+	if (added.next != NO_SLAB)
+		slabs_[added.next].prev = addedIndex;
+	slab.next = addedIndex;
+	slab.end = mid;
+
+	FillHeads(addedIndex, added.start, added.end);
+	return addedIndex;
+}
+
+bool MemSlabMap::Same(const Slab &a, const Slab &b) {
+	if (a.allocated != b.allocated)
 		return false;
-	if (a->pc != b->pc)
+	if (a.pc != b.pc)
 		return false;
-	if (strcmp(a->tag, b->tag))
+	if (strcmp(a.tag, b.tag))
 		return false;
 	return true;
 }
 
-void MemSlabMap::MergeAdjacent(Slab *slab) {
-	while (slab->next != nullptr && Same(slab, slab->next)) {
-		Merge(slab, slab->next);
+void MemSlabMap::MergeAdjacent(uint32_t index) {
+	while (slabs_[index].next != NO_SLAB && Same(slabs_[index], slabs_[slabs_[index].next])) {
+		Merge(index, slabs_[index].next);
 	}
-	while (slab->prev != nullptr && Same(slab, slab->prev)) {
-		Merge(slab, slab->prev);
+	while (slabs_[index].prev != NO_SLAB && Same(slabs_[index], slabs_[slabs_[index].prev])) {
+		Merge(index, slabs_[index].prev);
 	}
 }
 
-void MemSlabMap::Merge(Slab *a, Slab *b) {
-	if (a->next == b) {
-		_assert_(a->end == b->start);
-		a->end = b->end;
-		a->next = b->next;
+void MemSlabMap::Merge(uint32_t &aIndex, uint32_t bIndex) {
+	// Keep whichever covers more slices, so we update fewer heads.
+	if (CountSlices(slabs_[bIndex].start, slabs_[bIndex].end) > CountSlices(slabs_[aIndex].start, slabs_[aIndex].end))
+		std::swap(aIndex, bIndex);
 
-		if (a->next)
-			a->next->prev = a;
-	} else if (a->prev == b) {
-		_assert_(b->end == a->start);
-		a->start = b->start;
-		a->prev = b->prev;
+	Slab &a = slabs_[aIndex];
+	Slab &b = slabs_[bIndex];
+	if (a.next == bIndex) {
+		_assert_(a.end == b.start);
+		a.end = b.end;
+		a.next = b.next;
 
-		if (a->prev)
-			a->prev->next = a;
-		else if (first_ == b)
-			first_ = a;
+		if (a.next != NO_SLAB)
+			slabs_[a.next].prev = aIndex;
+	} else if (a.prev == bIndex) {
+		_assert_(b.end == a.start);
+		a.start = b.start;
+		a.prev = b.prev;
+
+		if (a.prev != NO_SLAB)
+			slabs_[a.prev].next = aIndex;
+		else if (first_ == bIndex)
+			first_ = aIndex;
 	} else {
 		_assert_(false);
 	}
 	// Take over index entries b had.
-	FillHeads(a);
-	if (b->ticks > a->ticks) {
-		a->ticks = b->ticks;
+	FillHeads(aIndex, b.start, b.end);
+	if (b.ticks > a.ticks) {
+		a.ticks = b.ticks;
 		// In case we ignore PC for same.
-		a->pc = b->pc;
+		a.pc = b.pc;
 	}
-	if (lastFind_ == b)
-		lastFind_ = a;
-	if (!b->bulkStorage)
-		delete b;
+	if (lastFind_ == bIndex)
+		lastFind_ = aIndex;
+	freeSlabs_.push_back(bIndex);
 }
 
-void MemSlabMap::FillHeads(Slab *slab) {
-	uint32_t slice = slab->start / SLICE_SIZE;
-	uint32_t endSlice = (slab->end - 1) / SLICE_SIZE;
+void MemSlabMap::FillHeads(uint32_t index, uint32_t start, uint32_t end) {
+	uint32_t slice = (start + SLICE_SIZE - 1) / SLICE_SIZE;
+	uint32_t endSlice = (end + SLICE_SIZE - 1) / SLICE_SIZE;
+	for (; slice < endSlice; ++slice)
+		heads_[slice] = index;
+}
 
-	// For the first slice, only replace if it's the one we're removing.
-	if (slab->start == slice * SLICE_SIZE) {
-		heads_[slice] = slab;
+size_t FormatMemWriteTagAtNoFlush(char *buf, size_t sz, const char *prefix, uint32_t start, uint32_t size);
+
+static void ApplyPendingMemInfo(const PendingNotifyMem &info) {
+	if (info.copySrc != 0) {
+		char tagData[128];
+		size_t tagSize = FormatMemWriteTagAtNoFlush(tagData, sizeof(tagData), info.tag, info.copySrc, info.size);
+		writeMap.Mark(info.start, info.size, info.ticks, info.pc, true, tagData);
+		return;
 	}
 
-	// Now replace all the rest - we definitely cover the start of them.
-	Slab **next = &heads_[slice + 1];
-	// We want to set slice + 1 through endSlice, inclusive.
-	size_t c = endSlice - slice;
-	for (size_t i = 0; i < c; ++i) {
-		next[i] = slab;
+	if (info.flags & MemBlockFlags::ALLOC) {
+		allocMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag);
+	} else if (info.flags & MemBlockFlags::FREE) {
+		// Maintain the previous allocation tag for debugging.
+		allocMap.Mark(info.start, info.size, info.ticks, 0, false, nullptr);
+		suballocMap.Mark(info.start, info.size, info.ticks, 0, false, nullptr);
+	}
+	if (info.flags & MemBlockFlags::SUB_ALLOC) {
+		suballocMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag);
+	} else if (info.flags & MemBlockFlags::SUB_FREE) {
+		// Maintain the previous allocation tag for debugging.
+		suballocMap.Mark(info.start, info.size, info.ticks, 0, false, nullptr);
+	}
+	if (info.flags & MemBlockFlags::TEXTURE) {
+		textureMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag);
+	}
+	if (info.flags & MemBlockFlags::WRITE) {
+		writeMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag);
 	}
 }
 
-size_t FormatMemWriteTagAtNoFlush(char *buf, size_t sz, const char *prefix, uint32_t start, uint32_t size);
+// Must hold pendingReadMutex.
+static void FlushPendingMemInfoLocked() {
+	// Reset these before looking at the rings.  A notify racing with us either gets drained
+	// below, or sets them again after.
+	pendingNotifyMinAddr1 = 0xFFFFFFFF;
+	pendingNotifyMaxAddr1 = 0;
+	pendingNotifyMinAddr2 = 0xFFFFFFFF;
+	pendingNotifyMaxAddr2 = 0;
 
-void FlushPendingMemInfo() {
-	// This lock prevents us from another thread reading while we're busy flushing.
-	std::lock_guard<std::mutex> guard(pendingReadMutex);
-	std::vector<PendingNotifyMem> thisBatch;
-	{
-		std::lock_guard<std::mutex> guard(pendingWriteMutex);
-		thisBatch = std::move(pendingNotifies);
-		pendingNotifies.clear();
-		pendingNotifies.reserve(MAX_PENDING_NOTIFIES);
-
-		pendingNotifyMinAddr1 = 0xFFFFFFFF;
-		pendingNotifyMaxAddr1 = 0;
-		pendingNotifyMinAddr2 = 0xFFFFFFFF;
-		pendingNotifyMaxAddr2 = 0;
-	}
-
-	for (const auto &info : thisBatch) {
-		if (info.copySrc != 0) {
-			char tagData[128];
-			size_t tagSize = FormatMemWriteTagAtNoFlush(tagData, sizeof(tagData), info.tag, info.copySrc, info.size);
-			writeMap.Mark(info.start, info.size, info.ticks, info.pc, true, tagData);
-			continue;
+	std::lock_guard<std::mutex> guard(pendingRingsMutex);
+	struct Cursor {
+		PendingNotifyRing *ring;
+		uint32_t pos;
+		uint32_t end;
+	};
+	Cursor cursors[64];
+	size_t numCursors = 0;
+	for (size_t i = 0; i < pendingRings.size(); ++i) {
+		PendingNotifyRing *ring = pendingRings[i];
+		uint32_t pos = ring->tail.load(std::memory_order_relaxed);
+		uint32_t end = ring->head.load();
+		if (pos != end)
+			cursors[numCursors++] = { ring, pos, end };
+
+		// Apply what we have, and come back for the rest.
+		if (numCursors == ARRAY_SIZE(cursors) || i == pendingRings.size() - 1) {
+			// Merge by sequence, so writes from different threads keep their order.
+			while (numCursors != 0) {
+				size_t best = 0;
+				for (size_t c = 1; c < numCursors; ++c) {
+					if (cursors[c].ring->entries[cursors[c].pos % PENDING_RING_SIZE].seq < cursors[best].ring->entries[cursors[best].pos % PENDING_RING_SIZE].seq)
+						best = c;
+				}
+
+				Cursor &cursor = cursors[best];
+				ApplyPendingMemInfo(cursor.ring->entries[cursor.pos % PENDING_RING_SIZE]);
+				cursor.pos++;
+				cursor.ring->tail.store(cursor.pos, std::memory_order_release);
+				if (cursor.pos == cursor.end)
+					cursors[best] = cursors[--numCursors];
+			}
 		}
+	}
 
-		if (info.flags & MemBlockFlags::ALLOC) {
-			allocMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag);
-		} else if (info.flags & MemBlockFlags::FREE) {
-			// Maintain the previous allocation tag for debugging.
-			allocMap.Mark(info.start, info.size, info.ticks, 0, false, nullptr);
-			suballocMap.Mark(info.start, info.size, info.ticks, 0, false, nullptr);
-		}
-		if (info.flags & MemBlockFlags::SUB_ALLOC) {
-			suballocMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag);
-		} else if (info.flags & MemBlockFlags::SUB_FREE) {
-			// Maintain the previous allocation tag for debugging.
-			suballocMap.Mark(info.start, info.size, info.ticks, 0, false, nullptr);
-		}
-		if (info.flags & MemBlockFlags::TEXTURE) {
-			textureMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag);
-		}
-		if (info.flags & MemBlockFlags::WRITE) {
-			writeMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag);
+	// Now that they're drained, free rings from threads that exited.
+	for (size_t i = 0; i < pendingRings.size(); ) {
+		PendingNotifyRing *ring = pendingRings[i];
+		if (ring->abandoned && ring->tail.load(std::memory_order_relaxed) == ring->head.load()) {
+			delete ring;
+			pendingRings[i] = pendingRings.back();
+			pendingRings.pop_back();
+		} else {
+			++i;
 		}
 	}
 }
 
+void FlushPendingMemInfo() {
+	// This lock prevents us from another thread reading while we're busy flushing.
+	std::lock_guard<std::mutex> guard(pendingReadMutex);
+	FlushPendingMemInfoLocked();
+}
+
+static inline void FlushPendingMemInfoIfNeeded(uint32_t start, uint32_t size) {
+	if (pendingNotifyMinAddr1 < start + size && pendingNotifyMaxAddr1 >= start)
+		FlushPendingMemInfo();
+	else if (pendingNotifyMinAddr2 < start + size && pendingNotifyMaxAddr2 >= start)
+		FlushPendingMemInfo();
+}
+
 static inline uint32_t NormalizeAddress(uint32_t addr) {
 	if ((addr & 0x3F000000) == 0x04000000)
 		return addr & 0x041FFFFF;
 	return addr & 0x3FFFFFFF;
 }
 
-static inline bool MergeRecentMemInfo(const PendingNotifyMem &info, size_t copyLength) {
-	if (pendingNotifies.size() < 4)
-		return false;
+static inline void AtomicMin(std::atomic<uint32_t> &value, uint32_t v) {
+	uint32_t cur = value.load();
+	while (v < cur && !value.compare_exchange_weak(cur, v)) {
+		continue;
+	}
+}
 
-	for (size_t i = 1; i <= 4; ++i) {
-		auto &prev = pendingNotifies[pendingNotifies.size() - i];
-		if (prev.copySrc != 0)
-			return false;
+static inline void AtomicMax(std::atomic<uint32_t> &value, uint32_t v) {
+	uint32_t cur = value.load();
+	while (v > cur && !value.compare_exchange_weak(cur, v)) {
+		continue;
+	}
+}
 
-		if (prev.flags != info.flags)
-			continue;
+static PendingNotifyRing *GetPendingRing() {
+	PendingNotifyRing *ring = localPendingRing.ring;
+	if (!ring) {
+		ring = new PendingNotifyRing();
+		std::lock_guard<std::mutex> guard(pendingRingsMutex);
+		pendingRings.push_back(ring);
+		localPendingRing.ring = ring;
+	}
+	return ring;
+}
 
-		if (prev.start >= info.start + info.size || prev.start + prev.size <= info.start)
-			continue;
+// Returns the slot to fill in, call PublishPendingNotify() after.
+static PendingNotifyMem &ReservePendingNotify(PendingNotifyRing *ring) {
+	uint32_t head = ring->head.load(std::memory_order_relaxed);
+	if (head - ring->tail.load(std::memory_order_acquire) >= PENDING_RING_SIZE) {
+		// Full, the flush thread is behind.  Rare, so just do it ourselves.
+		FlushPendingMemInfo();
+	}
+	return ring->entries[head % PENDING_RING_SIZE];
+}
 
-		// This means there's overlap, but not a match, so we can't combine any.
-		if (prev.start != info.start || prev.size > info.size)
-			return false;
+static void PublishPendingNotify(PendingNotifyRing *ring, uint32_t start, uint32_t size) {
+	uint32_t head = ring->head.load(std::memory_order_relaxed) + 1;
+	ring->head.store(head);
 
-		memcpy(prev.tag, info.tag, copyLength + 1);
-		prev.size = info.size;
-		prev.ticks = info.ticks;
-		prev.pc = info.pc;
-		return true;
+	// After the head, see FlushPendingMemInfoLocked().
+	if (start < 0x08000000) {
+		AtomicMin(pendingNotifyMinAddr1, start);
+		AtomicMax(pendingNotifyMaxAddr1, start + size);
+	} else {
+		AtomicMin(pendingNotifyMinAddr2, start);
+		AtomicMax(pendingNotifyMaxAddr2, start + size);
 	}
 
-	return false;
+	// Wake the flush thread once per batch.
+	if (head - ring->tail.load(std::memory_order_relaxed) == PENDING_RING_FLUSH_THRESHOLD) {
+		{
+			std::lock_guard<std::mutex> guard(flushLock);
+			flushThreadPending = true;
+		}
+		flushCond.notify_one();
+	}
 }
 
 void NotifyMemInfoPC(MemBlockFlags flags, uint32_t start, uint32_t size, uint32_t pc, const char *tagStr, size_t strLength) {
@@ -486,11 +599,20 @@ void NotifyMemInfoPC(MemBlockFlags flags, uint32_t start, uint32_t size, uint32_
 	// Clear the uncached and kernel bits.
 	start = NormalizeAddress(start);
 
-	bool needFlush = false;
+	// HLE may write with a syscall like read(), which won't trigger the fault handler.
+	if (flags & MemBlockFlags::WRITE)
+		Memory::MemFault_PrepareCodeWrite(start, size);
+
 	// When the setting is off, we skip smaller info to keep things fast.
 	if (MemBlockInfoDetailed(size) && flags != MemBlockFlags::READ) {
-		PendingNotifyMem info{ flags, start, size };
+		PendingNotifyRing *ring = GetPendingRing();
+		PendingNotifyMem &info = ReservePendingNotify(ring);
+		info.flags = flags;
+		info.start = start;
+		info.size = size;
+		info.copySrc = 0;
 		info.ticks = CoreTiming::GetTicks();
+		info.seq = pendingNotifySeq.fetch_add(1, std::memory_order_relaxed);
 		info.pc = pc;
 
 		size_t copyLength = strLength;
@@ -500,27 +622,7 @@ void NotifyMemInfoPC(MemBlockFlags flags, uint32_t start, uint32_t size, uint32_
 		memcpy(info.tag, tagStr, copyLength);
 		info.tag[copyLength] = 0;
 
-		std::lock_guard<std::mutex> guard(pendingWriteMutex);
-		// Sometimes we get duplicates, quickly check.
-		if (!MergeRecentMemInfo(info, copyLength)) {
-			if (start < 0x08000000) {
-				pendingNotifyMinAddr1 = std::min(pendingNotifyMinAddr1.load(), start);
-				pendingNotifyMaxAddr1 = std::max(pendingNotifyMaxAddr1.load(), start + size);
-			} else {
-				pendingNotifyMinAddr2 = std::min(pendingNotifyMinAddr2.load(), start);
-				pendingNotifyMaxAddr2 = std::max(pendingNotifyMaxAddr2.load(), start + size);
-			}
-			pendingNotifies.push_back(info);
-		}
-		needFlush = pendingNotifies.size() > MAX_PENDING_NOTIFIES_THREAD;
-	}
-
-	if (needFlush) {
-		{
-			std::lock_guard<std::mutex> guard(flushLock);
-			flushThreadPending = true;
-		}
-		flushCond.notify_one();
+		PublishPendingNotify(ring, start, size);
 	}
 
 	if (!(flags & MemBlockFlags::SKIP_MEMCHECK)) {
@@ -540,7 +642,6 @@ void NotifyMemInfoCopy(uint32_t destPtr, uint32_t srcPtr, uint32_t size, const c
 	if (size == 0)
 		return;
 
-	bool needsFlush = false;
 	if (CBreakPoints::HasMemChecks()) {
 		// This will cause a flush, but it's needed to trigger memchecks with proper data.
 		char tagData[128];
@@ -551,44 +652,29 @@ void NotifyMemInfoCopy(uint32_t destPtr, uint32_t srcPtr, uint32_t size, const c
 		srcPtr = NormalizeAddress(srcPtr);
 		destPtr = NormalizeAddress(destPtr);
 
-		PendingNotifyMem info{ MemBlockFlags::WRITE, destPtr, size };
+		PendingNotifyRing *ring = GetPendingRing();
+		PendingNotifyMem &info = ReservePendingNotify(ring);
+		info.flags = MemBlockFlags::WRITE;
+		info.start = destPtr;
+		info.size = size;
 		info.copySrc = srcPtr;
 		info.ticks = CoreTiming::GetTicks();
+		info.seq = pendingNotifySeq.fetch_add(1, std::memory_order_relaxed);
 		info.pc = currentMIPS->pc;
 
 		// Store the prefix for now.  The correct tag will be calculated on flush.
 		truncate_cpy(info.tag, prefix);
 
-		std::lock_guard<std::mutex> guard(pendingWriteMutex);
-		if (destPtr < 0x08000000) {
-			pendingNotifyMinAddr1 = std::min(pendingNotifyMinAddr1.load(), destPtr);
-			pendingNotifyMaxAddr1 = std::max(pendingNotifyMaxAddr1.load(), destPtr + size);
-		} else {
-			pendingNotifyMinAddr2 = std::min(pendingNotifyMinAddr2.load(), destPtr);
-			pendingNotifyMaxAddr2 = std::max(pendingNotifyMaxAddr2.load(), destPtr + size);
-		}
-		pendingNotifies.push_back(info);
-		needsFlush = pendingNotifies.size() > MAX_PENDING_NOTIFIES_THREAD;
-	}
-
-	if (needsFlush) {
-		{
-			std::lock_guard<std::mutex> guard(flushLock);
-			flushThreadPending = true;
-		}
-		flushCond.notify_one();
+		PublishPendingNotify(ring, destPtr, size);
 	}
 }
 
 std::vector<MemBlockInfo> FindMemInfo(uint32_t start, uint32_t size) {
 	start = NormalizeAddress(start);
-
-	if (pendingNotifyMinAddr1 < start + size && pendingNotifyMaxAddr1 >= start)
-		FlushPendingMemInfo();
-	if (pendingNotifyMinAddr2 < start + size && pendingNotifyMaxAddr2 >= start)
-		FlushPendingMemInfo();
+	FlushPendingMemInfoIfNeeded(start, size);
 
 	std::vector<MemBlockInfo> results;
+	std::lock_guard<std::mutex> guard(pendingReadMutex);
 	allocMap.Find(MemBlockFlags::ALLOC, start, size, results);
 	suballocMap.Find(MemBlockFlags::SUB_ALLOC, start, size, results);
 	writeMap.Find(MemBlockFlags::WRITE, start, size, results);
@@ -598,13 +684,10 @@ std::vector<MemBlockInfo> FindMemInfo(uint32_t start, uint32_t size) {
 
 std::vector<MemBlockInfo> FindMemInfoByFlag(MemBlockFlags flags, uint32_t start, uint32_t size) {
 	start = NormalizeAddress(start);
-
-	if (pendingNotifyMinAddr1 < start + size && pendingNotifyMaxAddr1 >= start)
-		FlushPendingMemInfo();
-	if (pendingNotifyMinAddr2 < start + size && pendingNotifyMaxAddr2 >= start)
-		FlushPendingMemInfo();
+	FlushPendingMemInfoIfNeeded(start, size);
 
 	std::vector<MemBlockInfo> results;
+	std::lock_guard<std::mutex> guard(pendingReadMutex);
 	if (flags & MemBlockFlags::ALLOC)
 		allocMap.Find(MemBlockFlags::ALLOC, start, size, results);
 	if (flags & MemBlockFlags::SUB_ALLOC)
@@ -616,16 +699,10 @@ std::vector<MemBlockInfo> FindMemInfoByFlag(MemBlockFlags flags, uint32_t start,
 	return results;
 }
 
-static const char *FindWriteTagByFlag(MemBlockFlags flags, uint32_t start, uint32_t size, bool flush = true) {
+// Must hold pendingReadMutex.
+static const char *FindWriteTagByFlag(MemBlockFlags flags, uint32_t start, uint32_t size) {
 	start = NormalizeAddress(start);
 
-	if (flush) {
-		if (pendingNotifyMinAddr1 < start + size && pendingNotifyMaxAddr1 >= start)
-			FlushPendingMemInfo();
-		if (pendingNotifyMinAddr2 < start + size && pendingNotifyMaxAddr2 >= start)
-			FlushPendingMemInfo();
-	}
-
 	if (flags & MemBlockFlags::ALLOC) {
 		const char *tag = allocMap.FastFindWriteTag(MemBlockFlags::ALLOC, start, size);
 		if (tag)
@@ -650,25 +727,18 @@ static const char *FindWriteTagByFlag(MemBlockFlags flags, uint32_t start, uint3
 }
 
 size_t FormatMemWriteTagAt(char *buf, size_t sz, const char *prefix, uint32_t start, uint32_t size) {
-	const char *tag = FindWriteTagByFlag(MemBlockFlags::WRITE, start, size);
-	if (tag && strcmp(tag, "MemInit") != 0) {
-		return snprintf(buf, sz, "%s%s", prefix, tag);
-	}
-	// Fall back to alloc and texture, especially for VRAM.  We prefer write above.
-	tag = FindWriteTagByFlag(MemBlockFlags::ALLOC | MemBlockFlags::TEXTURE, start, size);
-	if (tag) {
-		return snprintf(buf, sz, "%s%s", prefix, tag);
-	}
-	return snprintf(buf, sz, "%s%08x_size_%08x", prefix, start, size);
+	FlushPendingMemInfoIfNeeded(NormalizeAddress(start), size);
+	std::lock_guard<std::mutex> guard(pendingReadMutex);
+	return FormatMemWriteTagAtNoFlush(buf, sz, prefix, start, size);
 }
 
 size_t FormatMemWriteTagAtNoFlush(char *buf, size_t sz, const char *prefix, uint32_t start, uint32_t size) {
-	const char *tag = FindWriteTagByFlag(MemBlockFlags::WRITE, start, size, false);
+	const char *tag = FindWriteTagByFlag(MemBlockFlags::WRITE, start, size);
 	if (tag && strcmp(tag, "MemInit") != 0) {
 		return snprintf(buf, sz, "%s%s", prefix, tag);
 	}
 	// Fall back to alloc and texture, especially for VRAM.  We prefer write above.
-	tag = FindWriteTagByFlag(MemBlockFlags::ALLOC | MemBlockFlags::TEXTURE, start, size, false);
+	tag = FindWriteTagByFlag(MemBlockFlags::ALLOC | MemBlockFlags::TEXTURE, start, size);
 	if (tag) {
 		return snprintf(buf, sz, "%s%s", prefix, tag);
 	}
@@ -691,8 +761,6 @@ static void FlushMemInfoThread() {
 
 void MemBlockInfoInit() {
 	std::lock_guard<std::mutex> guard(pendingReadMutex);
-	std::lock_guard<std::mutex> guardW(pendingWriteMutex);
-	pendingNotifies.reserve(MAX_PENDING_NOTIFIES);
 	pendingNotifyMinAddr1 = 0xFFFFFFFF;
 	pendingNotifyMaxAddr1 = 0;
 	pendingNotifyMinAddr2 = 0xFFFFFFFF;
@@ -706,12 +774,15 @@ void MemBlockInfoInit() {
 void MemBlockInfoShutdown() {
 	{
 		std::lock_guard<std::mutex> guard(pendingReadMutex);
-		std::lock_guard<std::mutex> guardW(pendingWriteMutex);
 		allocMap.Reset();
 		suballocMap.Reset();
 		writeMap.Reset();
 		textureMap.Reset();
-		pendingNotifies.clear();
+
+		// Drop anything still pending.
+		std::lock_guard<std::mutex> guardRings(pendingRingsMutex);
+		for (PendingNotifyRing *ring : pendingRings)
+			ring->tail.store(ring->head.load());
 	}
 
 	if (flushThreadRunning.load()) {
@@ -728,7 +799,8 @@ void MemBlockInfoDoState(PointerWrap &p) {
 	if (!s)
 		return;
 
-	FlushPendingMemInfo();
+	std::lock_guard<std::mutex> guard(pendingReadMutex);
+	FlushPendingMemInfoLocked();
 	allocMap.DoState(p);
 	suballocMap.DoState(p);
 	writeMap.DoState(p);
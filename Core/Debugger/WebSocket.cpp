@@ -18,6 +18,7 @@
 #include <mutex>
 #include <condition_variable>
 #include "Common/Thread/ThreadUtil.h"
+#include "Common/TimeUtil.h"
 #include "Core/Debugger/WebSocket.h"
 #include "Core/Debugger/WebSocket/WebSocketUtils.h"
 #include "Core/MemMap.h"
@@ -25,6 +26,12 @@
 // This WebSocket (connected through the same port as disc sharing) allows API/debugger access to PPSSPP.
 // Currently, the only subprotocol "debugger.ppsspp.org" uses a simple JSON based interface.
 //
+// For high rate use, requests may also be sent as a binary message holding a batch of JSON
+// requests (see net::BatchRecordType for the layout.)  All responses to a batch are returned
+// as a single batch, deflated if the request was.  Spontaneous events can be batched the same
+// way and rate limited using "broadcast.config.set".  Bulk data such as "memory.read" and
+// "gpu.buffer.*" can be returned as raw binary messages with type 'binary'.
+//
 // Messages to and from PPSSPP follow the same basic format:
 //    { "event": "NAME", ... }
 //
@@ -82,6 +89,9 @@ static const std::vector<SubscriberInit> subscribers({
 	&WebSocketClientConfigInit,
 });
 
+// Above this much unsent output, spontaneous events wait for the client to catch up.
+static const size_t MAX_BROADCAST_BACKLOG = 1024 * 1024;
+
 // To handle webserver restart, keep track of how many running.
 static volatile int debuggersConnected = 0;
 static volatile bool stopRequested = false;
@@ -157,7 +167,7 @@ void HandleDebuggerRequest(const http::ServerRequest &request) {
 
 	// There's a tradeoff between responsiveness to incoming events, and polling for changes.
 	int highActivity = 0;
-	ws->SetTextHandler([&](const std::string &t) {
+	auto handleRequest = [&](const std::string &t) {
 		JsonReader reader(t.c_str(), t.size());
 		if (!reader.ok()) {
 			ws->Send(DebuggerErrorEvent("Bad message: invalid JSON", LogLevel::LERROR));
@@ -183,30 +193,57 @@ void HandleDebuggerRequest(const http::ServerRequest &request) {
 		} else {
 			req.Fail("Bad message: unknown event");
 		}
-	});
+	};
+	ws->SetTextHandler(handleRequest);
 	ws->SetBinaryHandler([&](const std::vector<uint8_t> &d) {
-		ws->Send(DebuggerErrorEvent("Bad message", LogLevel::LERROR));
+		std::vector<std::pair<net::BatchRecordType, std::string>> records;
+		if (!net::WebSocketServer::ParseBatch(d, &records)) {
+			ws->Send(DebuggerErrorEvent("Bad message: invalid batch", LogLevel::LERROR));
+			return;
+		}
+
+		// All responses to a batch go back as a single batch, compressed if the request was.
+		ws->BeginBatch();
+		for (const auto &record : records) {
+			if (record.first == net::BatchRecordType::TEXT)
+				handleRequest(record.second);
+			else
+				ws->Send(DebuggerErrorEvent("Bad message: binary request record", LogLevel::LERROR));
+		}
+		ws->EndBatch((d[0] & net::BATCH_FLAG_ZLIB) != 0);
 	});
 
+	double lastBroadcast = 0.0;
 	while (ws->Process(highActivity ? 1.0f / 1000.0f : 1.0f / 60.0f)) {
 		std::lock_guard<std::mutex> guard(lifecycleLock);
-		// These send events that aren't just responses to requests
-
-		// The client can explicitly ask not to be notified about some events
-		// so we check the client settings first
-		if (!disallowed_config["logger"])
-			logger.Broadcast(ws);
-		if (!disallowed_config["game"])
-			game.Broadcast(ws);
-		if (!disallowed_config["stepping"])
-			stepping.Broadcast(ws);
-		if (!disallowed_config["input"])
-			input.Broadcast(ws);
-
-		for (size_t i = 0; i < subscribers.size(); ++i) {
-			if (subscriberData[i]) {
-				subscriberData[i]->Broadcast(ws);
+		// These send events that aren't just responses to requests.
+		// Broadcasters track what they've already sent, so skipping a poll just coalesces events.
+		// Hold off while the client is behind or if it asked for a lower event rate.
+		double now = time_now_d();
+		if (ws->PendingOutput() <= MAX_BROADCAST_BACKLOG && now - lastBroadcast >= client_info.broadcastInterval) {
+			lastBroadcast = now;
+			if (client_info.batch)
+				ws->BeginBatch();
+
+			// The client can explicitly ask not to be notified about some events
+			// so we check the client settings first
+			if (!disallowed_config["logger"])
+				logger.Broadcast(ws);
+			if (!disallowed_config["game"])
+				game.Broadcast(ws);
+			if (!disallowed_config["stepping"])
+				stepping.Broadcast(ws);
+			if (!disallowed_config["input"])
+				input.Broadcast(ws);
+
+			for (size_t i = 0; i < subscribers.size(); ++i) {
+				if (subscriberData[i]) {
+					subscriberData[i]->Broadcast(ws);
+				}
 			}
+
+			if (client_info.batch)
+				ws->EndBatch(client_info.compress);
 		}
 
 		if (stopRequested) {
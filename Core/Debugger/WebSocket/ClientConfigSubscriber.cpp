@@ -26,6 +26,11 @@ DebuggerSubscriber *WebSocketClientConfigInit(DebuggerEventHandlerMap & map) {
 	return nullptr;
 }
 
+static void WriteBatchConfig(JsonWriter &json, const WebSocketClientInfo &client) {
+	json.writeBool("batch", client.batch);
+	json.writeBool("compress", client.compress);
+	json.writeInt("maxRate", client.broadcastInterval > 0.0 ? (int)(1.0 / client.broadcastInterval + 0.5) : 0);
+}
 
 // Request the current client broadcast configuration (broadcast.config.get)
 //
@@ -37,6 +42,9 @@ DebuggerSubscriber *WebSocketClientConfigInit(DebuggerEventHandlerMap & map) {
 //     - game: whether game events are disallowed
 //     - stepping: whether stepping events are disallowed
 //     - input: whether input events are disallowed
+//  - batch: whether events are sent as binary batches.
+//  - compress: whether batches of events are deflated.
+//  - maxRate: maximum number of event polls per second, or 0 if unlimited.
 void WebSocketBroadcastConfigGet(DebuggerRequest & req) {
 	JsonWriter &json = req.Respond();
 	const auto& disallowed_config = req.client->disallowed;
@@ -49,6 +57,8 @@ void WebSocketBroadcastConfigGet(DebuggerRequest & req) {
 	}
 
 	json.end();
+
+	WriteBatchConfig(json, *req.client);
 }
 
 // Update the current client broadcast configuration (broadcast.config.set)
@@ -59,6 +69,11 @@ void WebSocketBroadcastConfigGet(DebuggerRequest & req) {
 //     - game: new game config state
 //     - stepping: new stepping config state
 //     - input: new input config state
+//  - batch: optional boolean, send each poll's events as one binary batch (see WebSocket.cpp.)
+//  - compress: optional boolean, deflate batches of events.
+//  - maxRate: optional number, maximum event polls per second (0 for unlimited.)
+//    Events are coalesced until the next poll.  Log events are kept in a ring of the latest
+//    1024 lines though, so at low rates a burst of logging can drop older lines.
 //
 // Response (same event name):
 //  - disallowed: object with optional boolean fields:
@@ -66,35 +81,54 @@ void WebSocketBroadcastConfigGet(DebuggerRequest & req) {
 //     - game: whether game events are now disallowed
 //     - stepping: whether stepping events are now disallowed
 //     - input: whether input events are now disallowed
+//  - batch: whether events are now sent as binary batches.
+//  - compress: whether batches of events are now deflated.
+//  - maxRate: maximum number of event polls per second, or 0 if unlimited.
 void WebSocketBroadcastConfigSet(DebuggerRequest & req) {
-	JsonWriter &json = req.Respond();
 	auto& disallowed_config = req.client->disallowed;
 
+	bool batch = req.client->batch;
+	if (!req.ParamBool("batch", &batch, DebuggerParamType::OPTIONAL))
+		return;
+	bool compress = req.client->compress;
+	if (!req.ParamBool("compress", &compress, DebuggerParamType::OPTIONAL))
+		return;
+	uint32_t maxRate = req.client->broadcastInterval > 0.0 ? (uint32_t)(1.0 / req.client->broadcastInterval + 0.5) : 0;
+	if (!req.ParamU32("maxRate", &maxRate, false, DebuggerParamType::OPTIONAL))
+		return;
+
 	const JsonNode *jsonDisallowed = req.data.get("disallowed");
-	if (!jsonDisallowed) {
+	if (!jsonDisallowed && !req.HasParam("batch") && !req.HasParam("compress") && !req.HasParam("maxRate")) {
 		return req.Fail("Missing 'disallowed' parameter");
 	}
-	if (jsonDisallowed->value.getTag() != JSON_OBJECT) {
+	if (jsonDisallowed && jsonDisallowed->value.getTag() != JSON_OBJECT) {
 		return req.Fail("Invalid 'disallowed' parameter type");
 	}
 
-	for (const JsonNode *broadcaster : jsonDisallowed->value) {
-		auto it = disallowed_config.find(broadcaster->key);
-		if (it == disallowed_config.end()) {
-			return req.Fail(StringFromFormat("Unsupported 'disallowed' object key '%s'", broadcaster->key));
-		}
-
-		if (broadcaster->value.getTag() == JSON_TRUE) {
-			it->second = true;
-		}
-		else if (broadcaster->value.getTag() == JSON_FALSE) {
-			it->second = false;
-		}
-		else if (broadcaster->value.getTag() != JSON_NULL) {
-			return req.Fail(StringFromFormat("Unsupported 'disallowed' object type for key '%s'", broadcaster->key));
+	if (jsonDisallowed) {
+		for (const JsonNode *broadcaster : jsonDisallowed->value) {
+			auto it = disallowed_config.find(broadcaster->key);
+			if (it == disallowed_config.end()) {
+				return req.Fail(StringFromFormat("Unsupported 'disallowed' object key '%s'", broadcaster->key));
+			}
+
+			if (broadcaster->value.getTag() == JSON_TRUE) {
+				it->second = true;
+			}
+			else if (broadcaster->value.getTag() == JSON_FALSE) {
+				it->second = false;
+			}
+			else if (broadcaster->value.getTag() != JSON_NULL) {
+				return req.Fail(StringFromFormat("Unsupported 'disallowed' object type for key '%s'", broadcaster->key));
+			}
 		}
 	}
 
+	req.client->batch = batch;
+	req.client->compress = compress;
+	req.client->broadcastInterval = maxRate != 0 ? 1.0 / maxRate : 0.0;
+
+	JsonWriter &json = req.Respond();
 	json.pushDict("disallowed");
 
 	for (const auto[name, status] : disallowed_config) {
@@ -103,4 +137,6 @@ void WebSocketBroadcastConfigSet(DebuggerRequest & req) {
 	}
 
 	json.end();
+
+	WriteBatchConfig(json, *req.client);
 }
@@ -223,6 +223,25 @@ static bool StreamBufferToBase64(DebuggerRequest &req, const GPUDebugBuffer &buf
 	return true;
 }
 
+// Note: Calls req.Respond() and sends the response, then the data as a binary message.
+static bool StreamBufferToBinary(DebuggerRequest &req, const GPUDebugBuffer &buf, bool isFramebuffer) {
+	size_t length = buf.GetStride() * buf.GetHeight() * buf.PixelSize();
+
+	auto &json = req.Respond();
+	json.writeInt("width", buf.GetStride());
+	json.writeInt("height", buf.GetHeight());
+	json.writeBool("flipped", buf.GetFlipped());
+	json.writeString("format", DescribeFormat(buf.GetFormat()));
+	if (isFramebuffer) {
+		json.writeBool("isFramebuffer", isFramebuffer);
+	}
+	json.writeUint("size", (uint32_t)length);
+	req.Finish();
+
+	req.ws->Send(buf.GetData(), length);
+	return true;
+}
+
 static void GenericStreamBuffer(DebuggerRequest &req, std::function<bool(const GPUDebugBuffer *&, bool *isFramebuffer)> func) {
 	if (!currentDebugMIPS->isAlive()) {
 		return req.Fail("CPU not started");
@@ -240,8 +259,8 @@ static void GenericStreamBuffer(DebuggerRequest &req, std::function<bool(const G
 	std::string type = "uri";
 	if (!req.ParamString("type", &type, DebuggerParamType::OPTIONAL))
 		return;
-	if (type != "uri" && type != "base64")
-		return req.Fail("Parameter 'type' must be either 'uri' or 'base64'");
+	if (type != "uri" && type != "base64" && type != "binary")
+		return req.Fail("Parameter 'type' must be 'uri', 'base64', or 'binary'");
 
 	const GPUDebugBuffer *buf = nullptr;
 	bool isFramebuffer = false;
@@ -252,6 +271,8 @@ static void GenericStreamBuffer(DebuggerRequest &req, std::function<bool(const G
 
 	if (type == "base64") {
 		StreamBufferToBase64(req, *buf, isFramebuffer);
+	} else if (type == "binary") {
+		StreamBufferToBinary(req, *buf, isFramebuffer);
 	} else if (type == "uri") {
 		StreamBufferToDataURI(req, *buf, isFramebuffer, includeAlpha, stackWidth);
 	} else {
@@ -262,7 +283,7 @@ static void GenericStreamBuffer(DebuggerRequest &req, std::function<bool(const G
 // Retrieve a screenshot (gpu.buffer.screenshot)
 //
 // Parameters:
-//  - type: either 'uri' or 'base64'.
+//  - type: 'uri', 'base64', or 'binary'.
 //  - alpha: boolean to include the alpha channel for 'uri' type (not normally useful for screenshots.)
 //
 // Response (same event name) for 'uri' type:
@@ -276,6 +297,9 @@ static void GenericStreamBuffer(DebuggerRequest &req, std::function<bool(const G
 //  - flipped: boolean to indicate whether buffer is vertically flipped.
 //  - format: string indicating format, such as 'R8G8B8A8_UNORM' or 'B8G8R8A8_UNORM'.
 //  - base64: base64 encode of binary data.
+//
+// Response (same event name) for 'binary' type is as for 'base64', except:
+//  - size: number of bytes, sent as the very next (binary) message instead of base64.
 void WebSocketGPUBufferScreenshot(DebuggerRequest &req) {
 	GenericStreamBuffer(req, [](const GPUDebugBuffer *&buf, bool *isFramebuffer) {
 		*isFramebuffer = false;
@@ -286,7 +310,7 @@ void WebSocketGPUBufferScreenshot(DebuggerRequest &req) {
 // Retrieve current color render buffer (gpu.buffer.renderColor)
 //
 // Parameters:
-//  - type: either 'uri' or 'base64'.
+//  - type: 'uri', 'base64', or 'binary'.
 //  - alpha: boolean to include the alpha channel for 'uri' type.
 //
 // Response (same event name) for 'uri' type:
@@ -310,7 +334,7 @@ void WebSocketGPUBufferRenderColor(DebuggerRequest &req) {
 // Retrieve current depth render buffer (gpu.buffer.renderDepth)
 //
 // Parameters:
-//  - type: either 'uri' or 'base64'.
+//  - type: 'uri', 'base64', or 'binary'.
 //  - alpha: true to use alpha to encode depth, otherwise red for 'uri' type.
 //
 // Response (same event name) for 'uri' type:
@@ -334,7 +358,7 @@ void WebSocketGPUBufferRenderDepth(DebuggerRequest &req) {
 // Retrieve current stencil render buffer (gpu.buffer.renderStencil)
 //
 // Parameters:
-//  - type: either 'uri' or 'base64'.
+//  - type: 'uri', 'base64', or 'binary'.
 //  - alpha: true to use alpha to encode stencil, otherwise red for 'uri' type.
 //
 // Response (same event name) for 'uri' type:
@@ -358,7 +382,7 @@ void WebSocketGPUBufferRenderStencil(DebuggerRequest &req) {
 // Retrieve current texture (gpu.buffer.texture)
 //
 // Parameters:
-//  - type: either 'uri' or 'base64'.
+//  - type: 'uri', 'base64', or 'binary'.
 //  - alpha: boolean to include the alpha channel for 'uri' type.
 //  - level: texture mip level, default 0.
 //
@@ -388,7 +412,7 @@ void WebSocketGPUBufferTexture(DebuggerRequest &req) {
 // Retrieve current CLUT (gpu.buffer.clut)
 //
 // Parameters:
-//  - type: either 'uri' or 'base64'.
+//  - type: 'uri', 'base64', or 'binary'.
 //  - alpha: boolean to include the alpha channel for 'uri' type.
 //  - stackWidth: forced width for 'uri' type (increases height.)
 //
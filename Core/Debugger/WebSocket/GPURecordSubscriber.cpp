@@ -15,6 +15,8 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
+
 #include "Common/Data/Encoding/Base64.h"
 #include "Common/File/FileUtil.h"
 #include "Core/Debugger/WebSocket/GPURecordSubscriber.h"
@@ -49,7 +51,8 @@ WebSocketGPURecordState::~WebSocketGPURecordState() {
 
 // Begin recording (gpu.record.dump)
 //
-// No parameters.
+// Parameters:
+//  - frames: optional number of frames to record into the same dump, default 1.
 //
 // Response (same event name):
 //  - uri: data: URI containing debug dump data.
@@ -60,10 +63,14 @@ void WebSocketGPURecordState::Dump(DebuggerRequest &req) {
 		return req.Fail("CPU not started");
 	}
 
+	uint32_t frames = 1;
+	if (!req.ParamU32("frames", &frames, false, DebuggerParamType::OPTIONAL))
+		return;
+
 	bool result = GPURecord::RecordNextFrame([=](const Path &filename) {
 		lastFilename_ = filename;
 		pending_ = false;
-	});
+	}, (int)std::min(frames, (uint32_t)10000));
 
 	if (!result) {
 		return req.Fail("Recording already in progress");
@@ -15,6 +15,9 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
+#include <vector>
+
 #include "Common/StringUtils.h"
 #include "Core/Config.h"
 #include "Core/Core.h"
@@ -26,6 +29,8 @@
 #include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/MIPS/MIPSDebugInterface.h"
 #include "Core/MIPS/MIPSStackWalk.h"
+#include "Core/HLE/HLE.h"
+#include "Core/HLE/ReplaceTables.h"
 #include "Core/HLE/sceKernelThread.h"
 #include "Core/Reporting.h"
 
@@ -41,6 +46,11 @@ DebuggerSubscriber *WebSocketHLEInit(DebuggerEventHandlerMap &map) {
 	map["hle.func.scan"] = &WebSocketHLEFuncScan;
 	map["hle.module.list"] = &WebSocketHLEModuleList;
 	map["hle.backtrace"] = &WebSocketHLEBacktrace;
+	map["hle.syscall.profile"] = &WebSocketHLESyscallProfile;
+	map["hle.syscall.profile.enable"] = &WebSocketHLESyscallProfileEnable;
+	map["hle.syscall.profile.reset"] = &WebSocketHLESyscallProfileReset;
+	map["hle.replacement.stats"] = &WebSocketHLEReplacementStats;
+	map["hle.replacement.stats.reset"] = &WebSocketHLEReplacementStatsReset;
 
 	return nullptr;
 }
@@ -601,3 +611,111 @@ void WebSocketHLEBacktrace(DebuggerRequest &req) {
 	}
 	json.pop();
 }
+
+// Get syscall timing statistics (hle.syscall.profile)
+//
+// No parameters.
+//
+// Response (same event name):
+//  - enabled: boolean, whether the profiler is currently collecting.
+//  - syscalls: array of objects, slowest total first, each with properties:
+//     - module: string name of the HLE module.
+//     - name: string name of the function.
+//     - calls: number of calls.
+//     - total: number of seconds spent in the function.
+//     - max: number of seconds taken by the slowest call.
+//     - histogram: array of call counts, index i counting calls that took [2^i, 2^(i+1)) ns.
+//
+// Note: only includes syscalls made while the profiler or debug stats were enabled.
+void WebSocketHLESyscallProfile(DebuggerRequest &req) {
+	std::vector<HLESyscallProfile> profile = hleGetSyscallProfile();
+
+	JsonWriter &json = req.Respond();
+	json.writeBool("enabled", hleSyscallProfilerEnabled());
+	json.pushArray("syscalls");
+	for (const auto &info : profile) {
+		json.pushDict();
+		json.writeString("module", info.module);
+		json.writeString("name", info.name);
+		json.writeFloat("calls", (double)info.calls);
+		json.writeFloat("total", info.totalNs / 1000000000.0);
+		json.writeFloat("max", info.maxNs / 1000000000.0);
+		json.pushArray("histogram");
+		for (uint32_t count : info.histogram)
+			json.writeUint(count);
+		json.pop();
+		json.pop();
+	}
+	json.pop();
+}
+
+// Enable or disable the syscall profiler (hle.syscall.profile.enable)
+//
+// Parameters:
+//  - enable: optional boolean, pass false to stop profiling.
+//
+// Response (same event name) with no extra data.
+//
+// Note: takes effect at the start of the next frame.
+void WebSocketHLESyscallProfileEnable(DebuggerRequest &req) {
+	bool enable = true;
+	if (!req.ParamBool("enable", &enable, DebuggerParamType::OPTIONAL))
+		return;
+
+	hleSetSyscallProfilerEnabled(enable);
+	req.Respond();
+}
+
+// Clear syscall timing statistics (hle.syscall.profile.reset)
+//
+// No parameters.
+//
+// Response (same event name) with no extra data.
+void WebSocketHLESyscallProfileReset(DebuggerRequest &req) {
+	hleResetSyscallProfile();
+	req.Respond();
+}
+
+// Get how often each function replacement was called (hle.replacement.stats)
+//
+// No parameters.
+//
+// Response (same event name):
+//  - replacements: array of objects, most hits first, each with properties:
+//     - name: string name of the replaced function, e.g. 'memcpy'.
+//     - index: unsigned integer index in the replacement table.
+//     - hits: number of calls since the game started or the last reset, on any cpu core.
+//
+// Note: replacements that were never hit are left out.
+void WebSocketHLEReplacementStats(DebuggerRequest &req) {
+	std::vector<std::pair<u32, int>> hits;
+	for (int i = 0; i < GetNumReplacementFuncs(); ++i) {
+		u32 count = GetReplacementHitCount(i);
+		if (count != 0)
+			hits.emplace_back(count, i);
+	}
+	std::sort(hits.begin(), hits.end(), [](const std::pair<u32, int> &a, const std::pair<u32, int> &b) {
+		return a.first > b.first;
+	});
+
+	JsonWriter &json = req.Respond();
+	json.pushArray("replacements");
+	for (const auto &hit : hits) {
+		json.pushDict();
+		json.writeString("name", GetReplacementFunc(hit.second)->name);
+		json.writeUint("index", hit.second);
+		json.writeFloat("hits", (double)hit.first);
+		json.pop();
+	}
+	json.pop();
+}
+
+// Clear function replacement hit counts (hle.replacement.stats.reset)
+//
+// No parameters.
+//
+// Response (same event name) with no extra data.
+void WebSocketHLEReplacementStatsReset(DebuggerRequest &req) {
+	ResetReplacementHitCounts();
+	req.Respond();
+}
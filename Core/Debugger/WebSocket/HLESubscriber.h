@@ -32,3 +32,8 @@ void WebSocketHLEFuncRename(DebuggerRequest &req);
 void WebSocketHLEFuncScan(DebuggerRequest &req);
 void WebSocketHLEModuleList(DebuggerRequest &req);
 void WebSocketHLEBacktrace(DebuggerRequest &req);
+void WebSocketHLESyscallProfile(DebuggerRequest &req);
+void WebSocketHLESyscallProfileEnable(DebuggerRequest &req);
+void WebSocketHLESyscallProfileReset(DebuggerRequest &req);
+void WebSocketHLEReplacementStats(DebuggerRequest &req);
+void WebSocketHLEReplacementStatsReset(DebuggerRequest &req);
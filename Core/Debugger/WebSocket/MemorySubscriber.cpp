@@ -187,9 +187,13 @@ void WebSocketMemoryReadU32(DebuggerRequest &req) {
 //  - address: unsigned integer address for the start of the memory range.
 //  - size: unsigned integer specifying size of memory range.
 //  - replacements: optional, false to ignore PPSSPP replacements in MIPS code.
+//  - type: optional, 'base64' (default) or 'binary'.
 //
-// Response (same event name):
+// Response (same event name) for 'base64':
 //  - base64: base64 encode of binary data.
+//
+// Response (same event name) for 'binary':
+//  - size: number of bytes, sent as the very next (binary) message.
 void WebSocketMemoryRead(DebuggerRequest &req) {
 	uint32_t addr;
 	if (!req.ParamU32("address", &addr))
@@ -200,6 +204,11 @@ void WebSocketMemoryRead(DebuggerRequest &req) {
 	bool replacements = true;
 	if (!req.ParamBool("replacements", &replacements, DebuggerParamType::OPTIONAL))
 		return;
+	std::string type = "base64";
+	if (!req.ParamString("type", &type, DebuggerParamType::OPTIONAL))
+		return;
+	if (type != "base64" && type != "binary")
+		return req.Fail("Invalid type, must be either base64 or binary");
 
 	auto memLock = LockMemoryAndCPU(addr, replacements);
 	if (!currentDebugMIPS->isAlive() || !Memory::IsActive())
@@ -211,6 +220,14 @@ void WebSocketMemoryRead(DebuggerRequest &req) {
 		return req.Fail("Invalid size");
 
 	JsonWriter &json = req.Respond();
+	if (type == "binary") {
+		json.writeUint("size", size);
+		req.Finish();
+		// Straight from emulated memory, no encoding.
+		req.ws->Send(Memory::GetPointerUnchecked(addr), size);
+		return;
+	}
+
 	// Start a value without any actual data yet...
 	json.writeRaw("base64", "");
 	req.Flush();
@@ -39,6 +39,12 @@ struct WebSocketClientInfo {
 	std::string name;
 	std::string version;
 	std::map <std::string, bool> disallowed;
+	// Spontaneous events from one poll are sent as a single binary batch.
+	bool batch = false;
+	// Deflate broadcast batches.
+	bool compress = false;
+	// Minimum seconds between broadcast polls.
+	double broadcastInterval = 0.0;
 };
 
 struct DebuggerErrorEvent {
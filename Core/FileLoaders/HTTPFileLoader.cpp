@@ -16,9 +16,13 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 
 #include "Common/Log.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ThreadUtil.h"
+#include "Common/TimeUtil.h"
 #include "Core/Config.h"
 #include "Core/FileLoaders/HTTPFileLoader.h"
 
@@ -152,6 +156,19 @@ int HTTPFileLoader::SendHEAD(const Url &url, std::vector<std::string> &responseH
 }
 
 HTTPFileLoader::~HTTPFileLoader() {
+	{
+		std::lock_guard<std::mutex> guard(blocksMutex_);
+		stopping_ = true;
+		cancel_ = true;
+	}
+	fetchCond_.notify_all();
+	for (auto &thread : fetchThreads_) {
+		thread.join();
+	}
+
+	for (auto &block : blocks_) {
+		delete[] block.second.ptr;
+	}
 	Disconnect();
 }
 
@@ -180,7 +197,6 @@ Path HTTPFileLoader::GetPath() const {
 
 size_t HTTPFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Flags flags) {
 	Prepare();
-	std::lock_guard<std::mutex> guard(readAtMutex_);
 
 	s64 absoluteEnd = std::min(absolutePos + (s64)bytes, filesize_);
 	if (absolutePos >= filesize_ || bytes == 0) {
@@ -188,32 +204,239 @@ size_t HTTPFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Flags f
 		return 0;
 	}
 
-	Connect(10.0);
-	if (!connected_) {
-		return 0;
+	s64 firstBlock = absolutePos >> BLOCK_SHIFT;
+	s64 lastBlock = (absoluteEnd - 1) >> BLOCK_SHIFT;
+	s64 lastFileBlock = (filesize_ - 1) >> BLOCK_SHIFT;
+
+	std::unique_lock<std::mutex> guard(blocksMutex_);
+	// Only a Cancel() from now on stops this read.
+	const u64 cancelGeneration = cancelGeneration_;
+	u64 abortedFetches = abortedFetches_;
+	++generation_;
+	// Mark the blocks we already have as used now, so making space for the rest can't evict them.
+	for (auto it = blocks_.lower_bound(firstBlock); it != blocks_.end() && it->first <= lastBlock; ++it) {
+		it->second.generation = generation_;
+	}
+	QueueFetches(firstBlock, lastBlock, false);
+	// Sequential reads keep a window of blocks fetching ahead of them.
+	if (absolutePos == nextSequentialPos_ && lastBlock < lastFileBlock) {
+		QueueFetches(lastBlock + 1, std::min(lastBlock + readAheadBlocks_, lastFileBlock), true);
+	}
+	nextSequentialPos_ = absoluteEnd;
+
+	size_t readSize = 0;
+	s64 pos = absolutePos;
+	while (pos < absoluteEnd) {
+		auto block = blocks_.find(pos >> BLOCK_SHIFT);
+		if (block == blocks_.end()) {
+			if (abortedFetches_ != abortedFetches && cancelGeneration_ == cancelGeneration) {
+				// We were waiting on a fetch an earlier Cancel() aborted, so ask again.
+				abortedFetches = abortedFetches_;
+				QueueFetches(pos >> BLOCK_SHIFT, lastBlock, false);
+				continue;
+			}
+			// The fetch failed, return what we have.
+			break;
+		}
+		if (block->second.pending) {
+			if (cancelGeneration_ != cancelGeneration) {
+				break;
+			}
+			// Woken by each finished fetch, and by Cancel().
+			blocksCond_.wait(guard);
+			continue;
+		}
+
+		block->second.generation = generation_;
+		size_t offset = (size_t)(pos & (BLOCK_SIZE - 1));
+		size_t toRead = (size_t)std::min(absoluteEnd - pos, (s64)(BLOCK_SIZE - offset));
+		memcpy((u8 *)data + readSize, block->second.ptr + offset, toRead);
+		readSize += toRead;
+		pos += toRead;
+	}
+
+	return readSize;
+}
+
+void HTTPFileLoader::Cancel() {
+	{
+		std::lock_guard<std::mutex> guard(blocksMutex_);
+		cancelGeneration_++;
+		// Nothing will fetch these now, so don't leave readers waiting on them.
+		for (std::deque<FetchRequest> *queue : { &demandFetches_, &aheadFetches_ }) {
+			for (const FetchRequest &fetch : *queue) {
+				for (s64 i = fetch.firstBlock; i < fetch.firstBlock + fetch.count; ++i) {
+					blocks_.erase(i);
+				}
+			}
+			queue->clear();
+		}
+		// Also stops Prepare(), if it's still running.
+		cancel_ = true;
+	}
+	blocksCond_.notify_all();
+	fetchCond_.notify_all();
+}
+
+void HTTPFileLoader::QueueFetches(s64 firstBlock, s64 lastBlock, bool readingAhead) {
+	// Split the missing blocks into runs, each run is a single range request.
+	s64 runStart = -1;
+	for (s64 i = firstBlock; i <= lastBlock + 1; ++i) {
+		bool missing = i <= lastBlock && blocks_.find(i) == blocks_.end();
+		if (missing && runStart == -1) {
+			runStart = i;
+		}
+		if (runStart != -1 && (!missing || i - runStart == MAX_BLOCKS_PER_FETCH)) {
+			FetchRequest fetch{ runStart, i - runStart };
+			if (!MakeCacheSpaceFor((size_t)fetch.count, readingAhead)) {
+				return;
+			}
+			for (s64 j = fetch.firstBlock; j < fetch.firstBlock + fetch.count; ++j) {
+				blocks_[j].generation = generation_;
+			}
+			if (readingAhead) {
+				aheadFetches_.push_back(fetch);
+			} else {
+				demandFetches_.push_back(fetch);
+			}
+			fetchCond_.notify_one();
+			runStart = missing ? i : -1;
+		}
+	}
+
+	if (fetchThreads_.empty() && (!demandFetches_.empty() || !aheadFetches_.empty())) {
+		for (int i = 0; i < MAX_FETCH_THREADS; ++i) {
+			fetchThreads_.push_back(std::thread(std::bind(&HTTPFileLoader::FetchThread, this)));
+		}
+	}
+}
+
+bool HTTPFileLoader::MakeCacheSpaceFor(size_t blocks, bool readingAhead) {
+	while (blocks_.size() + blocks > MAX_BLOCKS_CACHED) {
+		if (readingAhead) {
+			// Don't push out blocks for something that might not be used.
+			return false;
+		}
+
+		auto oldest = blocks_.end();
+		for (auto it = blocks_.begin(); it != blocks_.end(); ++it) {
+			if (!it->second.pending && (oldest == blocks_.end() || it->second.generation < oldest->second.generation)) {
+				oldest = it;
+			}
+		}
+		if (oldest == blocks_.end()) {
+			// Everything is in flight, just go over.
+			break;
+		}
+		delete[] oldest->second.ptr;
+		blocks_.erase(oldest);
+	}
+	return true;
+}
+
+struct HTTPFileLoader::FetchConnection {
+	http::Client client;
+	bool connected = false;
+};
+
+void HTTPFileLoader::FetchThread() {
+	SetCurrentThreadName("HTTPFileFetch");
+
+	AndroidJNIThreadContext jniContext;
+
+	FetchConnection conn;
+	conn.client.SetUserAgent(StringFromFormat("PPSSPP/%s", PPSSPP_GIT_VERSION));
+	conn.client.SetDataTimeout(20.0);
+	conn.client.SetKeepAlive(true);
+
+	while (true) {
+		FetchRequest fetch;
+		{
+			std::unique_lock<std::mutex> guard(blocksMutex_);
+			while (!stopping_) {
+				if (cancel_ && activeFetches_ == 0) {
+					// Everything the cancel was meant for is done.
+					cancel_ = false;
+				}
+				// New fetches wait until a cancel has run its course, so it can't hit them too.
+				if (!cancel_ && (!demandFetches_.empty() || !aheadFetches_.empty()))
+					break;
+				fetchCond_.wait(guard);
+			}
+			if (stopping_) {
+				break;
+			}
+			std::deque<FetchRequest> &queue = demandFetches_.empty() ? aheadFetches_ : demandFetches_;
+			fetch = queue.front();
+			queue.pop_front();
+			activeFetches_++;
+		}
+
+		bool success = FetchBlocks(conn, fetch);
+		{
+			std::lock_guard<std::mutex> guard(blocksMutex_);
+			if (!success) {
+				if (cancel_)
+					abortedFetches_++;
+				for (s64 i = fetch.firstBlock; i < fetch.firstBlock + fetch.count; ++i) {
+					blocks_.erase(i);
+				}
+			}
+			if (--activeFetches_ == 0 && cancel_) {
+				fetchCond_.notify_all();
+			}
+		}
+		blocksCond_.notify_all();
 	}
 
+	if (conn.connected) {
+		conn.client.Disconnect();
+	}
+}
+
+bool HTTPFileLoader::FetchBlocks(FetchConnection &conn, const FetchRequest &fetch) {
+	s64 absolutePos = fetch.firstBlock << BLOCK_SHIFT;
+	s64 absoluteEnd = std::min((fetch.firstBlock + fetch.count) << BLOCK_SHIFT, filesize_);
+
+	if (!conn.connected) {
+		if (!conn.client.Resolve(url_.Host().c_str(), url_.Port())) {
+			latestError_ = "Could not connect (name not resolved)";
+			return false;
+		}
+		conn.connected = conn.client.Connect(3, 10.0, &cancel_);
+		if (!conn.connected) {
+			latestError_ = "Could not connect (refused to connect)";
+			return false;
+		}
+	}
+
+	auto fail = [&](const char *error) {
+		latestError_ = error;
+		conn.client.Disconnect();
+		conn.connected = false;
+		return false;
+	};
+
 	char requestHeaders[4096];
 	// Note that the Range header is *inclusive*.
 	snprintf(requestHeaders, sizeof(requestHeaders),
 		"Range: bytes=%lld-%lld\r\n", absolutePos, absoluteEnd - 1);
 
+	double startTime = time_now_d();
+	net::RequestProgress progress(&cancel_);
 	http::RequestParams req(url_.Resource(), "*/*");
-	int err = client_.SendRequest("GET", req, requestHeaders, &progress_);
+	int err = conn.client.SendRequest("GET", req, requestHeaders, &progress);
 	if (err < 0) {
-		latestError_ = "Invalid response reading data";
-		Disconnect();
-		return 0;
+		return fail("Invalid response reading data");
 	}
 
 	net::Buffer readbuf;
 	std::vector<std::string> responseHeaders;
-	int code = client_.ReadResponseHeaders(&readbuf, responseHeaders, &progress_);
+	int code = conn.client.ReadResponseHeaders(&readbuf, responseHeaders, &progress);
+	double latency = time_now_d() - startTime;
 	if (code != 206) {
 		ERROR_LOG(LOADER, "HTTP server did not respond with range, received code=%03d", code);
-		latestError_ = "Invalid response reading data";
-		Disconnect();
-		return 0;
+		return fail("Invalid response reading data");
 	}
 
 	// TODO: Expire cache via ETag, etc.
@@ -237,27 +460,60 @@ size_t HTTPFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Flags f
 		}
 	}
 
-	// TODO: Would be nice to read directly.
 	net::Buffer output;
-	int res = client_.ReadResponseEntity(&readbuf, responseHeaders, &output, &progress_);
+	int res = conn.client.ReadResponseEntity(&readbuf, responseHeaders, &output, &progress);
 	if (res != 0) {
 		ERROR_LOG(LOADER, "Unable to read HTTP response entity: %d", res);
-		// Let's take anything we got anyway.  Not worse than returning nothing?
+		return fail("Invalid response reading data");
+	}
+	if (!supportedResponse || (s64)output.size() != absoluteEnd - absolutePos) {
+		ERROR_LOG(LOADER, "HTTP server did not respond with the range we wanted.");
+		return fail("Invalid response reading data");
 	}
 
-	// TODO: Keepalive instead.
-	Disconnect();
+	std::string connectionHeader;
+	if (!http::GetHeaderValue(responseHeaders, "Connection", &connectionHeader) || !equalsNoCase(connectionHeader, "keep-alive")) {
+		// Older servers will close on us, reconnect next time.
+		conn.client.Disconnect();
+		conn.connected = false;
+	}
 
-	if (!supportedResponse) {
-		ERROR_LOG(LOADER, "HTTP server did not respond with the range we wanted.");
-		latestError_ = "Invalid response reading data";
-		return 0;
+	UpdateReadAhead(latency, time_now_d() - startTime, output.size());
+
+	std::lock_guard<std::mutex> guard(blocksMutex_);
+	for (s64 i = fetch.firstBlock; i < fetch.firstBlock + fetch.count; ++i) {
+		size_t toTake = std::min(output.size(), (size_t)BLOCK_SIZE);
+		auto block = blocks_.find(i);
+		if (block == blocks_.end() || !block->second.pending) {
+			// Shouldn't happen, pending blocks aren't evicted.
+			output.Skip(toTake);
+			continue;
+		}
+		block->second.ptr = new u8[BLOCK_SIZE];
+		output.Take(toTake, (char *)block->second.ptr);
+		block->second.pending = false;
+	}
+	return true;
+}
+
+void HTTPFileLoader::UpdateReadAhead(double latency, double seconds, size_t bytes) {
+	double transferTime = std::max(seconds - latency, 0.001);
+	double bandwidth = (double)bytes / transferTime;
+
+	std::lock_guard<std::mutex> guard(blocksMutex_);
+	// Smooth it out, so a single slow request doesn't collapse the window.
+	if (bandwidthEstimate_ == 0.0) {
+		bandwidthEstimate_ = bandwidth;
+		latencyEstimate_ = latency;
+	} else {
+		bandwidthEstimate_ = bandwidthEstimate_ * 0.75 + bandwidth * 0.25;
+		latencyEstimate_ = latencyEstimate_ * 0.75 + latency * 0.25;
 	}
 
-	size_t readBytes = output.size();
-	output.Take(readBytes, (char *)data);
-	filepos_ = absolutePos + readBytes;
-	return readBytes;
+	// Enough in flight to cover a round trip, with room for the request itself.
+	double bandwidthDelay = bandwidthEstimate_ * latencyEstimate_;
+	int blocks = (int)(2.0 * bandwidthDelay / BLOCK_SIZE) + MAX_BLOCKS_PER_FETCH;
+	readAheadBlocks_ = std::max((int)MIN_READAHEAD_BLOCKS, std::min(blocks, (int)MAX_READAHEAD_BLOCKS));
 }
 
 void HTTPFileLoader::Connect(double timeout) {
@@ -17,7 +17,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 #include "Common/File/Path.h"
@@ -46,12 +51,10 @@ class HTTPFileLoader : public FileLoader {
 	}
 	size_t ReadAt(s64 absolutePos, size_t bytes, void *data, Flags flags = Flags::NONE) override;
 
-	void Cancel() override {
-		cancel_ = true;
-	}
+	void Cancel() override;
 
 	std::string LatestError() const override {
-		return latestError_;
+		return latestError_.load();
 	}
 
 private:
@@ -67,16 +70,72 @@ class HTTPFileLoader : public FileLoader {
 		connected_ = false;
 	}
 
+	struct FetchRequest {
+		s64 firstBlock;
+		s64 count;
+	};
+	struct FetchConnection;
+
+	// These expect blocksMutex_ to be locked.
+	void QueueFetches(s64 firstBlock, s64 lastBlock, bool readingAhead);
+	bool MakeCacheSpaceFor(size_t blocks, bool readingAhead);
+
+	void FetchThread();
+	bool FetchBlocks(FetchConnection &conn, const FetchRequest &fetch);
+	void UpdateReadAhead(double latency, double seconds, size_t bytes);
+
+	enum {
+		BLOCK_SIZE = 65536,
+		BLOCK_SHIFT = 16,
+		MAX_BLOCKS_PER_FETCH = 8,
+		MAX_BLOCKS_CACHED = 1024, // 64 MB
+		MIN_READAHEAD_BLOCKS = 4,
+		MAX_READAHEAD_BLOCKS = 128,
+		// Also the number of kept alive connections, since each thread has one.
+		MAX_FETCH_THREADS = 4,
+	};
+
 	s64 filesize_ = 0;
-	s64 filepos_ = 0;
 	Url url_;
 	http::Client client_;
 	net::RequestProgress progress_;
 	::Path filename_;
 	bool connected_ = false;
-	bool cancel_ = false;
-	const char *latestError_ = "";
+	// Aborts network requests in flight.  Only cleared by the fetch threads, once no fetch is
+	// running (or by Connect(), before there are any.)
+	std::atomic<bool> cancel_{};
+	// Set by the fetch threads too.
+	std::atomic<const char *> latestError_{ "" };
 
 	std::once_flag preparedFlag_;
-	std::mutex readAtMutex_;
+
+	struct BlockInfo {
+		u8 *ptr = nullptr;
+		u64 generation = 0;
+		// Still being fetched, ptr isn't valid yet.
+		bool pending = true;
+	};
+
+	std::map<s64, BlockInfo> blocks_;
+	u64 generation_ = 0;
+	std::mutex blocksMutex_;
+	// Signaled whenever a fetch finishes, successfully or not.
+	std::condition_variable blocksCond_;
+
+	std::deque<FetchRequest> demandFetches_;
+	std::deque<FetchRequest> aheadFetches_;
+	std::condition_variable fetchCond_;
+	std::vector<std::thread> fetchThreads_;
+	int activeFetches_ = 0;
+	// Bumped by Cancel(), so reads in progress give up without resetting anything.
+	u64 cancelGeneration_ = 0;
+	// Fetches that failed because of a Cancel(), so later reads waiting on them can retry.
+	u64 abortedFetches_ = 0;
+	bool stopping_ = false;
+
+	// Read-ahead is sized from the measured bandwidth-delay product, to keep the pipe full.
+	s64 nextSequentialPos_ = -1;
+	double latencyEstimate_ = 0.0;
+	double bandwidthEstimate_ = 0.0;
+	int readAheadBlocks_ = MIN_READAHEAD_BLOCKS;
 };
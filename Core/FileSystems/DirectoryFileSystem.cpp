@@ -124,7 +124,7 @@ bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, File
 #if HOST_IS_CASE_SENSITIVE
 	if (access & (FILEACCESS_APPEND | FILEACCESS_CREATE | FILEACCESS_WRITE)) {
 		DEBUG_LOG(FILESYS, "Checking case for path %s", fileName.c_str());
-		if (!FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST)) {
+		if (!FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST, caseCache_)) {
 			error = SCE_KERNEL_ERROR_ERRNO_FILE_NOT_FOUND;
 			return false;  // or go on and attempt (for a better error code than just 0?)
 		}
@@ -257,7 +257,7 @@ bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, File
 
 #if HOST_IS_CASE_SENSITIVE
 	if (!success && !(access & FILEACCESS_CREATE)) {
-		if (!FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST)) {
+		if (!FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST, caseCache_)) {
 			error = SCE_KERNEL_ERROR_ERRNO_FILE_NOT_FOUND;
 			return false;
 		}
@@ -302,6 +302,11 @@ bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, File
 	if (access & (FILEACCESS_APPEND | FILEACCESS_CREATE | FILEACCESS_WRITE)) {
 		MemoryStick_NotifyWrite();
 	}
+#if HOST_IS_CASE_SENSITIVE
+	// We may have just added a name to the directory.
+	if (success && (access & FILEACCESS_CREATE) && caseCache_)
+		caseCache_->Clear();
+#endif
 
 	return success;
 }
@@ -437,7 +442,15 @@ void DirectoryFileHandle::Close()
 #endif
 }
 
+void DirectoryFileSystem::NotifyEntriesChanged() {
+#if HOST_IS_CASE_SENSITIVE
+	caseCache_.Clear();
+#endif
+	MemoryStick_NotifyWrite();
+}
+
 void DirectoryFileSystem::CloseAll() {
+	std::lock_guard<std::mutex> guard(entriesLock_);
 	for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
 		INFO_LOG(FILESYS, "DirectoryFileSystem::CloseAll(): Force closing %d (%s)", (int)iter->first, iter->second.guestFilename.c_str());
 		iter->second.hFile.Close();
@@ -452,14 +465,14 @@ bool DirectoryFileSystem::MkDir(const std::string &dirname) {
 	// duplicate (different case) directories
 
 	std::string fixedCase = dirname;
-	if (!FixPathCase(basePath, fixedCase, FPC_PARTIAL_ALLOWED))
+	if (!FixPathCase(basePath, fixedCase, FPC_PARTIAL_ALLOWED, &caseCache_))
 		result = false;
 	else
 		result = File::CreateFullPath(GetLocalPath(fixedCase));
 #else
 	result = File::CreateFullPath(GetLocalPath(dirname));
 #endif
-	MemoryStick_NotifyWrite();
+	NotifyEntriesChanged();
 	return ReplayApplyDisk(ReplayAction::MKDIR, result, CoreTiming::GetGlobalTimeUs()) != 0;
 }
 
@@ -469,20 +482,20 @@ bool DirectoryFileSystem::RmDir(const std::string &dirname) {
 #if HOST_IS_CASE_SENSITIVE
 	// Maybe we're lucky?
 	if (File::DeleteDirRecursively(fullName)) {
-		MemoryStick_NotifyWrite();
+		NotifyEntriesChanged();
 		return (bool)ReplayApplyDisk(ReplayAction::RMDIR, true, CoreTiming::GetGlobalTimeUs());
 	}
 
 	// Nope, fix case and try again.  Should we try again?
 	std::string fullPath = dirname;
-	if (!FixPathCase(basePath, fullPath, FPC_FILE_MUST_EXIST))
+	if (!FixPathCase(basePath, fullPath, FPC_FILE_MUST_EXIST, &caseCache_))
 		return (bool)ReplayApplyDisk(ReplayAction::RMDIR, false, CoreTiming::GetGlobalTimeUs());
 
 	fullName = GetLocalPath(fullPath);
 #endif
 
 	bool result = File::DeleteDirRecursively(fullName);
-	MemoryStick_NotifyWrite();
+	NotifyEntriesChanged();
 	return ReplayApplyDisk(ReplayAction::RMDIR, result, CoreTiming::GetGlobalTimeUs()) != 0;
 }
 
@@ -507,7 +520,7 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 
 #if HOST_IS_CASE_SENSITIVE
 	// In case TO should overwrite a file with different case.  Check error code?
-	if (!FixPathCase(basePath, fullTo, FPC_PATH_MUST_EXIST))
+	if (!FixPathCase(basePath, fullTo, FPC_PATH_MUST_EXIST, &caseCache_))
 		return ReplayApplyDisk(ReplayAction::FILE_RENAME, -1, CoreTiming::GetGlobalTimeUs());
 #endif
 
@@ -520,7 +533,7 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 	{
 		// May have failed due to case sensitivity on FROM, so try again.  Check error code?
 		std::string fullFromPath = from;
-		if (!FixPathCase(basePath, fullFromPath, FPC_FILE_MUST_EXIST))
+		if (!FixPathCase(basePath, fullFromPath, FPC_FILE_MUST_EXIST, &caseCache_))
 			return ReplayApplyDisk(ReplayAction::FILE_RENAME, -1, CoreTiming::GetGlobalTimeUs());
 		fullFrom = GetLocalPath(fullFromPath);
 
@@ -530,7 +543,7 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 
 	// TODO: Better error codes.
 	int result = retValue ? 0 : (int)SCE_KERNEL_ERROR_ERRNO_FILE_ALREADY_EXISTS;
-	MemoryStick_NotifyWrite();
+	NotifyEntriesChanged();
 	return ReplayApplyDisk(ReplayAction::FILE_RENAME, result, CoreTiming::GetGlobalTimeUs());
 }
 
@@ -544,7 +557,7 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 	{
 		// May have failed due to case sensitivity, so try again.  Try even if it fails?
 		std::string fullNamePath = filename;
-		if (!FixPathCase(basePath, fullNamePath, FPC_FILE_MUST_EXIST))
+		if (!FixPathCase(basePath, fullNamePath, FPC_FILE_MUST_EXIST, &caseCache_))
 			return (bool)ReplayApplyDisk(ReplayAction::FILE_REMOVE, false, CoreTiming::GetGlobalTimeUs());
 		localPath = GetLocalPath(fullNamePath);
 
@@ -552,13 +565,16 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 	}
 #endif
 
-	MemoryStick_NotifyWrite();
+	NotifyEntriesChanged();
 	return ReplayApplyDisk(ReplayAction::FILE_REMOVE, retValue, CoreTiming::GetGlobalTimeUs()) != 0;
 }
 
 int DirectoryFileSystem::OpenFile(std::string filename, FileAccess access, const char *devicename) {
 	OpenFileEntry entry;
 	entry.hFile.fileSystemFlags_ = flags;
+#if HOST_IS_CASE_SENSITIVE
+	entry.hFile.caseCache_ = &caseCache_;
+#endif
 	u32 err = 0;
 	bool success = entry.hFile.Open(basePath, filename, (FileAccess)(access & FILEACCESS_PSP_FLAGS), err);
 	if (err == 0 && !success) {
@@ -592,6 +608,7 @@ int DirectoryFileSystem::OpenFile(std::string filename, FileAccess access, const
 		entry.guestFilename = filename;
 		entry.access = (FileAccess)(access & FILEACCESS_PSP_FLAGS);
 
+		std::lock_guard<std::mutex> guard(entriesLock_);
 		entries[newHandle] = entry;
 
 		return newHandle;
@@ -599,6 +616,7 @@ int DirectoryFileSystem::OpenFile(std::string filename, FileAccess access, const
 }
 
 void DirectoryFileSystem::CloseFile(u32 handle) {
+	std::lock_guard<std::mutex> guard(entriesLock_);
 	EntryMap::iterator iter = entries.find(handle);
 	if (iter != entries.end()) {
 		hAlloc->FreeHandle(handle);
@@ -629,14 +647,14 @@ size_t DirectoryFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size) {
 }
 
 size_t DirectoryFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) {
-	EntryMap::iterator iter = entries.find(handle);
-	if (iter != entries.end()) {
+	OpenFileEntry *entry = FindEntry(handle);
+	if (entry) {
 		if (size < 0) {
-			ERROR_LOG_REPORT(FILESYS, "Invalid read for %lld bytes from disk %s", size, iter->second.guestFilename.c_str());
+			ERROR_LOG_REPORT(FILESYS, "Invalid read for %lld bytes from disk %s", size, entry->guestFilename.c_str());
 			return 0;
 		}
 
-		size_t bytesRead = iter->second.hFile.Read(pointer,size);
+		size_t bytesRead = entry->hFile.Read(pointer,size);
 		return bytesRead;
 	} else {
 		// This shouldn't happen...
@@ -651,9 +669,9 @@ size_t DirectoryFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size) {
 }
 
 size_t DirectoryFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size, int &usec) {
-	EntryMap::iterator iter = entries.find(handle);
-	if (iter != entries.end()) {
-		size_t bytesWritten = iter->second.hFile.Write(pointer,size);
+	OpenFileEntry *entry = FindEntry(handle);
+	if (entry) {
+		size_t bytesWritten = entry->hFile.Write(pointer,size);
 		return bytesWritten;
 	} else {
 		//This shouldn't happen...
@@ -662,6 +680,13 @@ size_t DirectoryFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size, i
 	}
 }
 
+DirectoryFileSystem::OpenFileEntry *DirectoryFileSystem::FindEntry(u32 handle) {
+	// Map nodes are stable, so the entry stays valid after unlocking until the handle is closed.
+	std::lock_guard<std::mutex> guard(entriesLock_);
+	EntryMap::iterator iter = entries.find(handle);
+	return iter != entries.end() ? &iter->second : nullptr;
+}
+
 size_t DirectoryFileSystem::SeekFile(u32 handle, s32 position, FileMove type) {
 	EntryMap::iterator iter = entries.find(handle);
 	if (iter != entries.end()) {
@@ -681,7 +706,7 @@ PSPFileInfo DirectoryFileSystem::GetFileInfo(std::string filename) {
 	Path fullName = GetLocalPath(filename);
 	if (!File::GetFileInfo(fullName, &info)) {
 #if HOST_IS_CASE_SENSITIVE
-		if (! FixPathCase(basePath, filename, FPC_FILE_MUST_EXIST))
+		if (! FixPathCase(basePath, filename, FPC_FILE_MUST_EXIST, &caseCache_))
 			return ReplayApplyDiskFileInfo(x, CoreTiming::GetGlobalTimeUs());
 		fullName = GetLocalPath(filename);
 
@@ -806,7 +831,7 @@ std::vector<PSPFileInfo> DirectoryFileSystem::GetDirListing(const std::string &p
 	if (!success) {
 		// TODO: Case sensitivity should be checked on a file system basis, right?
 		std::string fixedPath = path;
-		if (FixPathCase(basePath, fixedPath, FPC_FILE_MUST_EXIST)) {
+		if (FixPathCase(basePath, fixedPath, FPC_FILE_MUST_EXIST, &caseCache_)) {
 			// May have failed due to case sensitivity, try again
 			localPath = GetLocalPath(fixedPath);
 			success = File::GetFilesInDir(localPath, &files, nullptr, flags);
@@ -879,7 +904,7 @@ u64 DirectoryFileSystem::FreeSpace(const std::string &path) {
 
 #if HOST_IS_CASE_SENSITIVE
 	std::string fixedCase = path;
-	if (FixPathCase(basePath, fixedCase, FPC_FILE_MUST_EXIST)) {
+	if (FixPathCase(basePath, fixedCase, FPC_FILE_MUST_EXIST, &caseCache_)) {
 		// May have failed due to case sensitivity, try again.
 		if (free_disk_space(GetLocalPath(fixedCase), result)) {
 			return ReplayApplyDisk64(ReplayAction::FREESPACE, result, CoreTiming::GetGlobalTimeUs());
@@ -913,6 +938,9 @@ void DirectoryFileSystem::DoState(PointerWrap &p) {
 		u32 key;
 		OpenFileEntry entry;
 		entry.hFile.fileSystemFlags_ = flags;
+#if HOST_IS_CASE_SENSITIVE
+		entry.hFile.caseCache_ = &caseCache_;
+#endif
 		for (u32 i = 0; i < num; i++) {
 			Do(p, key);
 			Do(p, entry.guestFilename);
@@ -935,6 +963,7 @@ void DirectoryFileSystem::DoState(PointerWrap &p) {
 			// Let's hope that things don't go that badly with the file mysteriously auto-closed.
 			// Better than not loading the save state at all, hopefully.
 			if (!brokenFile) {
+				std::lock_guard<std::mutex> guard(entriesLock_);
 				entries[key] = entry;
 			}
 		}
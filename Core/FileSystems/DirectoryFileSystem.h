@@ -20,6 +20,7 @@
 // TODO: Remove the Windows-specific code, FILE is fine there too.
 
 #include <map>
+#include <mutex>
 
 #include "Common/File/Path.h"
 #include "Core/FileSystems/FileSystem.h"
@@ -43,6 +44,10 @@ struct DirectoryFileHandle {
 	bool replay_ = true;
 	bool inGameDir_ = false;
 	FileSystemFlags fileSystemFlags_ = (FileSystemFlags)0;
+#if HOST_IS_CASE_SENSITIVE
+	// Owned by the file system, if any.
+	PathCaseCache *caseCache_ = nullptr;
+#endif
 
 	DirectoryFileHandle() {}
 
@@ -86,6 +91,7 @@ class DirectoryFileSystem : public IFileSystem {
 	u64 FreeSpace(const std::string &path) override;
 
 	bool ComputeRecursiveDirSizeIfFast(const std::string &path, int64_t *size) override;
+	bool ConcurrentIO() override { return true; }
 
 private:
 	struct OpenFileEntry {
@@ -96,11 +102,18 @@ class DirectoryFileSystem : public IFileSystem {
 
 	typedef std::map<u32, OpenFileEntry> EntryMap;
 	EntryMap entries;
+	// Guards changes to entries, since reads and writes look them up without MetaFileSystem's lock.
+	std::mutex entriesLock_;
 	Path basePath;
 	IHandleAllocator *hAlloc;
 	FileSystemFlags flags;
+#if HOST_IS_CASE_SENSITIVE
+	PathCaseCache caseCache_;
+#endif
 
 	Path GetLocalPath(std::string internalPath) const;
+	OpenFileEntry *FindEntry(u32 handle);
+	void NotifyEntriesChanged();
 };
 
 // VFSFileSystem: Ability to map in Android APK paths as well! Does not support all features, only meant for fonts.
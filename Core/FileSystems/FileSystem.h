@@ -147,6 +147,9 @@ class IFileSystem {
 	virtual FileSystemFlags Flags() = 0;
 	virtual u64      FreeSpace(const std::string &path) = 0;
 	virtual bool     ComputeRecursiveDirSizeIfFast(const std::string &path, int64_t *size) = 0;
+	// If true, MetaFileSystem calls ReadFile/WriteFile without holding its lock, so they may run
+	// alongside other calls on other handles.
+	virtual bool     ConcurrentIO() { return false; }
 };
 
 
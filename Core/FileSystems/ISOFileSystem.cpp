@@ -29,6 +29,8 @@
 #include "Core/Reporting.h"
 
 const int sectorSize = 2048;
+// Directories with at least this many entries get a hash index for lookups.
+static const size_t CHILD_INDEX_MIN_ENTRIES = 16;
 
 bool parseLBN(const std::string &filename, u32 *sectorStart, u32 *readSize) {
 	// The format of this is: "/sce_lbn" "0x"? HEX* ANY* "_size" "0x"? HEX* ANY*
@@ -253,9 +255,29 @@ void ISOFileSystem::ReadDirectory(TreeEntry *root) {
 			root->children.push_back(entry);
 		}
 	}
+
+	if (root->children.size() >= CHILD_INDEX_MIN_ENTRIES) {
+		root->childIndex.reserve(root->children.size());
+		// emplace keeps the first of any duplicate names, same as a linear scan would find.
+		for (TreeEntry *child : root->children)
+			root->childIndex.emplace(child->name, child);
+	}
 	root->valid = true;
 }
 
+ISOFileSystem::TreeEntry *ISOFileSystem::TreeEntry::FindChild(const std::string &childName) const {
+	if (!childIndex.empty()) {
+		auto it = childIndex.find(childName);
+		return it != childIndex.end() ? it->second : nullptr;
+	}
+
+	for (TreeEntry *child : children) {
+		if (child->name == childName)
+			return child;
+	}
+	return nullptr;
+}
+
 ISOFileSystem::TreeEntry *ISOFileSystem::GetFromPath(const std::string &path, bool catchError) {
 	const size_t pathLength = path.length();
 
@@ -277,40 +299,41 @@ ISOFileSystem::TreeEntry *ISOFileSystem::GetFromPath(const std::string &path, bo
 	if (pathLength <= pathIndex)
 		return treeroot;
 
+	// Entries are never freed and the ISO can't change, so a found path stays valid.
+	std::string cacheKey = path.substr(pathIndex);
+	auto cached = pathCache_.find(cacheKey);
+	if (cached != pathCache_.end())
+		return cached->second;
+
 	TreeEntry *entry = treeroot;
 	while (true) {
 		if (!entry->valid) {
 			ReadDirectory(entry);
 		}
 		TreeEntry *nextEntry = nullptr;
-		std::string name = "";
+		size_t nameLength = 0;
 		if (pathLength > pathIndex) {
 			size_t nextSlashIndex = path.find_first_of('/', pathIndex);
 			if (nextSlashIndex == std::string::npos)
 				nextSlashIndex = pathLength;
 
 			const std::string firstPathComponent = path.substr(pathIndex, nextSlashIndex - pathIndex);
-			for (size_t i = 0; i < entry->children.size(); i++) {
-				const std::string &n = entry->children[i]->name;
-				if (firstPathComponent == n) {
-					//yay we got it
-					nextEntry = entry->children[i];
-					name = n;
-					break;
-				}
-			}
+			nextEntry = entry->FindChild(firstPathComponent);
+			nameLength = firstPathComponent.length();
 		}
-		
+
 		if (nextEntry) {
 			entry = nextEntry;
 			if (!entry->valid)
 				ReadDirectory(entry);
-			pathIndex += name.length();
+			pathIndex += nameLength;
 			if (pathIndex < pathLength && path[pathIndex] == '/')
 				++pathIndex;
 
-			if (pathLength <= pathIndex)
+			if (pathLength <= pathIndex) {
+				pathCache_[cacheKey] = entry;
 				return entry;
+			}
 		} else {
 			if (catchError)
 				ERROR_LOG(FILESYS, "File '%s' not found", path.c_str());
@@ -651,6 +674,12 @@ std::vector<PSPFileInfo> ISOFileSystem::GetDirListing(const std::string &path, b
 		entry = GetFromPath("/");
 	}
 
+	if (entry->listingValid) {
+		if (exists)
+			*exists = true;
+		return entry->listing;
+	}
+
 	const std::string dot(".");
 	const std::string dotdot("..");
 
@@ -674,6 +703,11 @@ std::vector<PSPFileInfo> ISOFileSystem::GetDirListing(const std::string &path, b
 		x.numSectors = (u32)((e->size + sectorSize - 1) / sectorSize);
 		myVector.push_back(x);
 	}
+	// Only cache once the directory was actually read, otherwise it was a read error.
+	if (entry->valid) {
+		entry->listing = myVector;
+		entry->listingValid = true;
+	}
 	if (exists)
 		*exists = true;
 	return myVector;
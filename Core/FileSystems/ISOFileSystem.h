@@ -20,6 +20,7 @@
 #include <map>
 #include <list>
 #include <memory>
+#include <unordered_map>
 
 #include "FileSystem.h"
 
@@ -76,6 +77,14 @@ class ISOFileSystem : public IFileSystem {
 
 		bool valid = false;
 		std::vector<TreeEntry *> children;
+		// Name -> child, only built for large directories (where a linear scan hurts.)
+		std::unordered_map<std::string, TreeEntry *> childIndex;
+
+		// GetDirListing result, built on first use.  The ISO never changes.
+		std::vector<PSPFileInfo> listing;
+		bool listingValid = false;
+
+		TreeEntry *FindChild(const std::string &childName) const;
 	};
 
 	struct OpenFileEntry {
@@ -96,6 +105,9 @@ class ISOFileSystem : public IFileSystem {
 
 	TreeEntry entireISO;
 
+	// Successful lookups by path (after the leading "./" or "/"), so repeated opens skip the walk.
+	std::unordered_map<std::string, TreeEntry *> pathCache_;
+
 	void ReadDirectory(TreeEntry *root);
 	TreeEntry *GetFromPath(const std::string &path, bool catchError = true);
 	std::string EntryFullPath(TreeEntry *e);
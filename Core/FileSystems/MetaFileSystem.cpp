@@ -178,6 +178,19 @@ IFileSystem *MetaFileSystem::GetHandleOwner(u32 handle)
 	return nullptr;
 }
 
+std::shared_ptr<IFileSystem> MetaFileSystem::GetHandleOwnerShared(u32 handle)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	for (size_t i = 0; i < fileSystems.size(); i++)
+	{
+		if (fileSystems[i].system->OwnsHandle(handle))
+			return fileSystems[i].system;
+	}
+
+	// Not found
+	return nullptr;
+}
+
 int MetaFileSystem::MapFilePath(const std::string &_inpath, std::string &outpath, MountPoint **system)
 {
 	int error = SCE_KERNEL_ERROR_ERRNO_FILE_NOT_FOUND;
@@ -532,42 +545,50 @@ void MetaFileSystem::CloseFile(u32 handle)
 
 size_t MetaFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->ReadFile(handle, pointer, size);
-	else
+	std::unique_lock<std::recursive_mutex> guard(lock);
+	std::shared_ptr<IFileSystem> sys = GetHandleOwnerShared(handle);
+	if (!sys)
 		return 0;
+	// Only needed the lock to find the owner, don't hold up other files during the transfer.
+	if (sys->ConcurrentIO())
+		guard.unlock();
+	return sys->ReadFile(handle, pointer, size);
 }
 
 size_t MetaFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->WriteFile(handle, pointer, size);
-	else
+	std::unique_lock<std::recursive_mutex> guard(lock);
+	std::shared_ptr<IFileSystem> sys = GetHandleOwnerShared(handle);
+	if (!sys)
 		return 0;
+	// Only needed the lock to find the owner, don't hold up other files during the transfer.
+	if (sys->ConcurrentIO())
+		guard.unlock();
+	return sys->WriteFile(handle, pointer, size);
 }
 
 size_t MetaFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->ReadFile(handle, pointer, size, usec);
-	else
+	std::unique_lock<std::recursive_mutex> guard(lock);
+	std::shared_ptr<IFileSystem> sys = GetHandleOwnerShared(handle);
+	if (!sys)
 		return 0;
+	// Only needed the lock to find the owner, don't hold up other files during the transfer.
+	if (sys->ConcurrentIO())
+		guard.unlock();
+	return sys->ReadFile(handle, pointer, size, usec);
 }
 
 size_t MetaFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size, int &usec)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->WriteFile(handle, pointer, size, usec);
-	else
+	std::unique_lock<std::recursive_mutex> guard(lock);
+	std::shared_ptr<IFileSystem> sys = GetHandleOwnerShared(handle);
+	if (!sys)
 		return 0;
+	// Only needed the lock to find the owner, don't hold up other files during the transfer.
+	if (sys->ConcurrentIO())
+		guard.unlock();
+	return sys->WriteFile(handle, pointer, size, usec);
 }
 
 size_t MetaFileSystem::SeekFile(u32 handle, s32 position, FileMove type)
@@ -68,6 +68,8 @@ class MetaFileSystem : public IHandleAllocator, public IFileSystem {
 	IFileSystem *GetSystem(const std::string &prefix);
 	IFileSystem *GetSystemFromFilename(const std::string &filename);
 	IFileSystem *GetHandleOwner(u32 handle);
+	// Keeps the filesystem alive even if it's unmounted while in use.
+	std::shared_ptr<IFileSystem> GetHandleOwnerShared(u32 handle);
 	FileSystemFlags FlagsFromFilename(const std::string &filename) {
 		IFileSystem *sys = GetSystemFromFilename(filename);
 		return sys ? sys->Flags() : FileSystemFlags::NONE;
@@ -15,13 +15,18 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
+#include <atomic>
 #include <cstdarg>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
 #include "Common/Profiler/Profiler.h"
 
+#include "Common/BitScan.h"
 #include "Common/Log.h"
 #include "Common/Serialize/SerializeFuncs.h"
 #include "Common/TimeUtil.h"
@@ -69,6 +74,28 @@ static const HLEFunction *latestSyscall = nullptr;
 static uint32_t latestSyscallPC = 0;
 static int idleOp;
 
+struct SyscallProfileEntry {
+	// Only the emu thread writes these, so relaxed loads and stores are enough.
+	std::atomic<uint64_t> calls;
+	std::atomic<uint64_t> totalNs;
+	std::atomic<uint64_t> maxNs;
+	std::atomic<uint32_t> histogram[HLE_SYSCALL_HISTOGRAM_BUCKETS];
+	// Emu thread only, for the per frame debug stats.
+	uint32_t frame;
+	uint64_t frameNs;
+};
+
+// Indexed by syscallProfileOffsets[module] + func.
+static std::unique_ptr<SyscallProfileEntry[]> syscallProfile;
+static std::vector<int> syscallProfileOffsets;
+// Only guards the lifetime of the table, never taken by the emu thread while running.
+static std::mutex syscallProfileLock;
+static std::atomic<bool> syscallProfileRequested;
+static std::atomic<bool> syscallProfileResetPending;
+static bool syscallProfileActive = false;
+static double syscallProfileTicksPerSecond = 1.0;
+static double syscallProfileNsPerTick = 1.0;
+
 struct HLEMipsCallInfo {
 	u32 func;
 	PSPAction *action;
@@ -118,6 +145,17 @@ void HLEInit() {
 	RegisterAllModules();
 	delayedResultEvent = CoreTiming::RegisterEvent("HLEDelayedResult", hleDelayResultFinish);
 	idleOp = GetSyscallOp("FakeSysCalls", NID_IDLE);
+
+	std::lock_guard<std::mutex> guard(syscallProfileLock);
+	int numFunctions = 0;
+	syscallProfileOffsets.resize(moduleDB.size());
+	for (size_t i = 0; i < moduleDB.size(); ++i) {
+		syscallProfileOffsets[i] = numFunctions;
+		numFunctions += moduleDB[i].numFunctions;
+	}
+	syscallProfile.reset(new SyscallProfileEntry[numFunctions]());
+	syscallProfileTicksPerSecond = time_ticks_per_second();
+	syscallProfileNsPerTick = 1000000000.0 / syscallProfileTicksPerSecond;
 }
 
 void HLEDoState(PointerWrap &p) {
@@ -154,7 +192,12 @@ void HLEShutdown() {
 	hleAfterSyscall = HLE_AFTER_NOTHING;
 	latestSyscall = nullptr;
 	latestSyscallPC = 0;
-	moduleDB.clear();
+	{
+		std::lock_guard<std::mutex> guard(syscallProfileLock);
+		syscallProfile.reset();
+		syscallProfileOffsets.clear();
+		moduleDB.clear();
+	}
 	enqueuedMipsCalls.clear();
 	for (auto p : mipsCallActions) {
 		delete p;
@@ -589,40 +632,112 @@ inline void hleFinishSyscall(const HLEFunction &info)
 	hleAfterSyscallReschedReason = 0;
 }
 
-static void updateSyscallStats(int modulenum, int funcnum, double total)
-{
-	const char *name = moduleDB[modulenum].funcTable[funcnum].name;
-	// Ignore this one, especially for msInSyscalls (although that ignores CoreTiming events.)
-	if (0 == strcmp(name, "_sceKernelIdle"))
+static void ClearSyscallProfile() {
+	int numFunctions = syscallProfileOffsets.empty() ? 0 : syscallProfileOffsets.back() + moduleDB.back().numFunctions;
+	for (int i = 0; i < numFunctions; ++i) {
+		SyscallProfileEntry &entry = syscallProfile[i];
+		entry.calls.store(0, std::memory_order_relaxed);
+		entry.totalNs.store(0, std::memory_order_relaxed);
+		entry.maxNs.store(0, std::memory_order_relaxed);
+		for (auto &bucket : entry.histogram)
+			bucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+template <typename T>
+static inline void AddRelaxed(std::atomic<T> &value, T amount) {
+	// Single writer, so no need for a locked add.
+	value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static void updateSyscallStats(int modulenum, int funcnum, uint64_t ticks) {
+	if (syscallProfileResetPending.load(std::memory_order_relaxed)) {
+		ClearSyscallProfile();
+		syscallProfileResetPending = false;
+	}
+
+	SyscallProfileEntry &entry = syscallProfile[syscallProfileOffsets[modulenum] + funcnum];
+	uint64_t ns = (uint64_t)(ticks * syscallProfileNsPerTick);
+	AddRelaxed<uint64_t>(entry.calls, 1);
+	AddRelaxed<uint64_t>(entry.totalNs, ns);
+	if (ns > entry.maxNs.load(std::memory_order_relaxed))
+		entry.maxNs.store(ns, std::memory_order_relaxed);
+	uint32_t clampedNs = ns > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)ns;
+	AddRelaxed<uint32_t>(entry.histogram[31 - clz32_nonzero(clampedNs | 1)], 1);
+
+	if (!coreCollectDebugStats)
 		return;
 
-	if (total > kernelStats.slowestSyscallTime)
-	{
+	const char *name = moduleDB[modulenum].funcTable[funcnum].name;
+	double total = ns * (1.0 / 1000000000.0);
+	if (total > kernelStats.slowestSyscallTime) {
 		kernelStats.slowestSyscallTime = total;
 		kernelStats.slowestSyscallName = name;
 	}
 	kernelStats.msInSyscalls += total;
 
-	KernelStatsSyscall statCall(modulenum, funcnum);
-	auto summedStat = kernelStats.summedMsInSyscalls.find(statCall);
-	if (summedStat == kernelStats.summedMsInSyscalls.end())
-	{
-		kernelStats.summedMsInSyscalls[statCall] = total;
-		if (total > kernelStats.summedSlowestSyscallTime)
-		{
-			kernelStats.summedSlowestSyscallTime = total;
-			kernelStats.summedSlowestSyscallName = name;
-		}
+	if (entry.frame != kernelStats.frame) {
+		entry.frame = kernelStats.frame;
+		entry.frameNs = 0;
 	}
-	else
-	{
-		double newTotal = kernelStats.summedMsInSyscalls[statCall] += total;
-		if (newTotal > kernelStats.summedSlowestSyscallTime)
-		{
-			kernelStats.summedSlowestSyscallTime = newTotal;
-			kernelStats.summedSlowestSyscallName = name;
+	entry.frameNs += ns;
+	double summed = entry.frameNs * (1.0 / 1000000000.0);
+	if (summed > kernelStats.summedSlowestSyscallTime) {
+		kernelStats.summedSlowestSyscallTime = summed;
+		kernelStats.summedSlowestSyscallName = name;
+	}
+}
+
+void hleSetSyscallProfilerEnabled(bool enable) {
+	syscallProfileRequested = enable;
+}
+
+bool hleSyscallProfilerEnabled() {
+	return syscallProfileRequested;
+}
+
+bool hleUpdateSyscallProfilerState() {
+	bool requested = syscallProfileRequested;
+	if (requested == syscallProfileActive)
+		return false;
+	syscallProfileActive = requested;
+	return true;
+}
+
+void hleResetSyscallProfile() {
+	syscallProfileResetPending = true;
+}
+
+std::vector<HLESyscallProfile> hleGetSyscallProfile() {
+	std::vector<HLESyscallProfile> result;
+	std::lock_guard<std::mutex> guard(syscallProfileLock);
+	if (!syscallProfile)
+		return result;
+
+	for (size_t i = 0; i < syscallProfileOffsets.size(); ++i) {
+		const HLEModule &module = moduleDB[i];
+		for (int func = 0; func < module.numFunctions; ++func) {
+			const SyscallProfileEntry &entry = syscallProfile[syscallProfileOffsets[i] + func];
+			uint64_t calls = entry.calls.load(std::memory_order_relaxed);
+			if (calls == 0)
+				continue;
+
+			HLESyscallProfile info;
+			info.module = module.name;
+			info.name = module.funcTable[func].name;
+			info.calls = calls;
+			info.totalNs = entry.totalNs.load(std::memory_order_relaxed);
+			info.maxNs = entry.maxNs.load(std::memory_order_relaxed);
+			for (int b = 0; b < HLE_SYSCALL_HISTOGRAM_BUCKETS; ++b)
+				info.histogram[b] = entry.histogram[b].load(std::memory_order_relaxed);
+			result.push_back(info);
 		}
 	}
+
+	std::sort(result.begin(), result.end(), [](const HLESyscallProfile &a, const HLESyscallProfile &b) {
+		return a.totalNs > b.totalNs;
+	});
+	return result;
 }
 
 inline void CallSyscallWithFlags(const HLEFunction *info)
@@ -685,7 +800,7 @@ const HLEFunction *GetSyscallFuncPointer(MIPSOpcode op)
 }
 
 void *GetQuickSyscallFunc(MIPSOpcode op) {
-	if (coreCollectDebugStats)
+	if (coreCollectDebugStats || syscallProfileActive)
 		return nullptr;
 
 	const HLEFunction *info = GetSyscallFuncPointer(op);
@@ -714,10 +829,9 @@ void hleSetFlipTime(double t) {
 void CallSyscall(MIPSOpcode op)
 {
 	PROFILE_THIS_SCOPE("syscall");
-	double start = 0.0;  // need to initialize to fix the race condition where coreCollectDebugStats is enabled in the middle of this func.
-	if (coreCollectDebugStats) {
-		start = time_now_d();
-	}
+	// Read once, in case coreCollectDebugStats is enabled in the middle of this func.
+	const bool profile = coreCollectDebugStats || syscallProfileActive;
+	uint64_t start = profile ? time_now_ticks() : 0;
 
 	const HLEFunction *info = GetSyscallFuncPointer(op);
 	if (!info) {
@@ -738,17 +852,22 @@ void CallSyscall(MIPSOpcode op)
 		ERROR_LOG_REPORT(HLE, "Unimplemented HLE function %s", info->name ? info->name : "(\?\?\?)");
 	}
 
-	if (coreCollectDebugStats) {
+	if (profile) {
 		u32 callno = (op >> 6) & 0xFFFFF; //20 bits
 		int funcnum = callno & 0xFFF;
 		int modulenum = (callno & 0xFF000) >> 12;
-		double total = time_now_d() - start - hleSteppingTime;
-		if (total >= hleFlipTime)
-			total -= hleFlipTime;
-		_dbg_assert_msg_(total >= 0.0, "Time spent in syscall became negative");
+		uint64_t ticks = time_now_ticks() - start;
+		// Don't count time spent in the debugger or waiting for flip.
+		uint64_t steppingTicks = (uint64_t)(hleSteppingTime * syscallProfileTicksPerSecond);
+		uint64_t flipTicks = (uint64_t)(hleFlipTime * syscallProfileTicksPerSecond);
+		ticks = ticks >= steppingTicks ? ticks - steppingTicks : 0;
+		if (ticks >= flipTicks)
+			ticks -= flipTicks;
 		hleSteppingTime = 0.0;
 		hleFlipTime = 0.0;
-		updateSyscallStats(modulenum, funcnum, total);
+		// Ignore idle, especially for msInSyscalls (although that ignores CoreTiming events.)
+		if (op != idleOp)
+			updateSyscallStats(modulenum, funcnum, ticks);
 	}
 }
 
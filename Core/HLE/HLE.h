@@ -19,7 +19,9 @@
 
 #include <cstdio>
 #include <cstdarg>
+#include <cstdint>
 #include <type_traits>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "Common/Log.h"
@@ -155,6 +157,31 @@ const HLEFunction *GetSyscallFuncPointer(MIPSOpcode op);
 // For jit, takes arg: const HLEFunction *
 void *GetQuickSyscallFunc(MIPSOpcode op);
 
+enum {
+	// Bucket i counts calls that took [2^i, 2^(i+1)) nanoseconds.
+	HLE_SYSCALL_HISTOGRAM_BUCKETS = 32,
+};
+
+struct HLESyscallProfile {
+	const char *module;
+	const char *name;
+	uint64_t calls;
+	uint64_t totalNs;
+	uint64_t maxNs;
+	uint32_t histogram[HLE_SYSCALL_HISTOGRAM_BUCKETS];
+};
+
+// Per syscall counts and latency histograms, cheap enough to leave on.  While enabled, the jit
+// goes through CallSyscall instead of calling syscalls directly.  Takes effect at the next frame.
+void hleSetSyscallProfilerEnabled(bool enable);
+bool hleSyscallProfilerEnabled();
+// Call on the emu thread.  Returns true if the state changed, and the jit cache must be cleared.
+bool hleUpdateSyscallProfilerState();
+// The counters are cleared at the next syscall.
+void hleResetSyscallProfile();
+// Safe from any thread.  Only functions that were called, slowest total first.
+std::vector<HLESyscallProfile> hleGetSyscallProfile();
+
 void hleDoLogInternal(LogType t, LogLevel level, u64 res, const char *file, int line, const char *reportTag, char retmask, const char *reason, const char *formatted_reason);
 
 template <typename T>
@@ -17,12 +17,15 @@
 
 #include "ppsspp_config.h"
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <unordered_map>
 
+#include "Common/BitSet.h"
 #include "Common/CommonTypes.h"
 #include "Common/Data/Convert/SmallDataConvert.h"
 #include "Common/Log.h"
+#include "Common/Math/CrossSIMD.h"
 #include "Common/Swap.h"
 #include "Core/Config.h"
 #include "Core/System.h"
@@ -42,10 +45,6 @@
 #include "GPU/GPUInterface.h"
 #include "GPU/GPUState.h"
 
-#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
-#include <emmintrin.h>
-#endif
-
 enum class GPUReplacementSkip {
 	MEMSET = 1,
 	MEMCPY = 2,
@@ -494,6 +493,175 @@ static int Replace_strncmp() {
 	return 10 + bytes / 4;  // approximation
 }
 
+// Returns the offset of the first differing byte, or bytes if equal.
+static u32 FindFirstMismatch(const u8 *a, const u8 *b, u32 bytes) {
+	u32 offset = 0;
+#if PPSSPP_ARCH(SSE2)
+	for (; offset + 16 <= bytes; offset += 16) {
+		__m128i va = _mm_loadu_si128((const __m128i *)(a + offset));
+		__m128i vb = _mm_loadu_si128((const __m128i *)(b + offset));
+		u32 equalMask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+		if (equalMask != 0xFFFF)
+			return offset + LeastSignificantSetBit(~equalMask & 0xFFFF);
+	}
+#elif PPSSPP_ARCH(ARM64_NEON)
+	for (; offset + 16 <= bytes; offset += 16) {
+		uint8x16_t eq = vceqq_u8(vld1q_u8(a + offset), vld1q_u8(b + offset));
+		if (vminvq_u8(eq) != 0xFF)
+			break;
+	}
+#endif
+	for (; offset < bytes; ++offset) {
+		if (a[offset] != b[offset])
+			break;
+	}
+	return offset;
+}
+
+static int Replace_memcmp() {
+	u32 aPtr = PARAM(0);
+	u32 bPtr = PARAM(1);
+	u32 bytes = PARAM(2);
+	// Compare what's valid on the host, the rest byte by byte like the guest would (so bad accesses get reported.)
+	u32 validBytes = std::min(Memory::ValidSize(aPtr, bytes), Memory::ValidSize(bPtr, bytes));
+	const u8 *a = Memory::GetPointerRange(aPtr, validBytes);
+	const u8 *b = Memory::GetPointerRange(bPtr, validBytes);
+	u32 offset = a && b ? FindFirstMismatch(a, b, validBytes) : 0;
+	s32 result = 0;
+	if (offset < validBytes) {
+		// Like newlib, return the difference of the first mismatching bytes.
+		result = (s32)a[offset] - (s32)b[offset];
+	} else {
+		for (; offset < bytes; ++offset) {
+			result = (s32)Memory::Read_U8(aPtr + offset) - (s32)Memory::Read_U8(bPtr + offset);
+			if (result != 0)
+				break;
+		}
+	}
+	RETURN(result);
+
+	const u32 readBytes = std::min(offset + 1, bytes);
+	if (readBytes != 0 && MemBlockInfoDetailed(readBytes)) {
+		NotifyMemInfo(MemBlockFlags::READ, aPtr, readBytes, "ReplaceMemcmp");
+		NotifyMemInfo(MemBlockFlags::READ, bPtr, readBytes, "ReplaceMemcmp");
+	}
+	return 10 + offset / 4;  // approximation
+}
+
+static int Replace_memchr() {
+	u32 srcPtr = PARAM(0);
+	u8 c = (u8)PARAM(1);
+	u32 bytes = PARAM(2);
+	u32 validBytes = Memory::ValidSize(srcPtr, bytes);
+	const u8 *src = Memory::GetPointerRange(srcPtr, validBytes);
+	u32 scanned = validBytes;
+	bool found = false;
+	if (src && validBytes != 0) {
+		// The host memchr is already vectorized.
+		const u8 *match = (const u8 *)memchr(src, c, validBytes);
+		if (match) {
+			scanned = (u32)(match - src);
+			found = true;
+		}
+	}
+	// Anything past the valid part is read like the guest would, so bad accesses get reported.
+	for (; !found && scanned < bytes; ++scanned) {
+		found = Memory::Read_U8(srcPtr + scanned) == c;
+		if (found)
+			break;
+	}
+	RETURN(found ? srcPtr + scanned : 0);
+	return 10 + scanned / 4;  // approximation
+}
+
+// Finds the terminator within valid memory. Returns false if the string runs off the end of it.
+static bool ValidStringLen(u32 ptr, u32 *len) {
+	u32 validBytes = Memory::ValidSize(ptr, 0x07FFFFFF);
+	const u8 *p = Memory::GetPointerRange(ptr, validBytes);
+	const u8 *end = p ? (const u8 *)memchr(p, '\0', validBytes) : nullptr;
+	if (!end)
+		return false;
+	*len = (u32)(end - p);
+	return true;
+}
+
+static int Replace_strchr() {
+	u32 srcPtr = PARAM(0);
+	u8 c = (u8)PARAM(1);
+	u32 len;
+	u32 result = 0;
+	if (ValidStringLen(srcPtr, &len)) {
+		const u8 *src = Memory::GetPointerRange(srcPtr, len + 1);
+		// Note that searching for '\0' finds the terminator, like the real thing.
+		const u8 *found = (const u8 *)memchr(src, c, len + 1);
+		result = found ? srcPtr + (u32)(found - src) : 0;
+	} else {
+		// Runs into invalid memory, read it like the guest would.
+		for (len = 0; ; ++len) {
+			u8 v = Memory::Read_U8(srcPtr + len);
+			if (v == c) {
+				result = srcPtr + len;
+				break;
+			}
+			if (v == 0)
+				break;
+		}
+	}
+	RETURN(result);
+	return 10 + len / 2;  // approximation
+}
+
+static int Replace_strrchr() {
+	u32 srcPtr = PARAM(0);
+	u8 c = (u8)PARAM(1);
+	u32 len;
+	u32 result = 0;
+	if (ValidStringLen(srcPtr, &len)) {
+		const char *src = (const char *)Memory::GetPointerRange(srcPtr, len + 1);
+		const char *found = c == '\0' ? src + len : strrchr(src, c);
+		result = found ? srcPtr + (u32)(found - src) : 0;
+	} else {
+		// Runs into invalid memory, read it like the guest would.
+		for (len = 0; ; ++len) {
+			u8 v = Memory::Read_U8(srcPtr + len);
+			if (v == c)
+				result = srcPtr + len;
+			if (v == 0)
+				break;
+		}
+	}
+	RETURN(result);
+	return 10 + len / 2;  // approximation
+}
+
+static int Replace_strcat() {
+	u32 destPtr = PARAM(0);
+	u32 srcPtr = PARAM(1);
+	u32 destLen, srcLen;
+	char *dst = nullptr;
+	if (ValidStringLen(destPtr, &destLen) && ValidStringLen(srcPtr, &srcLen))
+		dst = (char *)Memory::GetPointerWriteRange(destPtr, destLen + srcLen + 1);
+	if (dst) {
+		const char *src = (const char *)Memory::GetPointerRange(srcPtr, srcLen + 1);
+		memmove(dst + destLen, src, srcLen + 1);
+		if (MemBlockInfoDetailed(srcLen + 1)) {
+			NotifyMemInfoCopy(destPtr + destLen, srcPtr, srcLen + 1, "ReplaceStrcat/");
+		}
+	} else {
+		// Something runs into invalid memory, copy like the guest would.
+		for (destLen = 0; Memory::Read_U8(destPtr + destLen) != 0; ++destLen)
+			continue;
+		for (srcLen = 0; ; ++srcLen) {
+			u8 v = Memory::Read_U8(srcPtr + srcLen);
+			Memory::Write_U8(v, destPtr + destLen + srcLen);
+			if (v == 0)
+				break;
+		}
+	}
+	RETURN(destPtr);
+	return 10 + (destLen + srcLen) / 2;  // approximation
+}
+
 static int Replace_fabsf() {
 	RETURNF(fabsf(PARAMF(0)));
 	return 4;
@@ -1466,6 +1634,19 @@ static int Hook_ZZT3_select_hack() {
 
 #define JITFUNC(f) (&MIPSComp::MIPSFrontendInterface::f)
 
+static size_t GetReplacementIndex(ReplaceFunc func);
+
+// The interpreters and all the jits call replacements through this, so hit counts cover every core.
+// Entries sharing a function are all counted on the first of them.
+template <ReplaceFunc Func>
+static int CountedReplacement() {
+	static const size_t index = GetReplacementIndex(&CountedReplacement<Func>);
+	CountReplacementHit(index);
+	return Func();
+}
+
+#define REPLACEFUNC(f) (&CountedReplacement<&f>)
+
 // Can either replace with C functions or functions emitted in Asm/ArmAsm.
 static const ReplacementTableEntry entries[] = {
 	// TODO: I think some games can be helped quite a bit by implementing the
@@ -1473,123 +1654,137 @@ static const ReplacementTableEntry entries[] = {
 	// should of course be implemented JIT style, inline.
 
 	/*  These two collide (same hash) and thus can't be replaced :/
-	{ "asinf", &Replace_asinf, 0, REPFLAG_DISABLED },
-	{ "acosf", &Replace_acosf, 0, REPFLAG_DISABLED },
+	{ "asinf", REPLACEFUNC(Replace_asinf), 0, REPFLAG_DISABLED },
+	{ "acosf", REPLACEFUNC(Replace_acosf), 0, REPFLAG_DISABLED },
 	*/
 
-	{ "sinf", &Replace_sinf, 0, REPFLAG_DISABLED },
-	{ "cosf", &Replace_cosf, 0, REPFLAG_DISABLED },
-	{ "tanf", &Replace_tanf, 0, REPFLAG_DISABLED },
-	{ "atanf", &Replace_atanf, 0, REPFLAG_DISABLED },
-	{ "sqrtf", &Replace_sqrtf, 0, REPFLAG_DISABLED },
-	{ "atan2f", &Replace_atan2f, 0, REPFLAG_DISABLED },
-	{ "floorf", &Replace_floorf, 0, REPFLAG_DISABLED },
-	{ "ceilf", &Replace_ceilf, 0, REPFLAG_DISABLED },
-
-	{ "memcpy", &Replace_memcpy, 0, 0 },
-	{ "memcpy_jak", &Replace_memcpy_jak, 0, REPFLAG_SLICED },
-	{ "memcpy16", &Replace_memcpy16, 0, 0 },
-	{ "memcpy_swizzled", &Replace_memcpy_swizzled, 0, 0 },
-	{ "memmove", &Replace_memmove, 0, 0 },
-	{ "memset", &Replace_memset, 0, 0 },
-	{ "memset_jak", &Replace_memset_jak, 0, REPFLAG_SLICED },
-	{ "strlen", &Replace_strlen, 0, REPFLAG_DISABLED },
-	{ "strcpy", &Replace_strcpy, 0, REPFLAG_DISABLED },
-	{ "strncpy", &Replace_strncpy, 0, REPFLAG_DISABLED },
-	{ "strcmp", &Replace_strcmp, 0, REPFLAG_DISABLED },
-	{ "strncmp", &Replace_strncmp, 0, REPFLAG_DISABLED },
-	{ "fabsf", &Replace_fabsf, JITFUNC(Replace_fabsf), REPFLAG_ALLOWINLINE | REPFLAG_DISABLED },
-	{ "dl_write_matrix", &Replace_dl_write_matrix, 0, REPFLAG_DISABLED }, // &MIPSComp::Jit::Replace_dl_write_matrix, REPFLAG_DISABLED },
-	{ "dl_write_matrix_2", &Replace_dl_write_matrix, 0, REPFLAG_DISABLED },
-	{ "gta_dl_write_matrix", &Replace_gta_dl_write_matrix, 0, REPFLAG_DISABLED },
+	{ "sinf", REPLACEFUNC(Replace_sinf), 0, REPFLAG_DISABLED },
+	{ "cosf", REPLACEFUNC(Replace_cosf), 0, REPFLAG_DISABLED },
+	{ "tanf", REPLACEFUNC(Replace_tanf), 0, REPFLAG_DISABLED },
+	{ "atanf", REPLACEFUNC(Replace_atanf), 0, REPFLAG_DISABLED },
+	{ "sqrtf", REPLACEFUNC(Replace_sqrtf), 0, REPFLAG_DISABLED },
+	{ "atan2f", REPLACEFUNC(Replace_atan2f), 0, REPFLAG_DISABLED },
+	{ "floorf", REPLACEFUNC(Replace_floorf), 0, REPFLAG_DISABLED },
+	{ "ceilf", REPLACEFUNC(Replace_ceilf), 0, REPFLAG_DISABLED },
+
+	{ "memcpy", REPLACEFUNC(Replace_memcpy), 0, 0 },
+	{ "memcpy_jak", REPLACEFUNC(Replace_memcpy_jak), 0, REPFLAG_SLICED },
+	{ "memcpy16", REPLACEFUNC(Replace_memcpy16), 0, 0 },
+	{ "memcpy_swizzled", REPLACEFUNC(Replace_memcpy_swizzled), 0, 0 },
+	{ "memmove", REPLACEFUNC(Replace_memmove), 0, 0 },
+	{ "memset", REPLACEFUNC(Replace_memset), 0, 0 },
+	{ "memset_jak", REPLACEFUNC(Replace_memset_jak), 0, REPFLAG_SLICED },
+	{ "strlen", REPLACEFUNC(Replace_strlen), 0, REPFLAG_DISABLED },
+	{ "strcpy", REPLACEFUNC(Replace_strcpy), 0, REPFLAG_DISABLED },
+	{ "strncpy", REPLACEFUNC(Replace_strncpy), 0, REPFLAG_DISABLED },
+	{ "strcmp", REPLACEFUNC(Replace_strcmp), 0, REPFLAG_DISABLED },
+	{ "strncmp", REPLACEFUNC(Replace_strncmp), 0, REPFLAG_DISABLED },
+	{ "memcmp", REPLACEFUNC(Replace_memcmp), 0, 0 },
+	{ "memchr", REPLACEFUNC(Replace_memchr), 0, 0 },
+	{ "strchr", REPLACEFUNC(Replace_strchr), 0, 0 },
+	{ "strrchr", REPLACEFUNC(Replace_strrchr), 0, 0 },
+	{ "strcat", REPLACEFUNC(Replace_strcat), 0, 0 },
+	{ "fabsf", REPLACEFUNC(Replace_fabsf), JITFUNC(Replace_fabsf), REPFLAG_ALLOWINLINE | REPFLAG_DISABLED },
+	{ "dl_write_matrix", REPLACEFUNC(Replace_dl_write_matrix), 0, REPFLAG_DISABLED }, // &MIPSComp::Jit::Replace_dl_write_matrix, REPFLAG_DISABLED },
+	{ "dl_write_matrix_2", REPLACEFUNC(Replace_dl_write_matrix), 0, REPFLAG_DISABLED },
+	{ "gta_dl_write_matrix", REPLACEFUNC(Replace_gta_dl_write_matrix), 0, REPFLAG_DISABLED },
 	// dl_write_matrix_3 doesn't take the dl as a parameter, it accesses a global instead. Need to extract the address of the global from the code when replacing...
 	// Haven't investigated write_matrix_4 and 5 but I think they are similar to 1 and 2.
 
-	// { "vmmul_q_transp", &Replace_vmmul_q_transp, 0, REPFLAG_DISABLED },
+	// { "vmmul_q_transp", REPLACEFUNC(Replace_vmmul_q_transp), 0, REPFLAG_DISABLED },
 
-	{ "godseaterburst_blit_texture", &Hook_godseaterburst_blit_texture, 0, REPFLAG_HOOKENTER },
-	{ "godseaterburst_depthmask_5551", &Hook_godseaterburst_depthmask_5551, 0, REPFLAG_HOOKENTER },
-	{ "hexyzforce_monoclome_thread", &Hook_hexyzforce_monoclome_thread, 0, REPFLAG_HOOKENTER, 0x58 },
-	{ "starocean_write_stencil", &Hook_starocean_write_stencil, 0, REPFLAG_HOOKENTER, 0x260 },
-	{ "topx_create_saveicon", &Hook_topx_create_saveicon, 0, REPFLAG_HOOKENTER, 0x34 },
-	{ "ff1_battle_effect", &Hook_ff1_battle_effect, 0, REPFLAG_HOOKENTER },
+	{ "godseaterburst_blit_texture", REPLACEFUNC(Hook_godseaterburst_blit_texture), 0, REPFLAG_HOOKENTER },
+	{ "godseaterburst_depthmask_5551", REPLACEFUNC(Hook_godseaterburst_depthmask_5551), 0, REPFLAG_HOOKENTER },
+	{ "hexyzforce_monoclome_thread", REPLACEFUNC(Hook_hexyzforce_monoclome_thread), 0, REPFLAG_HOOKENTER, 0x58 },
+	{ "starocean_write_stencil", REPLACEFUNC(Hook_starocean_write_stencil), 0, REPFLAG_HOOKENTER, 0x260 },
+	{ "topx_create_saveicon", REPLACEFUNC(Hook_topx_create_saveicon), 0, REPFLAG_HOOKENTER, 0x34 },
+	{ "ff1_battle_effect", REPLACEFUNC(Hook_ff1_battle_effect), 0, REPFLAG_HOOKENTER },
 	// This is actually used in other games, not just Dissidia.
-	{ "dissidia_recordframe_avi", &Hook_dissidia_recordframe_avi, 0, REPFLAG_HOOKENTER },
-	{ "brandish_download_frame", &Hook_brandish_download_frame, 0, REPFLAG_HOOKENTER },
-	{ "growlanser_create_saveicon", &Hook_growlanser_create_saveicon, 0, REPFLAG_HOOKENTER, 0x7C },
-	{ "sd_gundam_g_generation_download_frame", &Hook_sd_gundam_g_generation_download_frame, 0, REPFLAG_HOOKENTER, 0x48},
-	{ "narisokonai_download_frame", &Hook_narisokonai_download_frame, 0, REPFLAG_HOOKENTER, 0x14 },
-	{ "kirameki_school_life_download_frame", &Hook_kirameki_school_life_download_frame, 0, REPFLAG_HOOKENTER },
-	{ "orenoimouto_download_frame", &Hook_orenoimouto_download_frame, 0, REPFLAG_HOOKENTER },
-	{ "sakurasou_download_frame", &Hook_sakurasou_download_frame, 0, REPFLAG_HOOKENTER, 0xF8 },
-	{ "suikoden1_and_2_download_frame_1", &Hook_suikoden1_and_2_download_frame_1, 0, REPFLAG_HOOKENTER, 0x9C },
-	{ "suikoden1_and_2_download_frame_2", &Hook_suikoden1_and_2_download_frame_2, 0, REPFLAG_HOOKENTER, 0x48 },
-	{ "rezel_cross_download_frame", &Hook_rezel_cross_download_frame, 0, REPFLAG_HOOKENTER, 0x54 },
-	{ "kagaku_no_ensemble_download_frame", &Hook_kagaku_no_ensemble_download_frame, 0, REPFLAG_HOOKENTER, 0x38 },
-	{ "soranokiseki_fc_download_frame", &Hook_soranokiseki_fc_download_frame, 0, REPFLAG_HOOKENTER, 0x180 },
-	{ "soranokiseki_sc_download_frame", &Hook_soranokiseki_sc_download_frame, 0, REPFLAG_HOOKENTER, },
-	{ "bokunonatsuyasumi4_download_frame", &Hook_bokunonatsuyasumi4_download_frame, 0, REPFLAG_HOOKENTER, 0x8C },
-	{ "danganronpa2_1_download_frame", &Hook_danganronpa2_1_download_frame, 0, REPFLAG_HOOKENTER, 0x68 },
-	{ "danganronpa2_2_download_frame", &Hook_danganronpa2_2_download_frame, 0, REPFLAG_HOOKENTER, 0x94 },
-	{ "danganronpa1_1_download_frame", &Hook_danganronpa1_1_download_frame, 0, REPFLAG_HOOKENTER, 0x78 },
-	{ "danganronpa1_2_download_frame", &Hook_danganronpa1_2_download_frame, 0, REPFLAG_HOOKENTER, 0xA8 },
-	{ "kankabanchoutbr_download_frame", &Hook_kankabanchoutbr_download_frame, 0, REPFLAG_HOOKENTER, },
-	{ "orenoimouto_download_frame_2", &Hook_orenoimouto_download_frame_2, 0, REPFLAG_HOOKENTER, },
-	{ "rewrite_download_frame", &Hook_rewrite_download_frame, 0, REPFLAG_HOOKENTER, 0x5C },
-	{ "kudwafter_download_frame", &Hook_kudwafter_download_frame, 0, REPFLAG_HOOKENTER, 0x58 },
-	{ "kumonohatateni_download_frame", &Hook_kumonohatateni_download_frame, 0, REPFLAG_HOOKENTER, },
-	{ "otomenoheihou_download_frame", &Hook_otomenoheihou_download_frame, 0, REPFLAG_HOOKENTER, 0x14 },
-	{ "grisaianokajitsu_download_frame", &Hook_grisaianokajitsu_download_frame, 0, REPFLAG_HOOKENTER, 0x14 },
-	{ "kokoroconnect_download_frame", &Hook_kokoroconnect_download_frame, 0, REPFLAG_HOOKENTER, 0x60 },
-	{ "toheart2_download_frame", &Hook_toheart2_download_frame, 0, REPFLAG_HOOKENTER, },
-	{ "toheart2_download_frame_2", &Hook_toheart2_download_frame_2, 0, REPFLAG_HOOKENTER, 0x18 },
-	{ "flowers_download_frame", &Hook_flowers_download_frame, 0, REPFLAG_HOOKENTER, 0x44 },
-	{ "motorstorm_download_frame", &Hook_motorstorm_download_frame, 0, REPFLAG_HOOKENTER, },
-	{ "utawarerumono_download_frame", &Hook_utawarerumono_download_frame, 0, REPFLAG_HOOKENTER, },
-	{ "photokano_download_frame", &Hook_photokano_download_frame, 0, REPFLAG_HOOKENTER, 0x2C },
-	{ "photokano_download_frame_2", &Hook_photokano_download_frame_2, 0, REPFLAG_HOOKENTER, },
-	{ "gakuenheaven_download_frame", &Hook_gakuenheaven_download_frame, 0, REPFLAG_HOOKENTER, },
-	{ "youkosohitsujimura_download_frame", &Hook_youkosohitsujimura_download_frame, 0, REPFLAG_HOOKENTER, 0x94 },
-	{ "zettai_hero_update_minimap_tex", &Hook_zettai_hero_update_minimap_tex, 0, REPFLAG_HOOKEXIT, },
-	{ "tonyhawkp8_upload_tutorial_frame", &Hook_tonyhawkp8_upload_tutorial_frame, 0, REPFLAG_HOOKENTER, },
-	{ "sdgundamggenerationportable_download_frame", &Hook_sdgundamggenerationportable_download_frame, 0, REPFLAG_HOOKENTER, 0x34 },
-	{ "atvoffroadfurypro_download_frame", &Hook_atvoffroadfurypro_download_frame, 0, REPFLAG_HOOKENTER, 0xA0 },
-	{ "atvoffroadfuryblazintrails_download_frame", &Hook_atvoffroadfuryblazintrails_download_frame, 0, REPFLAG_HOOKENTER, 0x80 },
-	{ "littlebustersce_download_frame", &Hook_littlebustersce_download_frame, 0, REPFLAG_HOOKENTER, },
-	{ "shinigamitoshoujo_download_frame", &Hook_shinigamitoshoujo_download_frame, 0, REPFLAG_HOOKENTER, 0xBC },
-	{ "atvoffroadfuryprodemo_download_frame", &Hook_atvoffroadfuryprodemo_download_frame, 0, REPFLAG_HOOKENTER, 0x80 },
-	{ "unendingbloodycall_download_frame", &Hook_unendingbloodycall_download_frame, 0, REPFLAG_HOOKENTER, 0x54 },
-	{ "omertachinmokunookitethelegacy_download_frame", &Hook_omertachinmokunookitethelegacy_download_frame, 0, REPFLAG_HOOKENTER, 0x88 },
-	{ "katamari_render_check", &Hook_katamari_render_check, 0, REPFLAG_HOOKENTER, 0, },
-	{ "katamari_screenshot_to_565", &Hook_katamari_screenshot_to_565, 0, REPFLAG_HOOKENTER, 0 },
-	{ "mytranwars_upload_frame", &Hook_mytranwars_upload_frame, 0, REPFLAG_HOOKENTER, 0x128 },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_a1_before, 0, REPFLAG_HOOKENTER, 0x284 },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_after, 0, REPFLAG_HOOKENTER, 0x2bc },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_a1_before, 0, REPFLAG_HOOKENTER, 0x2e8 },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_after, 0, REPFLAG_HOOKENTER, 0x320 },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_a2_before, 0, REPFLAG_HOOKENTER, 0x3b0 },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_after, 0, REPFLAG_HOOKENTER, 0x3e8 },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_a2_before, 0, REPFLAG_HOOKENTER, 0x410 },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_after, 0, REPFLAG_HOOKENTER, 0x448 },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_a1_before, 0, REPFLAG_HOOKENTER, 0x600 },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_after, 0, REPFLAG_HOOKENTER, 0x638 },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_a1_before, 0, REPFLAG_HOOKENTER, 0x664 },
-	{ "marvelalliance1_copy", &Hook_marvelalliance1_copy_after, 0, REPFLAG_HOOKENTER, 0x69c },
-	{ "starocean_clear_framebuf", &Hook_starocean_clear_framebuf_before, 0, REPFLAG_HOOKENTER, 0 },
-	{ "starocean_clear_framebuf", &Hook_starocean_clear_framebuf_after, 0, REPFLAG_HOOKEXIT, 0 },
-	{ "motorstorm_pixel_read", &Hook_motorstorm_pixel_read, 0, REPFLAG_HOOKENTER, 0 },
-	{ "worms_copy_normalize_alpha", &Hook_worms_copy_normalize_alpha, 0, REPFLAG_HOOKENTER, 0x0CC },
-	{ "openseason_data_decode", &Hook_openseason_data_decode, 0, REPFLAG_HOOKENTER, 0x2F0 },
-	{ "soltrigger_render_ucschar", &Hook_soltrigger_render_ucschar, 0, REPFLAG_HOOKENTER, 0 },
-	{ "gow_fps_hack", &Hook_gow_fps_hack, 0, REPFLAG_HOOKEXIT , 0 },
-	{ "gow_vortex_hack", &Hook_gow_vortex_hack, 0, REPFLAG_HOOKENTER, 0x60 },
-	{ "ZZT3_select_hack", &Hook_ZZT3_select_hack, 0, REPFLAG_HOOKENTER, 0xC4 },
+	{ "dissidia_recordframe_avi", REPLACEFUNC(Hook_dissidia_recordframe_avi), 0, REPFLAG_HOOKENTER },
+	{ "brandish_download_frame", REPLACEFUNC(Hook_brandish_download_frame), 0, REPFLAG_HOOKENTER },
+	{ "growlanser_create_saveicon", REPLACEFUNC(Hook_growlanser_create_saveicon), 0, REPFLAG_HOOKENTER, 0x7C },
+	{ "sd_gundam_g_generation_download_frame", REPLACEFUNC(Hook_sd_gundam_g_generation_download_frame), 0, REPFLAG_HOOKENTER, 0x48},
+	{ "narisokonai_download_frame", REPLACEFUNC(Hook_narisokonai_download_frame), 0, REPFLAG_HOOKENTER, 0x14 },
+	{ "kirameki_school_life_download_frame", REPLACEFUNC(Hook_kirameki_school_life_download_frame), 0, REPFLAG_HOOKENTER },
+	{ "orenoimouto_download_frame", REPLACEFUNC(Hook_orenoimouto_download_frame), 0, REPFLAG_HOOKENTER },
+	{ "sakurasou_download_frame", REPLACEFUNC(Hook_sakurasou_download_frame), 0, REPFLAG_HOOKENTER, 0xF8 },
+	{ "suikoden1_and_2_download_frame_1", REPLACEFUNC(Hook_suikoden1_and_2_download_frame_1), 0, REPFLAG_HOOKENTER, 0x9C },
+	{ "suikoden1_and_2_download_frame_2", REPLACEFUNC(Hook_suikoden1_and_2_download_frame_2), 0, REPFLAG_HOOKENTER, 0x48 },
+	{ "rezel_cross_download_frame", REPLACEFUNC(Hook_rezel_cross_download_frame), 0, REPFLAG_HOOKENTER, 0x54 },
+	{ "kagaku_no_ensemble_download_frame", REPLACEFUNC(Hook_kagaku_no_ensemble_download_frame), 0, REPFLAG_HOOKENTER, 0x38 },
+	{ "soranokiseki_fc_download_frame", REPLACEFUNC(Hook_soranokiseki_fc_download_frame), 0, REPFLAG_HOOKENTER, 0x180 },
+	{ "soranokiseki_sc_download_frame", REPLACEFUNC(Hook_soranokiseki_sc_download_frame), 0, REPFLAG_HOOKENTER, },
+	{ "bokunonatsuyasumi4_download_frame", REPLACEFUNC(Hook_bokunonatsuyasumi4_download_frame), 0, REPFLAG_HOOKENTER, 0x8C },
+	{ "danganronpa2_1_download_frame", REPLACEFUNC(Hook_danganronpa2_1_download_frame), 0, REPFLAG_HOOKENTER, 0x68 },
+	{ "danganronpa2_2_download_frame", REPLACEFUNC(Hook_danganronpa2_2_download_frame), 0, REPFLAG_HOOKENTER, 0x94 },
+	{ "danganronpa1_1_download_frame", REPLACEFUNC(Hook_danganronpa1_1_download_frame), 0, REPFLAG_HOOKENTER, 0x78 },
+	{ "danganronpa1_2_download_frame", REPLACEFUNC(Hook_danganronpa1_2_download_frame), 0, REPFLAG_HOOKENTER, 0xA8 },
+	{ "kankabanchoutbr_download_frame", REPLACEFUNC(Hook_kankabanchoutbr_download_frame), 0, REPFLAG_HOOKENTER, },
+	{ "orenoimouto_download_frame_2", REPLACEFUNC(Hook_orenoimouto_download_frame_2), 0, REPFLAG_HOOKENTER, },
+	{ "rewrite_download_frame", REPLACEFUNC(Hook_rewrite_download_frame), 0, REPFLAG_HOOKENTER, 0x5C },
+	{ "kudwafter_download_frame", REPLACEFUNC(Hook_kudwafter_download_frame), 0, REPFLAG_HOOKENTER, 0x58 },
+	{ "kumonohatateni_download_frame", REPLACEFUNC(Hook_kumonohatateni_download_frame), 0, REPFLAG_HOOKENTER, },
+	{ "otomenoheihou_download_frame", REPLACEFUNC(Hook_otomenoheihou_download_frame), 0, REPFLAG_HOOKENTER, 0x14 },
+	{ "grisaianokajitsu_download_frame", REPLACEFUNC(Hook_grisaianokajitsu_download_frame), 0, REPFLAG_HOOKENTER, 0x14 },
+	{ "kokoroconnect_download_frame", REPLACEFUNC(Hook_kokoroconnect_download_frame), 0, REPFLAG_HOOKENTER, 0x60 },
+	{ "toheart2_download_frame", REPLACEFUNC(Hook_toheart2_download_frame), 0, REPFLAG_HOOKENTER, },
+	{ "toheart2_download_frame_2", REPLACEFUNC(Hook_toheart2_download_frame_2), 0, REPFLAG_HOOKENTER, 0x18 },
+	{ "flowers_download_frame", REPLACEFUNC(Hook_flowers_download_frame), 0, REPFLAG_HOOKENTER, 0x44 },
+	{ "motorstorm_download_frame", REPLACEFUNC(Hook_motorstorm_download_frame), 0, REPFLAG_HOOKENTER, },
+	{ "utawarerumono_download_frame", REPLACEFUNC(Hook_utawarerumono_download_frame), 0, REPFLAG_HOOKENTER, },
+	{ "photokano_download_frame", REPLACEFUNC(Hook_photokano_download_frame), 0, REPFLAG_HOOKENTER, 0x2C },
+	{ "photokano_download_frame_2", REPLACEFUNC(Hook_photokano_download_frame_2), 0, REPFLAG_HOOKENTER, },
+	{ "gakuenheaven_download_frame", REPLACEFUNC(Hook_gakuenheaven_download_frame), 0, REPFLAG_HOOKENTER, },
+	{ "youkosohitsujimura_download_frame", REPLACEFUNC(Hook_youkosohitsujimura_download_frame), 0, REPFLAG_HOOKENTER, 0x94 },
+	{ "zettai_hero_update_minimap_tex", REPLACEFUNC(Hook_zettai_hero_update_minimap_tex), 0, REPFLAG_HOOKEXIT, },
+	{ "tonyhawkp8_upload_tutorial_frame", REPLACEFUNC(Hook_tonyhawkp8_upload_tutorial_frame), 0, REPFLAG_HOOKENTER, },
+	{ "sdgundamggenerationportable_download_frame", REPLACEFUNC(Hook_sdgundamggenerationportable_download_frame), 0, REPFLAG_HOOKENTER, 0x34 },
+	{ "atvoffroadfurypro_download_frame", REPLACEFUNC(Hook_atvoffroadfurypro_download_frame), 0, REPFLAG_HOOKENTER, 0xA0 },
+	{ "atvoffroadfuryblazintrails_download_frame", REPLACEFUNC(Hook_atvoffroadfuryblazintrails_download_frame), 0, REPFLAG_HOOKENTER, 0x80 },
+	{ "littlebustersce_download_frame", REPLACEFUNC(Hook_littlebustersce_download_frame), 0, REPFLAG_HOOKENTER, },
+	{ "shinigamitoshoujo_download_frame", REPLACEFUNC(Hook_shinigamitoshoujo_download_frame), 0, REPFLAG_HOOKENTER, 0xBC },
+	{ "atvoffroadfuryprodemo_download_frame", REPLACEFUNC(Hook_atvoffroadfuryprodemo_download_frame), 0, REPFLAG_HOOKENTER, 0x80 },
+	{ "unendingbloodycall_download_frame", REPLACEFUNC(Hook_unendingbloodycall_download_frame), 0, REPFLAG_HOOKENTER, 0x54 },
+	{ "omertachinmokunookitethelegacy_download_frame", REPLACEFUNC(Hook_omertachinmokunookitethelegacy_download_frame), 0, REPFLAG_HOOKENTER, 0x88 },
+	{ "katamari_render_check", REPLACEFUNC(Hook_katamari_render_check), 0, REPFLAG_HOOKENTER, 0, },
+	{ "katamari_screenshot_to_565", REPLACEFUNC(Hook_katamari_screenshot_to_565), 0, REPFLAG_HOOKENTER, 0 },
+	{ "mytranwars_upload_frame", REPLACEFUNC(Hook_mytranwars_upload_frame), 0, REPFLAG_HOOKENTER, 0x128 },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_a1_before), 0, REPFLAG_HOOKENTER, 0x284 },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_after), 0, REPFLAG_HOOKENTER, 0x2bc },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_a1_before), 0, REPFLAG_HOOKENTER, 0x2e8 },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_after), 0, REPFLAG_HOOKENTER, 0x320 },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_a2_before), 0, REPFLAG_HOOKENTER, 0x3b0 },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_after), 0, REPFLAG_HOOKENTER, 0x3e8 },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_a2_before), 0, REPFLAG_HOOKENTER, 0x410 },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_after), 0, REPFLAG_HOOKENTER, 0x448 },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_a1_before), 0, REPFLAG_HOOKENTER, 0x600 },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_after), 0, REPFLAG_HOOKENTER, 0x638 },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_a1_before), 0, REPFLAG_HOOKENTER, 0x664 },
+	{ "marvelalliance1_copy", REPLACEFUNC(Hook_marvelalliance1_copy_after), 0, REPFLAG_HOOKENTER, 0x69c },
+	{ "starocean_clear_framebuf", REPLACEFUNC(Hook_starocean_clear_framebuf_before), 0, REPFLAG_HOOKENTER, 0 },
+	{ "starocean_clear_framebuf", REPLACEFUNC(Hook_starocean_clear_framebuf_after), 0, REPFLAG_HOOKEXIT, 0 },
+	{ "motorstorm_pixel_read", REPLACEFUNC(Hook_motorstorm_pixel_read), 0, REPFLAG_HOOKENTER, 0 },
+	{ "worms_copy_normalize_alpha", REPLACEFUNC(Hook_worms_copy_normalize_alpha), 0, REPFLAG_HOOKENTER, 0x0CC },
+	{ "openseason_data_decode", REPLACEFUNC(Hook_openseason_data_decode), 0, REPFLAG_HOOKENTER, 0x2F0 },
+	{ "soltrigger_render_ucschar", REPLACEFUNC(Hook_soltrigger_render_ucschar), 0, REPFLAG_HOOKENTER, 0 },
+	{ "gow_fps_hack", REPLACEFUNC(Hook_gow_fps_hack), 0, REPFLAG_HOOKEXIT , 0 },
+	{ "gow_vortex_hack", REPLACEFUNC(Hook_gow_vortex_hack), 0, REPFLAG_HOOKENTER, 0x60 },
+	{ "ZZT3_select_hack", REPLACEFUNC(Hook_ZZT3_select_hack), 0, REPFLAG_HOOKENTER, 0xC4 },
 	{}
 };
 
 
 static std::map<u32, u32> replacedInstructions;
 static std::unordered_map<std::string, std::vector<int> > replacementNameLookup;
+static std::atomic<u32> replacementHitCounts[ARRAY_SIZE(entries)];
+
+static size_t GetReplacementIndex(ReplaceFunc func) {
+	for (size_t i = 0; i < ARRAY_SIZE(entries); ++i) {
+		if (entries[i].replaceFunc == func)
+			return i;
+	}
+	return ARRAY_SIZE(entries);
+}
 
 void Replacement_Init() {
 	for (int i = 0; i < (int)ARRAY_SIZE(entries); i++) {
@@ -1600,9 +1795,16 @@ void Replacement_Init() {
 	}
 
 	skipGPUReplacements = 0;
+	ResetReplacementHitCounts();
 }
 
 void Replacement_Shutdown() {
+	for (int i = 0; i < (int)ARRAY_SIZE(entries); i++) {
+		if (replacementHitCounts[i] != 0) {
+			DEBUG_LOG(HLE, "Replacement %s (%d) hit %u times", entries[i].name, i, replacementHitCounts[i].load());
+		}
+	}
+
 	replacedInstructions.clear();
 	replacementNameLookup.clear();
 }
@@ -1632,6 +1834,25 @@ const ReplacementTableEntry *GetReplacementFunc(size_t i) {
 	return &entries[i];
 }
 
+void CountReplacementHit(size_t i) {
+	if (i < ARRAY_SIZE(entries)) {
+		// Only the emu thread counts, readers just want a rough number.
+		replacementHitCounts[i].store(replacementHitCounts[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+}
+
+u32 GetReplacementHitCount(size_t i) {
+	if (i >= ARRAY_SIZE(entries)) {
+		return 0;
+	}
+	return replacementHitCounts[i].load(std::memory_order_relaxed);
+}
+
+void ResetReplacementHitCounts() {
+	for (auto &count : replacementHitCounts)
+		count.store(0, std::memory_order_relaxed);
+}
+
 static bool WriteReplaceInstruction(u32 address, int index) {
 	u32 prevInstr = Memory::Read_Instruction(address, false).encoding;
 	if (MIPS_IS_REPLACEMENT(prevInstr)) {
@@ -68,6 +68,12 @@ int GetNumReplacementFuncs();
 std::vector<int> GetReplacementFuncIndexes(u64 hash, int funcSize);
 const ReplacementTableEntry *GetReplacementFunc(size_t index);
 
+// Per-replacement usage stats, useful to see which replacements actually matter.
+// Counted on every cpu core, jits included.
+void CountReplacementHit(size_t index);
+u32 GetReplacementHitCount(size_t index);
+void ResetReplacementHitCounts();
+
 void WriteReplaceInstructions(u32 address, u64 hash, int size);
 void RestoreReplacedInstruction(u32 address);
 void RestoreReplacedInstructions(u32 startAddr, u32 endAddr);
@@ -543,17 +543,15 @@ class KernelObjectPool {
 
 extern KernelObjectPool kernelObjects;
 
-typedef std::pair<int, int> KernelStatsSyscall;
-
 struct KernelStats {
 	void Reset() {
 		ResetFrame();
 	}
 	void ResetFrame() {
+		frame++;
 		msInSyscalls = 0;
 		slowestSyscallTime = 0;
 		slowestSyscallName = 0;
-		summedMsInSyscalls.clear();
 		summedSlowestSyscallTime = 0;
 		summedSlowestSyscallName = 0;
 	}
@@ -561,9 +559,10 @@ struct KernelStats {
 	double msInSyscalls;
 	double slowestSyscallTime;
 	const char *slowestSyscallName;
-	std::map<KernelStatsSyscall, double> summedMsInSyscalls;
 	double summedSlowestSyscallTime;
 	const char *summedSlowestSyscallName;
+	// Lets per syscall sums reset lazily, see updateSyscallStats().
+	u32 frame = 0;
 };
 
 extern KernelStats kernelStats;
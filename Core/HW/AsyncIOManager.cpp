@@ -22,12 +22,35 @@
 #include "Common/Serialize/SerializeFuncs.h"
 #include "Common/Serialize/SerializeMap.h"
 #include "Common/Serialize/SerializeSet.h"
+#include "Common/Thread/ThreadManager.h"
 #include "Core/MIPS/MIPS.h"
 #include "Core/Reporting.h"
 #include "Core/System.h"
 #include "Core/HW/AsyncIOManager.h"
 #include "Core/FileSystems/MetaFileSystem.h"
 
+// Runs one read or write on an I/O worker, so operations on different files can overlap
+// instead of queueing up behind each other on the single IO thread.
+class AsyncIOTask : public Task {
+public:
+	AsyncIOTask(AsyncIOManager *manager, const AsyncIOEvent &ev) : manager_(manager), ev_(ev) {}
+
+	TaskType Type() const override { return TaskType::IO_BLOCKING; }
+	TaskPriority Priority() const override { return TaskPriority::HIGH; }
+
+	void Run() override {
+		manager_->RunOperation(ev_);
+
+		std::lock_guard<std::mutex> guard(manager_->resultsLock_);
+		manager_->inFlight_--;
+		manager_->resultsWait_.notify_all();
+	}
+
+private:
+	AsyncIOManager *manager_;
+	AsyncIOEvent ev_;
+};
+
 bool AsyncIOManager::HasOperation(u32 handle) {
 	std::lock_guard<std::mutex> guard(resultsLock_);
 	if (resultsPending_.find(handle) != resultsPending_.end()) {
@@ -46,15 +69,30 @@ void AsyncIOManager::ScheduleOperation(const AsyncIOEvent &ev) {
 			ERROR_LOG_REPORT(SCEIO, "Scheduling operation for file %d while one is pending (type %d)", ev.handle, ev.type);
 		}
 	}
-	ScheduleEvent(ev);
+	AsyncIOEvent timed = ev;
+	timed.startTicks = CoreTiming::GetTicks();
+	ScheduleEvent(timed);
 }
 
 void AsyncIOManager::Shutdown() {
+	WaitForWorkers();
+
 	std::lock_guard<std::mutex> guard(resultsLock_);
 	resultsPending_.clear();
 	results_.clear();
 }
 
+void AsyncIOManager::SyncThread(bool force) {
+	IOThreadEventQueue::SyncThread(force);
+	WaitForWorkers();
+}
+
+void AsyncIOManager::WaitForWorkers() {
+	std::unique_lock<std::mutex> guard(resultsLock_);
+	while (inFlight_ > 0)
+		resultsWait_.wait(guard);
+}
+
 bool AsyncIOManager::HasResult(u32 handle) {
 	std::lock_guard<std::mutex> guard(resultsLock_);
 	return results_.find(handle) != results_.end();
@@ -89,7 +127,7 @@ bool AsyncIOManager::ReadResult(u32 handle, AsyncIOResult &result) {
 bool AsyncIOManager::WaitResult(u32 handle, AsyncIOResult &result) {
 	std::unique_lock<std::mutex> guard(resultsLock_);
 	ScheduleEvent(IO_EVENT_SYNC);
-	while (HasEvents() && ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end()) {
+	while ((HasEvents() || inFlight_ > 0) && ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end()) {
 		if (PopResult(handle, result)) {
 			return true;
 		}
@@ -103,7 +141,7 @@ u64 AsyncIOManager::ResultFinishTicks(u32 handle) {
 
 	std::unique_lock<std::mutex> guard(resultsLock_);
 	ScheduleEvent(IO_EVENT_SYNC);
-	while (HasEvents() && ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end()) {
+	while ((HasEvents() || inFlight_ > 0) && ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end()) {
 		if (ReadResult(handle, result)) {
 			return result.finishTicks;
 		}
@@ -119,11 +157,18 @@ u64 AsyncIOManager::ResultFinishTicks(u32 handle) {
 void AsyncIOManager::ProcessEvent(AsyncIOEvent ev) {
 	switch (ev.type) {
 	case IO_EVENT_READ:
-		Read(ev.handle, ev.buf, ev.bytes, ev.invalidateAddr);
-		break;
-
 	case IO_EVENT_WRITE:
-		Write(ev.handle, ev.buf, ev.bytes);
+		// Only one operation per handle is ever pending, so handing off keeps per-file order.
+		// Without the IO thread, results are expected synchronously, so just run it here.
+		if (ThreadEnabled() && g_threadManager.IsInitialized()) {
+			{
+				std::lock_guard<std::mutex> guard(resultsLock_);
+				inFlight_++;
+			}
+			g_threadManager.EnqueueTask(new AsyncIOTask(this, ev));
+		} else {
+			RunOperation(ev);
+		}
 		break;
 
 	default:
@@ -131,16 +176,24 @@ void AsyncIOManager::ProcessEvent(AsyncIOEvent ev) {
 	}
 }
 
-void AsyncIOManager::Read(u32 handle, u8 *buf, size_t bytes, u32 invalidateAddr) {
+void AsyncIOManager::RunOperation(const AsyncIOEvent &ev) {
+	if (ev.type == IO_EVENT_READ) {
+		Read(ev.handle, ev.buf, ev.bytes, ev.invalidateAddr, ev.startTicks);
+	} else {
+		Write(ev.handle, ev.buf, ev.bytes, ev.startTicks);
+	}
+}
+
+void AsyncIOManager::Read(u32 handle, u8 *buf, size_t bytes, u32 invalidateAddr, u64 startTicks) {
 	int usec = 0;
 	s64 result = pspFileSystem.ReadFile(handle, buf, bytes, usec);
-	EventResult(handle, AsyncIOResult(result, usec, invalidateAddr));
+	EventResult(handle, AsyncIOResult(result, startTicks, usec, invalidateAddr));
 }
 
-void AsyncIOManager::Write(u32 handle, const u8 *buf, size_t bytes) {
+void AsyncIOManager::Write(u32 handle, const u8 *buf, size_t bytes, u64 startTicks) {
 	int usec = 0;
 	s64 result = pspFileSystem.WriteFile(handle, buf, bytes, usec);
-	EventResult(handle, AsyncIOResult(result, usec));
+	EventResult(handle, AsyncIOResult(result, startTicks, usec));
 }
 
 void AsyncIOManager::EventResult(u32 handle, const AsyncIOResult &result) {
@@ -149,7 +202,7 @@ void AsyncIOManager::EventResult(u32 handle, const AsyncIOResult &result) {
 		ERROR_LOG_REPORT(SCEIO, "Overwriting previous result for file action on handle %d", handle);
 	}
 	results_[handle] = result;
-	resultsWait_.notify_one();
+	resultsWait_.notify_all();
 }
 
 void AsyncIOManager::DoState(PointerWrap &p) {
@@ -20,6 +20,7 @@
 #include <map>
 #include <set>
 #include <mutex>
+#include <condition_variable>
 
 #include "Core/ThreadEventQueue.h"
 
@@ -41,6 +42,9 @@ struct AsyncIOEvent {
 	u8 *buf;
 	size_t bytes;
 	u32 invalidateAddr;
+	// Emulated time the operation was issued.  Completion time is based on this, not on
+	// when a host worker gets to it, so timing doesn't depend on host scheduling.
+	u64 startTicks;
 
 	operator AsyncIOEventType() const {
 		return type;
@@ -54,8 +58,8 @@ struct AsyncIOResult {
 	explicit AsyncIOResult(s64 r) : result(r), finishTicks(0), invalidateAddr(0) {
 	}
 
-	AsyncIOResult(s64 r, int usec, u32 addr = 0) : result(r), invalidateAddr(addr) {
-		finishTicks = CoreTiming::GetTicks() + usToCycles(usec);
+	AsyncIOResult(s64 r, u64 startTicks, int usec, u32 addr = 0) : result(r), invalidateAddr(addr) {
+		finishTicks = startTicks + usToCycles(usec);
 	}
 
 	void DoState(PointerWrap &p) {
@@ -86,6 +90,9 @@ class AsyncIOManager : public IOThreadEventQueue {
 	void ScheduleOperation(const AsyncIOEvent &ev);
 	void Shutdown();
 
+	// Also waits for reads and writes already handed off to workers.
+	void SyncThread(bool force = false) override;
+
 	bool HasResult(u32 handle);
 	bool WaitResult(u32 handle, AsyncIOResult &result);
 	u64 ResultFinishTicks(u32 handle);
@@ -99,13 +106,19 @@ class AsyncIOManager : public IOThreadEventQueue {
 private:
 	bool PopResult(u32 handle, AsyncIOResult &result);
 	bool ReadResult(u32 handle, AsyncIOResult &result);
-	void Read(u32 handle, u8 *buf, size_t bytes, u32 invalidateAddr);
-	void Write(u32 handle, const u8 *buf, size_t bytes);
+	void Read(u32 handle, u8 *buf, size_t bytes, u32 invalidateAddr, u64 startTicks);
+	void Write(u32 handle, const u8 *buf, size_t bytes, u64 startTicks);
 
 	void EventResult(u32 handle, const AsyncIOResult &result);
+	void RunOperation(const AsyncIOEvent &ev);
+	void WaitForWorkers();
+
+	friend class AsyncIOTask;
 
 	std::mutex resultsLock_;
 	std::condition_variable resultsWait_;
 	std::set<u32> resultsPending_;
 	std::map<u32, AsyncIOResult> results_;
+	// Operations currently running on the thread manager's I/O workers.
+	int inFlight_ = 0;
 };
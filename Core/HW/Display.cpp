@@ -20,6 +20,7 @@
 #include <mutex>
 #include <vector>
 #include "Common/CommonTypes.h"
+#include "Common/File/Path.h"
 #include "Common/Serialize/SerializeFuncs.h"
 #include "Common/System/System.h"
 #include "Common/TimeUtil.h"
@@ -188,15 +189,25 @@ void __DisplayGetDebugStats(char *stats, size_t bufsize) {
 	}
 	gpu->GetStats(statbuf, sizeof(statbuf));
 
+	char fileStats[128] = "";
+#if HOST_IS_CASE_SENSITIVE
+	int caseHits = 0, caseScans = 0;
+	GetPathCaseCacheStats(&caseHits, &caseScans);
+	if (caseHits + caseScans > 0) {
+		snprintf(fileStats, sizeof(fileStats), "Path case cache: %d hits, %d dir reads (%0.1f%% hit)\n", caseHits, caseScans, caseHits * 100.0f / (caseHits + caseScans));
+	}
+#endif
+
 	snprintf(stats, bufsize,
 		"Kernel processing time: %0.2f ms\n"
 		"Slowest syscall: %s : %0.2f ms\n"
-		"Most active syscall: %s : %0.2f ms\n%s",
+		"Most active syscall: %s : %0.2f ms\n%s%s",
 		kernelStats.msInSyscalls * 1000.0f,
 		kernelStats.slowestSyscallName ? kernelStats.slowestSyscallName : "(none)",
 		kernelStats.slowestSyscallTime * 1000.0f,
 		kernelStats.summedSlowestSyscallName ? kernelStats.summedSlowestSyscallName : "(none)",
 		kernelStats.summedSlowestSyscallTime * 1000.0f,
+		fileStats,
 		statbuf);
 }
 
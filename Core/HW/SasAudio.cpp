@@ -17,6 +17,7 @@
 
 #include <algorithm>
 
+#include "Common/Math/CrossSIMD.h"
 #include "Common/Profiler/Profiler.h"
 
 #include "Common/Serialize/SerializeFuncs.h"
@@ -575,6 +576,8 @@ void SasInstance::MixVoice(SasVoice &voice) {
 			voice.envelope.Step();
 		}
 
+		// The resampling and envelope are serial (state carries from sample to sample), so
+		// do those first, then scale and mix the whole grain at once.
 		const bool needsInterp = voicePitch != PSP_SAS_PITCH_BASE || (sampleFrac & PSP_SAS_PITCH_MASK) != 0;
 		for (int i = delay; i < grainSize; i++) {
 			const int16_t *s = mixTemp_ + (sampleFrac >> PSP_SAS_PITCH_BASE_SHIFT);
@@ -586,24 +589,17 @@ void SasInstance::MixVoice(SasVoice &voice) {
 				sample = (s[0] * (PSP_SAS_PITCH_MASK - f) + s[1] * f) >> PSP_SAS_PITCH_BASE_SHIFT;
 			}
 			sampleFrac += voicePitch;
+			mixSamples_[i] = sample;
 
 			// The maximum envelope height (PSP_SAS_ENVELOPE_HEIGHT_MAX) is (1 << 30) - 1.
 			// Reduce it to 14 bits, by shifting off 15.  Round up by adding (1 << 14) first.
 			int envelopeValue = voice.envelope.GetHeight();
 			voice.envelope.Step();
-			envelopeValue = (envelopeValue + (1 << 14)) >> 15;
-
-			// We just scale by the envelope before we scale by volumes.
-			// Again, we round up by adding (1 << 14) first (*after* multiplying.)
-			sample = ((sample * envelopeValue) + (1 << 14)) >> 15;
-
-			// We mix into this 32-bit temp buffer and clip in a second loop
-			// Ideally, the shift right should be there too but for now I'm concerned about
-			// not overflowing.
-			mixBuffer[i * 2] += (sample * voice.volumeLeft) >> 12;
-			mixBuffer[i * 2 + 1] += (sample * voice.volumeRight) >> 12;
-			sendBuffer[i * 2] += sample * voice.effectLeft >> 12;
-			sendBuffer[i * 2 + 1] += sample * voice.effectRight >> 12;
+			mixEnvelope_[i] = (envelopeValue + (1 << 14)) >> 15;
+		}
+
+		if (grainSize > delay) {
+			SasMixScaledSamples(mixBuffer + delay * 2, sendBuffer + delay * 2, mixSamples_ + delay, mixEnvelope_ + delay, grainSize - delay, voice.volumeLeft, voice.volumeRight, voice.effectLeft, voice.effectRight);
 		}
 
 		voice.resampleHist[0] = mixTemp_[tempPos - 2];
@@ -621,6 +617,105 @@ void SasInstance::MixVoice(SasVoice &voice) {
 	}
 }
 
+#if PPSSPP_ARCH(SSE2)
+// SSE2 has no 32-bit mullo, but the low halves of the unsigned products are the same.
+static inline __m128i MulLo32(__m128i a, __m128i b) {
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
+
+void SasMixScaledSamples(int *mixBuffer, int *sendBuffer, const int *samples, const int *envelope, int count, int volumeLeft, int volumeRight, int effectLeft, int effectRight) {
+	int i = 0;
+#if PPSSPP_ARCH(SSE2)
+	const __m128i round = _mm_set1_epi32(1 << 14);
+	const __m128i volume = _mm_setr_epi32(volumeLeft, volumeRight, volumeLeft, volumeRight);
+	const __m128i effect = _mm_setr_epi32(effectLeft, effectRight, effectLeft, effectRight);
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(samples + i));
+		__m128i e = _mm_loadu_si128((const __m128i *)(envelope + i));
+		s = _mm_srai_epi32(_mm_add_epi32(MulLo32(s, e), round), 15);
+		// Duplicate each sample for the left and right lanes.
+		__m128i s01 = _mm_unpacklo_epi32(s, s);
+		__m128i s23 = _mm_unpackhi_epi32(s, s);
+
+		__m128i *mix = (__m128i *)(mixBuffer + i * 2);
+		__m128i *send = (__m128i *)(sendBuffer + i * 2);
+		_mm_storeu_si128(mix + 0, _mm_add_epi32(_mm_loadu_si128(mix + 0), _mm_srai_epi32(MulLo32(s01, volume), 12)));
+		_mm_storeu_si128(mix + 1, _mm_add_epi32(_mm_loadu_si128(mix + 1), _mm_srai_epi32(MulLo32(s23, volume), 12)));
+		_mm_storeu_si128(send + 0, _mm_add_epi32(_mm_loadu_si128(send + 0), _mm_srai_epi32(MulLo32(s01, effect), 12)));
+		_mm_storeu_si128(send + 1, _mm_add_epi32(_mm_loadu_si128(send + 1), _mm_srai_epi32(MulLo32(s23, effect), 12)));
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	const int32x4_t round = vdupq_n_s32(1 << 14);
+	const int32_t volumes[4] = { volumeLeft, volumeRight, volumeLeft, volumeRight };
+	const int32_t effects[4] = { effectLeft, effectRight, effectLeft, effectRight };
+	const int32x4_t volume = vld1q_s32(volumes);
+	const int32x4_t effect = vld1q_s32(effects);
+	for (; i + 4 <= count; i += 4) {
+		int32x4_t s = vld1q_s32(samples + i);
+		int32x4_t e = vld1q_s32(envelope + i);
+		s = vshrq_n_s32(vaddq_s32(vmulq_s32(s, e), round), 15);
+		int32x4x2_t dup = vzipq_s32(s, s);
+
+		int *mix = mixBuffer + i * 2;
+		int *send = sendBuffer + i * 2;
+		vst1q_s32(mix + 0, vaddq_s32(vld1q_s32(mix + 0), vshrq_n_s32(vmulq_s32(dup.val[0], volume), 12)));
+		vst1q_s32(mix + 4, vaddq_s32(vld1q_s32(mix + 4), vshrq_n_s32(vmulq_s32(dup.val[1], volume), 12)));
+		vst1q_s32(send + 0, vaddq_s32(vld1q_s32(send + 0), vshrq_n_s32(vmulq_s32(dup.val[0], effect), 12)));
+		vst1q_s32(send + 4, vaddq_s32(vld1q_s32(send + 4), vshrq_n_s32(vmulq_s32(dup.val[1], effect), 12)));
+	}
+#endif
+
+	for (; i < count; i++) {
+		// We just scale by the envelope before we scale by volumes.
+		// Again, we round up by adding (1 << 14) first (*after* multiplying.)
+		int sample = ((samples[i] * envelope[i]) + (1 << 14)) >> 15;
+
+		// We mix into this 32-bit temp buffer and clip in a second loop
+		// Ideally, the shift right should be there too but for now I'm concerned about
+		// not overflowing.
+		mixBuffer[i * 2] += (sample * volumeLeft) >> 12;
+		mixBuffer[i * 2 + 1] += (sample * volumeRight) >> 12;
+		sendBuffer[i * 2] += sample * effectLeft >> 12;
+		sendBuffer[i * 2 + 1] += sample * effectRight >> 12;
+	}
+}
+
+void SasClampMixToS16(s16 *outp, const int *mix, const s16 *wet, int count) {
+	int i = 0;
+#if PPSSPP_ARCH(SSE2)
+	for (; i + 8 <= count; i += 8) {
+		__m128i lo = _mm_loadu_si128((const __m128i *)(mix + i));
+		__m128i hi = _mm_loadu_si128((const __m128i *)(mix + i + 4));
+		if (wet) {
+			__m128i w = _mm_loadu_si128((const __m128i *)(wet + i));
+			// Sign extend to 32 bits.
+			lo = _mm_add_epi32(lo, _mm_srai_epi32(_mm_unpacklo_epi16(w, w), 16));
+			hi = _mm_add_epi32(hi, _mm_srai_epi32(_mm_unpackhi_epi16(w, w), 16));
+		}
+		// Saturating pack, same as clamp_s16.
+		_mm_storeu_si128((__m128i *)(outp + i), _mm_packs_epi32(lo, hi));
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	for (; i + 8 <= count; i += 8) {
+		int32x4_t lo = vld1q_s32(mix + i);
+		int32x4_t hi = vld1q_s32(mix + i + 4);
+		if (wet) {
+			int16x8_t w = vld1q_s16(wet + i);
+			lo = vaddq_s32(lo, vmovl_s16(vget_low_s16(w)));
+			hi = vaddq_s32(hi, vmovl_s16(vget_high_s16(w)));
+		}
+		vst1q_s16(outp + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+	}
+#endif
+
+	for (; i < count; i++) {
+		outp[i] = clamp_s16(wet ? mix[i] + wet[i] : mix[i]);
+	}
+}
+
 void SasInstance::Mix(u32 outAddr, u32 inAddr, int leftVol, int rightVol) {
 	for (int v = 0; v < PSP_SAS_VOICES_MAX; v++) {
 		SasVoice &voice = voices[v];
@@ -691,15 +786,9 @@ void SasInstance::WriteMixedOutput(s16 *outp, const s16 *inp, int leftVol, int r
 	} else {
 		// These are the optimal cases.
 		if (dry && wet) {
-			for (int i = 0; i < grainSize * 2; i += 2) {
-				*outp++ = clamp_s16(mixBuffer[i + 0] + sendBufferProcessed[i + 0]);
-				*outp++ = clamp_s16(mixBuffer[i + 1] + sendBufferProcessed[i + 1]);
-			}
+			SasClampMixToS16(outp, mixBuffer, sendBufferProcessed, grainSize * 2);
 		} else if (dry) {
-			for (int i = 0; i < grainSize * 2; i += 2) {
-				*outp++ = clamp_s16(mixBuffer[i + 0]);
-				*outp++ = clamp_s16(mixBuffer[i + 1]);
-			}
+			SasClampMixToS16(outp, mixBuffer, nullptr, grainSize * 2);
 		} else {
 			// This is another uncommon case, dry must be off but let's keep it for clarity.
 			for (int i = 0; i < grainSize * 2; i += 2) {
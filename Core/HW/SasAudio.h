@@ -293,6 +293,12 @@ struct SasVoice {
 	SasAtrac3 atrac3;
 };
 
+// Scales resampled voice samples by their envelope, then by the voice volumes, and accumulates
+// into the interleaved stereo mix and send buffers.  Vectorized, but bit-exact with the scalar path.
+void SasMixScaledSamples(int *mixBuffer, int *sendBuffer, const int *samples, const int *envelope, int count, int volumeLeft, int volumeRight, int effectLeft, int effectRight);
+// Writes clamp_s16(mix[i] + wet[i]) for count values.  wet may be null.
+void SasClampMixToS16(s16 *outp, const int *mix, const s16 *wet, int count);
+
 class SasInstance {
 public:
 	SasInstance();
@@ -333,6 +339,9 @@ class SasInstance {
 	SasReverb reverb_;
 	int grainSize = 0;
 	int16_t mixTemp_[PSP_SAS_MAX_GRAIN * 4 + 2 + 16];  // some extra margin for very high pitches.
+	// Per voice: resampled samples and envelope values, before volumes are applied.
+	int mixSamples_[PSP_SAS_MAX_GRAIN];
+	int mixEnvelope_[PSP_SAS_MAX_GRAIN];
 };
 
 const char *ADSRCurveModeAsString(SasADSRCurveMode mode);
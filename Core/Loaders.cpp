@@ -22,7 +22,6 @@
 #include "Common/File/FileUtil.h"
 #include "Common/File/Path.h"
 #include "Common/StringUtils.h"
-#include "Core/FileLoaders/CachingFileLoader.h"
 #include "Core/FileLoaders/DiskCachingFileLoader.h"
 #include "Core/FileLoaders/HTTPFileLoader.h"
 #include "Core/FileLoaders/LocalFileLoader.h"
@@ -43,12 +42,13 @@ void RegisterFileLoaderFactory(const std::string &prefix, std::unique_ptr<FileLo
 
 FileLoader *ConstructFileLoader(const Path &filename) {
 	if (filename.Type() == PathType::HTTP) {
+		// HTTPFileLoader keeps its own block cache and read-ahead, so no CachingFileLoader.
 		FileLoader *baseLoader = new RetryingFileLoader(new HTTPFileLoader(filename));
 		// For headless, avoid disk caching since it's usually used for tests that might mutate.
 		if (!PSP_CoreParameter().headLess) {
 			baseLoader = new DiskCachingFileLoader(baseLoader);
 		}
-		return new CachingFileLoader(baseLoader);
+		return baseLoader;
 	}
 
 	for (auto &iter : factories) {
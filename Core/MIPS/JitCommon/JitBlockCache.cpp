@@ -28,6 +28,7 @@
 #endif
 
 #include "Core/Core.h"
+#include "Core/MemFault.h"
 #include "Core/MemMap.h"
 #include "Core/CoreTiming.h"
 #include "Core/Reporting.h"
@@ -126,6 +127,7 @@ void JitBlockCache::Clear() {
 		DestroyBlock(i, DestroyType::CLEAR);
 	links_to_.clear();
 	num_blocks_ = 0;
+	Memory::MemFault_UnprotectAllCode();
 
 	blockMemRanges_[JITBLOCK_RANGE_SCRATCH] = std::make_pair(0xFFFFFFFF, 0x00000000);
 	blockMemRanges_[JITBLOCK_RANGE_RAMBOTTOM] = std::make_pair(0xFFFFFFFF, 0x00000000);
@@ -207,6 +209,7 @@ void JitBlockCache::ProxyBlock(u32 rootAddress, u32 startAddress, u32 size, cons
 	b.checkedEntry = codePtr;
 	proxyBlockMap_.emplace(startAddress, num_blocks_);
 	AddBlockMap(num_blocks_);
+	Memory::MemFault_ProtectCodeRange(startAddress, 4 * size);
 
 	num_blocks_++; //commit the current block
 }
@@ -257,6 +260,8 @@ void JitBlockCache::FinalizeBlock(int block_num, bool block_link) {
 	b.compiledHash = HashJitBlock(b);
 
 	AddBlockMap(block_num);
+	// From now on, a guest write to these pages invalidates the block (if enabled.)
+	Memory::MemFault_ProtectCodeRange(b.originalAddress, 4 * b.originalSize);
 
 	if (block_link) {
 		for (int i = 0; i < MAX_JIT_BLOCK_EXITS; i++) {
@@ -347,6 +347,8 @@ int MIPSState::RunLoopUntil(u64 globalTicks) {
 		break;
 
 	case CPUCore::INTERPRETER:
+		if (hasPendingClears)
+			ProcessPendingClears();
 		return MIPSInterpret_RunUntil(globalTicks);
 	}
 	return 1;
@@ -358,10 +360,17 @@ static std::vector<std::pair<u32, int>> pendingClears;
 void MIPSState::ProcessPendingClears() {
 	std::lock_guard<std::recursive_mutex> guard(MIPSComp::jitLock);
 	for (auto &p : pendingClears) {
-		if (p.first == 0 && p.second == 0)
+		if (!MIPSComp::jit) {
+			// The interpreter's pre-decoded instructions.
+			if (p.first == 0 && p.second == 0)
+				MIPSInterpret_ClearCache();
+			else
+				MIPSInterpret_InvalidateCache(p.first, p.second);
+		} else if (p.first == 0 && p.second == 0) {
 			MIPSComp::jit->ClearCache();
-		else
+		} else {
 			MIPSComp::jit->InvalidateCacheAt(p.first, p.second);
+		}
 	}
 	pendingClears.clear();
 	hasPendingClears = false;
@@ -373,12 +382,19 @@ void MIPSState::InvalidateICache(u32 address, int length) {
 	std::lock_guard<std::recursive_mutex> guard(MIPSComp::jitLock);
 	if (MIPSComp::jit && length != 0) {
 		MIPSComp::jit->InvalidateCacheAt(address, length);
+	} else if (length != 0 && PSP_CoreParameter().cpuCore == CPUCore::INTERPRETER) {
+		// This may be called from other threads, so the interpreter picks it up between slices.
+		pendingClears.emplace_back(address, length);
+		hasPendingClears = true;
 	}
 }
 
 void MIPSState::ClearJitCache() {
 	std::lock_guard<std::recursive_mutex> guard(MIPSComp::jitLock);
-	if (MIPSComp::jit) {
+	if (!MIPSComp::jit && PSP_CoreParameter().cpuCore == CPUCore::INTERPRETER) {
+		pendingClears.emplace_back(0, 0);
+		hasPendingClears = true;
+	} else if (MIPSComp::jit) {
 		if (coreState == CORE_RUNNING || insideJit) {
 			pendingClears.emplace_back(0, 0);
 			hasPendingClears = true;
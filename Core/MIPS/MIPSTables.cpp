@@ -15,6 +15,10 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include "Common/StringUtils.h"
 
 #include "Core/Core.h"
@@ -967,6 +971,65 @@ void MIPSInterpret(MIPSOpcode op) {
 #define _RD   ((op>>11) & 0x1F)
 #define R(i)   (curMips->r[i])
 
+// Pre-decoded instructions for the fast interpreter loop, so it doesn't need to walk the encoding
+// tables for every instruction. Each fetch still compares against memory, so code that's modified
+// without an icache invalidate runs the same as before - invalidation just drops the pages.
+struct PredecodedOp {
+	u32 op;
+	u16 cycles;
+	// Can't branch, syscall, or be a replacement, so it's safe to run several back to back.
+	bool straight;
+	MIPSInterpretFunc func;  // Null until decoded.
+};
+
+static const int PREDECODE_PAGE_SHIFT = 12;
+static const u32 PREDECODE_PAGE_OPS = 1 << (PREDECODE_PAGE_SHIFT - 2);
+// Cap for straight-line runs, in case we're sliding through zeroed memory with bad accesses ignored.
+static const int MAX_STRAIGHT_RUN = 256;
+
+struct PredecodePage {
+	PredecodedOp ops[PREDECODE_PAGE_OPS];
+};
+
+// Indexed by physical address (mirrors share pages.) Only touched on the emu thread.
+static std::vector<std::unique_ptr<PredecodePage>> predecodePages;
+
+static inline const PredecodedOp *Predecode(u32 pc, MIPSOpcode op) {
+	if (predecodePages.empty())
+		predecodePages.resize(0x20000000 >> PREDECODE_PAGE_SHIFT);
+
+	std::unique_ptr<PredecodePage> &page = predecodePages[(pc & 0x1FFFFFFF) >> PREDECODE_PAGE_SHIFT];
+	if (!page)
+		page.reset(new PredecodePage());
+
+	PredecodedOp &entry = page->ops[(pc >> 2) & (PREDECODE_PAGE_OPS - 1)];
+	if (entry.func && entry.op == op.encoding)
+		return &entry;
+
+	const MIPSInstruction *instr = MIPSGetInstruction(op);
+	if (!instr || !instr->interpret)
+		return nullptr;
+	entry.op = op.encoding;
+	entry.cycles = (u16)GetInstructionCycleEstimate(instr);
+	entry.straight = (instr->flags & (IS_CONDBRANCH | IS_JUMP)) == 0 && instr->interpret != &Int_Syscall && !MIPS_IS_EMUHACK(op);
+	entry.func = instr->interpret;
+	return &entry;
+}
+
+void MIPSInterpret_InvalidateCache(u32 address, int length) {
+	if (predecodePages.empty() || length <= 0)
+		return;
+	const u32 start = address & 0x1FFFFFFF;
+	const u32 end = std::min(start + (u32)length - 1, 0x1FFFFFFFU);
+	for (u32 page = start >> PREDECODE_PAGE_SHIFT; page <= end >> PREDECODE_PAGE_SHIFT; ++page)
+		predecodePages[page].reset();
+}
+
+void MIPSInterpret_ClearCache() {
+	predecodePages.clear();
+	predecodePages.shrink_to_fit();
+}
+
 static inline void RunUntilFast() {
 	MIPSState *curMips = currentMIPS;
 	// NEVER stop in a delay slot!
@@ -974,11 +1037,34 @@ static inline void RunUntilFast() {
 		do {
 			// Replacements and similar are processed here, intentionally.
 			MIPSOpcode op = MIPSOpcode(Memory::Read_U32(curMips->pc));
+			const PredecodedOp *pre = Predecode(curMips->pc, op);
+
+			if (pre && pre->straight && !curMips->inDelaySlot) {
+				// Nothing in a straight run can branch or reschedule, so keep going without the
+				// outer loop. Stop where it would have: out of cycles, or the pc jumps anyway (exceptions.)
+				for (int i = 0; i < MAX_STRAIGHT_RUN; ++i) {
+					const u32 pc = curMips->pc;
+					pre->func(op);
+					curMips->downcount -= pre->cycles;
+					if (curMips->downcount < 0 || curMips->pc != pc + 4 || coreState != CORE_RUNNING)
+						break;
+					op = MIPSOpcode(Memory::Read_U32(curMips->pc));
+					pre = Predecode(curMips->pc, op);
+					if (!pre || !pre->straight)
+						break;
+				}
+				continue;
+			}
 
 			bool wasInDelaySlot = curMips->inDelaySlot;
-			const MIPSInstruction *instr = MIPSGetInstruction(op);
-			Interpret(instr, op);
-			curMips->downcount -= GetInstructionCycleEstimate(instr);
+			if (pre) {
+				pre->func(op);
+				curMips->downcount -= pre->cycles;
+			} else {
+				const MIPSInstruction *instr = MIPSGetInstruction(op);
+				Interpret(instr, op);
+				curMips->downcount -= GetInstructionCycleEstimate(instr);
+			}
 
 			// The reason we have to check this is the delay slot hack in Int_Syscall.
 			if (curMips->inDelaySlot && wasInDelaySlot) {
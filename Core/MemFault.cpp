@@ -17,11 +17,17 @@
 
 #include "ppsspp_config.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <unordered_set>
 #include <mutex>
 #include <sstream>
+#include <thread>
+#include <vector>
 
+#include "Common/MemoryUtil.h"
 #include "Common/StringUtils.h"
 #include "Common/MachineContext.h"
 
@@ -56,11 +62,271 @@ static bool inCrashHandler = false;
 
 std::unordered_set<const uint8_t *> g_ignoredAddresses;
 
+#if defined(MACHINE_CONTEXT_SUPPORTED) && !defined(MASKED_PSP_MEMORY)
+#define CODE_PAGE_PROTECTION_SUPPORTED
+#endif
+
+// State per host page of RAM. The low bits count guest writes that unprotected the page.
+// Past MAX_CODE_PAGE_WRITES we stop protecting it, it most likely mixes code and data.
+enum : uint8_t {
+	CODE_PAGE_PROTECTED = 0x80,
+	CODE_PAGE_TOUCHED = 0x40,
+	// Someone is changing the page's protection, faults on it should just retry.
+	CODE_PAGE_BUSY = 0x20,
+	CODE_PAGE_WRITES_MASK = 0x1F,
+};
+static const uint8_t MAX_CODE_PAGE_WRITES = 16;
+
+// The fault handler can't take locks, so page states are atomics it updates with a CAS.
+// This lock only keeps the other (non-handler) callers from interleaving with each other.
+static std::mutex g_codePageLock;
+static std::unique_ptr<std::atomic<uint8_t>[]> g_codePages;
+static uint32_t g_numCodePages;
+static std::atomic<int> g_numProtectedCodePages;
+static uint32_t g_codePageShift;
+// One bit per page written since the emu thread last invalidated its blocks.
+static std::unique_ptr<std::atomic<uint32_t>[]> g_pendingCodePageClears;
+static std::atomic<bool> g_hasPendingCodePageClears;
+
+#ifdef CODE_PAGE_PROTECTION_SUPPORTED
+
+// Each RAM mirror is a separate host view, so they all need protecting.
+static const uint32_t g_ramMirrors[] = {
+	0x00000000,
+	0x40000000,
+#if !(PPSSPP_PLATFORM(IOS) && PPSSPP_ARCH(64BIT))
+	0x80000000,
+	0xC0000000,
+#endif
+};
+
+static void ResetCodePages() {
+	std::lock_guard<std::mutex> guard(g_codePageLock);
+	const uint32_t pageSize = (uint32_t)GetMemoryProtectPageSize();
+	g_codePageShift = 0;
+	while ((1U << g_codePageShift) < pageSize)
+		g_codePageShift++;
+	g_numCodePages = g_MemorySize >> g_codePageShift;
+	g_codePages.reset(new std::atomic<uint8_t>[g_numCodePages]);
+	for (uint32_t i = 0; i < g_numCodePages; ++i)
+		g_codePages[i] = 0;
+	g_pendingCodePageClears.reset(new std::atomic<uint32_t>[(g_numCodePages + 31) / 32]);
+	for (uint32_t i = 0; i < (g_numCodePages + 31) / 32; ++i)
+		g_pendingCodePageClears[i] = 0;
+	g_numProtectedCodePages = 0;
+	g_hasPendingCodePageClears = false;
+}
+
+// Returns false if the range isn't within RAM. Safe from the fault handler.
+static bool CodePageRange(uint32_t address, uint32_t size, uint32_t *first, uint32_t *last) {
+	const uint32_t start = address & 0x3FFFFFFF;
+	if (!base || g_numCodePages == 0 || size == 0)
+		return false;
+	if (start < PSP_GetKernelMemoryBase() || start >= PSP_GetUserMemoryEnd())
+		return false;
+	const uint32_t end = std::min(start + size, PSP_GetUserMemoryEnd());
+	*first = (start - PSP_GetKernelMemoryBase()) >> g_codePageShift;
+	*last = std::min((end - 1 - PSP_GetKernelMemoryBase()) >> g_codePageShift, g_numCodePages - 1);
+	return true;
+}
+
+static void ProtectCodePage(uint32_t page, bool writable, uint32_t mirror) {
+	const uint32_t address = mirror + PSP_GetKernelMemoryBase() + (page << g_codePageShift);
+	ProtectMemoryPages(base + address, (size_t)1 << g_codePageShift, writable ? (MEM_PROT_READ | MEM_PROT_WRITE) : MEM_PROT_READ);
+}
+
+static void ProtectCodePageMirrors(uint32_t page, bool writable) {
+	for (uint32_t mirror : g_ramMirrors)
+		ProtectCodePage(page, writable, mirror);
+}
+
+// Waits out a fault handler that's in the middle of unprotecting the page. Returns the state, with BUSY set.
+static uint8_t LockCodePageState(uint32_t page) {
+	std::atomic<uint8_t> &state = g_codePages[page];
+	while (true) {
+		uint8_t old = state.load();
+		if ((old & CODE_PAGE_BUSY) == 0 && state.compare_exchange_weak(old, old | CODE_PAGE_BUSY))
+			return old;
+		std::this_thread::yield();
+	}
+}
+
+// Lock free, safe from the fault handler. Returns true if this call unprotected the page.
+static bool UnprotectCodePage(uint32_t page, bool countWrite) {
+	std::atomic<uint8_t> &state = g_codePages[page];
+	uint8_t old = state.load();
+	uint8_t busy;
+	do {
+		if ((old & CODE_PAGE_PROTECTED) == 0 || (old & CODE_PAGE_BUSY) != 0)
+			return false;
+		busy = (old & ~CODE_PAGE_PROTECTED) | CODE_PAGE_BUSY;
+		if (countWrite && (old & CODE_PAGE_WRITES_MASK) != CODE_PAGE_WRITES_MASK)
+			busy++;
+	} while (!state.compare_exchange_weak(old, busy));
+
+	ProtectCodePageMirrors(page, true);
+	state.fetch_and((uint8_t)~CODE_PAGE_BUSY);
+	g_numProtectedCodePages--;
+	return true;
+}
+
+// Lock free, safe from the fault handler.
+static void QueueCodePageClear(uint32_t page) {
+	g_pendingCodePageClears[page >> 5].fetch_or(1U << (page & 31));
+	g_hasPendingCodePageClears = true;
+}
+
+void MemFault_ProtectCodeRange(uint32_t address, uint32_t size) {
+	if (!g_Config.bProtectJitCodePages || !g_Config.bFastMemory)
+		return;
+
+	std::lock_guard<std::mutex> guard(g_codePageLock);
+	uint32_t first, last;
+	if (!CodePageRange(address, size, &first, &last))
+		return;
+	for (uint32_t page = first; page <= last; ++page) {
+		uint8_t old = LockCodePageState(page);
+		if ((old & CODE_PAGE_PROTECTED) != 0 || (old & CODE_PAGE_WRITES_MASK) >= MAX_CODE_PAGE_WRITES) {
+			g_codePages[page] = old;
+			continue;
+		}
+		ProtectCodePageMirrors(page, false);
+		g_numProtectedCodePages++;
+		g_codePages[page] = old | CODE_PAGE_PROTECTED | CODE_PAGE_TOUCHED;
+	}
+}
+
+void MemFault_UnprotectAllCode() {
+	std::lock_guard<std::mutex> guard(g_codePageLock);
+	for (uint32_t page = 0; page < g_numCodePages; ++page) {
+		// Not counted as a write, this isn't the guest's doing.
+		// If memory is already shut down, there's nothing mapped to unprotect.
+		if (base) {
+			UnprotectCodePage(page, false);
+		} else if (g_codePages[page].fetch_and((uint8_t)~CODE_PAGE_PROTECTED) & CODE_PAGE_PROTECTED) {
+			g_numProtectedCodePages--;
+		}
+	}
+}
+
+void MemFault_PrepareCodeWrite(uint32_t address, uint32_t size) {
+	if (g_numProtectedCodePages.load() == 0)
+		return;
+
+	std::lock_guard<std::mutex> guard(g_codePageLock);
+	uint32_t first, last;
+	if (!CodePageRange(address, size, &first, &last))
+		return;
+	for (uint32_t page = first; page <= last; ++page) {
+		if (UnprotectCodePage(page, true))
+			QueueCodePageClear(page);
+	}
+}
+
+bool MemFault_WriteProtectedCode(uint32_t address, uint32_t value) {
+	if (g_numProtectedCodePages.load() == 0)
+		return false;
+
+	std::lock_guard<std::mutex> guard(g_codePageLock);
+	uint32_t first, last;
+	if (!CodePageRange(address, 4, &first, &last)) {
+		WriteUnchecked_U32(value, address);
+		return true;
+	}
+
+	// While busy, a fault on this page (from another view) just retries until we're done.
+	uint8_t old = LockCodePageState(first);
+	if ((old & CODE_PAGE_PROTECTED) != 0) {
+		// Only open up the view we write through, and only for this one write.
+		const uint32_t mirror = address & 0xC0000000;
+		ProtectCodePage(first, true, mirror);
+		WriteUnchecked_U32(value, address);
+		ProtectCodePage(first, false, mirror);
+	} else {
+		WriteUnchecked_U32(value, address);
+	}
+	g_codePages[first] = old;
+	return true;
+}
+
+void MemFault_ProcessPendingCodeClears() {
+	// Checked every CoreTiming slice, so keep the common case to a plain load.
+	if (!g_hasPendingCodePageClears.load(std::memory_order_relaxed) || !g_hasPendingCodePageClears.exchange(false))
+		return;
+
+	std::lock_guard<std::recursive_mutex> guard(MIPSComp::jitLock);
+	for (uint32_t i = 0; i < (g_numCodePages + 31) / 32; ++i) {
+		uint32_t bits = g_pendingCodePageClears[i].exchange(0);
+		for (uint32_t page = i * 32; bits != 0; ++page, bits >>= 1) {
+			if ((bits & 1) == 0 || !MIPSComp::jit)
+				continue;
+			const uint32_t start = PSP_GetKernelMemoryBase() + (page << g_codePageShift);
+			VERBOSE_LOG(JIT, "Guest write to code page at %08x, invalidating", start);
+			MIPSComp::jit->InvalidateCacheAt(start, 1 << g_codePageShift);
+		}
+	}
+}
+
+// Called from the exception handler on any thread, before anything else. Must not lock or allocate.
+static bool HandleCodePageFault(uintptr_t hostAddress) {
+	const uintptr_t baseAddress = (uintptr_t)base;
+	if (!base || hostAddress < baseAddress || hostAddress - baseAddress >= 0x100000000ULL)
+		return false;
+
+	const uint32_t offset = (uint32_t)(hostAddress - baseAddress);
+	if (std::find(std::begin(g_ramMirrors), std::end(g_ramMirrors), offset & 0xC0000000) == std::end(g_ramMirrors))
+		return false;
+
+	uint32_t first, last;
+	if (!CodePageRange(offset, 1, &first, &last))
+		return false;
+	// Pages we never protected can't fault here, so this is some other problem.
+	if ((g_codePages[first].load() & CODE_PAGE_TOUCHED) == 0)
+		return false;
+
+	// If we lose the race, someone else is unprotecting it (or just did), so the write can simply retry.
+	if (UnprotectCodePage(first, true)) {
+		// The emu thread drops the blocks, it may be running them right now.
+		QueueCodePageClear(first);
+	}
+	return true;
+}
+
+#else
+
+static void ResetCodePages() {
+}
+
+void MemFault_ProtectCodeRange(uint32_t address, uint32_t size) {
+}
+
+void MemFault_UnprotectAllCode() {
+}
+
+void MemFault_PrepareCodeWrite(uint32_t address, uint32_t size) {
+}
+
+bool MemFault_WriteProtectedCode(uint32_t address, uint32_t value) {
+	return false;
+}
+
+void MemFault_ProcessPendingCodeClears() {
+}
+
+#if defined(MACHINE_CONTEXT_SUPPORTED)
+static bool HandleCodePageFault(uintptr_t hostAddress) {
+	return false;
+}
+#endif
+
+#endif
+
 void MemFault_Init() {
 	g_numReportedBadAccesses = 0;
 	g_lastCrashAddress = nullptr;
 	g_lastMemoryExceptionType = MemoryExceptionType::NONE;
 	g_ignoredAddresses.clear();
+	ResetCodePages();
 }
 
 bool MemFault_MayBeResumable() {
@@ -103,6 +369,10 @@ static bool DisassembleNativeAt(const uint8_t *codePtr, int instructionSize, std
 }
 
 bool HandleFault(uintptr_t hostAddress, void *ctx) {
+	// Writes to protected code pages are expected, and may come from any thread.
+	if (HandleCodePageFault(hostAddress))
+		return true;
+
 	if (inCrashHandler)
 		return false;
 	inCrashHandler = true;
@@ -16,6 +16,20 @@ void MemFault_Init();
 bool MemFault_MayBeResumable();
 void MemFault_IgnoreLastCrash();
 
+// Optional write protection of RAM pages holding jitted code (bProtectJitCodePages.)
+// The first guest write to a protected page makes it writable again and queues that page,
+// so that the emu thread invalidates only its blocks. Self-modifying code then works without
+// icache syscalls.
+void MemFault_ProtectCodeRange(uint32_t address, uint32_t size);
+void MemFault_UnprotectAllCode();
+// Unprotects and queues ahead of writes that can't go through the fault handler,
+// like a read() syscall straight into PSP RAM (which would just fail with EFAULT.)
+void MemFault_PrepareCodeWrite(uint32_t address, uint32_t size);
+// Used for emuhack writes. Returns false if the page isn't protected, the caller writes normally then.
+bool MemFault_WriteProtectedCode(uint32_t address, uint32_t value);
+// Emu thread only, invalidates the blocks on pages written since the last call.
+void MemFault_ProcessPendingCodeClears();
+
 // Called by exception handlers. We simply filter out accesses to PSP RAM and otherwise
 // just leave it as-is.
 bool HandleFault(uintptr_t hostAddress, void *context);
@@ -386,6 +386,9 @@ void DoState(PointerWrap &p) {
 		}
 	}
 
+	// The jit cache gets cleared anyway, no need to fault on every code page.
+	if (p.mode == PointerWrap::MODE_READ)
+		MemFault_UnprotectAllCode();
 	DoMemoryVoid(p, PSP_GetKernelMemoryBase(), g_MemorySize);
 	p.DoMarker("RAM");
 
@@ -489,7 +492,9 @@ Opcode Read_Opcode_JIT(u32 address)
 // We assume that _Address is cached
 void Write_Opcode_JIT(const u32 _Address, const Opcode& _Value)
 {
-	Memory::WriteUnchecked_U32(_Value.encoding, _Address);
+	// The page may be write protected, if it already holds other jitted code.
+	if (!MemFault_WriteProtectedCode(_Address, _Value.encoding))
+		Memory::WriteUnchecked_U32(_Value.encoding, _Address);
 }
 
 void Memset(const u32 _Address, const u8 _iValue, const u32 _iLength, const char *tag) {
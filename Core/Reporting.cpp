@@ -87,7 +87,7 @@ namespace Reporting
 	static std::mutex pendingMessageLock;
 	static std::condition_variable pendingMessageCond;
 	static std::deque<int> pendingMessages;
-	static bool pendingMessagesDone = false;
+	static std::atomic<bool> pendingMessagesDone{};
 	static std::thread messageThread;
 	static std::thread compatThread;
 
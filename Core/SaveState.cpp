@@ -23,16 +23,19 @@
 #include "Common/Data/Text/I18n.h"
 #include "Common/Thread/ThreadUtil.h"
 #include "Common/Data/Text/Parsers.h"
+#include "Common/System/OSD.h"
 #include "Common/System/System.h"
 
 #include "Common/File/FileUtil.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/Serialize/SerializeFuncs.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/Promise.h"
 #include "Common/TimeUtil.h"
 
 #include "Core/SaveState.h"
 #include "Core/Config.h"
+#include "Core/ConfigValues.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
 #include "Core/Screenshot.h"
@@ -337,6 +340,25 @@ namespace SaveState
 	static const int SCREENSHOT_FAILURE_RETRIES = 15;
 	static StateRingbuffer rewindStates;
 
+	// A save that's been snapshotted on the emu thread, and is now compressed and written on a worker.
+	struct PendingSave {
+		PendingSave(const Operation &o, const std::string &t, double snapshot)
+			: op(o), title(t), snapshotSeconds(snapshot) {}
+
+		Operation op;
+		std::string title;
+		double snapshotSeconds;
+		CChunkFileReader::SaveStats stats;
+		CChunkFileReader::Error result = CChunkFileReader::ERROR_NONE;
+	};
+	struct PendingSaveTask {
+		// Kept out here so it can be checked without waiting on the promise.
+		Path filename;
+		Promise<PendingSave *> *promise;
+	};
+	// Only touched on the emu thread, in order of saving.
+	static std::vector<PendingSaveTask> pendingSaves;
+
 	void SaveStart::DoState(PointerWrap &p)
 	{
 		auto s = p.Section("SaveStart", 1, 3);
@@ -912,9 +934,88 @@ namespace SaveState
 		return Status::SUCCESS;
 	}
 
+	static void FinishSave(PendingSave *save) {
+		auto sc = GetI18NCategory(I18NCat::SCREEN);
+		const Operation &op = save->op;
+		std::string slot_prefix = op.slot >= 0 ? StringFromFormat("(%d) ", op.slot + 1) : "";
+
+		Status callbackResult;
+		std::string callbackMessage;
+		if (save->result == CChunkFileReader::ERROR_NONE) {
+			const auto &stats = save->stats;
+			std::string timings = StringFromFormat("snapshot %0.1f ms, compress %0.1f ms, write %0.1f ms (%d KB to %d KB)",
+				save->snapshotSeconds * 1000.0, stats.compressSeconds * 1000.0, stats.writeSeconds * 1000.0, (int)(stats.size / 1024), (int)(stats.compressedSize / 1024));
+			INFO_LOG(SAVESTATE, "Saved state to %s: %s", op.filename.c_str(), timings.c_str());
+			if ((DebugOverlay)g_Config.iDebugOverlay == DebugOverlay::DEBUG_STATS)
+				g_OSD.Show(OSDType::MESSAGE_INFO, timings, 3.0f, "savestate_timings");
+
+			callbackMessage = slot_prefix + std::string(sc->T("Saved State"));
+			callbackResult = Status::SUCCESS;
+		} else {
+			ERROR_LOG(SAVESTATE, "Failed to write state to %s", op.filename.c_str());
+			callbackMessage = sc->T("Failed to save state");
+			callbackResult = Status::FAILURE;
+		}
+
+		if (op.callback)
+			op.callback(callbackResult, callbackMessage, op.cbUserData);
+	}
+
+	// Runs callbacks for saves that have finished writing, in order.  If block is set, waits for all of them.
+	static void FinishPendingSaves(bool block) {
+		size_t done = 0;
+		for (; done < pendingSaves.size(); ++done) {
+			Promise<PendingSave *> *promise = pendingSaves[done].promise;
+			PendingSave *save = block ? promise->BlockUntilReady() : promise->Poll();
+			if (!save)
+				break;
+			FinishSave(save);
+			delete save;
+			delete promise;
+		}
+		pendingSaves.erase(pendingSaves.begin(), pendingSaves.begin() + done);
+	}
+
+	static bool IsSavePending(const Path &filename) {
+		for (const auto &pending : pendingSaves) {
+			if (pending.filename == filename)
+				return true;
+		}
+		return false;
+	}
+
+	// Takes a snapshot of the state, and hands compression and writing off to a worker thread.
+	// The callback runs from Process() once the file is written.
+	static CChunkFileReader::Error SaveAsync(const Operation &op, const std::string &title, SaveStart &state) {
+		// Two writes to the same file would trample each other.
+		if (IsSavePending(op.filename))
+			FinishPendingSaves(true);
+
+		double startTime = time_now_d();
+		u8 *buffer = nullptr;
+		size_t sz = 0;
+		CChunkFileReader::Error result = CChunkFileReader::MeasureAndSavePtr(state, &buffer, &sz);
+		if (result != CChunkFileReader::ERROR_NONE)
+			return result;
+
+		PendingSave *save = new PendingSave(op, title, time_now_d() - startTime);
+		auto write = [save, buffer, sz]() {
+			save->result = CChunkFileReader::SaveFile(save->op.filename, save->title, PPSSPP_GIT_VERSION, buffer, sz, &save->stats);
+			return save;
+		};
+		Promise<PendingSave *> *promise;
+		if (g_threadManager.IsInitialized())
+			promise = Promise<PendingSave *>::Spawn(&g_threadManager, write, TaskType::IO_BLOCKING);
+		else
+			promise = Promise<PendingSave *>::AlreadyDone(write());
+		pendingSaves.push_back({ op.filename, promise });
+		return CChunkFileReader::ERROR_NONE;
+	}
+
 	void Process()
 	{
 		rewindStates.Process();
+		FinishPendingSaves(false);
 
 		if (!needsProcess)
 			return;
@@ -944,10 +1045,14 @@ namespace SaveState
 
 			std::string slot_prefix = op.slot >= 0 ? StringFromFormat("(%d) ", op.slot + 1) : "";
 			std::string errorString;
+			// Set when the callback runs later, after an async save finishes.
+			bool deferred = false;
 
 			switch (op.type)
 			{
 			case SAVESTATE_LOAD:
+				// The state might still be being written.
+				FinishPendingSaves(true);
 				INFO_LOG(SAVESTATE, "Loading state from '%s'", op.filename.c_str());
 				// Use the state's latest version as a guess for saveStateInitialGitVersion.
 				result = CChunkFileReader::Load(op.filename, &saveStateInitialGitVersion, state, &errorString);
@@ -991,10 +1096,9 @@ namespace SaveState
 					std::size_t lslash = title.find_last_of('/');
 					title = title.substr(lslash + 1);
 				}
-				result = CChunkFileReader::Save(op.filename, title, PPSSPP_GIT_VERSION, state);
+				result = SaveAsync(op, title, state);
 				if (result == CChunkFileReader::ERROR_NONE) {
-					callbackMessage = slot_prefix + std::string(sc->T("Saved State"));
-					callbackResult = Status::SUCCESS;
+					deferred = true;
 #ifndef MOBILE_DEVICE
 					if (g_Config.bSaveLoadResetsAVdumping) {
 						if (g_Config.bDumpFrames) {
@@ -1075,7 +1179,7 @@ namespace SaveState
 				break;
 			}
 
-			if (op.callback)
+			if (op.callback && !deferred)
 				op.callback(callbackResult, callbackMessage, op.cbUserData);
 		}
 		if (operations.size()) {
@@ -1122,6 +1226,9 @@ namespace SaveState
 
 	void Shutdown()
 	{
+		// Make sure any states still being written make it to disk.
+		FinishPendingSaves(true);
+
 		std::lock_guard<std::mutex> guard(mutex);
 		rewindStates.Clear();
 	}
@@ -77,7 +77,8 @@ namespace SaveState
 	void Load(const Path &filename, int slot, Callback callback = Callback(), void *cbUserData = 0);
 
 	// Save the current state to the specified file (async.)
-	// Warning: callback will be called on a different thread.
+	// The state is snapshotted on the next Process(), then compressed and written in the background.
+	// Warning: callback will be called on a different thread, once the file is written.
 	void Save(const Path &filename, int slot, Callback callback = Callback(), void *cbUserData = 0);
 
 	CChunkFileReader::Error SaveToRam(std::vector<u8> &state);
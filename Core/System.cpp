@@ -49,6 +49,7 @@
 #include "Core/MIPS/MIPS.h"
 #include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
+#include "Core/MIPS/MIPSTables.h"
 #include "Core/Debugger/SymbolMap.h"
 #include "Core/System.h"
 #include "Core/HLE/HLE.h"
@@ -372,6 +373,7 @@ void CPU_Shutdown() {
 
 	pspFileSystem.Shutdown();
 	mipsr4k.Shutdown();
+	MIPSInterpret_ClearCache();
 	Memory::Shutdown();
 	HLEPlugins::Shutdown();
 
@@ -400,7 +402,8 @@ void Core_UpdateState(CoreState newState) {
 
 void Core_UpdateDebugStats(bool collectStats) {
 	bool newState = collectStats || coreCollectDebugStatsCounter > 0;
-	if (coreCollectDebugStats != newState) {
+	bool profilerChanged = hleUpdateSyscallProfilerState();
+	if (coreCollectDebugStats != newState || profilerChanged) {
 		coreCollectDebugStats = newState;
 		mipsr4k.ClearJitCache();
 	}
@@ -473,7 +476,7 @@ bool PSP_InitStart(const CoreParameter &coreParam, std::string *error_string) {
 	}
 
 	// Compat flags get loaded in CPU_Init (which is a bit of a misnomer) so we check for SW renderer here.
-	if (g_Config.bSoftwareRendering || PSP_CoreParameter().compat.flags().ForceSoftwareRenderer) {
+	if ((g_Config.bSoftwareRendering || PSP_CoreParameter().compat.flags().ForceSoftwareRenderer) && g_CoreParameter.gpuCore != GPUCORE_NULL) {
 		g_CoreParameter.gpuCore = GPUCORE_SOFTWARE;
 	}
 
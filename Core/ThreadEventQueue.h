@@ -150,7 +150,7 @@ struct ThreadEventQueue : public B {
 	}
 
 	// Force ignores coreState.
-	void SyncThread(bool force = false) {
+	virtual void SyncThread(bool force = false) {
 		if (!threadEnabled_) {
 			return;
 		}
@@ -17,6 +17,7 @@
 
 #include <cstring>
 
+#include "Common/BitScan.h"
 #include "Common/Log.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/Serialize/SerializeFuncs.h"
@@ -25,7 +26,37 @@
 #include "Core/Util/BlockAllocator.h"
 #include "Core/Reporting.h"
 
-// Slow freaking thing but works (eventually) :)
+// Free blocks are bucketed by size: 8 exact classes for tiny sizes, then 8 classes per power of two.
+static int FreeBucketFor(u32 size) {
+	if (size < 8)
+		return (int)size;
+	int fl = 31 - (int)clz32_nonzero(size);
+	int sl = (size >> (fl - 3)) & 7;
+	return 8 + (fl - 3) * 8 + sl;
+}
+
+static u32 FreeBucketMinSize(int bucket) {
+	if (bucket < 8)
+		return (u32)bucket;
+	int fl = (bucket - 8) / 8 + 3;
+	int sl = (bucket - 8) % 8;
+	return (u32)(8 + sl) << (fl - 3);
+}
+
+// These must match the checks AllocAligned() did when it walked the list, exactly.
+static inline bool FitsFromBottom(u32 start, u32 blockSize, u32 size, u32 grain) {
+	u32 offset = start % grain;
+	if (offset != 0)
+		offset = grain - offset;
+	u32 needed = offset + size;
+	return blockSize >= needed;
+}
+
+static inline bool FitsFromTop(u32 start, u32 blockSize, u32 size, u32 grain) {
+	u32 offset = (start + blockSize - size) % grain;
+	u32 needed = offset + size;
+	return blockSize >= needed;
+}
 
 BlockAllocator::BlockAllocator(int grain) : bottom_(NULL), top_(NULL), grain_(grain)
 {
@@ -44,6 +75,7 @@ void BlockAllocator::Init(u32 rangeStart, u32 rangeSize, bool suballoc) {
 	top_ = new Block(rangeStart_, rangeSize_, false, NULL, NULL);
 	bottom_ = top_;
 	suballoc_ = suballoc;
+	RebuildIndex();
 }
 
 void BlockAllocator::Shutdown()
@@ -55,6 +87,68 @@ void BlockAllocator::Shutdown()
 		bottom_ = next;
 	}
 	top_ = NULL;
+	blocksByStart_.clear();
+	for (auto &bucket : freeBuckets_)
+		bucket.clear();
+	freeBytes_ = 0;
+}
+
+void BlockAllocator::IndexFree(Block *b) {
+	freeBuckets_[FreeBucketFor(b->size)][b->start] = b;
+	freeBytes_ += b->size;
+}
+
+void BlockAllocator::UnindexFree(Block *b) {
+	freeBuckets_[FreeBucketFor(b->size)].erase(b->start);
+	freeBytes_ -= b->size;
+}
+
+void BlockAllocator::RebuildIndex() {
+	blocksByStart_.clear();
+	for (auto &bucket : freeBuckets_)
+		bucket.clear();
+	freeBytes_ = 0;
+	for (Block *bp = bottom_; bp != NULL; bp = bp->next) {
+		blocksByStart_[bp->start] = bp;
+		if (!bp->taken)
+			IndexFree(bp);
+	}
+}
+
+// Returns the same block as walking the list from the bottom (or top) for the first free block that fits.
+BlockAllocator::Block *BlockAllocator::FindFreeBlock(u32 size, u32 grain, bool fromTop) {
+	// Any block at least this big fits regardless of how its start is aligned.
+	const u64 alwaysFits = (u64)size + grain - 1;
+	Block *best = nullptr;
+	for (int i = FreeBucketFor(size); i < FREE_BUCKETS; ++i) {
+		const auto &bucket = freeBuckets_[i];
+		if (bucket.empty())
+			continue;
+		if (FreeBucketMinSize(i) >= alwaysFits) {
+			Block *candidate = fromTop ? bucket.rbegin()->second : bucket.begin()->second;
+			if (!best || (fromTop ? candidate->start > best->start : candidate->start < best->start))
+				best = candidate;
+			continue;
+		}
+
+		// Some blocks here might be too small, check each in order until we pass the best so far.
+		if (!fromTop) {
+			for (auto it = bucket.begin(); it != bucket.end() && (!best || it->first < best->start); ++it) {
+				if (FitsFromBottom(it->first, it->second->size, size, grain)) {
+					best = it->second;
+					break;
+				}
+			}
+		} else {
+			for (auto it = bucket.rbegin(); it != bucket.rend() && (!best || it->first > best->start); ++it) {
+				if (FitsFromTop(it->first, it->second->size, size, grain)) {
+					best = it->second;
+					break;
+				}
+			}
+		}
+	}
+	return best;
 }
 
 u32 BlockAllocator::AllocAligned(u32 &size, u32 sizeGrain, u32 grain, bool fromTop, const char *tag)
@@ -74,67 +168,52 @@ u32 BlockAllocator::AllocAligned(u32 &size, u32 sizeGrain, u32 grain, bool fromT
 	// upalign size to grain
 	size = (size + sizeGrain - 1) & ~(sizeGrain - 1);
 
-	if (!fromTop)
+	Block *bp = FindFreeBlock(size, grain, fromTop);
+	if (bp != NULL && !fromTop)
 	{
 		//Allocate from bottom of mem
-		for (Block *bp = bottom_; bp != NULL; bp = bp->next)
+		Block &b = *bp;
+		u32 offset = b.start % grain;
+		if (offset != 0)
+			offset = grain - offset;
+		u32 needed = offset + size;
+		UnindexFree(bp);
+		if (b.size == needed)
 		{
-			Block &b = *bp;
-			u32 offset = b.start % grain;
-			if (offset != 0)
-				offset = grain - offset;
-			u32 needed = offset + size;
-			if (b.taken == false && b.size >= needed)
-			{
-				if (b.size == needed)
-				{
-					if (offset >= grain_)
-						InsertFreeBefore(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-				else
-				{
-					InsertFreeAfter(&b, b.size - needed);
-					if (offset >= grain_)
-						InsertFreeBefore(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-			}
+			if (offset >= grain_)
+				InsertFreeBefore(&b, offset);
+		}
+		else
+		{
+			InsertFreeAfter(&b, b.size - needed);
+			if (offset >= grain_)
+				InsertFreeBefore(&b, offset);
 		}
+		b.taken = true;
+		b.SetAllocated(tag, suballoc_);
+		return b.start;
 	}
-	else
+	else if (bp != NULL)
 	{
 		// Allocate from top of mem.
-		for (Block *bp = top_; bp != NULL; bp = bp->prev)
+		Block &b = *bp;
+		u32 offset = (b.start + b.size - size) % grain;
+		u32 needed = offset + size;
+		UnindexFree(bp);
+		if (b.size == needed)
 		{
-			Block &b = *bp;
-			u32 offset = (b.start + b.size - size) % grain;
-			u32 needed = offset + size;
-			if (b.taken == false && b.size >= needed)
-			{
-				if (b.size == needed)
-				{
-					if (offset >= grain_)
-						InsertFreeAfter(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-				else
-				{
-					InsertFreeBefore(&b, b.size - needed);
-					if (offset >= grain_)
-						InsertFreeAfter(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-			}
+			if (offset >= grain_)
+				InsertFreeAfter(&b, offset);
 		}
+		else
+		{
+			InsertFreeBefore(&b, b.size - needed);
+			if (offset >= grain_)
+				InsertFreeAfter(&b, offset);
+		}
+		b.taken = true;
+		b.SetAllocated(tag, suballoc_);
+		return b.start;
 	}
 
 	//Out of memory :(
@@ -193,6 +272,7 @@ u32 BlockAllocator::AllocAt(u32 position, u32 size, const char *tag)
 			//good to go
 			else if (b.start == alignedPosition)
 			{
+				UnindexFree(bp);
 				if (b.size != alignedSize)
 					InsertFreeAfter(&b, b.size - alignedSize);
 				b.taken = true;
@@ -202,6 +282,7 @@ u32 BlockAllocator::AllocAt(u32 position, u32 size, const char *tag)
 			}
 			else
 			{
+				UnindexFree(bp);
 				InsertFreeBefore(&b, alignedPosition - b.start);
 				if (b.size > alignedSize)
 					InsertFreeAfter(&b, b.size - alignedSize);
@@ -228,10 +309,13 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 {
 	DEBUG_LOG(SCEKERNEL, "Merging Blocks");
 
+	// fromBlock was just freed, so it's not in the free index yet.
 	Block *prev = fromBlock->prev;
 	while (prev != NULL && prev->taken == false)
 	{
 		DEBUG_LOG(SCEKERNEL, "Block Alloc found adjacent free blocks - merging");
+		UnindexFree(prev);
+		blocksByStart_.erase(fromBlock->start);
 		prev->size += fromBlock->size;
 		if (fromBlock->next == NULL)
 			top_ = prev;
@@ -252,6 +336,8 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 	while (next != NULL && next->taken == false)
 	{
 		DEBUG_LOG(SCEKERNEL, "Block Alloc found adjacent free blocks - merging");
+		UnindexFree(next);
+		blocksByStart_.erase(next->start);
 		fromBlock->size += next->size;
 		fromBlock->next = next->next;
 		delete next;
@@ -262,6 +348,8 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 		top_ = fromBlock;
 	else
 		next->prev = fromBlock;
+
+	IndexFree(fromBlock);
 }
 
 bool BlockAllocator::Free(u32 position)
@@ -309,6 +397,9 @@ BlockAllocator::Block *BlockAllocator::InsertFreeBefore(Block *b, u32 size)
 
 	b->start += size;
 	b->size -= size;
+	blocksByStart_[inserted->start] = inserted;
+	blocksByStart_[b->start] = b;
+	IndexFree(inserted);
 	return inserted;
 }
 
@@ -322,14 +413,14 @@ BlockAllocator::Block *BlockAllocator::InsertFreeAfter(Block *b, u32 size)
 		inserted->next->prev = inserted;
 
 	b->size -= size;
+	blocksByStart_[inserted->start] = inserted;
+	IndexFree(inserted);
 	return inserted;
 }
 
 void BlockAllocator::CheckBlocks() const
 {
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
-	{
-		const Block &b = *bp;
+	auto check = [&](const Block &b) {
 		if (b.start > 0xc0000000) {  // probably free'd debug values
 			ERROR_LOG_REPORT(HLE, "Bogus block in allocator");
 		}
@@ -337,7 +428,18 @@ void BlockAllocator::CheckBlocks() const
 		if (b.start + b.size > rangeStart_ + rangeSize_ || b.start < rangeStart_) {
 			ERROR_LOG_REPORT(HLE, "Bogus block in allocator");
 		}
-	}
+	};
+#ifdef _DEBUG
+	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
+		check(*bp);
+#else
+	// Blocks are contiguous, so a broken block almost always shows up at the ends.
+	// Walking all of them on every AllocAt() is too slow with many blocks.
+	if (bottom_)
+		check(*bottom_);
+	if (top_)
+		check(*top_);
+#endif
 }
 
 const char *BlockAllocator::GetBlockTag(u32 addr) const {
@@ -345,30 +447,23 @@ const char *BlockAllocator::GetBlockTag(u32 addr) const {
 	return b->tag;
 }
 
-inline BlockAllocator::Block *BlockAllocator::GetBlockFromAddress(u32 addr)
+BlockAllocator::Block *BlockAllocator::GetBlockFromAddress(u32 addr)
 {
-	for (Block *bp = bottom_; bp != NULL; bp = bp->next)
-	{
-		Block &b = *bp;
-		if (b.start <= addr && b.start + b.size > addr)
-		{
-			// Got one!
-			return bp;
-		}
-	}
-	return NULL;
+	return const_cast<Block *>(static_cast<const BlockAllocator *>(this)->GetBlockFromAddress(addr));
 }
 
 const BlockAllocator::Block *BlockAllocator::GetBlockFromAddress(u32 addr) const
 {
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
+	// The last block starting at or before addr is the only one that can contain it.
+	auto it = blocksByStart_.upper_bound(addr);
+	if (it == blocksByStart_.begin())
+		return NULL;
+	--it;
+	const Block &b = *it->second;
+	if (b.start <= addr && b.start + b.size > addr)
 	{
-		const Block &b = *bp;
-		if (b.start <= addr && b.start + b.size > addr)
-		{
-			// Got one!
-			return bp;
-		}
+		// Got one!
+		return it->second;
 	}
 	return NULL;
 }
@@ -405,14 +500,17 @@ void BlockAllocator::ListBlocks() const
 u32 BlockAllocator::GetLargestFreeBlockSize() const
 {
 	u32 maxFreeBlock = 0;
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
+	// Only the largest non-empty size class needs to be checked.
+	for (int i = FREE_BUCKETS - 1; i >= 0; --i)
 	{
-		const Block &b = *bp;
-		if (!b.taken)
+		if (freeBuckets_[i].empty())
+			continue;
+		for (const auto &it : freeBuckets_[i])
 		{
-			if (b.size > maxFreeBlock)
-				maxFreeBlock = b.size;
+			if (it.second->size > maxFreeBlock)
+				maxFreeBlock = it.second->size;
 		}
+		break;
 	}
 	if (maxFreeBlock & (grain_ - 1))
 		WARN_LOG_REPORT(HLE, "GetLargestFreeBlockSize: free size %08x does not align to grain %08x.", maxFreeBlock, grain_);
@@ -421,15 +519,7 @@ u32 BlockAllocator::GetLargestFreeBlockSize() const
 
 u32 BlockAllocator::GetTotalFreeBytes() const
 {
-	u32 sum = 0;
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
-	{
-		const Block &b = *bp;
-		if (!b.taken)
-		{
-			sum += b.size;
-		}
-	}
+	u32 sum = freeBytes_;
 	if (sum & (grain_ - 1))
 		WARN_LOG_REPORT(HLE, "GetTotalFreeBytes: free size %08x does not align to grain %08x.", sum, grain_);
 	return sum;
@@ -481,6 +571,9 @@ void BlockAllocator::DoState(PointerWrap &p)
 	Do(p, rangeStart_);
 	Do(p, rangeSize_);
 	Do(p, grain_);
+
+	if (p.mode == p.MODE_READ)
+		RebuildIndex();
 }
 
 BlockAllocator::Block::Block(u32 _start, u32 _size, bool _taken, Block *_prev, Block *_next)
@@ -19,6 +19,8 @@
 
 class PointerWrap;
 
+#include <map>
+
 #include "Common/CommonTypes.h"
 
 class BlockAllocator
@@ -80,6 +82,19 @@ class BlockAllocator
 	u32 grain_;
 	bool suballoc_;
 
+	// The list above is the real state. These index it, so that lookups don't have to walk it:
+	// all blocks by start address, and free blocks in size classes, each ordered by address.
+	// Placement is still exactly first fit in address order, like walking the list.
+	enum { FREE_BUCKETS = 8 + 29 * 8 };
+	std::map<u32, Block *> blocksByStart_;
+	std::map<u32, Block *> freeBuckets_[FREE_BUCKETS];
+	u32 freeBytes_ = 0;
+
+	void IndexFree(Block *b);
+	void UnindexFree(Block *b);
+	void RebuildIndex();
+	Block *FindFreeBlock(u32 size, u32 grain, bool fromTop);
+
 	void MergeFreeBlocks(Block *fromBlock);
 	Block *GetBlockFromAddress(u32 addr);
 	const Block *GetBlockFromAddress(u32 addr) const;
@@ -76,7 +76,7 @@ static ServerStatus RetrieveStatus() {
 static bool RegisterServer(int port) {
 	bool success = false;
 	http::Client http;
-	bool cancelled = false;
+	std::atomic<bool> cancelled{};
 	net::RequestProgress progress(&cancelled);
 	Buffer theVoid = Buffer::Void();
 
@@ -228,32 +228,13 @@ static void DiscHandler(const http::ServerRequest &request, const Path &filename
 			return;
 		}
 
-		FILE *fp = File::OpenCFile(filename, "rb");
-		if (!fp || fseek(fp, begin, SEEK_SET) != 0) {
-			request.WriteHttpResponseHeader("1.0", 500, -1, "text/plain");
-			request.Out()->Push("File access failed.");
-			if (fp) {
-				fclose(fp);
-			}
-			return;
-		}
-
 		s64 len = last - begin + 1;
 		char contentRange[1024];
 		snprintf(contentRange, sizeof(contentRange), "Content-Range: bytes %lld-%lld/%lld\r\n", begin, last, sz);
 		request.WriteHttpResponseHeader("1.0", 206, len, "application/octet-stream", contentRange);
-
-		const size_t CHUNK_SIZE = 16 * 1024;
-		char *buf = new char[CHUNK_SIZE];
-		for (s64 pos = 0; pos < len; pos += CHUNK_SIZE) {
-			s64 chunklen = std::min(len - pos, (s64)CHUNK_SIZE);
-			if (fread(buf, chunklen, 1, fp) != 1)
-				break;
-			request.Out()->Push(buf, chunklen);
+		if (!request.SendFileRange(filename, begin, len)) {
+			ERROR_LOG(FILESYS, "Failed to send range of %s", filename.c_str());
 		}
-		fclose(fp);
-		delete[] buf;
-		request.Out()->Flush();
 	} else {
 		request.WriteHttpResponseHeader("1.0", 418, -1, "text/plain");
 		request.Out()->Push("This server only supports range requests.");
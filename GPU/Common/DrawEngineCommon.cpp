@@ -24,11 +24,14 @@
 #include "Common/Math/CrossSIMD.h"
 #include "Common/Math/lin/matrix4x4.h"
 #include "Core/Config.h"
+#include "Core/MemMap.h"
 #include "GPU/Common/DrawEngineCommon.h"
 #include "GPU/Common/SplineCommon.h"
 #include "GPU/Common/VertexDecoderCommon.h"
 #include "GPU/ge_constants.h"
+#include "GPU/GPU.h"
 #include "GPU/GPUState.h"
+#include "ext/xxhash.h"
 
 #define QUAD_INDICES_MAX 65536
 
@@ -36,7 +39,22 @@ enum {
 	TRANSFORMED_VERTEX_BUFFER_SIZE = VERTEX_BUFFER_MAX * sizeof(TransformedVertex)
 };
 
-DrawEngineCommon::DrawEngineCommon() : decoderMap_(16) {
+enum {
+	// Small draws are cheaper to decode than to track.
+	VERTEX_CACHE_MIN_VERTS = 16,
+	VERTEX_CACHE_MAX_BYTES = 32 * 1024 * 1024,
+	// Frames between rehashes of reliable data grows up to this.
+	VERTEX_CACHE_MAX_HASH_INTERVAL = 32,
+	VERTEX_CACHE_DECIMATE_FRAMES = 30,
+	VERTEX_CACHE_KILL_AGE = 120,
+	// Give up on data that changes more often than this.
+	VERTEX_CACHE_MAX_CHANGES = 3,
+};
+
+DrawEngineCommon::DrawEngineCommon() : decoderMap_(16), vertexCache_(256) {
+	drawVerts_.resize(INITIAL_DEFERRED_DRAW_VERTS);
+	drawVertexOffsets_.resize(INITIAL_DEFERRED_DRAW_VERTS);
+	drawInds_.resize(INITIAL_DEFERRED_DRAW_INDS);
 	if (g_Config.bVertexDecoderJit && (g_Config.iCpuCore == (int)CPUCore::JIT || g_Config.iCpuCore == (int)CPUCore::JIT_IR)) {
 		decJitCache_ = new VertexDecoderJitCache();
 	}
@@ -55,6 +73,7 @@ DrawEngineCommon::~DrawEngineCommon() {
 	decoderMap_.Iterate([&](const uint32_t vtype, VertexDecoder *decoder) {
 		delete decoder;
 	});
+	DrawEngineCommon::ClearTrackedVertexArrays();
 	ClearSplineBezierWeights();
 }
 
@@ -132,6 +151,7 @@ void DrawEngineCommon::NotifyConfigChanged() {
 
 	useHWTransform_ = g_Config.bHardwareTransform;
 	useHWTessellation_ = UpdateUseHWTessellation(g_Config.bHardwareTessellation);
+	useVertexCache_ = g_Config.bVertexCache;
 	decOptions_.applySkinInDecode = g_Config.bSoftwareSkinning;
 }
 
@@ -809,10 +829,9 @@ int DrawEngineCommon::ComputeNumVertsToDecode() const {
 int DrawEngineCommon::ExtendNonIndexedPrim(const uint32_t *cmd, const uint32_t *stall, u32 vertTypeID, bool clockwise, int *bytesRead, bool isTriangle) {
 	const uint32_t *start = cmd;
 	int prevDrawVerts = numDrawVerts_ - 1;
-	DeferredVerts &dv = drawVerts_[prevDrawVerts];
-	int offset = dv.vertexCount;
+	int offset = drawVerts_[prevDrawVerts].vertexCount;
 
-	_dbg_assert_(numDrawInds_ <= MAX_DEFERRED_DRAW_INDS);  // if it's equal, the check below will take care of it before any action is taken.
+	_dbg_assert_(numDrawInds_ <= (int)drawInds_.size());  // if it's equal, the check below will take care of it before any action is taken.
 	_dbg_assert_(numDrawVerts_ > 0);
 
 	if (!clockwise) {
@@ -828,9 +847,14 @@ int DrawEngineCommon::ExtendNonIndexedPrim(const uint32_t *cmd, const uint32_t *
 		if (IsTrianglePrim(newPrim) != isTriangle)
 			break;
 		int vertexCount = data & 0xFFFF;
-		if (numDrawInds_ >= MAX_DEFERRED_DRAW_INDS || vertexCountInDrawCalls_ + offset + vertexCount > VERTEX_BUFFER_MAX) {
+		if (vertexCountInDrawCalls_ + offset + vertexCount > VERTEX_BUFFER_MAX) {
 			break;
 		}
+		if (numDrawInds_ >= (int)drawInds_.size()) {
+			if (drawInds_.size() >= MAX_DEFERRED_DRAW_INDS)
+				break;
+			drawInds_.resize(drawInds_.size() * 2);
+		}
 		DeferredInds &di = drawInds_[numDrawInds_++];
 		di.indexType = 0;
 		di.prim = newPrim;
@@ -845,6 +869,7 @@ int DrawEngineCommon::ExtendNonIndexedPrim(const uint32_t *cmd, const uint32_t *
 
 	seenPrims_ |= seenPrims;
 
+	DeferredVerts &dv = drawVerts_[prevDrawVerts];
 	int totalCount = offset - dv.vertexCount;
 	dv.vertexCount = offset;
 	dv.indexUpperBound = dv.vertexCount - 1;
@@ -853,9 +878,25 @@ int DrawEngineCommon::ExtendNonIndexedPrim(const uint32_t *cmd, const uint32_t *
 	return cmd - start;
 }
 
+// Returns false if we're already at the limits, then the caller needs to flush.
+bool DrawEngineCommon::GrowDeferredDraws() {
+	if (numDrawVerts_ >= (int)drawVerts_.size()) {
+		if (drawVerts_.size() >= MAX_DEFERRED_DRAW_VERTS)
+			return false;
+		drawVerts_.resize(drawVerts_.size() * 2);
+		drawVertexOffsets_.resize(drawVerts_.size());
+	}
+	if (numDrawInds_ >= (int)drawInds_.size()) {
+		if (drawInds_.size() >= MAX_DEFERRED_DRAW_INDS)
+			return false;
+		drawInds_.resize(drawInds_.size() * 2);
+	}
+	return true;
+}
+
 void DrawEngineCommon::SkipPrim(GEPrimitiveType prim, int vertexCount, u32 vertTypeID, int *bytesRead) {
 	if (!indexGen.PrimCompatible(prevPrim_, prim)) {
-		DispatchFlush();
+		DispatchFlushFor(FlushReason::PRIM_CHANGE);
 	}
 
 	// This isn't exactly right, if we flushed, since prims can straddle previous calls.
@@ -880,11 +921,15 @@ void DrawEngineCommon::SkipPrim(GEPrimitiveType prim, int vertexCount, u32 vertT
 
 // vertTypeID is the vertex type but with the UVGen mode smashed into the top bits.
 bool DrawEngineCommon::SubmitPrim(const void *verts, const void *inds, GEPrimitiveType prim, int vertexCount, u32 vertTypeID, bool clockwise, int *bytesRead) {
-	if (!indexGen.PrimCompatible(prevPrim_, prim) || numDrawVerts_ >= MAX_DEFERRED_DRAW_VERTS || numDrawInds_ >= MAX_DEFERRED_DRAW_INDS || vertexCountInDrawCalls_ + vertexCount > VERTEX_BUFFER_MAX) {
-		DispatchFlush();
+	if (!indexGen.PrimCompatible(prevPrim_, prim)) {
+		DispatchFlushFor(FlushReason::PRIM_CHANGE);
+	} else if (vertexCountInDrawCalls_ + vertexCount > VERTEX_BUFFER_MAX) {
+		DispatchFlushFor(FlushReason::VERTEX_LIMIT);
+	} else if ((numDrawVerts_ >= (int)drawVerts_.size() || numDrawInds_ >= (int)drawInds_.size()) && !GrowDeferredDraws()) {
+		DispatchFlushFor(FlushReason::DRAW_LIMIT);
 	}
-	_dbg_assert_(numDrawVerts_ < MAX_DEFERRED_DRAW_VERTS);
-	_dbg_assert_(numDrawInds_ < MAX_DEFERRED_DRAW_INDS);
+	_dbg_assert_(numDrawVerts_ < (int)drawVerts_.size());
+	_dbg_assert_(numDrawInds_ < (int)drawInds_.size());
 
 	// This isn't exactly right, if we flushed, since prims can straddle previous calls.
 	// But it generally works for common usage.
@@ -934,8 +979,8 @@ bool DrawEngineCommon::SubmitPrim(const void *verts, const void *inds, GEPrimiti
 	di.vertDecodeIndex = numDrawVerts_;
 	di.offset = 0;
 
-	_dbg_assert_(numDrawVerts_ <= MAX_DEFERRED_DRAW_VERTS);
-	_dbg_assert_(numDrawInds_ <= MAX_DEFERRED_DRAW_INDS);
+	_dbg_assert_(numDrawVerts_ <= (int)drawVerts_.size());
+	_dbg_assert_(numDrawInds_ <= (int)drawInds_.size());
 
 	if (inds && numDrawVerts_ > decodeVertsCounter_ && drawVerts_[numDrawVerts_ - 1].verts == verts && !applySkin) {
 		// Same vertex pointer as a previous un-decoded draw call - let's just extend the decode!
@@ -964,14 +1009,19 @@ bool DrawEngineCommon::SubmitPrim(const void *verts, const void *inds, GEPrimiti
 	if (prim == GE_PRIM_RECTANGLES && (gstate.getTextureAddress(0) & 0x3FFFFFFF) == (gstate.getFrameBufAddress() & 0x3FFFFFFF)) {
 		// This prevents issues with consecutive self-renders in Ridge Racer.
 		gstate_c.Dirty(DIRTY_TEXTURE_PARAMS);
-		DispatchFlush();
+		DispatchFlushFor(FlushReason::SELF_RENDER);
 	}
 	return true;
 }
 
 void DrawEngineCommon::DecodeVerts(u8 *dest) {
+	GPUPhaseScope phase(GPUPhase::VERTEX_DECODE);
 	// Note that this should be able to continue a partial decode - we don't necessarily start from zero here (although we do most of the time).
 
+	// Morphing and software skinning depend on state beyond the vertex data, so those can't be cached.
+	bool applySkin = (lastVType_ & GE_VTYPE_WEIGHT_MASK) && decOptions_.applySkinInDecode;
+	bool useCache = useVertexCache_ && !applySkin && (lastVType_ & GE_VTYPE_MORPHCOUNT_MASK) == 0;
+
 	int i = decodeVertsCounter_;
 	int stride = (int)dec_->GetDecVtxFmt().stride;
 	for (; i < numDrawVerts_; i++) {
@@ -981,13 +1031,193 @@ void DrawEngineCommon::DecodeVerts(u8 *dest) {
 		drawVertexOffsets_[i] = numDecodedVerts_ - indexLowerBound;
 
 		int indexUpperBound = dv.indexUpperBound;
-		// Decode the verts (and at the same time apply morphing/skinning). Simple.
-		dec_->DecodeVerts(dest + numDecodedVerts_ * stride, dv.verts, &dv.uvScale, indexLowerBound, indexUpperBound);
+		u8 *vertDest = dest + numDecodedVerts_ * stride;
+		if (!useCache || !DecodeVertsCached(vertDest, dv)) {
+			// Decode the verts (and at the same time apply morphing/skinning). Simple.
+			dec_->DecodeVerts(vertDest, dv.verts, &dv.uvScale, indexLowerBound, indexUpperBound);
+		}
 		numDecodedVerts_ += indexUpperBound - indexLowerBound + 1;
 	}
 	decodeVertsCounter_ = i;
 }
 
+static inline void ApplyCachedDecodeSideEffects(const DecodedVertexCacheEntry *entry) {
+	gstate_c.vertexFullAlpha = gstate_c.vertexFullAlpha && entry->fullAlpha;
+	gstate_c.vertBounds.minU = std::min(gstate_c.vertBounds.minU, entry->minU);
+	gstate_c.vertBounds.minV = std::min(gstate_c.vertBounds.minV, entry->minV);
+	gstate_c.vertBounds.maxU = std::max(gstate_c.vertBounds.maxU, entry->maxU);
+	gstate_c.vertBounds.maxV = std::max(gstate_c.vertBounds.maxV, entry->maxV);
+}
+
+// Returns true if dest was filled, either from the cache or by decoding and storing the result.
+bool DrawEngineCommon::DecodeVertsCached(u8 *dest, const DeferredVerts &dv) {
+	const int count = dv.indexUpperBound - dv.indexLowerBound + 1;
+	if (count < VERTEX_CACHE_MIN_VERTS) {
+		return false;
+	}
+
+	const int frame = gpuStats.numFlips;
+	if (frame - lastVertexCacheDecimation_ >= VERTEX_CACHE_DECIMATE_FRAMES) {
+		DecimateTrackedVertexArrays();
+	}
+
+	DecodedVertexCacheKey key;
+	memset(&key, 0, sizeof(key));
+	key.verts = dv.verts;
+	key.vertTypeID = lastVType_;
+	key.indexLowerBound = dv.indexLowerBound;
+	key.indexUpperBound = dv.indexUpperBound;
+	key.uvScale = dv.uvScale;
+
+	const u8 *src = (const u8 *)dv.verts + dv.indexLowerBound * dec_->VertexSize();
+	const u32 srcSize = count * dec_->VertexSize();
+	const u32 decodedSize = count * dec_->GetDecVtxFmt().stride;
+
+	DecodedVertexCacheEntry *entry = vertexCache_.GetOrNull(key);
+	if (!entry) {
+		entry = new DecodedVertexCacheEntry();
+		entry->hash = XXH3_64bits(src, srcSize);
+		entry->src = src;
+		entry->srcSize = srcSize;
+		entry->lastFrame = frame;
+		entry->lastHashFrame = frame;
+		entry->hashInterval = 1;
+		entry->numChanges = 0;
+		entry->status = DecodedVertexCacheEntry::Status::HASHING;
+		entry->needsRehash = false;
+		vertexCache_.Insert(key, entry);
+		gpuStats.numVertexCacheMisses++;
+		return false;
+	}
+
+	entry->lastFrame = frame;
+	switch (entry->status) {
+	case DecodedVertexCacheEntry::Status::UNRELIABLE:
+		gpuStats.numVertexCacheMisses++;
+		return false;
+
+	case DecodedVertexCacheEntry::Status::HASHING:
+	{
+		u64 hash = XXH3_64bits(src, srcSize);
+		entry->lastHashFrame = frame;
+		entry->needsRehash = false;
+		if (hash != entry->hash) {
+			entry->hash = hash;
+			if (++entry->numChanges >= VERTEX_CACHE_MAX_CHANGES) {
+				entry->status = DecodedVertexCacheEntry::Status::UNRELIABLE;
+			}
+			gpuStats.numVertexCacheMisses++;
+			return false;
+		}
+		if (vertexCacheBytes_ + decodedSize > VERTEX_CACHE_MAX_BYTES) {
+			gpuStats.numVertexCacheMisses++;
+			return false;
+		}
+
+		// Looks static. Decode, capturing the side effects of the decode so we can replay them on hits.
+		bool prevFullAlpha = gstate_c.vertexFullAlpha;
+		KnownVertexBounds prevBounds = gstate_c.vertBounds;
+		gstate_c.vertexFullAlpha = true;
+		gstate_c.vertBounds.minU = 512;
+		gstate_c.vertBounds.minV = 512;
+		gstate_c.vertBounds.maxU = 0;
+		gstate_c.vertBounds.maxV = 0;
+
+		dec_->DecodeVerts(dest, dv.verts, &dv.uvScale, dv.indexLowerBound, dv.indexUpperBound);
+
+		entry->fullAlpha = gstate_c.vertexFullAlpha;
+		entry->minU = gstate_c.vertBounds.minU;
+		entry->minV = gstate_c.vertBounds.minV;
+		entry->maxU = gstate_c.vertBounds.maxU;
+		entry->maxV = gstate_c.vertBounds.maxV;
+		gstate_c.vertexFullAlpha = prevFullAlpha;
+		gstate_c.vertBounds = prevBounds;
+		ApplyCachedDecodeSideEffects(entry);
+
+		entry->decoded.assign(dest, dest + decodedSize);
+		vertexCacheBytes_ += decodedSize;
+		entry->status = DecodedVertexCacheEntry::Status::RELIABLE;
+		gpuStats.numVertexCacheMisses++;
+		return true;
+	}
+
+	case DecodedVertexCacheEntry::Status::RELIABLE:
+		if (entry->needsRehash || frame - entry->lastHashFrame >= entry->hashInterval) {
+			u64 hash = XXH3_64bits(src, srcSize);
+			entry->lastHashFrame = frame;
+			entry->needsRehash = false;
+			gpuStats.numVertexCacheRehashes++;
+			if (hash != entry->hash) {
+				entry->hash = hash;
+				entry->hashInterval = 1;
+				vertexCacheBytes_ -= entry->decoded.size();
+				std::vector<u8>().swap(entry->decoded);
+				entry->status = ++entry->numChanges >= VERTEX_CACHE_MAX_CHANGES ? DecodedVertexCacheEntry::Status::UNRELIABLE : DecodedVertexCacheEntry::Status::HASHING;
+				gpuStats.numVertexCacheMisses++;
+				return false;
+			}
+			entry->hashInterval = std::min(entry->hashInterval * 2, (int)VERTEX_CACHE_MAX_HASH_INTERVAL);
+		}
+
+		_dbg_assert_(entry->decoded.size() == decodedSize);
+		memcpy(dest, entry->decoded.data(), decodedSize);
+		ApplyCachedDecodeSideEffects(entry);
+		gpuStats.numVertexCacheHits++;
+		return true;
+	}
+
+	return false;
+}
+
+void DrawEngineCommon::InvalidateTrackedVertexArrays(u32 addr, int size) {
+	if (vertexCache_.size() == 0) {
+		return;
+	}
+
+	if (size <= 0 || !Memory::IsValidAddress(addr)) {
+		vertexCache_.IterateMut([&](const DecodedVertexCacheKey &key, DecodedVertexCacheEntry *entry) {
+			entry->needsRehash = true;
+		});
+		return;
+	}
+
+	const u8 *start = Memory::GetPointerUnchecked(addr);
+	const u8 *end = start + size;
+	vertexCache_.IterateMut([&](const DecodedVertexCacheKey &key, DecodedVertexCacheEntry *entry) {
+		if (entry->src < end && entry->src + entry->srcSize > start) {
+			entry->needsRehash = true;
+		}
+	});
+}
+
+void DrawEngineCommon::DecimateTrackedVertexArrays() {
+	const int frame = gpuStats.numFlips;
+	lastVertexCacheDecimation_ = frame;
+
+	std::vector<DecodedVertexCacheKey> toRemove;
+	vertexCache_.Iterate([&](const DecodedVertexCacheKey &key, DecodedVertexCacheEntry *entry) {
+		if (frame - entry->lastFrame > VERTEX_CACHE_KILL_AGE) {
+			toRemove.push_back(key);
+		}
+	});
+
+	for (const DecodedVertexCacheKey &key : toRemove) {
+		DecodedVertexCacheEntry *entry = vertexCache_.GetOrNull(key);
+		vertexCacheBytes_ -= entry->decoded.size();
+		delete entry;
+		vertexCache_.Remove(key);
+	}
+	vertexCache_.Maintain();
+}
+
+void DrawEngineCommon::ClearTrackedVertexArrays() {
+	vertexCache_.Iterate([&](const DecodedVertexCacheKey &key, DecodedVertexCacheEntry *entry) {
+		delete entry;
+	});
+	vertexCache_.Clear();
+	vertexCacheBytes_ = 0;
+}
+
 int DrawEngineCommon::DecodeInds() {
 	// Note that this should be able to continue a partial decode - we don't necessarily start from zero here (although we do most of the time).
 
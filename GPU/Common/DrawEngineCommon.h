@@ -47,6 +47,15 @@ enum {
 	TEX_SLOT_SPLINE_WEIGHTS_V = 6,
 };
 
+// Why the draw engine flushed, for the stats.
+enum class FlushReason {
+	OTHER,
+	PRIM_CHANGE,
+	VERTEX_LIMIT,
+	DRAW_LIMIT,
+	SELF_RENDER,
+};
+
 enum FBOTexState {
 	FBO_TEX_NONE,
 	FBO_TEX_COPY_BIND_TEX,
@@ -69,6 +78,40 @@ class TessellationDataTransfer {
 	virtual void SendDataToShader(const SimpleVertex *const *points, int size_u, int size_v, u32 vertType, const Spline::Weight2D &weights) = 0;
 };
 
+// Identifies a range of decoded vertices. Compared with memcmp, so keep it free of padding.
+struct DecodedVertexCacheKey {
+	const void *verts;
+	u32 vertTypeID;
+	u16 indexLowerBound;
+	u16 indexUpperBound;
+	UVScale uvScale;
+};
+
+// Decoded vertices for static geometry, so we don't have to run the vertex decoder again
+// for data that hasn't changed since last frame. Similar to the old per-backend vertex arrays
+// cache, but backend independent and only skips the decode.
+struct DecodedVertexCacheEntry {
+	enum class Status : u8 {
+		HASHING,  // Seen, data not yet stored. Waiting to see if it stays the same.
+		RELIABLE,  // Data stored and used, rehashed every now and then.
+		UNRELIABLE,  // Changes too often, not worth hashing.
+	};
+
+	std::vector<u8> decoded;
+	u64 hash;
+	const u8 *src;
+	u32 srcSize;
+	int lastFrame;
+	int lastHashFrame;
+	int hashInterval;
+	int numChanges;
+	Status status;
+	bool needsRehash;
+	// Side effects of the decode, reapplied on hit.
+	bool fullAlpha;
+	u16 minU, minV, maxU, maxV;
+};
+
 // Culling plane, group of 8.
 struct alignas(16) Plane8 {
 	float x[8], y[8], z[8], w[8];
@@ -145,7 +188,12 @@ class DrawEngineCommon {
 
 	VertexDecoder *GetVertexDecoder(u32 vtype);
 
-	virtual void ClearTrackedVertexArrays() {}
+	virtual void ClearTrackedVertexArrays();
+	// Called on memory writes, so we recheck decoded vertices from the range next time they're used.
+	void InvalidateTrackedVertexArrays(u32 addr, int size);
+	size_t NumTrackedVertexArrays() const {
+		return vertexCache_.size();
+	}
 
 protected:
 	virtual bool UpdateUseHWTessellation(bool enabled) const { return enabled; }
@@ -153,6 +201,13 @@ class DrawEngineCommon {
 
 	void DecodeVerts(u8 *dest);
 	int DecodeInds();
+	// Only counted if something was actually drawn.
+	void DispatchFlushFor(FlushReason reason) {
+		flushReason_ = reason;
+		DispatchFlush();
+		flushReason_ = FlushReason::OTHER;
+	}
+	void DecimateTrackedVertexArrays();
 
 	// Preprocessing for spline/bezier
 	u32 NormalizeVertices(u8 *outPtr, u8 *bufPtr, const u8 *inPtr, int lowerBound, int upperBound, u32 vertType, int *vertexSize = nullptr);
@@ -191,6 +246,13 @@ class DrawEngineCommon {
 
 	inline void ResetAfterDrawInline() {
 		gpuStats.numFlushes++;
+		switch (flushReason_) {
+		case FlushReason::PRIM_CHANGE: gpuStats.numFlushesPrimChange++; break;
+		case FlushReason::VERTEX_LIMIT: gpuStats.numFlushesVertexLimit++; break;
+		case FlushReason::DRAW_LIMIT: gpuStats.numFlushesDrawLimit++; break;
+		case FlushReason::SELF_RENDER: gpuStats.numFlushesSelfRender++; break;
+		default: gpuStats.numFlushesOther++; break;
+		}
 		gpuStats.numDrawCalls += numDrawInds_;
 		gpuStats.numVertexDecodes += numDrawVerts_;
 		gpuStats.numVertsSubmitted += vertexCountInDrawCalls_;
@@ -279,18 +341,27 @@ class DrawEngineCommon {
 	struct DeferredInds {
 		const void *inds;
 		u32 vertexCount;
-		u8 vertDecodeIndex;  // index into the drawVerts_ array to look up the vertexOffset.
+		u16 vertDecodeIndex;  // index into the drawVerts_ array to look up the vertexOffset.
 		u8 indexType;
 		GEPrimitiveType prim;
 		bool clockwise;
 		u16 offset;
 	};
 
-	enum { MAX_DEFERRED_DRAW_VERTS = 128 };  // If you change this to more than 256, change type of DeferredInds::vertDecodeIndex.
-	enum { MAX_DEFERRED_DRAW_INDS = 512 };  // Monster Hunter spams indexed calls that we end up merging.
-	DeferredVerts drawVerts_[MAX_DEFERRED_DRAW_VERTS];
-	uint32_t drawVertexOffsets_[MAX_DEFERRED_DRAW_VERTS];
-	DeferredInds drawInds_[MAX_DEFERRED_DRAW_INDS];
+	bool DecodeVertsCached(u8 *dest, const DeferredVerts &dv);
+	bool GrowDeferredDraws();
+
+	// The deferred draw arrays start out at these sizes, and grow when a game merges a lot of draws.
+	// Monster Hunter spams indexed calls that we end up merging.
+	enum { INITIAL_DEFERRED_DRAW_VERTS = 128 };
+	enum { INITIAL_DEFERRED_DRAW_INDS = 512 };
+	// If you change this to more than 65536, change type of DeferredInds::vertDecodeIndex.
+	// Can't usefully merge more draws than that anyway, since we're limited by VERTEX_BUFFER_MAX.
+	enum { MAX_DEFERRED_DRAW_VERTS = 4096 };
+	enum { MAX_DEFERRED_DRAW_INDS = 16384 };
+	std::vector<DeferredVerts> drawVerts_;
+	std::vector<uint32_t> drawVertexOffsets_;
+	std::vector<DeferredInds> drawInds_;
 
 	VertexDecoder *dec_ = nullptr;
 	u32 lastVType_ = -1;  // corresponds to dec_.  Could really just pick it out of dec_...
@@ -305,10 +376,17 @@ class DrawEngineCommon {
 	bool anyCCWOrIndexed_ = 0;
 	bool anyIndexed_ = 0;
 
+	// Decoded vertex cache
+	DenseHashMap<DecodedVertexCacheKey, DecodedVertexCacheEntry *> vertexCache_;
+	size_t vertexCacheBytes_ = 0;
+	int lastVertexCacheDecimation_ = 0;
+	bool useVertexCache_ = false;
+
 	// Vertex collector state
 	IndexGenerator indexGen;
 	int numDecodedVerts_ = 0;
 	GEPrimitiveType prevPrim_ = GE_PRIM_INVALID;
+	FlushReason flushReason_ = FlushReason::OTHER;
 
 	// Shader blending state
 	bool fboTexBound_ = false;
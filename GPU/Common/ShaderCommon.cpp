@@ -1,2 +1,194 @@
+#include <algorithm>
+#include <cstring>
+
 #include "Common/GPU/Shader.h"
+#include "Common/Log.h"
 #include "GPU/Common/ShaderCommon.h"
+#include "ext/xxhash.h"
+
+// Refuse obviously corrupt entries, generated shaders are far smaller than this.
+static const uint32_t MAX_SPIRV_WORDS = 4 * 1024 * 1024;
+
+SpirvCache::Key SpirvCache::MakeKey(uint32_t stage, const char *source) {
+	XXH128_hash_t hash = XXH3_128bits_withSeed(source, strlen(source), stage);
+	return Key{ hash.low64, hash.high64 };
+}
+
+bool SpirvCache::Get(const Key &key, std::vector<uint32_t> *spirv) {
+	std::lock_guard<std::mutex> guard(lock_);
+	auto it = entries_.find(key);
+	if (it == entries_.end())
+		return false;
+	it->second.used = true;
+	*spirv = it->second.spirv;
+	return true;
+}
+
+void SpirvCache::Put(const Key &key, const std::vector<uint32_t> &spirv) {
+	std::lock_guard<std::mutex> guard(lock_);
+	Entry &entry = entries_[key];
+	entry.spirv = spirv;
+	entry.used = true;
+}
+
+bool SpirvCache::Contains(const Key &key) {
+	std::lock_guard<std::mutex> guard(lock_);
+	return entries_.find(key) != entries_.end();
+}
+
+void SpirvCache::Clear() {
+	std::lock_guard<std::mutex> guard(lock_);
+	entries_.clear();
+}
+
+size_t SpirvCache::size() {
+	std::lock_guard<std::mutex> guard(lock_);
+	return entries_.size();
+}
+
+bool SpirvCache::Load(FILE *f) {
+	std::lock_guard<std::mutex> guard(lock_);
+	uint32_t count = 0;
+	if (fread(&count, sizeof(count), 1, f) != 1)
+		return false;
+
+	for (uint32_t i = 0; i < count; ++i) {
+		Key key;
+		uint32_t words = 0;
+		if (fread(&key, sizeof(key), 1, f) != 1 || fread(&words, sizeof(words), 1, f) != 1 || words > MAX_SPIRV_WORDS)
+			return false;
+
+		Entry entry{ std::vector<uint32_t>(words), false };
+		if (words != 0 && fread(entry.spirv.data(), sizeof(uint32_t), words, f) != words)
+			return false;
+		entries_[key] = std::move(entry);
+	}
+	return true;
+}
+
+bool SpirvCache::Save(FILE *f) {
+	std::lock_guard<std::mutex> guard(lock_);
+	uint32_t count = 0;
+	for (const auto &it : entries_) {
+		if (it.second.used)
+			count++;
+	}
+
+	bool success = fwrite(&count, sizeof(count), 1, f) == 1;
+	for (const auto &it : entries_) {
+		if (!success)
+			break;
+		if (!it.second.used)
+			continue;
+		uint32_t words = (uint32_t)it.second.spirv.size();
+		success = fwrite(&it.first, sizeof(it.first), 1, f) == 1 && fwrite(&words, sizeof(words), 1, f) == 1;
+		success = success && (words == 0 || fwrite(it.second.spirv.data(), sizeof(uint32_t), words, f) == words);
+	}
+	return success;
+}
+
+static const uint32_t SHADER_PROFILE_MAGIC = 0x50485350;  // 'PSHP'
+
+void ShaderUsage::Merge(const ShaderUsage &other) {
+	if (other.hits == 0)
+		return;
+	firstFrame = hits == 0 ? other.firstFrame : std::min(firstFrame, other.firstFrame);
+	hits = (uint32_t)std::min((uint64_t)hits + other.hits, (uint64_t)0xFFFFFFFF);
+}
+
+void ShaderProfile::Add(Kind kind, const void *key, size_t size, const ShaderUsage &usage) {
+	entries_[(int)kind][std::string((const char *)key, size)].Merge(usage);
+}
+
+std::vector<std::pair<std::string, ShaderUsage>> ShaderProfile::Sorted(Kind kind) const {
+	std::vector<std::pair<std::string, ShaderUsage>> sorted(entries_[(int)kind].begin(), entries_[(int)kind].end());
+	std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, ShaderUsage> &a, const std::pair<std::string, ShaderUsage> &b) {
+		if (a.second.hits != b.second.hits)
+			return a.second.hits > b.second.hits;
+		return a.second.firstFrame < b.second.firstFrame;
+	});
+	return sorted;
+}
+
+bool ShaderProfile::empty() const {
+	for (const auto &entries : entries_) {
+		if (!entries.empty())
+			return false;
+	}
+	return true;
+}
+
+void ShaderProfile::Clear() {
+	for (auto &entries : entries_)
+		entries.clear();
+}
+
+bool ShaderProfile::Load(const uint8_t *data, size_t size, uint32_t formatVersion, const size_t (&keySizes)[(int)Kind::COUNT]) {
+	const uint8_t *end = data + size;
+	auto readU32 = [&](uint32_t *v) {
+		if (end - data < 4)
+			return false;
+		memcpy(v, data, 4);
+		data += 4;
+		return true;
+	};
+
+	uint32_t magic = 0, version = 0, sections = 0;
+	if (!readU32(&magic) || !readU32(&version) || !readU32(&sections) || magic != SHADER_PROFILE_MAGIC || version != formatVersion)
+		return false;
+
+	// Parse everything first so a bad file doesn't leave us half loaded.
+	std::map<std::string, ShaderUsage> parsed[(int)Kind::COUNT];
+	for (uint32_t s = 0; s < sections; ++s) {
+		uint32_t kind = 0, keySize = 0, count = 0;
+		if (!readU32(&kind) || !readU32(&keySize) || !readU32(&count) || kind >= (uint32_t)Kind::COUNT)
+			return false;
+		if (keySize == 0 || keySize != keySizes[kind])
+			return false;
+		if ((size_t)(end - data) / (keySize + 8) < count)
+			return false;
+
+		for (uint32_t i = 0; i < count; ++i) {
+			std::string key((const char *)data, keySize);
+			data += keySize;
+			ShaderUsage usage;
+			readU32(&usage.hits);
+			readU32(&usage.firstFrame);
+			parsed[kind][key].Merge(usage);
+		}
+	}
+
+	for (int kind = 0; kind < (int)Kind::COUNT; ++kind) {
+		for (const auto &it : parsed[kind])
+			entries_[kind][it.first].Merge(it.second);
+	}
+	return true;
+}
+
+bool ShaderProfile::Save(FILE *f, uint32_t formatVersion) const {
+	uint32_t sections = 0;
+	for (const auto &entries : entries_) {
+		if (!entries.empty())
+			sections++;
+	}
+
+	uint32_t header[3] = { SHADER_PROFILE_MAGIC, formatVersion, sections };
+	bool success = fwrite(header, sizeof(header), 1, f) == 1;
+	for (uint32_t kind = 0; kind < (uint32_t)Kind::COUNT && success; ++kind) {
+		const auto &entries = entries_[kind];
+		if (entries.empty())
+			continue;
+
+		uint32_t sectionHeader[3] = { kind, (uint32_t)entries.begin()->first.size(), (uint32_t)entries.size() };
+		success = fwrite(sectionHeader, sizeof(sectionHeader), 1, f) == 1;
+		for (const auto &it : entries) {
+			if (!success)
+				break;
+			_dbg_assert_(it.first.size() == sectionHeader[1]);
+			success = fwrite(it.first.data(), 1, it.first.size(), f) == it.first.size();
+			success = success && fwrite(&it.second.hits, sizeof(uint32_t), 1, f) == 1;
+			success = success && fwrite(&it.second.firstFrame, sizeof(uint32_t), 1, f) == 1;
+		}
+	}
+	return success;
+}
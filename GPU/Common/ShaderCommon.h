@@ -18,6 +18,9 @@
 #pragma once
 
 #include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -142,6 +145,90 @@ class ShaderManagerCommon {
 	Draw::DrawContext *draw_ = nullptr;
 };
 
+// Content addressed cache of compiled SPIR-V, keyed by a hash of the stage and generated source.
+// Since the key covers the full source, generator changes can't produce stale hits.
+// Thread safe, so compile tasks can use it directly.
+class SpirvCache {
+public:
+	struct Key {
+		uint64_t low;
+		uint64_t high;
+
+		bool operator <(const Key &other) const {
+			return low < other.low || (low == other.low && high < other.high);
+		}
+	};
+
+	static Key MakeKey(uint32_t stage, const char *source);
+
+	bool Get(const Key &key, std::vector<uint32_t> *spirv);
+	void Put(const Key &key, const std::vector<uint32_t> &spirv);
+	bool Contains(const Key &key);
+	void Clear();
+	size_t size();
+
+	// Only entries looked up or added since loading are saved, so stale ones age out.
+	bool Load(FILE *f);
+	bool Save(FILE *f);
+
+private:
+	struct Entry {
+		std::vector<uint32_t> spirv;
+		bool used;
+	};
+
+	std::mutex lock_;
+	std::map<Key, Entry> entries_;
+};
+
+// How many draws used a shader or pipeline variant, and the frame it was first needed on.
+// Hits saturate rather than wrap, a wrapped count would sort the hottest variants last.
+struct ShaderUsage {
+	uint32_t hits = 0;
+	uint32_t firstFrame = 0;
+
+	void Record(uint32_t frame) {
+		if (hits == 0)
+			firstFrame = frame;
+		if (hits != 0xFFFFFFFF)
+			hits++;
+	}
+	void Merge(const ShaderUsage &other);
+};
+
+// Per-game list of shader and pipeline variants with their usage, hottest first on request.
+// Stored separately from the per-device caches so that one recorded elsewhere (like on a test
+// farm) can be shipped and used to warm up a cold start.  Keys are stored as raw bytes, and the
+// format version lets a backend reject keys whose layout has changed.
+class ShaderProfile {
+public:
+	enum class Kind : uint32_t {
+		VERTEX_SHADER = 0,
+		FRAGMENT_SHADER = 1,
+		GEOMETRY_SHADER = 2,
+		VULKAN_PIPELINE = 3,
+
+		COUNT,
+	};
+
+	void Add(Kind kind, const void *key, size_t size, const ShaderUsage &usage);
+	// Most hits first, then earliest used.
+	std::vector<std::pair<std::string, ShaderUsage>> Sorted(Kind kind) const;
+	size_t size(Kind kind) const {
+		return entries_[(int)kind].size();
+	}
+	bool empty() const;
+	void Clear();
+
+	// keySizes is the key size the backend uses for each kind, 0 if unused.  Sections with any
+	// other key size are rejected along with the rest of the file.
+	bool Load(const uint8_t *data, size_t size, uint32_t formatVersion, const size_t (&keySizes)[(int)Kind::COUNT]);
+	bool Save(FILE *f, uint32_t formatVersion) const;
+
+private:
+	std::map<std::string, ShaderUsage> entries_[(int)Kind::COUNT];
+};
+
 enum DoLightComputation {
 	LIGHT_OFF,
 	LIGHT_SHADE,
@@ -42,6 +42,7 @@
 #include "GPU/Debugger/Record.h"
 #include "GPU/GPUCommon.h"
 #include "GPU/GPUInterface.h"
+#include "GPU/GPU.h"
 #include "GPU/GPUState.h"
 #include "Core/Util/PPGeDraw.h"
 
@@ -2972,6 +2973,7 @@ void TextureCacheCommon::LoadTextureLevel(TexCacheEntry &entry, uint8_t *data, s
 	int h = gstate.getTextureHeight(srcLevel);
 
 	PROFILE_THIS_SCOPE("decodetex");
+	GPUPhaseScope phase(GPUPhase::TEXTURE_DECODE);
 
 	if (plan.doReplace) {
 		plan.replaced->GetSize(srcLevel, &w, &h);
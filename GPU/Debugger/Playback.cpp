@@ -18,6 +18,8 @@
 #include <algorithm>
 #include <cstring>
 #include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <vector>
 #include <snappy-c.h>
@@ -25,6 +27,7 @@
 #include "Common/Profiler/Profiler.h"
 #include "Common/CommonTypes.h"
 #include "Common/Log.h"
+#include "Common/TimeUtil.h"
 #include "Core/Config.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
@@ -51,6 +54,11 @@ static std::vector<Command> lastExecCommands;
 static std::vector<u8> lastExecPushbuf;
 static std::mutex executeLock;
 
+class ChunkedDumpReader;
+// Only for chunked dumps, which keep the file open and load a frame at a time.
+static std::unique_ptr<ChunkedDumpReader> lastExecReader;
+static int lastExecFrame = -1;
+
 // This class maps pushbuffer (dump data) sections to PSP memory.
 // Dumps can be larger than available PSP memory, because they include generated data too.
 //
@@ -764,6 +772,214 @@ static bool ReadCompressed(u32 fp, void *dest, size_t sz, uint32_t version) {
 	return real_size == sz;
 }
 
+static bool SeekDump(u32 fp, u64 offset) {
+	// SeekFile() only takes 32-bit offsets, and multi-frame dumps can be larger.
+	pspFileSystem.SeekFile(fp, 0, FILEMOVE_BEGIN);
+	u64 pos = 0;
+	while (pos < offset) {
+		s32 step = (s32)std::min(offset - pos, (u64)0x40000000);
+		if (pspFileSystem.SeekFile(fp, step, FILEMOVE_CURRENT) != (size_t)(pos + step))
+			return false;
+		pos += step;
+	}
+	return true;
+}
+
+// Reads frames of a chunked dump (see RecordFormat.h) on demand, so any frame can be
+// replayed without decoding the ones before it, and without loading the whole file.
+class ChunkedDumpReader {
+public:
+	~ChunkedDumpReader() {
+		if (fp_)
+			pspFileSystem.CloseFile(fp_);
+	}
+
+	// Takes ownership of fp.
+	bool Open(u32 fp);
+	int FrameCount() const {
+		return (int)frames_.size();
+	}
+	// Produces a flat command list and pushbuf, just like an older dump.
+	bool ReadFrame(int frame, std::vector<Command> *commands, std::vector<u8> *pushbuf);
+
+private:
+	bool ReadChunk(u64 offset, u32 compressedSize, void *dest, size_t size);
+	const std::vector<u8> *GetBlob(u32 index);
+	void TrimBlobCache();
+
+	enum {
+		// Recently used blobs are kept, since the next frame usually needs most of them again.
+		BLOB_CACHE_BYTES = 64 * 1024 * 1024,
+	};
+
+	struct CachedBlob {
+		std::vector<u8> data;
+		int lastUsed;
+	};
+
+	u32 fp_ = 0;
+	std::vector<FrameIndexEntry> frames_;
+	std::vector<BlobIndexEntry> blobs_;
+	std::map<u32, CachedBlob> blobCache_;
+	size_t blobCacheBytes_ = 0;
+	int generation_ = 0;
+};
+
+// A zstd block decompresses to at most 128 KB and takes at least 4 bytes, so no chunk can expand
+// by more than this.  Sizes beyond that are corrupt, and we check before allocating for them.
+static const u64 MAX_ZSTD_EXPANSION = 32768;
+
+static bool ValidChunkSize(u32 compressedSize, u64 size) {
+	return compressedSize != 0 && size <= (u64)compressedSize * MAX_ZSTD_EXPANSION && (u64)(size_t)size == size;
+}
+
+bool ChunkedDumpReader::Open(u32 fp) {
+	fp_ = fp;
+
+	ChunkedFooter footer;
+	const u64 footerPos = pspFileSystem.SeekFile(fp_, -(s32)sizeof(footer), FILEMOVE_END);
+	if (pspFileSystem.ReadFile(fp_, (u8 *)&footer, sizeof(footer)) != sizeof(footer) || memcmp(footer.magic, FOOTER_MAGIC, sizeof(footer.magic)) != 0) {
+		ERROR_LOG(SYSTEM, "GE dump has no index, recording didn't finish?");
+		return false;
+	}
+
+	// Chunks sit between the header and the index, and the index right before the footer.
+	if (footer.indexOffset < sizeof(Header) || footer.indexOffset > footerPos || footer.indexCompressedSize > footerPos - footer.indexOffset) {
+		ERROR_LOG(SYSTEM, "Corrupt GE dump index position");
+		return false;
+	}
+	const u64 frameBytes = (u64)footer.frameCount * sizeof(FrameIndexEntry);
+	const u64 blobBytes = (u64)footer.blobCount * sizeof(BlobIndexEntry);
+	if (!ValidChunkSize(footer.indexCompressedSize, frameBytes + blobBytes)) {
+		ERROR_LOG(SYSTEM, "Corrupt GE dump index size");
+		return false;
+	}
+
+	std::vector<u8> index((size_t)(frameBytes + blobBytes));
+	if (!ReadChunk(footer.indexOffset, footer.indexCompressedSize, index.data(), index.size())) {
+		ERROR_LOG(SYSTEM, "Truncated GE dump index");
+		return false;
+	}
+	frames_.resize(footer.frameCount);
+	blobs_.resize(footer.blobCount);
+	memcpy(frames_.data(), index.data(), (size_t)frameBytes);
+	memcpy(blobs_.data(), index.data() + frameBytes, (size_t)blobBytes);
+
+	auto validChunk = [&](u64 offset, u32 compressedSize, u64 size) {
+		if (offset < sizeof(Header) || offset > footer.indexOffset || compressedSize > footer.indexOffset - offset)
+			return false;
+		return ValidChunkSize(compressedSize, size);
+	};
+	for (const FrameIndexEntry &entry : frames_) {
+		const u64 size = (u64)entry.commandCount * sizeof(Command) + (u64)entry.blobRefCount * sizeof(BlobRef) + entry.bufSize;
+		if (!validChunk(entry.offset, entry.compressedSize, size)) {
+			ERROR_LOG(SYSTEM, "Corrupt GE dump frame index");
+			return false;
+		}
+	}
+	for (const BlobIndexEntry &entry : blobs_) {
+		if (!validChunk(entry.offset, entry.compressedSize, entry.size)) {
+			ERROR_LOG(SYSTEM, "Corrupt GE dump blob index");
+			return false;
+		}
+	}
+	return !frames_.empty();
+}
+
+bool ChunkedDumpReader::ReadChunk(u64 offset, u32 compressedSize, void *dest, size_t size) {
+	std::vector<u8> compressed(compressedSize);
+	if (!SeekDump(fp_, offset) || pspFileSystem.ReadFile(fp_, compressed.data(), compressedSize) != compressedSize)
+		return false;
+	if (ZSTD_getFrameContentSize(compressed.data(), compressedSize) != size)
+		return false;
+	return ZSTD_decompress(dest, size, compressed.data(), compressedSize) == size;
+}
+
+const std::vector<u8> *ChunkedDumpReader::GetBlob(u32 index) {
+	auto it = blobCache_.find(index);
+	if (it == blobCache_.end()) {
+		const BlobIndexEntry &entry = blobs_[index];
+		std::vector<u8> data(entry.size);
+		if (!ReadChunk(entry.offset, entry.compressedSize, data.data(), data.size()))
+			return nullptr;
+		blobCacheBytes_ += data.size();
+		it = blobCache_.emplace(index, CachedBlob{ std::move(data), 0 }).first;
+	}
+	it->second.lastUsed = generation_;
+	return &it->second.data;
+}
+
+void ChunkedDumpReader::TrimBlobCache() {
+	if (blobCacheBytes_ <= BLOB_CACHE_BYTES)
+		return;
+
+	// Oldest first, but never anything the current frame uses.
+	std::vector<std::pair<int, u32>> candidates;
+	for (const auto &it : blobCache_) {
+		if (it.second.lastUsed != generation_)
+			candidates.emplace_back(it.second.lastUsed, it.first);
+	}
+	std::sort(candidates.begin(), candidates.end());
+	for (const auto &candidate : candidates) {
+		if (blobCacheBytes_ <= BLOB_CACHE_BYTES)
+			break;
+		auto it = blobCache_.find(candidate.second);
+		blobCacheBytes_ -= it->second.data.size();
+		blobCache_.erase(it);
+	}
+}
+
+bool ChunkedDumpReader::ReadFrame(int frame, std::vector<Command> *commands, std::vector<u8> *pushbuf) {
+	if (frame < 0 || frame >= FrameCount())
+		return false;
+
+	// Open() already checked these sizes against the file.
+	const FrameIndexEntry &entry = frames_[frame];
+	const size_t commandBytes = (size_t)entry.commandCount * sizeof(Command);
+	const size_t refBytes = (size_t)entry.blobRefCount * sizeof(BlobRef);
+	std::vector<u8> chunk(commandBytes + refBytes + entry.bufSize);
+	if (!ReadChunk(entry.offset, entry.compressedSize, chunk.data(), chunk.size()))
+		return false;
+
+	commands->resize(entry.commandCount);
+	memcpy(commands->data(), chunk.data(), commandBytes);
+	std::vector<BlobRef> refs(entry.blobRefCount);
+	memcpy(refs.data(), chunk.data() + commandBytes, refBytes);
+	pushbuf->assign(chunk.begin() + commandBytes + refBytes, chunk.end());
+
+	// Blobs go after the frame's own data, each only once.
+	generation_++;
+	std::map<u32, u32> placed;
+	for (const BlobRef &ref : refs) {
+		if (ref.command >= entry.commandCount || ref.blob >= blobs_.size())
+			return false;
+
+		auto it = placed.find(ref.blob);
+		if (it == placed.end()) {
+			const std::vector<u8> *blob = GetBlob(ref.blob);
+			if (!blob)
+				return false;
+			const u64 pos64 = ((u64)pushbuf->size() + 15) & ~15ULL;
+			// Command::ptr is 32-bit.
+			if (pos64 + blob->size() > 0xFFFFFFFFULL)
+				return false;
+			const u32 pos = (u32)pos64;
+			pushbuf->resize(pos + blob->size());
+			memcpy(pushbuf->data() + pos, blob->data(), blob->size());
+			it = placed.emplace(ref.blob, pos).first;
+		}
+		(*commands)[ref.command].ptr = it->second;
+		(*commands)[ref.command].sz = blobs_[ref.blob].size;
+	}
+	TrimBlobCache();
+
+	for (const Command &cmd : *commands) {
+		if ((u64)cmd.ptr + cmd.sz > pushbuf->size())
+			return false;
+	}
+	return true;
+}
+
 static void ReplayStop() {
 	// This can happen from a separate thread.
 	std::lock_guard<std::mutex> guard(executeLock);
@@ -771,37 +987,47 @@ static void ReplayStop() {
 	lastExecCommands.clear();
 	lastExecPushbuf.clear();
 	lastExecVersion = 0;
+	lastExecReader.reset();
+	lastExecFrame = -1;
 }
 
-bool RunMountedReplay(const std::string &filename) {
-	_assert_msg_(!GPURecord::IsActivePending(), "Cannot run replay while recording.");
+// Loads filename, unless it's the dump we last ran.  Call with executeLock held.
+static bool LoadReplay(const std::string &filename) {
+	if (lastExecFilename == filename)
+		return true;
 
-	std::lock_guard<std::mutex> guard(executeLock);
-	Core_ListenStopRequest(&ReplayStop);
+	PROFILE_THIS_SCOPE("ReplayLoad");
+	lastExecFilename.clear();
+	lastExecReader.reset();
+	lastExecFrame = -1;
 
-	uint32_t version = lastExecVersion;
-	if (lastExecFilename != filename) {
-		PROFILE_THIS_SCOPE("ReplayLoad");
-		u32 fp = pspFileSystem.OpenFile(filename, FILEACCESS_READ);
-		Header header;
-		pspFileSystem.ReadFile(fp, (u8 *)&header, sizeof(header));
-		version = header.version;
-
-		if (memcmp(header.magic, HEADER_MAGIC, sizeof(header.magic)) != 0 || header.version > VERSION || header.version < MIN_VERSION) {
-			ERROR_LOG(SYSTEM, "Invalid GE dump or unsupported version");
-			pspFileSystem.CloseFile(fp);
-			return false;
-		}
-		if (header.version <= 3) {
-			pspFileSystem.SeekFile(fp, 12, FILEMOVE_BEGIN);
-			memset(header.gameID, 0, sizeof(header.gameID));
-		}
+	u32 fp = pspFileSystem.OpenFile(filename, FILEACCESS_READ);
+	Header header;
+	pspFileSystem.ReadFile(fp, (u8 *)&header, sizeof(header));
+	uint32_t version = header.version;
 
-		size_t gameIDLength = strnlen(header.gameID, sizeof(header.gameID));
-		if (gameIDLength != 0) {
-			g_paramSFO.SetValue("DISC_ID", std::string(header.gameID, gameIDLength), (int)sizeof(header.gameID));
-		}
+	if (memcmp(header.magic, HEADER_MAGIC, sizeof(header.magic)) != 0 || header.version > VERSION || header.version < MIN_VERSION) {
+		ERROR_LOG(SYSTEM, "Invalid GE dump or unsupported version");
+		pspFileSystem.CloseFile(fp);
+		return false;
+	}
+	if (header.version <= 3) {
+		pspFileSystem.SeekFile(fp, 12, FILEMOVE_BEGIN);
+		memset(header.gameID, 0, sizeof(header.gameID));
+	}
+
+	size_t gameIDLength = strnlen(header.gameID, sizeof(header.gameID));
+	if (gameIDLength != 0) {
+		g_paramSFO.SetValue("DISC_ID", std::string(header.gameID, gameIDLength), (int)sizeof(header.gameID));
+	}
 
+	if (header.version >= CHUNKED_VERSION) {
+		lastExecReader.reset(new ChunkedDumpReader());
+		if (!lastExecReader->Open(fp)) {
+			lastExecReader.reset();
+			return false;
+		}
+	} else {
 		u32 sz = 0;
 		pspFileSystem.ReadFile(fp, (u8 *)&sz, sizeof(sz));
 		u32 bufsz = 0;
@@ -820,13 +1046,106 @@ bool RunMountedReplay(const std::string &filename) {
 			ERROR_LOG(SYSTEM, "Truncated GE dump");
 			return false;
 		}
+	}
 
-		lastExecFilename = filename;
-		lastExecVersion = version;
+	lastExecFilename = filename;
+	lastExecVersion = version;
+	return true;
+}
+
+static int LoadedFrameCount() {
+	return lastExecReader ? lastExecReader->FrameCount() : 1;
+}
+
+static bool replayTiming = false;
+static std::vector<ReplayFrameTiming> replayTimings;
+
+static void RecordDrawTiming(const GPUPhaseTimes &draw) {
+	if (!replayTimings.empty())
+		replayTimings.back().draws.push_back(draw);
+}
+
+static bool ExecuteFrame(int frame) {
+	if (lastExecReader && lastExecFrame != frame) {
+		PROFILE_THIS_SCOPE("ReplayLoadFrame");
+		lastExecFrame = -1;
+		if (!lastExecReader->ReadFrame(frame, &lastExecCommands, &lastExecPushbuf)) {
+			ERROR_LOG(SYSTEM, "Truncated or corrupt GE dump frame %d", frame);
+			return false;
+		}
+		lastExecFrame = frame;
+	} else if (!lastExecReader && frame != 0) {
+		return false;
 	}
 
-	DumpExecute executor(lastExecPushbuf, lastExecCommands, version);
-	return executor.Run();
+	DumpExecute executor(lastExecPushbuf, lastExecCommands, lastExecVersion);
+	if (!replayTiming)
+		return executor.Run();
+
+	// Run() ends with a list sync, so deferred rasterization is included in the frame.
+	replayTimings.emplace_back();
+	gpuPhaseTimer.Reset();
+	gpuPhaseTimer.onDraw = &RecordDrawTiming;
+	gpuPhaseTimer.enabled = true;
+	double start = time_now_d();
+	bool success = executor.Run();
+
+	ReplayFrameTiming &timing = replayTimings.back();
+	timing.frame.total = time_now_d() - start;
+	memcpy(timing.frame.phases, gpuPhaseTimer.phases, sizeof(timing.frame.phases));
+	gpuPhaseTimer.enabled = false;
+	gpuPhaseTimer.onDraw = nullptr;
+	return success;
+}
+
+bool RunMountedReplay(const std::string &filename) {
+	_assert_msg_(!GPURecord::IsActivePending(), "Cannot run replay while recording.");
+
+	std::lock_guard<std::mutex> guard(executeLock);
+	Core_ListenStopRequest(&ReplayStop);
+
+	if (!LoadReplay(filename))
+		return false;
+
+	// Frames are streamed in one at a time.
+	const int frames = LoadedFrameCount();
+	for (int i = 0; i < frames; ++i) {
+		if (!ExecuteFrame(i))
+			return false;
+	}
+	return true;
+}
+
+bool RunMountedReplayFrame(const std::string &filename, int frame) {
+	_assert_msg_(!GPURecord::IsActivePending(), "Cannot run replay while recording.");
+
+	std::lock_guard<std::mutex> guard(executeLock);
+	Core_ListenStopRequest(&ReplayStop);
+
+	if (!LoadReplay(filename) || frame < 0 || frame >= LoadedFrameCount())
+		return false;
+	return ExecuteFrame(frame);
+}
+
+int GetMountedReplayFrameCount(const std::string &filename) {
+	std::lock_guard<std::mutex> guard(executeLock);
+	Core_ListenStopRequest(&ReplayStop);
+
+	if (!LoadReplay(filename))
+		return -1;
+	return LoadedFrameCount();
+}
+
+void SetReplayTiming(bool enabled) {
+	std::lock_guard<std::mutex> guard(executeLock);
+	replayTiming = enabled;
+}
+
+std::vector<ReplayFrameTiming> TakeReplayTimings() {
+	std::lock_guard<std::mutex> guard(executeLock);
+	std::vector<ReplayFrameTiming> timings;
+	std::swap(timings, replayTimings);
+	return timings;
 }
 
 };
@@ -18,9 +18,26 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include "GPU/GPU.h"
 
 namespace GPURecord {
 
+// Replays every frame of the dump.
 bool RunMountedReplay(const std::string &filename);
+// Replays only the given frame (0 based.)  With chunked dumps, earlier frames aren't decoded.
+bool RunMountedReplayFrame(const std::string &filename, int frame);
+// Returns the number of frames in the dump, or -1 if it can't be read.
+int GetMountedReplayFrameCount(const std::string &filename);
+
+struct ReplayFrameTiming {
+	GPUPhaseTimes frame;
+	std::vector<GPUPhaseTimes> draws;
+};
+
+// While enabled, replays record the time taken by each frame and draw, for benchmarking.
+void SetReplayTiming(bool enabled);
+// Returns and clears the timings recorded so far.
+std::vector<ReplayFrameTiming> TakeReplayTimings();
 
 };
@@ -19,11 +19,14 @@
 #include <atomic>
 #include <cstring>
 #include <functional>
+#include <map>
 #include <set>
 #include <vector>
 #include <mutex>
 #include <zstd.h>
 
+#include "ext/xxhash.h"
+
 #include "Common/CommonTypes.h"
 #include "Common/File/FileUtil.h"
 #include "Common/Thread/ParallelLoop.h"
@@ -54,6 +57,8 @@ static int flipLastAction = -1;
 static int flipFinishAt = -1;
 static uint32_t lastEdramTrans = 0x400;
 static std::function<void(const Path &)> writeCallback;
+static int pendingFrameCount = 1;
+static int framesLeft = 0;
 
 static std::vector<u8> pushbuf;
 static std::vector<Command> commands;
@@ -62,6 +67,32 @@ static std::vector<u32> lastTextures;
 static std::set<u32> lastRenderTargets;
 static std::vector<u8> lastVRAM;
 
+// The file is written as we go, see RecordFormat.h.
+static FILE *recordFp = nullptr;
+static Path recordFilename;
+static u64 recordOffset = 0;
+static bool recordWriteFailed = false;
+static std::vector<FrameIndexEntry> frameIndex;
+static std::vector<BlobIndexEntry> blobIndex;
+
+struct BlobKey {
+	u64 low;
+	u64 high;
+	u32 size;
+
+	bool operator <(const BlobKey &other) const {
+		if (low != other.low)
+			return low < other.low;
+		if (high != other.high)
+			return high < other.high;
+		return size < other.size;
+	}
+};
+static std::map<BlobKey, u32> blobLookup;
+
+// Smaller data stays in the frame chunk, not worth an index entry.
+static constexpr u32 BLOB_MIN_SIZE = 1024;
+
 enum class DirtyVRAMFlag : uint8_t {
 	CLEAN = 0,
 	UNKNOWN = 1,
@@ -151,9 +182,7 @@ static void DirtyDrawnVRAM() {
 	DirtyVRAM(gstate.getFrameBufAddress(), bytes, DirtyVRAMFlag::DRAWN);
 }
 
-static void BeginRecording() {
-	active = true;
-	nextFrame = false;
+static void BeginFrame() {
 	lastTextures.clear();
 	lastRenderTargets.clear();
 	flipLastAction = gpuStats.numFlips;
@@ -164,7 +193,6 @@ static void BeginRecording() {
 	pushbuf.resize(pushbuf.size() + sz);
 	gstate.Save((u32_le *)(pushbuf.data() + ptr));
 	commands.push_back({CommandType::INIT, sz, ptr});
-	lastVRAM.resize(2 * 1024 * 1024);
 
 	// Also save the initial CLUT.
 	GPUDebugBuffer clut;
@@ -177,46 +205,153 @@ static void BeginRecording() {
 		commands.push_back({ CommandType::CLUT, sz, ptr });
 	}
 
+	// Each frame must replay on its own, so it can't rely on VRAM sent in an earlier frame.
 	DirtyAllVRAM(DirtyVRAMFlag::DIRTY);
 }
 
-static void WriteCompressed(FILE *fp, const void *p, size_t sz) {
+static void BeginRecording() {
+	nextFrame = false;
+
+	recordFilename = GenRecordingFilename();
+	NOTICE_LOG(G3D, "Recording filename: %s", recordFilename.c_str());
+
+	recordFp = File::OpenCFile(recordFilename, "wb");
+	if (!recordFp) {
+		ERROR_LOG(G3D, "Unable to create GE dump file");
+		// Let the requester know nothing is coming.
+		if (writeCallback)
+			writeCallback(Path());
+		writeCallback = nullptr;
+		return;
+	}
+
+	Header header{};
+	strncpy(header.magic, HEADER_MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	strncpy(header.gameID, g_paramSFO.GetDiscID().c_str(), sizeof(header.gameID));
+	recordWriteFailed = fwrite(&header, sizeof(header), 1, recordFp) != 1;
+	recordOffset = sizeof(header);
+
+	active = true;
+	framesLeft = pendingFrameCount;
+	lastVRAM.resize(2 * 1024 * 1024);
+	BeginFrame();
+}
+
+// Writes a compressed chunk at the end of the file and returns its offset.
+static u64 WriteChunk(const void *p, size_t sz, u32 *compressedSize) {
 	size_t compressed_size = ZSTD_compressBound(sz);
 	u8 *compressed = new u8[compressed_size];
 	compressed_size = ZSTD_compress(compressed, compressed_size, p, sz, 6);
 
-	u32 write_size = (u32)compressed_size;
-	fwrite(&write_size, sizeof(write_size), 1, fp);
-	fwrite(compressed, compressed_size, 1, fp);
+	u64 offset = recordOffset;
+	if (ZSTD_isError(compressed_size)) {
+		recordWriteFailed = true;
+		compressed_size = 0;
+	} else if (fwrite(compressed, compressed_size, 1, recordFp) != 1) {
+		recordWriteFailed = true;
+	}
+	recordOffset += compressed_size;
+	*compressedSize = (u32)compressed_size;
 
 	delete [] compressed;
+	return offset;
+}
+
+// Textures and such are often the same from frame to frame, so they're stored only once.
+static u32 WriteBlob(const u8 *p, u32 sz) {
+	XXH128_hash_t hash = XXH3_128bits(p, sz);
+	const BlobKey key{ hash.low64, hash.high64, sz };
+	auto it = blobLookup.find(key);
+	if (it != blobLookup.end())
+		return it->second;
+
+	BlobIndexEntry entry{};
+	entry.size = sz;
+	entry.offset = WriteChunk(p, sz, &entry.compressedSize);
+
+	u32 index = (u32)blobIndex.size();
+	blobIndex.push_back(entry);
+	blobLookup[key] = index;
+	return index;
+}
+
+static bool IsBlobCommand(CommandType type) {
+	switch (type) {
+	case CommandType::VERTICES:
+	case CommandType::INDICES:
+	case CommandType::CLUT:
+	case CommandType::TRANSFERSRC:
+	case CommandType::MEMCPYDATA:
+		return true;
+
+	default:
+		return type >= CommandType::TEXTURE0 && type <= CommandType::FRAMEBUF7;
+	}
 }
 
-static Path WriteRecording() {
+static void WriteFrame() {
 	FlushRegisters();
 
-	const Path filename = GenRecordingFilename();
+	std::vector<Command> frameCommands = commands;
+	std::vector<BlobRef> refs;
+	std::vector<u8> buf;
+	for (u32 i = 0; i < (u32)frameCommands.size(); ++i) {
+		Command &cmd = frameCommands[i];
+		const u8 *data = pushbuf.data() + cmd.ptr;
+		if (IsBlobCommand(cmd.type) && cmd.sz >= BLOB_MIN_SIZE) {
+			refs.push_back({ i, WriteBlob(data, cmd.sz) });
+			cmd.ptr = 0;
+			continue;
+		}
 
-	NOTICE_LOG(G3D, "Recording filename: %s", filename.c_str());
+		// Keep the alignment EmitCommandWithRAM() gave the data.
+		size_t pos = (buf.size() + 15) & ~15;
+		buf.resize(pos + cmd.sz);
+		memcpy(buf.data() + pos, data, cmd.sz);
+		cmd.ptr = (u32)pos;
+	}
 
-	FILE *fp = File::OpenCFile(filename, "wb");
-	Header header{};
-	strncpy(header.magic, HEADER_MAGIC, sizeof(header.magic));
-	header.version = VERSION;
-	strncpy(header.gameID, g_paramSFO.GetDiscID().c_str(), sizeof(header.gameID));
-	fwrite(&header, sizeof(header), 1, fp);
+	FrameIndexEntry entry{};
+	entry.commandCount = (u32)frameCommands.size();
+	entry.blobRefCount = (u32)refs.size();
+	entry.bufSize = (u32)buf.size();
 
-	u32 sz = (u32)commands.size();
-	fwrite(&sz, sizeof(sz), 1, fp);
-	u32 bufsz = (u32)pushbuf.size();
-	fwrite(&bufsz, sizeof(bufsz), 1, fp);
+	const size_t commandBytes = frameCommands.size() * sizeof(Command);
+	const size_t refBytes = refs.size() * sizeof(BlobRef);
+	std::vector<u8> chunk(commandBytes + refBytes + buf.size());
+	memcpy(chunk.data(), frameCommands.data(), commandBytes);
+	memcpy(chunk.data() + commandBytes, refs.data(), refBytes);
+	memcpy(chunk.data() + commandBytes + refBytes, buf.data(), buf.size());
+	entry.offset = WriteChunk(chunk.data(), chunk.size(), &entry.compressedSize);
+	frameIndex.push_back(entry);
 
-	WriteCompressed(fp, commands.data(), commands.size() * sizeof(Command));
-	WriteCompressed(fp, pushbuf.data(), bufsz);
+	commands.clear();
+	pushbuf.clear();
+}
+
+static void CloseRecording() {
+	const size_t frameBytes = frameIndex.size() * sizeof(FrameIndexEntry);
+	const size_t blobBytes = blobIndex.size() * sizeof(BlobIndexEntry);
+	std::vector<u8> index(frameBytes + blobBytes);
+	memcpy(index.data(), frameIndex.data(), frameBytes);
+	memcpy(index.data() + frameBytes, blobIndex.data(), blobBytes);
+
+	ChunkedFooter footer{};
+	footer.indexOffset = WriteChunk(index.data(), index.size(), &footer.indexCompressedSize);
+	footer.frameCount = (u32)frameIndex.size();
+	footer.blobCount = (u32)blobIndex.size();
+	memcpy(footer.magic, FOOTER_MAGIC, sizeof(footer.magic));
+	recordWriteFailed = recordWriteFailed || fwrite(&footer, sizeof(footer), 1, recordFp) != 1;
 
-	fclose(fp);
+	fclose(recordFp);
+	recordFp = nullptr;
+	if (recordWriteFailed)
+		ERROR_LOG(G3D, "Failed to write GE dump, disk full?");
 
-	return filename;
+	frameIndex.clear();
+	blobIndex.clear();
+	blobLookup.clear();
 }
 
 static void GetVertDataSizes(int vcount, const void *indices, u32 &vbytes, u32 &ibytes) {
@@ -601,11 +736,12 @@ bool IsActivePending() {
 	return nextFrame || active;
 }
 
-bool RecordNextFrame(const std::function<void(const Path &)> callback) {
-	if (!nextFrame) {
+bool RecordNextFrame(const std::function<void(const Path &)> callback, int frameCount) {
+	if (!IsActivePending()) {
 		flipLastAction = gpuStats.numFlips;
 		flipFinishAt = -1;
 		writeCallback = callback;
+		pendingFrameCount = std::max(frameCount, 1);
 		nextFrame = true;
 		return true;
 	}
@@ -619,9 +755,8 @@ void ClearCallback() {
 
 static void FinishRecording() {
 	// We're done - this was just to write the result out.
-	Path filename = WriteRecording();
-	commands.clear();
-	pushbuf.clear();
+	Path filename = recordFilename;
+	CloseRecording();
 	lastVRAM.clear();
 
 	NOTICE_LOG(SYSTEM, "Recording finished");
@@ -636,6 +771,40 @@ static void FinishRecording() {
 	writeCallback = nullptr;
 }
 
+void Abort() {
+	nextFrame = false;
+	if (!active)
+		return;
+
+	// Drop the partial frame, but keep the ones already written.
+	NOTICE_LOG(SYSTEM, "Recording stopped early, keeping %d frames", (int)frameIndex.size());
+	commands.clear();
+	pushbuf.clear();
+	lastRegisters.clear();
+	FinishRecording();
+}
+
+// Returns true if recording continues with another frame.
+static bool FinishFrame() {
+	WriteFrame();
+	if (--framesLeft > 0) {
+		BeginFrame();
+		return true;
+	}
+
+	FinishRecording();
+	return false;
+}
+
+static void EmitDisplay(const void *disp, u32 sz) {
+	FlushRegisters();
+	u32 ptr = (u32)pushbuf.size();
+	pushbuf.resize(pushbuf.size() + sz);
+	memcpy(pushbuf.data() + ptr, disp, sz);
+
+	commands.push_back({ CommandType::DISPLAY, sz, ptr });
+}
+
 static void CheckEdramTrans() {
 	if (!gpuDebug)
 		return;
@@ -798,18 +967,13 @@ void NotifyDisplay(u32 framebuf, int stride, int fmt) {
 	};
 
 	DisplayBufData disp{ { framebuf }, stride, fmt };
-
-	FlushRegisters();
-	u32 ptr = (u32)pushbuf.size();
-	u32 sz = (u32)sizeof(disp);
-	pushbuf.resize(pushbuf.size() + sz);
-	memcpy(pushbuf.data() + ptr, &disp, sz);
-
-	commands.push_back({ CommandType::DISPLAY, sz, ptr });
+	EmitDisplay(&disp, (u32)sizeof(disp));
 
 	if (writePending) {
 		NOTICE_LOG(SYSTEM, "Recording complete on display");
-		FinishRecording();
+		// Like the first frame, the next one starts from this display.
+		if (FinishFrame())
+			EmitDisplay(&disp, (u32)sizeof(disp));
 	}
 }
 
@@ -827,16 +991,11 @@ void NotifyBeginFrame() {
 
 		DisplayBufData disp;
 		__DisplayGetFramebuf(&disp.topaddr, &disp.linesize, &disp.pixelFormat, 0);
+		EmitDisplay(&disp, (u32)sizeof(disp));
 
-		FlushRegisters();
-		u32 ptr = (u32)pushbuf.size();
-		u32 sz = (u32)sizeof(disp);
-		pushbuf.resize(pushbuf.size() + sz);
-		memcpy(pushbuf.data() + ptr, &disp, sz);
-
-		commands.push_back({ CommandType::DISPLAY, sz, ptr });
-
-		FinishRecording();
+		// If we began on a BeginFrame, the next frame also ends on one.
+		if (FinishFrame())
+			flipFinishAt = gpuStats.numFlips + 1;
 	}
 	if (!active && nextFrame && (gstate_c.skipDrawReason & SKIPDRAW_SKIPFRAME) == 0 && noDisplayAction) {
 		NOTICE_LOG(SYSTEM, "Recording starting on frame...");
@@ -27,8 +27,12 @@ namespace GPURecord {
 
 bool IsActive();
 bool IsActivePending();
-bool RecordNextFrame(const std::function<void(const Path &)> callback);
+// Records frameCount frames into one dump, calling callback with its path when done.
+// The path is empty if the dump file couldn't be created.
+bool RecordNextFrame(const std::function<void(const Path &)> callback, int frameCount = 1);
 void ClearCallback();
+// Finishes any recording in progress with the frames written so far, for shutdown.
+void Abort();
 
 void NotifyCommand(u32 pc);
 void NotifyMemcpy(u32 dest, u32 src, u32 sz);
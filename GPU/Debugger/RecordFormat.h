@@ -35,8 +35,10 @@ static const char * const HEADER_MAGIC = "PPSSPPGE";
 // Version 4: Expanded header with game ID
 // Version 5: Uses zstd
 // Version 6: Corrects dirty VRAM flag
-static const int VERSION = 6;
+// Version 7: Chunked per frame with an index, large data in shared blobs
+static const int VERSION = 7;
 static const int MIN_VERSION = 2;
+static const int CHUNKED_VERSION = 7;
 
 enum class CommandType : u8 {
 	INIT = 0,
@@ -79,6 +81,43 @@ struct Command {
 	u32 ptr;
 };
 
+// From version 7, the header is followed by independently zstd compressed chunks, written
+// as recording goes: one per frame, and one per unique blob of memory (textures, vertices, etc.)
+// At the end of the file is the compressed index (FrameIndexEntry[frameCount] followed by
+// BlobIndexEntry[blobCount]), and then ChunkedFooter.
+//
+// Each frame starts with an INIT and can be replayed on its own.  Uncompressed, a frame chunk is
+// Command[commandCount], BlobRef[blobRefCount], then bufSize bytes that Command::ptr points into.
+// Commands named by a BlobRef instead use the whole blob as their data, and their ptr is unused.
+struct FrameIndexEntry {
+	u64 offset;
+	u32 compressedSize;
+	u32 commandCount;
+	u32 blobRefCount;
+	u32 bufSize;
+};
+
+struct BlobIndexEntry {
+	u64 offset;
+	u32 compressedSize;
+	u32 size;
+};
+
+struct BlobRef {
+	u32 command;
+	u32 blob;
+};
+
+struct ChunkedFooter {
+	u64 indexOffset;
+	u32 indexCompressedSize;
+	u32 frameCount;
+	u32 blobCount;
+	char magic[8];
+};
+
+static const char * const FOOTER_MAGIC = "PPGEINDX";
+
 #pragma pack(pop)
 
 };
@@ -79,8 +79,6 @@ class DrawEngineGLES : public DrawEngineCommon {
 	void DeviceLost() override;
 	void DeviceRestore(Draw::DrawContext *draw) override;
 
-	void ClearTrackedVertexArrays() override {}
-
 	void BeginFrame();
 	void EndFrame();
 
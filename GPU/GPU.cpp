@@ -23,6 +23,7 @@
 
 #include "GPU/GPU.h"
 #include "GPU/GPUInterface.h"
+#include "GPU/Debugger/Record.h"
 
 #if PPSSPP_API(ANY_GL)
 #include "GPU/GLES/GPU_GLES.h"
@@ -39,6 +40,7 @@
 #endif
 
 GPUStatistics gpuStats;
+GPUPhaseTimer gpuPhaseTimer;
 GPUInterface *gpu;
 GPUDebugInterface *gpuDebug;
 
@@ -64,10 +66,12 @@ bool GPU_IsStarted() {
 
 bool GPU_Init(GraphicsContext *ctx, Draw::DrawContext *draw) {
 	const auto &gpuCore = PSP_CoreParameter().gpuCore;
-	_assert_(draw || gpuCore == GPUCORE_SOFTWARE);
+	_assert_(draw || gpuCore == GPUCORE_SOFTWARE || gpuCore == GPUCORE_NULL);
 #if PPSSPP_PLATFORM(UWP)
 	if (gpuCore == GPUCORE_SOFTWARE) {
 		SetGPU(new SoftGPU(ctx, draw));
+	} else if (gpuCore == GPUCORE_NULL) {
+		SetGPU(new NullGPU(ctx, draw));
 	} else {
 		SetGPU(new GPU_D3D11(ctx, draw));
 	}
@@ -85,6 +89,9 @@ bool GPU_Init(GraphicsContext *ctx, Draw::DrawContext *draw) {
 	case GPUCORE_SOFTWARE:
 		SetGPU(new SoftGPU(ctx, draw));
 		break;
+	case GPUCORE_NULL:
+		SetGPU(new NullGPU(ctx, draw));
+		break;
 	case GPUCORE_DIRECTX9:
 #if PPSSPP_API(D3D9)
 		SetGPU(new GPU_DX9(ctx, draw));
@@ -123,6 +130,8 @@ bool GPU_Init(GraphicsContext *ctx, Draw::DrawContext *draw) {
 void GPU_Shutdown() {
 	// Reduce the risk for weird races with the Windows GE debugger.
 	gpuDebug = nullptr;
+	// Don't leave a dump without its index.
+	GPURecord::Abort();
 
 	delete gpu;
 	gpu = nullptr;
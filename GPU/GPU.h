@@ -21,6 +21,8 @@
 #include <cstring>
 #include <cstdint>
 
+#include "Common/TimeUtil.h"
+
 class GPUInterface;
 class GPUDebugInterface;
 class GraphicsContext;
@@ -81,12 +83,20 @@ struct GPUStatistics {
 		numListSyncs = 0;
 		numVertsSubmitted = 0;
 		numVertsDecoded = 0;
+		numVertexCacheHits = 0;
+		numVertexCacheMisses = 0;
+		numVertexCacheRehashes = 0;
 		numUncachedVertsDrawn = 0;
 		numTextureInvalidations = 0;
 		numTextureInvalidationsByFramebuffer = 0;
 		numTexturesHashed = 0;
 		numTextureDataBytesHashed = 0;
 		numFlushes = 0;
+		numFlushesPrimChange = 0;
+		numFlushesVertexLimit = 0;
+		numFlushesDrawLimit = 0;
+		numFlushesSelfRender = 0;
+		numFlushesOther = 0;
 		numBBOXJumps = 0;
 		numPlaneUpdates = 0;
 		numTexturesDecoded = 0;
@@ -117,10 +127,18 @@ struct GPUStatistics {
 	int numDrawSyncs;
 	int numListSyncs;
 	int numFlushes;
+	int numFlushesPrimChange;
+	int numFlushesVertexLimit;
+	int numFlushesDrawLimit;
+	int numFlushesSelfRender;
+	int numFlushesOther;
 	int numBBOXJumps;
 	int numPlaneUpdates;
 	int numVertsSubmitted;
 	int numVertsDecoded;
+	int numVertexCacheHits;
+	int numVertexCacheMisses;
+	int numVertexCacheRehashes;
 	int numUncachedVertsDrawn;
 	int numTextureInvalidations;
 	int numTextureInvalidationsByFramebuffer;
@@ -150,6 +168,91 @@ struct GPUStatistics {
 	int numFlips;
 };
 
+enum class GPUPhase : uint8_t {
+	VERTEX_DECODE,
+	TRANSFORM,
+	RASTERIZE,
+	TEXTURE_DECODE,
+
+	COUNT,
+};
+
+struct GPUPhaseTimes {
+	double total;
+	double phases[(int)GPUPhase::COUNT];
+};
+
+// Optional wall time per GPU phase, used to benchmark dump replays.  Only costs anything when
+// enabled.  Phases nest, and time spent in an inner phase isn't also counted in the outer one.
+struct GPUPhaseTimer {
+	bool enabled = false;
+	int current = -1;
+	double lastSwitch = 0.0;
+	double phases[(int)GPUPhase::COUNT]{};
+	// Called after each draw, if set.
+	void (*onDraw)(const GPUPhaseTimes &draw) = nullptr;
+
+	void Switch(int next) {
+		double now = time_now_d();
+		if (current >= 0)
+			phases[current] += now - lastSwitch;
+		current = next;
+		lastSwitch = now;
+	}
+	void Reset() {
+		current = -1;
+		memset(phases, 0, sizeof(phases));
+	}
+};
+
+extern GPUPhaseTimer gpuPhaseTimer;
+
+class GPUPhaseScope {
+public:
+	GPUPhaseScope(GPUPhase phase) {
+		if (gpuPhaseTimer.enabled) {
+			prev_ = gpuPhaseTimer.current;
+			gpuPhaseTimer.Switch((int)phase);
+			active_ = true;
+		}
+	}
+	~GPUPhaseScope() {
+		if (active_)
+			gpuPhaseTimer.Switch(prev_);
+	}
+
+private:
+	int prev_ = -1;
+	bool active_ = false;
+};
+
+// Reports a draw's time, and the phases within it, to gpuPhaseTimer.onDraw.
+class GPUDrawScope {
+public:
+	GPUDrawScope() {
+		if (gpuPhaseTimer.enabled && gpuPhaseTimer.onDraw) {
+			gpuPhaseTimer.Switch(gpuPhaseTimer.current);
+			start_.total = gpuPhaseTimer.lastSwitch;
+			memcpy(start_.phases, gpuPhaseTimer.phases, sizeof(start_.phases));
+			active_ = true;
+		}
+	}
+	~GPUDrawScope() {
+		if (!active_)
+			return;
+		gpuPhaseTimer.Switch(gpuPhaseTimer.current);
+		GPUPhaseTimes draw;
+		draw.total = gpuPhaseTimer.lastSwitch - start_.total;
+		for (int i = 0; i < (int)GPUPhase::COUNT; ++i)
+			draw.phases[i] = gpuPhaseTimer.phases[i] - start_.phases[i];
+		gpuPhaseTimer.onDraw(draw);
+	}
+
+private:
+	GPUPhaseTimes start_;
+	bool active_ = false;
+};
+
 extern GPUStatistics gpuStats;
 extern GPUInterface *gpu;
 extern GPUDebugInterface *gpuDebug;
@@ -773,6 +773,7 @@ void GPUCommonHW::InvalidateCache(u32 addr, int size, GPUInvalidationType type)
 		textureCache_->Invalidate(addr, size, type);
 	else
 		textureCache_->InvalidateAll(type);
+	drawEngineCommon_->InvalidateTrackedVertexArrays(addr, size);
 
 	if (type != GPU_INVALIDATE_ALL && framebufferManager_->MayIntersectFramebufferColor(addr)) {
 		// Vempire invalidates (with writeback) after drawing, but before blitting.
@@ -898,6 +899,7 @@ void GPUCommonHW::Execute_Prim(u32 op, u32 diff) {
 	PROFILE_THIS_SCOPE("execprim");
 
 	FlushImm();
+	GPUDrawScope draw;
 
 	// Upper bits are ignored.
 	GEPrimitiveType prim = static_cast<GEPrimitiveType>((op >> 16) & 7);
@@ -1250,6 +1252,7 @@ void GPUCommonHW::Execute_Prim(u32 op, u32 diff) {
 }
 
 void GPUCommonHW::Execute_Bezier(u32 op, u32 diff) {
+	GPUDrawScope draw;
 	// We don't dirty on normal changes anymore as we prescale, but it's needed for splines/bezier.
 	gstate_c.framebufFormat = gstate.FrameBufFormat();
 
@@ -1322,6 +1325,7 @@ void GPUCommonHW::Execute_Bezier(u32 op, u32 diff) {
 }
 
 void GPUCommonHW::Execute_Spline(u32 op, u32 diff) {
+	GPUDrawScope draw;
 	// We don't dirty on normal changes anymore as we prescale, but it's needed for splines/bezier.
 	gstate_c.framebufFormat = gstate.FrameBufFormat();
 
@@ -1749,7 +1753,9 @@ size_t GPUCommonHW::FormatGPUStatsCommon(char *buffer, size_t size) {
 	return snprintf(buffer, size,
 		"DL processing time: %0.2f ms, %d drawsync, %d listsync\n"
 		"Draw: %d (%d dec, %d culled), flushes %d, clears %d, bbox jumps %d (%d updates)\n"
+		"Flush reasons: prim %d, verts full %d, draws full %d, self-render %d, other %d\n"
 		"Vertices: %d dec: %d drawn: %d\n"
+		"Vertex cache: %d arrays, %d hits, %d misses, %d rehashes\n"
 		"FBOs active: %d (evaluations: %d)\n"
 		"Textures: %d, dec: %d, invalidated: %d, hashed: %d kB\n"
 		"readbacks %d (%d non-block), upload %d (cached %d), depal %d\n"
@@ -1767,9 +1773,18 @@ size_t GPUCommonHW::FormatGPUStatsCommon(char *buffer, size_t size) {
 		gpuStats.numClears,
 		gpuStats.numBBOXJumps,
 		gpuStats.numPlaneUpdates,
+		gpuStats.numFlushesPrimChange,
+		gpuStats.numFlushesVertexLimit,
+		gpuStats.numFlushesDrawLimit,
+		gpuStats.numFlushesSelfRender,
+		gpuStats.numFlushesOther,
 		gpuStats.numVertsSubmitted,
 		gpuStats.numVertsDecoded,
 		gpuStats.numUncachedVertsDrawn,
+		(int)drawEngineCommon_->NumTrackedVertexArrays(),
+		gpuStats.numVertexCacheHits,
+		gpuStats.numVertexCacheMisses,
+		gpuStats.numVertexCacheRehashes,
 		(int)framebufferManager_->NumVFBs(),
 		gpuStats.numFramebufferEvaluations,
 		(int)textureCache_->NumLoadedTextures(),
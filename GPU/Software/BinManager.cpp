@@ -22,6 +22,7 @@
 #include "Common/Thread/ThreadManager.h"
 #include "Common/TimeUtil.h"
 #include "Core/System.h"
+#include "GPU/GPU.h"
 #include "GPU/Common/TextureDecoder.h"
 #include "GPU/Software/BinManager.h"
 #include "GPU/Software/Rasterizer.h"
@@ -97,8 +98,8 @@ static inline void DrawBinItem(const BinItem &item, const RasterizerState &state
 
 class DrawBinItemsTask : public Task {
 public:
-	DrawBinItemsTask(BinWaitable *notify, BinManager::BinItemQueue &items, std::atomic<bool> &status, const BinManager::BinStateQueue &states)
-		: notify_(notify), items_(items), status_(status), states_(states) {
+	DrawBinItemsTask(BinWaitable *notify, BinManager::BinItemQueue &items, std::atomic<bool> &status, std::mutex &consumer, const BinManager::BinStateQueue &states)
+		: notify_(notify), items_(items), status_(status), consumer_(consumer), states_(states) {
 	}
 
 	TaskType Type() const override {
@@ -111,10 +112,15 @@ class DrawBinItemsTask : public Task {
 	}
 
 	void Run() override {
-		ProcessItems();
-		status_ = false;
-		// In case of any atomic issues, do another pass.
-		ProcessItems();
+		{
+			// Any thread may run this, and Drain() can queue the next pass while we're finishing.
+			// The item queue only supports one consumer, so the next pass waits for us.
+			std::lock_guard<std::mutex> guard(consumer_);
+			ProcessItems();
+			status_ = false;
+			// In case of any atomic issues, do another pass.
+			ProcessItems();
+		}
 		notify_->Drain();
 	}
 
@@ -134,6 +140,7 @@ class DrawBinItemsTask : public Task {
 	BinWaitable *notify_;
 	BinManager::BinItemQueue &items_;
 	std::atomic<bool> &status_;
+	std::mutex &consumer_;
 	const BinManager::BinStateQueue &states_;
 };
 
@@ -153,7 +160,7 @@ BinManager::BinManager() {
 	for (int i = 0; i < maxInitTasks; ++i) {
 		taskQueues_[i].Setup();
 		for (DrawBinItemsTask *&task : taskLists_[i].tasks)
-			task = new DrawBinItemsTask(waitable_, taskQueues_[i], taskStatus_[i], states_);
+			task = new DrawBinItemsTask(waitable_, taskQueues_[i], taskStatus_[i], taskConsumers_[i], states_);
 	}
 	states_.Setup();
 	cluts_.Setup();
@@ -460,6 +467,13 @@ void BinManager::AddPoint(const VertexData &v0) {
 
 void BinManager::Drain(bool flushing) {
 	PROFILE_THIS_SCOPE("bin_drain");
+	GPUPhaseScope phase(GPUPhase::RASTERIZE);
+
+	if (skipRasterization_) {
+		queue_.Reset();
+		pendingStateIndex_ = stateIndex_;
+		return;
+	}
 
 	// If the waitable has fully drained, we can update our binning decisions.
 	if (!tasksSplit_ || waitable_->Empty()) {
@@ -548,7 +562,7 @@ void BinManager::Drain(bool flushing) {
 
 			waitable_->Fill();
 			taskStatus_[i] = true;
-			g_threadManager.EnqueueTaskOnThread(i, taskLists_[i].Next());
+			g_threadManager.EnqueueTask(taskLists_[i].Next());
 			enqueues_++;
 		}
 
@@ -560,6 +574,7 @@ void BinManager::Flush(const char *reason) {
 	if (queueRange_.x1 == 0x7FFFFFFF)
 		return;
 
+	GPUPhaseScope phase(GPUPhase::RASTERIZE);
 	double st;
 	if (coreCollectDebugStats)
 		st = time_now_d();
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>
 #include <unordered_map>
 #include "GPU/Software/Rasterizer.h"
 
@@ -210,6 +211,11 @@ class BinManager {
 	void GetStats(char *buffer, size_t bufsize);
 	void ResetStats();
 
+	// Prims are still binned (for ranges and dependencies), but thrown away instead of drawn.
+	void SetSkipRasterization(bool skip) {
+		skipRasterization_ = skip;
+	}
+
 	void SetDirty(SoftDirty flags) {
 		dirty_ |= flags;
 	}
@@ -257,6 +263,8 @@ class BinManager {
 	BinItemQueue taskQueues_[MAX_POSSIBLE_TASKS];
 	BinTaskList taskLists_[MAX_POSSIBLE_TASKS];
 	std::atomic<bool> taskStatus_[MAX_POSSIBLE_TASKS];
+	// Held while a task drains its queue, since tasks for one range may run on different threads.
+	std::mutex taskConsumers_[MAX_POSSIBLE_TASKS];
 	BinWaitable *waitable_ = nullptr;
 
 	BinDirtyRange pendingWrites_[2]{};
@@ -264,6 +272,7 @@ class BinManager {
 
 	bool pendingOverlap_ = false;
 	bool creatingState_ = false;
+	bool skipRasterization_ = false;
 	uint16_t pendingStateIndex_ = 0;
 
 	std::unordered_map<const char *, double> flushReasonTimes_;
@@ -458,6 +458,12 @@ SoftGPU::SoftGPU(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	NotifyRenderResized();
 }
 
+NullGPU::NullGPU(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
+	: SoftGPU(gfxCtx, draw) {
+	if (drawEngine_ && drawEngine_->transformUnit.IsStarted())
+		drawEngine_->transformUnit.SetSkipRasterization(true);
+}
+
 void SoftGPU::DeviceLost() {
 	if (presentation_)
 		presentation_->DeviceLost();
@@ -846,6 +852,7 @@ void SoftGPU::Execute_Prim(u32 op, u32 diff) {
 	if (count == 0)
 		return;
 	FlushImm();
+	GPUDrawScope draw;
 
 	if (!Memory::IsValidAddress(gstate_c.vertexAddr)) {
 		ERROR_LOG_REPORT(G3D, "Software: Bad vertex address %08x!", gstate_c.vertexAddr);
@@ -884,6 +891,7 @@ void SoftGPU::Execute_Bezier(u32 op, u32 diff) {
 		// TODO: Should this eat some cycles?  Probably yes.  Not sure if important.
 		return;
 	}
+	GPUDrawScope draw;
 
 	if (!Memory::IsValidAddress(gstate_c.vertexAddr)) {
 		ERROR_LOG_REPORT(G3D, "Bad vertex address %08x!", gstate_c.vertexAddr);
@@ -936,6 +944,7 @@ void SoftGPU::Execute_Spline(u32 op, u32 diff) {
 		// TODO: Should this eat some cycles?  Probably yes.  Not sure if important.
 		return;
 	}
+	GPUDrawScope draw;
 
 	if (!Memory::IsValidAddress(gstate_c.vertexAddr)) {
 		ERROR_LOG_REPORT(G3D, "Bad vertex address %08x!", gstate_c.vertexAddr);
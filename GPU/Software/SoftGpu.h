@@ -216,6 +216,8 @@ class SoftGPU : public GPUCommon {
 
 	void BuildReportingInfo() override {}
 
+	SoftwareDrawEngine *drawEngine_ = nullptr;
+
 private:
 	void MarkDirty(uint32_t addr, uint32_t stride, uint32_t height, GEBufferFormat fmt, SoftGPUVRAMDirty value);
 	void MarkDirty(uint32_t addr, uint32_t bytes, SoftGPUVRAMDirty value);
@@ -233,7 +235,6 @@ class SoftGPU : public GPUCommon {
 	SoftDirty dirtyFlags_ = SoftDirty(-1);
 
 	PresentationCommon *presentation_ = nullptr;
-	SoftwareDrawEngine *drawEngine_ = nullptr;
 
 	Draw::Texture *fbTex = nullptr;
 	std::vector<u32> fbTexBuffer_;
@@ -250,3 +251,15 @@ enum class DSStretch {
 	Normal,
 	Wide,
 };
+
+// Runs the full software GE (state, transforms, culling, bounding box, block transfers),
+// but never rasterizes.  Useful to measure CPU/HLE throughput in headless runs.
+class NullGPU : public SoftGPU {
+public:
+	NullGPU(GraphicsContext *gfxCtx, Draw::DrawContext *draw);
+
+	void GetReportingInfo(std::string &primaryInfo, std::string &fullInfo) override {
+		primaryInfo = "Null";
+		fullInfo = "Null";
+	}
+};
@@ -24,6 +24,7 @@
 #include "Common/MemoryUtil.h"
 #include "Common/Profiler/Profiler.h"
 #include "Core/Config.h"
+#include "GPU/GPU.h"
 #include "GPU/GPUState.h"
 #include "GPU/Common/DrawEngineCommon.h"
 #include "GPU/Common/VertexDecoderCommon.h"
@@ -493,8 +494,10 @@ class SoftwareVertexReader {
 
 		if (useIndices_)
 			GetIndexBounds(indices, vertex_count, vertex_type, &lowerBound_, &upperBound_);
-		if (vertex_count != 0)
+		if (vertex_count != 0) {
+			GPUPhaseScope phase(GPUPhase::VERTEX_DECODE);
 			vdecoder.DecodeVerts(base, vertices, &gstate_c.uv, lowerBound_, upperBound_);
+		}
 
 		// If we're only using a subset of verts, it's better to decode with random access (usually.)
 		// However, if we're reusing a lot of verts, we should read and cache them.
@@ -551,6 +554,7 @@ std::vector<ClipVertexData> SoftwareVertexReader::cached_;
 
 void TransformUnit::SubmitPrimitive(const void* vertices, const void* indices, GEPrimitiveType prim_type, int vertex_count, u32 vertex_type, int *bytesRead, SoftwareDrawEngine *drawEngine)
 {
+	GPUPhaseScope phase(GPUPhase::TRANSFORM);
 	VertexDecoder &vdecoder = *drawEngine->FindVertexDecoder(vertex_type);
 
 	if (bytesRead)
@@ -920,6 +924,10 @@ void TransformUnit::NotifyClutUpdate(const void *src) {
 	binner_->UpdateClut(src);
 }
 
+void TransformUnit::SetSkipRasterization(bool skip) {
+	binner_->SetSkipRasterization(skip);
+}
+
 // TODO: This probably is not the best interface.
 // Also, we should try to merge this into the similar function in DrawEngineCommon.
 bool TransformUnit::GetCurrentSimpleVertices(int count, std::vector<GPUDebugVertex> &vertices, std::vector<u16> &indices) {
@@ -144,6 +144,7 @@ class TransformUnit {
 	void Flush(const char *reason);
 	void FlushIfOverlap(const char *reason, bool modifying, uint32_t addr, uint32_t stride, uint32_t w, uint32_t h);
 	void NotifyClutUpdate(const void *src);
+	void SetSkipRasterization(bool skip);
 
 	void GetStats(char *buffer, size_t bufsize);
 
@@ -318,6 +318,7 @@ void DrawEngineVulkan::DoFlush() {
 			lastPipeline_ = pipeline;
 		}
 		lastPrim_ = prim;
+		RecordDrawUsage();
 
 		dirtyUniforms_ |= shaderManager_->UpdateUniforms(framebufferManager_->UseBufferedRendering());
 		UpdateUBOs();
@@ -489,6 +490,7 @@ void DrawEngineVulkan::DoFlush() {
 			}
 
 			lastPrim_ = prim;
+			RecordDrawUsage();
 
 			dirtyUniforms_ |= shaderManager_->UpdateUniforms(framebufferManager_->UseBufferedRendering());
 
@@ -574,6 +576,13 @@ void DrawEngineVulkan::ResetAfterDraw() {
 	gstate_c.vertexFullAlpha = true;
 }
 
+// Every draw counts for the shader profile, not just the ones that changed state.
+void DrawEngineVulkan::RecordDrawUsage() {
+	uint32_t frame = (uint32_t)gpuStats.numFlips;
+	lastPipeline_->usage.Record(frame);
+	shaderManager_->RecordDraw(frame);
+}
+
 void DrawEngineVulkan::UpdateUBOs() {
 	if ((dirtyUniforms_ & DIRTY_BASE_UNIFORMS) || baseBuf == VK_NULL_HANDLE) {
 		baseUBOOffset = shaderManager_->PushBaseBuffer(pushUBO_, &baseBuf);
@@ -187,6 +187,7 @@ class DrawEngineVulkan : public DrawEngineCommon {
 	void UpdateUBOs();
 
 	NO_INLINE void ResetAfterDraw();
+	void RecordDrawUsage();
 
 	Draw::DrawContext *draw_;
 
@@ -22,6 +22,7 @@
 
 #include "Common/Log.h"
 #include "Common/File/FileUtil.h"
+#include "Common/File/VFS/VFS.h"
 #include "Common/GraphicsContext.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/TimeUtil.h"
@@ -93,21 +94,69 @@ GPU_Vulkan::GPU_Vulkan(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	if (discID.size()) {
 		File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
 		shaderCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".vkshadercache");
-		LoadCache(shaderCachePath_);
+		shaderProfilePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".shaderprofile");
+		LoadShaderProfile(discID);
+		if (!LoadCache(shaderCachePath_) && g_Config.bShaderCache && !shaderProfile_.empty()) {
+			// Cold start. Compile what the profile says we'll need, hottest first.
+			PSP_SetLoading("Compiling shaders from profile...");
+			shaderManagerVulkan_->WarmUpFromProfile(shaderProfile_);
+			pipelineManager_->CreatePipelinesFromProfile(shaderProfile_, shaderManagerVulkan_, draw_, drawEngine_.GetPipelineLayout(), msaaLevel_);
+		}
 	}
 }
 
-void GPU_Vulkan::LoadCache(const Path &filename) {
+void GPU_Vulkan::LoadShaderProfile(const std::string &discID) {
+	if (!g_Config.bShaderCache)
+		return;
+
+	const uint32_t version = ShaderManagerVulkan::GetCacheVersion();
+	const size_t keySizes[(int)ShaderProfile::Kind::COUNT] = { sizeof(VShaderID), sizeof(FShaderID), sizeof(GShaderID), PipelineManagerVulkan::GetProfileKeySize() };
+	std::string data;
+	if (File::ReadBinaryFileToString(shaderProfilePath_, &data) && shaderProfile_.Load((const uint8_t *)data.data(), data.size(), version, keySizes)) {
+		INFO_LOG(G3D, "Loaded shader profile %s", shaderProfilePath_.c_str());
+		return;
+	}
+
+	// Fall back to a profile shipped with the app, if there is one for this game.
+	size_t size = 0;
+	uint8_t *bundled = g_VFS.ReadFile(("shaderprofiles/" + discID + ".shaderprofile").c_str(), &size);
+	if (bundled) {
+		if (shaderProfile_.Load(bundled, size, version, keySizes))
+			INFO_LOG(G3D, "Loaded bundled shader profile for %s", discID.c_str());
+		delete[] bundled;
+	}
+}
+
+void GPU_Vulkan::SaveShaderProfile() {
+	if (!shaderProfilePath_.Valid())
+		return;
+	// Merge into a copy, so saving twice (like on device lost and then shutdown) doesn't count twice.
+	ShaderProfile profile = shaderProfile_;
+	shaderManagerVulkan_->ExportProfile(&profile);
+	pipelineManager_->ExportProfile(&profile, shaderManagerVulkan_);
+	if (profile.empty())
+		return;
+
+	FILE *f = File::OpenCFile(shaderProfilePath_, "wb");
+	if (!f)
+		return;
+	if (!profile.Save(f, ShaderManagerVulkan::GetCacheVersion())) {
+		ERROR_LOG(G3D, "Failed to write shader profile, disk full?");
+	}
+	fclose(f);
+}
+
+bool GPU_Vulkan::LoadCache(const Path &filename) {
 	if (!g_Config.bShaderCache) {
 		WARN_LOG(G3D, "Shader cache disabled. Not loading.");
-		return;
+		return false;
 	}
 
 	PSP_SetLoading("Loading shader cache...");
 	// Actually precompiled by IsReady() since we're single-threaded.
 	FILE *f = File::OpenCFile(filename, "rb");
 	if (!f)
-		return;
+		return false;
 
 	// First compile shaders to SPIR-V, then load the pipeline cache and recreate the pipelines.
 	// It's when recreating the pipelines that the pipeline cache is useful - in the ideal case,
@@ -140,6 +189,7 @@ void GPU_Vulkan::LoadCache(const Path &filename) {
 	} else {
 		INFO_LOG(G3D, "Loaded Vulkan pipeline cache.");
 	}
+	return result;
 }
 
 void GPU_Vulkan::SaveCache(const Path &filename) {
@@ -162,6 +212,8 @@ void GPU_Vulkan::SaveCache(const Path &filename) {
 	pipelineManager_->SavePipelineCache(f, false, shaderManagerVulkan_, draw_);
 	INFO_LOG(G3D, "Saved Vulkan pipeline cache");
 	fclose(f);
+
+	SaveShaderProfile();
 }
 
 GPU_Vulkan::~GPU_Vulkan() {
@@ -67,8 +67,10 @@ class GPU_Vulkan : public GPUCommonHW {
 	void InitDeviceObjects();
 	void DestroyDeviceObjects();
 
-	void LoadCache(const Path &filename);
+	bool LoadCache(const Path &filename);
 	void SaveCache(const Path &filename);
+	void LoadShaderProfile(const std::string &discID);
+	void SaveShaderProfile();
 
 	FramebufferManagerVulkan *framebufferManagerVulkan_;
 	TextureCacheVulkan *textureCacheVulkan_;
@@ -81,4 +83,7 @@ class GPU_Vulkan : public GPUCommonHW {
 	PipelineManagerVulkan *pipelineManager_;
 
 	Path shaderCachePath_;
+	Path shaderProfilePath_;
+	// Usage from earlier runs (or a bundled profile), merged with this run's when saving.
+	ShaderProfile shaderProfile_;
 };
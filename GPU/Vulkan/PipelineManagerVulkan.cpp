@@ -1,6 +1,5 @@
 #include <cstring>
 #include <memory>
-#include <set>
 #include <sstream>
 
 #include "Common/Profiler/Profiler.h"
@@ -9,6 +8,7 @@
 #include "Common/StringUtils.h"
 #include "Common/GPU/Vulkan/VulkanContext.h"
 #include "Core/Config.h"
+#include "GPU/GPU.h"
 #include "GPU/Vulkan/VulkanUtil.h"
 #include "GPU/Vulkan/PipelineManagerVulkan.h"
 #include "GPU/Vulkan/ShaderManagerVulkan.h"
@@ -620,13 +620,13 @@ struct StoredVulkanPipelineKey {
 	uint32_t vtxFmtId;
 	uint32_t variants;
 	bool useHWTransform;  // TODO: Still needed?
-
-	// For std::set. Better zero-initialize the struct properly for this to work.
-	bool operator < (const StoredVulkanPipelineKey &other) const {
-		return memcmp(this, &other, sizeof(*this)) < 0;
-	}
+	// Deduplicated as raw bytes in ShaderProfile. Better zero-initialize the struct properly for this to work.
 };
 
+size_t PipelineManagerVulkan::GetProfileKeySize() {
+	return sizeof(StoredVulkanPipelineKey);
+}
+
 // If you're looking for how to invalidate the cache, it's done in ShaderManagerVulkan, look for CACHE_VERSION and increment it.
 // (Header of the same file this is stored in).
 void PipelineManagerVulkan::SavePipelineCache(FILE *file, bool saveRawPipelineCache, ShaderManagerVulkan *shaderManager, Draw::DrawContext *drawContext) {
@@ -655,15 +655,45 @@ void PipelineManagerVulkan::SavePipelineCache(FILE *file, bool saveRawPipelineCa
 
 	size_t seekPosOnFailure = ftell(file);
 
-	bool failed = false;
 	bool writeFailed = false;
 	// Since we don't include the full pipeline key, there can be duplicates,
 	// caused by things like switching from buffered to non-buffered rendering.
-	// Make sure the set of pipelines we write is "unique".
-	std::set<StoredVulkanPipelineKey> keys;
+	// The profile merges these, so the set of pipelines we write is "unique".
+	ShaderProfile profile;
+	bool failed = !ExportProfile(&profile, shaderManager);
+	const auto keys = profile.Sorted(ShaderProfile::Kind::VULKAN_PIPELINE);
 
+	// Write the number of pipelines.
+	size = (uint32_t)keys.size();
+	writeFailed = writeFailed || fwrite(&size, sizeof(size), 1, file) != 1;
+
+	// Write the pipelines, hottest first so they're also created in that order.
+	for (auto &key : keys) {
+		writeFailed = writeFailed || fwrite(key.first.data(), key.first.size(), 1, file) != 1;
+	}
+
+	if (failed) {
+		ERROR_LOG(G3D, "Failed to write pipeline cache, some shader was missing");
+		// Write a zero in the right place so it doesn't try to load the pipelines next time.
+		size = 0;
+		fseek(file, (long)seekPosOnFailure, SEEK_SET);
+		writeFailed = fwrite(&size, sizeof(size), 1, file) != 1;
+		if (writeFailed) {
+			ERROR_LOG(G3D, "Failed to write pipeline cache, disk full?");
+		}
+		return;
+	}
+	if (writeFailed) {
+		ERROR_LOG(G3D, "Failed to write pipeline cache, disk full?");
+	} else {
+		NOTICE_LOG(G3D, "Saved Vulkan pipeline ID cache (%d unique pipelines/%d).", (int)keys.size(), (int)pipelines_.size());
+	}
+}
+
+bool PipelineManagerVulkan::ExportProfile(ShaderProfile *profile, ShaderManagerVulkan *shaderManager) {
+	bool failed = false;
 	pipelines_.Iterate([&](const VulkanPipelineKey &pkey, VulkanPipeline *value) {
-		if (failed)
+		if (failed || !value)
 			return;
 		VulkanVertexShader *vshader = shaderManager->GetVertexShaderFromModule(pkey.vShader->BlockUntilReady());
 		VulkanFragmentShader *fshader = shaderManager->GetFragmentShaderFromModule(pkey.fShader->BlockUntilReady());
@@ -689,34 +719,64 @@ void PipelineManagerVulkan::SavePipelineCache(FILE *file, bool saveRawPipelineCa
 			// NOTE: This is not a vtype, but a decoded vertex format.
 			key.vtxFmtId = pkey.vtxFmtId;
 		}
-		keys.insert(key);
+		profile->Add(ShaderProfile::Kind::VULKAN_PIPELINE, &key, sizeof(key), value->usage);
 	});
+	return !failed;
+}
 
-	// Write the number of pipelines.
-	size = (uint32_t)keys.size();
-	writeFailed = writeFailed || fwrite(&size, sizeof(size), 1, file) != 1;
+bool PipelineManagerVulkan::CreateStoredPipeline(VulkanRenderManager *rm, const StoredVulkanPipelineKey &key, ShaderManagerVulkan *shaderManager, VKRPipelineLayout *layout, int multiSampleLevel) {
+	if (key.raster.topology == VK_PRIMITIVE_TOPOLOGY_POINT_LIST || key.raster.topology == VK_PRIMITIVE_TOPOLOGY_LINE_LIST) {
+		WARN_LOG(G3D, "Bad raster key in cache, ignoring");
+		return false;
+	}
 
-	// Write the pipelines.
-	for (auto &key : keys) {
-		writeFailed = writeFailed || fwrite(&key, sizeof(key), 1, file) != 1;
+	VulkanVertexShader *vs = shaderManager->GetVertexShaderFromID(key.vShaderID);
+	VulkanFragmentShader *fs = shaderManager->GetFragmentShaderFromID(key.fShaderID);
+	VulkanGeometryShader *gs = shaderManager->GetGeometryShaderFromID(key.gShaderID);
+	if (!vs || !fs || (!gs && key.gShaderID.Bit(GS_BIT_ENABLED))) {
+		// We just ignore this one, it'll get created later if needed.
+		// Probably some useFlags mismatch.
+		WARN_LOG(G3D, "Failed to find vs or fs for cached pipeline, skipping pipeline");
+		return false;
 	}
 
-	if (failed) {
-		ERROR_LOG(G3D, "Failed to write pipeline cache, some shader was missing");
-		// Write a zero in the right place so it doesn't try to load the pipelines next time.
-		size = 0;
-		fseek(file, (long)seekPosOnFailure, SEEK_SET);
-		writeFailed = fwrite(&size, sizeof(size), 1, file) != 1;
-		if (writeFailed) {
-			ERROR_LOG(G3D, "Failed to write pipeline cache, disk full?");
+	// Avoid creating multisampled shaders if it's not enabled, as that results in an invalid combination.
+	// Note that variantsToBuild is NOT directly a RenderPassType! instead, it's a collection of (1 << RenderPassType).
+	u32 variantsToBuild = key.variants;
+	if (multiSampleLevel == 0) {
+		for (u32 i = 0; i < (int)RenderPassType::TYPE_COUNT; i++) {
+			if (RenderPassTypeHasMultisample((RenderPassType)i)) {
+				variantsToBuild &= ~(1 << i);
+			}
 		}
-		return;
 	}
-	if (writeFailed) {
-		ERROR_LOG(G3D, "Failed to write pipeline cache, disk full?");
-	} else {
-		NOTICE_LOG(G3D, "Saved Vulkan pipeline ID cache (%d unique pipelines/%d).", (int)keys.size(), (int)pipelines_.size());
+
+	DecVtxFormat fmt;
+	fmt.InitializeFromID(key.vtxFmtId);
+	VulkanPipeline *pipeline = GetOrCreatePipeline(
+		rm, layout, key.raster, key.useHWTransform ? &fmt : 0, vs, fs, gs, key.useHWTransform, variantsToBuild, multiSampleLevel, true);
+	return pipeline != nullptr;
+}
+
+void PipelineManagerVulkan::CreatePipelinesFromProfile(const ShaderProfile &profile, ShaderManagerVulkan *shaderManager, Draw::DrawContext *drawContext, VKRPipelineLayout *layout, int multiSampleLevel) {
+	VulkanRenderManager *rm = (VulkanRenderManager *)drawContext->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
+	const auto keys = profile.Sorted(ShaderProfile::Kind::VULKAN_PIPELINE);
+
+	int failCount = 0;
+	for (const auto &entry : keys) {
+		if (entry.first.size() != sizeof(StoredVulkanPipelineKey)) {
+			failCount++;
+			continue;
+		}
+		StoredVulkanPipelineKey key;
+		memcpy(&key, entry.first.data(), sizeof(key));
+		if (!CreateStoredPipeline(rm, key, shaderManager, layout, multiSampleLevel))
+			failCount++;
 	}
+
+	rm->NudgeCompilerThread();
+
+	NOTICE_LOG(G3D, "Created Vulkan pipelines from profile (%d pipelines, %d failed).", (int)keys.size(), failCount);
 }
 
 bool PipelineManagerVulkan::LoadPipelineCache(FILE *file, bool loadRawPipelineCache, ShaderManagerVulkan *shaderManager, Draw::DrawContext *drawContext, VKRPipelineLayout *layout, int multiSampleLevel) {
@@ -779,7 +839,6 @@ bool PipelineManagerVulkan::LoadPipelineCache(FILE *file, bool loadRawPipelineCa
 
 	NOTICE_LOG(G3D, "Creating %d pipelines from cache (%dx MSAA)...", size, (1 << multiSampleLevel));
 	int pipelineCreateFailCount = 0;
-	int shaderFailCount = 0;
 	for (uint32_t i = 0; i < size; i++) {
 		if (failed) {
 			break;
@@ -791,37 +850,7 @@ bool PipelineManagerVulkan::LoadPipelineCache(FILE *file, bool loadRawPipelineCa
 			break;
 		}
 
-		if (key.raster.topology == VK_PRIMITIVE_TOPOLOGY_POINT_LIST || key.raster.topology == VK_PRIMITIVE_TOPOLOGY_LINE_LIST) {
-			WARN_LOG(G3D, "Bad raster key in cache, ignoring");
-			continue;
-		}
-
-		VulkanVertexShader *vs = shaderManager->GetVertexShaderFromID(key.vShaderID);
-		VulkanFragmentShader *fs = shaderManager->GetFragmentShaderFromID(key.fShaderID);
-		VulkanGeometryShader *gs = shaderManager->GetGeometryShaderFromID(key.gShaderID);
-		if (!vs || !fs || (!gs && key.gShaderID.Bit(GS_BIT_ENABLED))) {
-			// We just ignore this one, it'll get created later if needed.
-			// Probably some useFlags mismatch.
-			WARN_LOG(G3D, "Failed to find vs or fs in pipeline %d in cache, skipping pipeline", (int)i);
-			continue;
-		}
-
-		// Avoid creating multisampled shaders if it's not enabled, as that results in an invalid combination.
-		// Note that variantsToBuild is NOT directly a RenderPassType! instead, it's a collection of (1 << RenderPassType).
-		u32 variantsToBuild = key.variants;
-		if (multiSampleLevel == 0) {
-			for (u32 i = 0; i < (int)RenderPassType::TYPE_COUNT; i++) {
-				if (RenderPassTypeHasMultisample((RenderPassType)i)) {
-					variantsToBuild &= ~(1 << i);
-				}
-			}
-		}
-
-		DecVtxFormat fmt;
-		fmt.InitializeFromID(key.vtxFmtId);
-		VulkanPipeline *pipeline = GetOrCreatePipeline(
-			rm, layout, key.raster, key.useHWTransform ? &fmt : 0, vs, fs, gs, key.useHWTransform, variantsToBuild, multiSampleLevel, true);
-		if (!pipeline) {
+		if (!CreateStoredPipeline(rm, key, shaderManager, layout, multiSampleLevel)) {
 			pipelineCreateFailCount += 1;
 		}
 	}
@@ -38,6 +38,7 @@ class VulkanFragmentShader;
 class VulkanGeometryShader;
 class ShaderManagerVulkan;
 class DrawEngineCommon;
+struct StoredVulkanPipelineKey;
 
 struct VulkanPipelineKey {
 	VulkanPipelineRasterStateKey raster;  // prim is included here
@@ -70,6 +71,7 @@ struct VulkanPipeline {
 	VKRGraphicsPipeline *pipeline;
 	VKRGraphicsPipelineDesc *desc;
 	PipelineFlags pipelineFlags;  // PipelineFlags enum above.
+	ShaderUsage usage;  // Draws using this pipeline, counted by DrawEngineVulkan.
 
 	bool UsesBlendConstant() const { return (pipelineFlags & PipelineFlags::USES_BLEND_CONSTANT) != 0; }
 	bool UsesDepthStencil() const { return (pipelineFlags & PipelineFlags::USES_DEPTH_STENCIL) != 0; }
@@ -102,7 +104,16 @@ class PipelineManagerVulkan {
 	void SavePipelineCache(FILE *file, bool saveRawPipelineCache, ShaderManagerVulkan *shaderManager, Draw::DrawContext *drawContext);
 	bool LoadPipelineCache(FILE *file, bool loadRawPipelineCache, ShaderManagerVulkan *shaderManager, Draw::DrawContext *drawContext, VKRPipelineLayout *layout, int multiSampleLevel);
 
+	// Size of the pipeline keys in shader profiles.
+	static size_t GetProfileKeySize();
+	// Adds this session's pipeline usage to profile.  Returns false if some shader was missing.
+	bool ExportProfile(ShaderProfile *profile, ShaderManagerVulkan *shaderManager);
+	// Creates the pipelines in profile, hottest first.  The shaders must already exist.
+	void CreatePipelinesFromProfile(const ShaderProfile &profile, ShaderManagerVulkan *shaderManager, Draw::DrawContext *drawContext, VKRPipelineLayout *layout, int multiSampleLevel);
+
 private:
+	bool CreateStoredPipeline(VulkanRenderManager *rm, const StoredVulkanPipelineKey &key, ShaderManagerVulkan *shaderManager, VKRPipelineLayout *layout, int multiSampleLevel);
+
 	DenseHashMap<VulkanPipelineKey, VulkanPipeline *> pipelines_;
 	VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
 	VulkanContext *vulkan_;
@@ -19,6 +19,9 @@
 //#define SHADERLOG
 #endif
 
+#include <atomic>
+#include <memory>
+
 #include "Common/LogReporting.h"
 #include "Common/Math/lin/matrix4x4.h"
 #include "Common/Math/math_util.h"
@@ -26,7 +29,9 @@
 #include "Common/Profiler/Profiler.h"
 #include "Common/GPU/thin3d.h"
 #include "Common/Data/Encoding/Utf8.h"
+#include "Common/File/FileUtil.h"
 #include "Common/TimeUtil.h"
+#include "Common/Thread/ParallelLoop.h"
 
 #include "Common/StringUtils.h"
 #include "Common/GPU/Vulkan/VulkanContext.h"
@@ -47,15 +52,24 @@
 // Most drivers treat vkCreateShaderModule as pretty much a memcpy. What actually
 // takes time here, and makes this worthy of parallelization, is GLSLtoSPV.
 // Takes ownership over tag.
+// If spirvCache already has this exact source compiled, glslang is skipped entirely.
 // This always returns something, checking the return value for null is not meaningful.
-static Promise<VkShaderModule> *CompileShaderModuleAsync(VulkanContext *vulkan, VkShaderStageFlagBits stage, const char *code, std::string *tag) {
+static Promise<VkShaderModule> *CompileShaderModuleAsync(VulkanContext *vulkan, VkShaderStageFlagBits stage, const char *code, std::string *tag, SpirvCache *spirvCache) {
+	const SpirvCache::Key key = SpirvCache::MakeKey((uint32_t)stage, code);
+	const bool cached = spirvCache && spirvCache->Contains(key);
+
 	auto compile = [=] {
 		PROFILE_THIS_SCOPE("shadercomp");
 
 		std::string errorMessage;
 		std::vector<uint32_t> spirv;
 
-		bool success = GLSLtoSPV(stage, code, GLSLVariant::VULKAN, spirv, &errorMessage);
+		bool success = cached && spirvCache->Get(key, &spirv);
+		if (!success) {
+			success = GLSLtoSPV(stage, code, GLSLVariant::VULKAN, spirv, &errorMessage);
+			if (success && spirvCache)
+				spirvCache->Put(key, spirv);
+		}
 
 		if (!errorMessage.empty()) {
 			if (success) {
@@ -104,18 +118,19 @@ static Promise<VkShaderModule> *CompileShaderModuleAsync(VulkanContext *vulkan,
 	bool singleThreaded = false;
 #endif
 
-	if (singleThreaded) {
+	// With SPIR-V already available, creating the module is cheap enough to just do it now.
+	if (singleThreaded || cached) {
 		return Promise<VkShaderModule>::AlreadyDone(compile());
 	} else {
 		return Promise<VkShaderModule>::Spawn(&g_threadManager, compile, TaskType::DEDICATED_THREAD);
 	}
 }
 
-VulkanFragmentShader::VulkanFragmentShader(VulkanContext *vulkan, FShaderID id, FragmentShaderFlags flags, const char *code)
+VulkanFragmentShader::VulkanFragmentShader(VulkanContext *vulkan, FShaderID id, FragmentShaderFlags flags, const char *code, SpirvCache *spirvCache)
 	: vulkan_(vulkan), id_(id), flags_(flags) {
 	_assert_(!id.is_invalid());
 	source_ = code;
-	module_ = CompileShaderModuleAsync(vulkan, VK_SHADER_STAGE_FRAGMENT_BIT, source_.c_str(), new std::string(FragmentShaderDesc(id)));
+	module_ = CompileShaderModuleAsync(vulkan, VK_SHADER_STAGE_FRAGMENT_BIT, source_.c_str(), new std::string(FragmentShaderDesc(id)), spirvCache);
 	VERBOSE_LOG(G3D, "Compiled fragment shader:\n%s\n", (const char *)code);
 }
 
@@ -143,11 +158,11 @@ std::string VulkanFragmentShader::GetShaderString(DebugShaderStringType type) co
 	}
 }
 
-VulkanVertexShader::VulkanVertexShader(VulkanContext *vulkan, VShaderID id, VertexShaderFlags flags, const char *code, bool useHWTransform)
+VulkanVertexShader::VulkanVertexShader(VulkanContext *vulkan, VShaderID id, VertexShaderFlags flags, const char *code, bool useHWTransform, SpirvCache *spirvCache)
 	: vulkan_(vulkan), useHWTransform_(useHWTransform), flags_(flags), id_(id) {
 	_assert_(!id.is_invalid());
 	source_ = code;
-	module_ = CompileShaderModuleAsync(vulkan, VK_SHADER_STAGE_VERTEX_BIT, source_.c_str(), new std::string(VertexShaderDesc(id)));
+	module_ = CompileShaderModuleAsync(vulkan, VK_SHADER_STAGE_VERTEX_BIT, source_.c_str(), new std::string(VertexShaderDesc(id)), spirvCache);
 	VERBOSE_LOG(G3D, "Compiled vertex shader:\n%s\n", (const char *)code);
 }
 
@@ -175,11 +190,11 @@ std::string VulkanVertexShader::GetShaderString(DebugShaderStringType type) cons
 	}
 }
 
-VulkanGeometryShader::VulkanGeometryShader(VulkanContext *vulkan, GShaderID id, const char *code)
+VulkanGeometryShader::VulkanGeometryShader(VulkanContext *vulkan, GShaderID id, const char *code, SpirvCache *spirvCache)
 	: vulkan_(vulkan), id_(id) {
 	_assert_(!id.is_invalid());
 	source_ = code;
-	module_ = CompileShaderModuleAsync(vulkan, VK_SHADER_STAGE_GEOMETRY_BIT, source_.c_str(), new std::string(GeometryShaderDesc(id).c_str()));
+	module_ = CompileShaderModuleAsync(vulkan, VK_SHADER_STAGE_GEOMETRY_BIT, source_.c_str(), new std::string(GeometryShaderDesc(id).c_str()), spirvCache);
 	VERBOSE_LOG(G3D, "Compiled geometry shader:\n%s\n", (const char *)code);
 }
 
@@ -264,6 +279,15 @@ void ShaderManagerVulkan::ClearShaders() {
 	gstate_c.Dirty(DIRTY_ALL_UNIFORMS | DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE | DIRTY_GEOMETRYSHADER_STATE);
 }
 
+void ShaderManagerVulkan::RecordDraw(uint32_t frame) {
+	if (lastVShader_)
+		lastVShader_->RecordUse(frame);
+	if (lastFShader_)
+		lastFShader_->RecordUse(frame);
+	if (lastGShader_)
+		lastGShader_->RecordUse(frame);
+}
+
 void ShaderManagerVulkan::DirtyLastShader() {
 	// Forget the last shader ID
 	lastFSID_.set_invalid();
@@ -311,7 +335,7 @@ void ShaderManagerVulkan::GetShaders(int prim, VertexDecoder *decoder, VulkanVer
 			_assert_msg_(strlen(codeBuffer_) < CODE_BUFFER_SIZE, "VS length error: %d", (int)strlen(codeBuffer_));
 
 			// Don't need to re-lookup anymore, now that we lock wider.
-			vs = new VulkanVertexShader(vulkan, VSID, flags, codeBuffer_, useHWTransform);
+			vs = new VulkanVertexShader(vulkan, VSID, flags, codeBuffer_, useHWTransform, &spirvCache_);
 			vsCache_.Insert(VSID, vs);
 		}
 		lastVShader_ = vs;
@@ -339,7 +363,7 @@ void ShaderManagerVulkan::GetShaders(int prim, VertexDecoder *decoder, VulkanVer
 			_assert_msg_(success, "FS gen error: %s", genErrorString.c_str());
 			_assert_msg_(strlen(codeBuffer_) < CODE_BUFFER_SIZE, "FS length error: %d", (int)strlen(codeBuffer_));
 
-			fs = new VulkanFragmentShader(vulkan, FSID, flags, codeBuffer_);
+			fs = new VulkanFragmentShader(vulkan, FSID, flags, codeBuffer_, &spirvCache_);
 			fsCache_.Insert(FSID, fs);
 		}
 		lastFShader_ = fs;
@@ -366,7 +390,7 @@ void ShaderManagerVulkan::GetShaders(int prim, VertexDecoder *decoder, VulkanVer
 				_assert_msg_(success, "GS gen error: %s", genErrorString.c_str());
 				_assert_msg_(strlen(codeBuffer_) < CODE_BUFFER_SIZE, "GS length error: %d", (int)strlen(codeBuffer_));
 
-				gs = new VulkanGeometryShader(vulkan, GSID, codeBuffer_);
+				gs = new VulkanGeometryShader(vulkan, GSID, codeBuffer_, &spirvCache_);
 				gsCache_.Insert(GSID, gs);
 			}
 		} else {
@@ -495,13 +519,16 @@ VulkanGeometryShader *ShaderManagerVulkan::GetGeometryShaderFromModule(VkShaderM
 // compile them on the fly later. We also store the Vulkan pipeline cache, so if it contains
 // pipelines compiled from SPIR-V matching these shaders, pipeline creation will be practically
 // instantaneous.
+//
+// The SPIR-V itself is stored too, keyed by a hash of the generated source, so that on the
+// next boot we only regenerate the (cheap) source and skip glslang for anything unchanged.
 
 enum class VulkanCacheDetectFlags {
 	EQUAL_DEPTH = 1,
 };
 
 #define CACHE_HEADER_MAGIC 0xff51f420 
-#define CACHE_VERSION 51
+#define CACHE_VERSION 52
 
 struct VulkanCacheHeader {
 	uint32_t magic;
@@ -513,6 +540,10 @@ struct VulkanCacheHeader {
 	int numGeometryShaders;
 };
 
+uint32_t ShaderManagerVulkan::GetCacheVersion() {
+	return CACHE_VERSION;
+}
+
 bool ShaderManagerVulkan::LoadCacheFlags(FILE *f, DrawEngineVulkan *drawEngine) {
 	VulkanCacheHeader header{};
 	long pos = ftell(f);
@@ -549,82 +580,151 @@ bool ShaderManagerVulkan::LoadCache(FILE *f) {
 		gstate_c.useFlagsChanged = false;
 	}
 
-	int failCount = 0;
+	if (!success || header.numVertexShaders < 0 || header.numFragmentShaders < 0 || header.numGeometryShaders < 0) {
+		ERROR_LOG(G3D, "Vulkan shader cache header invalid");
+		return false;
+	}
 
-	VulkanContext *vulkan = (VulkanContext *)draw_->GetNativeObject(Draw::NativeObject::CONTEXT);
-	for (int i = 0; i < header.numVertexShaders; i++) {
-		VShaderID id;
-		if (fread(&id, sizeof(id), 1, f) != 1) {
-			ERROR_LOG(G3D, "Vulkan shader cache truncated (in VertexShaders)");
-			return false;
-		}
-		bool useHWTransform = id.Bit(VS_BIT_USE_HW_TRANSFORM);
-		std::string genErrorString;
-		uint32_t attributeMask = 0;
-		uint64_t uniformMask = 0;
-		VertexShaderFlags flags;
-		if (!GenerateVertexShader(id, codeBuffer_, compat_, draw_->GetBugs(), &attributeMask, &uniformMask, &flags, &genErrorString)) {
-			ERROR_LOG(G3D, "Failed to generate vertex shader during cache load");
-			// We just ignore this one and carry on.
-			failCount++;
-			continue;
-		}
-		_assert_msg_(strlen(codeBuffer_) < CODE_BUFFER_SIZE, "VS length error: %d", (int)strlen(codeBuffer_));
-		// Don't add the new shader if already compiled - though this should no longer happen.
-		if (!vsCache_.ContainsKey(id)) {
-			VulkanVertexShader *vs = new VulkanVertexShader(vulkan, id, flags, codeBuffer_, useHWTransform);
-			vsCache_.Insert(id, vs);
-		}
+	// Don't trust the counts to size the allocations below, a corrupt file could ask for gigabytes.
+	const long idsStart = ftell(f);
+	const uint64_t fileSize = File::GetFileSize(f);
+	const uint64_t idBytes = (uint64_t)header.numVertexShaders * sizeof(VShaderID) + (uint64_t)header.numFragmentShaders * sizeof(FShaderID) + (uint64_t)header.numGeometryShaders * sizeof(GShaderID);
+	if (idsStart < 0 || fileSize < (uint64_t)idsStart || idBytes > fileSize - (uint64_t)idsStart) {
+		ERROR_LOG(G3D, "Vulkan shader cache truncated (shader counts don't fit in file)");
+		return false;
 	}
-	uint32_t vendorID = vulkan->GetPhysicalDeviceProperties().properties.vendorID;
 
-	for (int i = 0; i < header.numFragmentShaders; i++) {
-		FShaderID id;
-		if (fread(&id, sizeof(id), 1, f) != 1) {
-			ERROR_LOG(G3D, "Vulkan shader cache truncated (in FragmentShaders)");
-			return false;
-		}
-		std::string genErrorString;
-		uint64_t uniformMask = 0;
-		FragmentShaderFlags flags;
-		if (!GenerateFragmentShader(id, codeBuffer_, compat_, draw_->GetBugs(), &uniformMask, &flags, &genErrorString)) {
-			ERROR_LOG(G3D, "Failed to generate fragment shader during cache load");
-			// We just ignore this one and carry on.
-			failCount++;
-			continue;
-		}
-		_assert_msg_(strlen(codeBuffer_) < CODE_BUFFER_SIZE, "FS length error: %d", (int)strlen(codeBuffer_));
-		if (!fsCache_.ContainsKey(id)) {
-			VulkanFragmentShader *fs = new VulkanFragmentShader(vulkan, id, flags, codeBuffer_);
-			fsCache_.Insert(id, fs);
-		}
+	// The IDs come first, followed by the compiled SPIR-V.
+	std::vector<VShaderID> vsIDs(header.numVertexShaders);
+	std::vector<FShaderID> fsIDs(header.numFragmentShaders);
+	std::vector<GShaderID> gsIDs(header.numGeometryShaders);
+	if (fread(vsIDs.data(), sizeof(VShaderID), vsIDs.size(), f) != vsIDs.size()) {
+		ERROR_LOG(G3D, "Vulkan shader cache truncated (in VertexShaders)");
+		return false;
+	}
+	if (fread(fsIDs.data(), sizeof(FShaderID), fsIDs.size(), f) != fsIDs.size()) {
+		ERROR_LOG(G3D, "Vulkan shader cache truncated (in FragmentShaders)");
+		return false;
+	}
+	if (fread(gsIDs.data(), sizeof(GShaderID), gsIDs.size(), f) != gsIDs.size()) {
+		ERROR_LOG(G3D, "Vulkan shader cache truncated (in GeometryShaders)");
+		return false;
+	}
+	if (!spirvCache_.Load(f)) {
+		ERROR_LOG(G3D, "Vulkan shader cache truncated (in SPIR-V)");
+		return false;
 	}
 
-	// If it's not enabled, don't create shaders cached from earlier runs - creation will likely fail.
-	if (gstate_c.Use(GPU_USE_GS_CULLING)) {
-		for (int i = 0; i < header.numGeometryShaders; i++) {
-			GShaderID id;
-			if (fread(&id, sizeof(id), 1, f) != 1) {
-				ERROR_LOG(G3D, "Vulkan shader cache truncated (in GeometryShaders)");
-				return false;
-			}
+	WarmUp(vsIDs, fsIDs, gstate_c.Use(GPU_USE_GS_CULLING) ? gsIDs : std::vector<GShaderID>());
+	return true;
+}
+
+void ShaderManagerVulkan::WarmUp(const std::vector<VShaderID> &vsIDs, const std::vector<FShaderID> &fsIDs, const std::vector<GShaderID> &gsIDs) {
+	// Generate the source for every shader and compile any SPIR-V we don't already have across
+	// worker threads.  Creating the modules afterwards is then cheap.
+	const int vsCount = (int)vsIDs.size();
+	const int fsCount = (int)fsIDs.size();
+	const int total = vsCount + fsCount + (int)gsIDs.size();
+	std::vector<std::string> sources(total);
+	std::vector<VertexShaderFlags> vsFlags(vsCount);
+	std::vector<FragmentShaderFlags> fsFlags(fsCount);
+	std::atomic<int> failCount{};
+	std::atomic<int> compileCount{};
+	const Draw::Bugs bugs = draw_->GetBugs();
+
+	double start = time_now_d();
+	ParallelRangeLoop(&g_threadManager, [&](int lower, int upper) {
+		std::unique_ptr<char[]> buffer(new char[CODE_BUFFER_SIZE]);
+		for (int i = lower; i < upper; i++) {
 			std::string genErrorString;
-			if (!GenerateGeometryShader(id, codeBuffer_, compat_, draw_->GetBugs(), &genErrorString)) {
-				ERROR_LOG(G3D, "Failed to generate geometry shader during cache load");
+			VkShaderStageFlagBits stage;
+			bool generated;
+			if (i < vsCount) {
+				uint32_t attributeMask = 0;
+				uint64_t uniformMask = 0;
+				stage = VK_SHADER_STAGE_VERTEX_BIT;
+				generated = GenerateVertexShader(vsIDs[i], buffer.get(), compat_, bugs, &attributeMask, &uniformMask, &vsFlags[i], &genErrorString);
+			} else if (i < vsCount + fsCount) {
+				uint64_t uniformMask = 0;
+				stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+				generated = GenerateFragmentShader(fsIDs[i - vsCount], buffer.get(), compat_, bugs, &uniformMask, &fsFlags[i - vsCount], &genErrorString);
+			} else {
+				stage = VK_SHADER_STAGE_GEOMETRY_BIT;
+				generated = GenerateGeometryShader(gsIDs[i - vsCount - fsCount], buffer.get(), compat_, bugs, &genErrorString);
+			}
+			if (!generated) {
+				ERROR_LOG(G3D, "Failed to generate shader during cache load");
 				// We just ignore this one and carry on.
 				failCount++;
 				continue;
 			}
-			_assert_msg_(strlen(codeBuffer_) < CODE_BUFFER_SIZE, "GS length error: %d", (int)strlen(codeBuffer_));
-			if (!gsCache_.ContainsKey(id)) {
-				VulkanGeometryShader *gs = new VulkanGeometryShader(vulkan, id, codeBuffer_);
-				gsCache_.Insert(id, gs);
+			_assert_msg_(strlen(buffer.get()) < CODE_BUFFER_SIZE, "Shader length error: %d", (int)strlen(buffer.get()));
+			sources[i] = buffer.get();
+
+			// If this fails, the error gets reported when the shader is created below.
+			const SpirvCache::Key key = SpirvCache::MakeKey((uint32_t)stage, sources[i].c_str());
+			std::vector<uint32_t> spirv;
+			std::string errorMessage;
+			if (!spirvCache_.Contains(key) && GLSLtoSPV(stage, sources[i].c_str(), GLSLVariant::VULKAN, spirv, &errorMessage)) {
+				spirvCache_.Put(key, spirv);
+				compileCount++;
 			}
 		}
+	}, 0, total, 1);
+
+	VulkanContext *vulkan = (VulkanContext *)draw_->GetNativeObject(Draw::NativeObject::CONTEXT);
+	for (int i = 0; i < total; i++) {
+		if (sources[i].empty())
+			continue;
+		// Don't add the new shader if already compiled - though this should no longer happen.
+		if (i < vsCount) {
+			const VShaderID &id = vsIDs[i];
+			if (!vsCache_.ContainsKey(id))
+				vsCache_.Insert(id, new VulkanVertexShader(vulkan, id, vsFlags[i], sources[i].c_str(), id.Bit(VS_BIT_USE_HW_TRANSFORM), &spirvCache_));
+		} else if (i < vsCount + fsCount) {
+			const FShaderID &id = fsIDs[i - vsCount];
+			if (!fsCache_.ContainsKey(id))
+				fsCache_.Insert(id, new VulkanFragmentShader(vulkan, id, fsFlags[i - vsCount], sources[i].c_str(), &spirvCache_));
+		} else {
+			const GShaderID &id = gsIDs[i - vsCount - fsCount];
+			if (!gsCache_.ContainsKey(id))
+				gsCache_.Insert(id, new VulkanGeometryShader(vulkan, id, sources[i].c_str(), &spirvCache_));
+		}
 	}
 
-	NOTICE_LOG(G3D, "ShaderCache: Loaded %d vertex, %d fragment shaders and %d geometry shaders (failed %d)", header.numVertexShaders, header.numFragmentShaders, header.numGeometryShaders, failCount);
-	return true;
+	NOTICE_LOG(G3D, "ShaderCache: Loaded %d vertex, %d fragment shaders and %d geometry shaders (failed %d, compiled %d) in %0.1f ms", vsCount, fsCount, (int)gsIDs.size(), (int)failCount, (int)compileCount, (time_now_d() - start) * 1000.0);
+}
+
+template <typename ID>
+static std::vector<ID> SortedProfileIDs(const ShaderProfile &profile, ShaderProfile::Kind kind) {
+	std::vector<ID> ids;
+	for (const auto &entry : profile.Sorted(kind)) {
+		if (entry.first.size() != sizeof(ID))
+			continue;
+		ID id;
+		memcpy(&id, entry.first.data(), sizeof(ID));
+		ids.push_back(id);
+	}
+	return ids;
+}
+
+void ShaderManagerVulkan::WarmUpFromProfile(const ShaderProfile &profile) {
+	std::vector<GShaderID> gsIDs;
+	if (gstate_c.Use(GPU_USE_GS_CULLING))
+		gsIDs = SortedProfileIDs<GShaderID>(profile, ShaderProfile::Kind::GEOMETRY_SHADER);
+	WarmUp(SortedProfileIDs<VShaderID>(profile, ShaderProfile::Kind::VERTEX_SHADER), SortedProfileIDs<FShaderID>(profile, ShaderProfile::Kind::FRAGMENT_SHADER), gsIDs);
+}
+
+void ShaderManagerVulkan::ExportProfile(ShaderProfile *profile) const {
+	vsCache_.Iterate([&](const VShaderID &id, VulkanVertexShader *vs) {
+		profile->Add(ShaderProfile::Kind::VERTEX_SHADER, &id, sizeof(id), vs->Usage());
+	});
+	fsCache_.Iterate([&](const FShaderID &id, VulkanFragmentShader *fs) {
+		profile->Add(ShaderProfile::Kind::FRAGMENT_SHADER, &id, sizeof(id), fs->Usage());
+	});
+	gsCache_.Iterate([&](const GShaderID &id, VulkanGeometryShader *gs) {
+		profile->Add(ShaderProfile::Kind::GEOMETRY_SHADER, &id, sizeof(id), gs->Usage());
+	});
 }
 
 void ShaderManagerVulkan::SaveCache(FILE *f, DrawEngineVulkan *drawEngine) {
@@ -639,15 +739,16 @@ void ShaderManagerVulkan::SaveCache(FILE *f, DrawEngineVulkan *drawEngine) {
 	header.numFragmentShaders = (int)fsCache_.size();
 	header.numGeometryShaders = (int)gsCache_.size();
 	bool writeFailed = fwrite(&header, sizeof(header), 1, f) != 1;
-	vsCache_.Iterate([&](const VShaderID &id, VulkanVertexShader *vs) {
-		writeFailed = writeFailed || fwrite(&id, sizeof(id), 1, f) != 1;
-	});
-	fsCache_.Iterate([&](const FShaderID &id, VulkanFragmentShader *fs) {
-		writeFailed = writeFailed || fwrite(&id, sizeof(id), 1, f) != 1;
-	});
-	gsCache_.Iterate([&](const GShaderID &id, VulkanGeometryShader *gs) {
-		writeFailed = writeFailed || fwrite(&id, sizeof(id), 1, f) != 1;
-	});
+
+	// Write the IDs hottest first, so they're also compiled in that order next time.
+	ShaderProfile profile;
+	ExportProfile(&profile);
+	for (auto kind : { ShaderProfile::Kind::VERTEX_SHADER, ShaderProfile::Kind::FRAGMENT_SHADER, ShaderProfile::Kind::GEOMETRY_SHADER }) {
+		for (const auto &entry : profile.Sorted(kind)) {
+			writeFailed = writeFailed || fwrite(entry.first.data(), entry.first.size(), 1, f) != 1;
+		}
+	}
+	writeFailed = writeFailed || !spirvCache_.Save(f);
 	if (writeFailed) {
 		ERROR_LOG(G3D, "Failed to write Vulkan shader cache, disk full?");
 	} else {
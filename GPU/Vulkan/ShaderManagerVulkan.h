@@ -38,7 +38,7 @@ class VulkanPushPool;
 
 class VulkanFragmentShader {
 public:
-	VulkanFragmentShader(VulkanContext *vulkan, FShaderID id, FragmentShaderFlags flags, const char *code);
+	VulkanFragmentShader(VulkanContext *vulkan, FShaderID id, FragmentShaderFlags flags, const char *code, SpirvCache *spirvCache = nullptr);
 	~VulkanFragmentShader();
 
 	const std::string &source() const { return source_; }
@@ -49,6 +49,9 @@ class VulkanFragmentShader {
 
 	FragmentShaderFlags Flags() const { return flags_;  }
 
+	void RecordUse(uint32_t frame) { usage_.Record(frame); }
+	const ShaderUsage &Usage() const { return usage_; }
+
 protected:	
 	Promise<VkShaderModule> *module_ = nullptr;
 
@@ -57,11 +60,12 @@ class VulkanFragmentShader {
 	bool failed_ = false;
 	FShaderID id_;
 	FragmentShaderFlags flags_;
+	ShaderUsage usage_;
 };
 
 class VulkanVertexShader {
 public:
-	VulkanVertexShader(VulkanContext *vulkan, VShaderID id, VertexShaderFlags flags, const char *code, bool useHWTransform);
+	VulkanVertexShader(VulkanContext *vulkan, VShaderID id, VertexShaderFlags flags, const char *code, bool useHWTransform, SpirvCache *spirvCache = nullptr);
 	~VulkanVertexShader();
 
 	const std::string &source() const { return source_; }
@@ -73,6 +77,9 @@ class VulkanVertexShader {
 	Promise<VkShaderModule> *GetModule() { return module_; }
 	const VShaderID &GetID() const { return id_; }
 
+	void RecordUse(uint32_t frame) { usage_.Record(frame); }
+	const ShaderUsage &Usage() const { return usage_; }
+
 protected:
 	Promise<VkShaderModule> *module_ = nullptr;
 
@@ -81,11 +88,12 @@ class VulkanVertexShader {
 	bool useHWTransform_;
 	VShaderID id_;
 	VertexShaderFlags flags_;
+	ShaderUsage usage_;
 };
 
 class VulkanGeometryShader {
 public:
-	VulkanGeometryShader(VulkanContext *vulkan, GShaderID id, const char *code);
+	VulkanGeometryShader(VulkanContext *vulkan, GShaderID id, const char *code, SpirvCache *spirvCache = nullptr);
 	~VulkanGeometryShader();
 
 	const std::string &source() const { return source_; }
@@ -95,12 +103,16 @@ class VulkanGeometryShader {
 	Promise<VkShaderModule> *GetModule() const { return module_; }
 	const GShaderID &GetID() { return id_; }
 
+	void RecordUse(uint32_t frame) { usage_.Record(frame); }
+	const ShaderUsage &Usage() const { return usage_; }
+
 protected:
 	Promise<VkShaderModule> *module_ = nullptr;
 
 	VulkanContext *vulkan_;
 	std::string source_;
 	GShaderID id_;
+	ShaderUsage usage_;
 };
 
 class ShaderManagerVulkan : public ShaderManagerCommon {
@@ -114,6 +126,8 @@ class ShaderManagerVulkan : public ShaderManagerCommon {
 	void GetShaders(int prim, VertexDecoder *decoder, VulkanVertexShader **vshader, VulkanFragmentShader **fshader, VulkanGeometryShader **gshader, const ComputedPipelineState &pipelineState, bool useHWTransform, bool useHWTessellation, bool weightsAsFloat, bool useSkinInDecode);
 	void ClearShaders() override;
 	void DirtyLastShader() override;
+	// Counts a draw with the shaders from the last GetShaders(), for the profile.
+	void RecordDraw(uint32_t frame);
 
 	int GetNumVertexShaders() const { return (int)vsCache_.size(); }
 	int GetNumFragmentShaders() const { return (int)fsCache_.size(); }
@@ -150,12 +164,19 @@ class ShaderManagerVulkan : public ShaderManagerCommon {
 		return dest->Push(&ub_bones, sizeof(ub_bones), uboAlignment_, buf);
 	}
 
+	static uint32_t GetCacheVersion();
 	static bool LoadCacheFlags(FILE *f, DrawEngineVulkan *drawEngine);
 	bool LoadCache(FILE *f);
 	void SaveCache(FILE *f, DrawEngineVulkan *drawEngine);
 
+	// Adds this session's shader usage to profile.
+	void ExportProfile(ShaderProfile *profile) const;
+	// Compiles the shaders in profile, hottest first.  For a cold start without a cache.
+	void WarmUpFromProfile(const ShaderProfile &profile);
+
 private:
 	void Clear();
+	void WarmUp(const std::vector<VShaderID> &vsIDs, const std::vector<FShaderID> &fsIDs, const std::vector<GShaderID> &gsIDs);
 
 	ShaderLanguageDesc compat_;
 
@@ -170,6 +191,9 @@ class ShaderManagerVulkan : public ShaderManagerCommon {
 
 	char *codeBuffer_;
 
+	// Compiled SPIR-V for the shaders above, saved with the cache so we can skip glslang next boot.
+	SpirvCache spirvCache_;
+
 	uint64_t uboAlignment_;
 	// Uniform block scratchpad. These (the relevant ones) are copied to the current pushbuffer at draw time.
 	UB_VS_FS_Base ub_base;
@@ -25,6 +25,7 @@
 #include "Common/GPU/thin3d.h"
 #include "Common/Thread/ThreadManager.h"
 #include "Common/File/VFS/VFS.h"
+#include "Common/File/DirListing.h"
 #include "Common/File/FileUtil.h"
 #include "Common/File/Path.h"
 #include "Common/Render/ManagedTexture.h"
@@ -40,6 +41,7 @@
 #include "Core/Util/GameManager.h"
 #include "Core/Config.h"
 #include "UI/GameInfoCache.h"
+#include "ext/xxhash.h"
 
 GameInfoCache *g_gameInfoCache;
 
@@ -423,13 +425,186 @@ static bool ReadVFSToString(const char *filename, std::string *contents, std::mu
 	return true;
 }
 
+// PARAM.SFO and icons of games are also kept on disk between runs, so that the game list doesn't
+// need to open every game again (possibly on slow network storage) each time it's shown.
+// Entries are keyed on the path and invalidated when the file's size or modification time changes.
+static const uint32_t GAMEINFO_DISK_CACHE_MAGIC = 0x464E4947;  // GINF
+static const uint32_t GAMEINFO_DISK_CACHE_VERSION = 1;
+// Entries of games that were moved or deleted are never read again, so the oldest get pruned past this.
+static const size_t GAMEINFO_DISK_CACHE_MAX_ENTRIES = 1024;
+
+struct GameInfoDiskEntry {
+	IdentifiedFileType fileType = IdentifiedFileType::UNKNOWN;
+	std::string paramSFO;
+	std::string icon;
+};
+
+struct GameInfoDiskKey {
+	Path cachePath;
+	uint64_t size = 0;
+	uint64_t mtime = 0;
+};
+
+static bool IsDiskCacheable(IdentifiedFileType fileType) {
+	switch (fileType) {
+	case IdentifiedFileType::PSP_ISO:
+	case IdentifiedFileType::PSP_ISO_NP:
+	case IdentifiedFileType::PSP_PBP:
+		return true;
+	default:
+		// Directories can change without their own mtime changing, and the rest is cheap anyway.
+		return false;
+	}
+}
+
+static bool GetDiskCacheKey(const Path &gamePath, GameInfoDiskKey *key) {
+	if (gamePath.Type() != PathType::NATIVE && gamePath.Type() != PathType::CONTENT_URI)
+		return false;
+	File::FileInfo fileInfo;
+	if (!File::GetFileInfo(gamePath, &fileInfo) || !fileInfo.exists || fileInfo.isDirectory)
+		return false;
+	const std::string &pathStr = gamePath.ToString();
+	uint64_t hash = XXH3_64bits(pathStr.data(), pathStr.size());
+	key->cachePath = GetSysDirectory(DIRECTORY_APP_CACHE) / "gameinfo" / StringFromFormat("%016llx.ginfo", (unsigned long long)hash);
+	key->size = fileInfo.size;
+	key->mtime = fileInfo.mtime;
+	return true;
+}
+
+static void AppendU32(std::string *out, uint32_t value) {
+	out->append((const char *)&value, sizeof(value));
+}
+
+static void AppendU64(std::string *out, uint64_t value) {
+	out->append((const char *)&value, sizeof(value));
+}
+
+static void AppendBlob(std::string *out, const std::string &blob) {
+	AppendU32(out, (uint32_t)blob.size());
+	out->append(blob);
+}
+
+static bool ReadU32(const std::string &data, size_t *pos, uint32_t *value) {
+	if (data.size() - *pos < sizeof(*value))
+		return false;
+	memcpy(value, data.data() + *pos, sizeof(*value));
+	*pos += sizeof(*value);
+	return true;
+}
+
+static bool ReadU64(const std::string &data, size_t *pos, uint64_t *value) {
+	if (data.size() - *pos < sizeof(*value))
+		return false;
+	memcpy(value, data.data() + *pos, sizeof(*value));
+	*pos += sizeof(*value);
+	return true;
+}
+
+static bool ReadBlob(const std::string &data, size_t *pos, std::string *blob) {
+	uint32_t size;
+	if (!ReadU32(data, pos, &size) || data.size() - *pos < size)
+		return false;
+	blob->assign(data, *pos, size);
+	*pos += size;
+	return true;
+}
+
+static bool ReadDiskCacheEntry(const Path &gamePath, const GameInfoDiskKey &key, GameInfoDiskEntry *entry) {
+	std::string data;
+	if (!File::ReadBinaryFileToString(key.cachePath, &data))
+		return false;
+
+	size_t pos = 0;
+	uint32_t magic, version, fileType;
+	uint64_t size, mtime;
+	std::string path;
+	if (!ReadU32(data, &pos, &magic) || !ReadU32(data, &pos, &version) || !ReadU64(data, &pos, &size) || !ReadU64(data, &pos, &mtime))
+		return false;
+	if (magic != GAMEINFO_DISK_CACHE_MAGIC || version != GAMEINFO_DISK_CACHE_VERSION || size != key.size || mtime != key.mtime)
+		return false;
+	// The path is stored too, in case of a hash collision.
+	if (!ReadBlob(data, &pos, &path) || path != gamePath.ToString())
+		return false;
+	if (!ReadU32(data, &pos, &fileType) || !ReadBlob(data, &pos, &entry->paramSFO) || !ReadBlob(data, &pos, &entry->icon))
+		return false;
+	entry->fileType = (IdentifiedFileType)fileType;
+	return IsDiskCacheable(entry->fileType);
+}
+
+static void PruneDiskCache(const Path &cacheDir) {
+	std::vector<File::FileInfo> files;
+	File::GetFilesInDir(cacheDir, &files, "ginfo");
+	if (files.size() <= GAMEINFO_DISK_CACHE_MAX_ENTRIES)
+		return;
+
+	std::sort(files.begin(), files.end(), [](const File::FileInfo &a, const File::FileInfo &b) {
+		return a.mtime < b.mtime;
+	});
+	size_t excess = files.size() - GAMEINFO_DISK_CACHE_MAX_ENTRIES;
+	INFO_LOG(LOADER, "Pruning %d old game info cache entries", (int)excess);
+	for (size_t i = 0; i < excess; ++i) {
+		File::Delete(files[i].fullName);
+	}
+}
+
+static void WriteDiskCacheEntry(const Path &gamePath, const GameInfoDiskKey &key, const GameInfoDiskEntry &entry) {
+	std::string data;
+	AppendU32(&data, GAMEINFO_DISK_CACHE_MAGIC);
+	AppendU32(&data, GAMEINFO_DISK_CACHE_VERSION);
+	AppendU64(&data, key.size);
+	AppendU64(&data, key.mtime);
+	AppendBlob(&data, gamePath.ToString());
+	AppendU32(&data, (uint32_t)entry.fileType);
+	AppendBlob(&data, entry.paramSFO);
+	AppendBlob(&data, entry.icon);
+
+	const Path cacheDir = key.cachePath.NavigateUp();
+	File::CreateFullPath(cacheDir);
+	// Only new entries grow the cache, so once per run when writing is enough.
+	static std::once_flag pruneOnce;
+	std::call_once(pruneOnce, [&] { PruneDiskCache(cacheDir); });
+	// Write to a temporary first, so another scan never sees a partial entry.
+	Path tempPath = key.cachePath.WithExtraExtension(".tmp");
+	if (!File::WriteDataToFile(false, data.data(), data.size(), tempPath) || !File::Rename(tempPath, key.cachePath)) {
+		WARN_LOG(LOADER, "Failed to write game info cache entry for %s", gamePath.c_str());
+		File::Delete(tempPath);
+	}
+}
+
+// Keeps the game info loads queued, and only runs a few of them at a time. That keeps a large
+// game list from flooding the IO threads, and lets us pick the most recently requested game
+// next, which are the ones that are visible.
+class GameInfoScanner : public std::enable_shared_from_this<GameInfoScanner> {
+public:
+	void Queue(const Path &gamePath, std::shared_ptr<GameInfo> &info, GameInfoFlags flags);
+	void Finished();
+	void Clear();
+
+private:
+	void PumpLocked();
+
+	struct PendingScan {
+		Path gamePath;
+		std::shared_ptr<GameInfo> info;
+		GameInfoFlags flags;
+	};
+
+	std::mutex lock_;
+	std::vector<PendingScan> pending_;
+	int active_ = 0;
+};
+
+// Enough to keep network storage busy, while leaving IO threads for everything else.
+static const int MAX_PARALLEL_GAMEINFO_SCANS = 4;
+
 class GameInfoWorkItem : public Task {
 public:
-	GameInfoWorkItem(const Path &gamePath, std::shared_ptr<GameInfo> &info, GameInfoFlags flags)
-		: gamePath_(gamePath), info_(info), flags_(flags) {}
+	GameInfoWorkItem(const Path &gamePath, std::shared_ptr<GameInfo> &info, GameInfoFlags flags, std::shared_ptr<GameInfoScanner> scanner)
+		: gamePath_(gamePath), info_(info), flags_(flags), scanner_(scanner) {}
 
 	~GameInfoWorkItem() {
 		info_->DisposeFileLoader();
+		scanner_->Finished();
 	}
 
 	TaskType Type() const override {
@@ -449,6 +624,16 @@ class GameInfoWorkItem : public Task {
 	}
 
 	void Run() override {
+		GameInfoDiskKey diskKey;
+		bool hasDiskKey = (flags_ & (GameInfoFlags::PARAM_SFO | GameInfoFlags::ICON)) && GetDiskCacheKey(gamePath_, &diskKey);
+		if (hasDiskKey) {
+			LoadFromDiskCache(diskKey);
+			if (flags_ == (GameInfoFlags)0) {
+				// Everything came from the cache, no need to even open the file.
+				return;
+			}
+		}
+
 		// An early-return will result in the destructor running, where we can set
 		// flags like working and pending.
 		if (!info_->CreateLoader() || !info_->GetFileLoader() || !info_->GetFileLoader()->Exists()) {
@@ -503,6 +688,7 @@ class GameInfoWorkItem : public Task {
 							info_->region = GAMEREGION_MAX + 1; // Homebrew
 						}
 						info_->MarkReadyNoLock(GameInfoFlags::PARAM_SFO);
+						sfoFromGame_ = true;
 					}
 				}
 
@@ -511,6 +697,7 @@ class GameInfoWorkItem : public Task {
 					if (pbp.GetSubFileSize(PBP_ICON0_PNG) > 0) {
 						std::lock_guard<std::mutex> lock(info_->lock);
 						pbp.GetSubFileAsString(PBP_ICON0_PNG, &info_->icon.data);
+						iconFromGame_ = true;
 					} else {
 						Path screenshot_jpg = GetSysDirectory(DIRECTORY_SCREENSHOT) / (info_->id + "_00000.jpg");
 						Path screenshot_png = GetSysDirectory(DIRECTORY_SCREENSHOT) / (info_->id + "_00000.png");
@@ -701,6 +888,7 @@ class GameInfoWorkItem : public Task {
 							// quick-update the info while we have the lock, so we don't need to wait for the image load to display the title.
 							info_->MarkReadyNoLock(GameInfoFlags::PARAM_SFO);
 						}
+						sfoFromGame_ = true;
 					}
 				}
 
@@ -729,6 +917,7 @@ class GameInfoWorkItem : public Task {
 						}
 					} else {
 						info_->icon.dataLoaded = true;
+						iconFromGame_ = true;
 					}
 				}
 				break;
@@ -775,6 +964,10 @@ class GameInfoWorkItem : public Task {
 			info_->gameSizeUncompressed = info_->GetGameSizeUncompressedInBytes();
 		}
 
+		if (hasDiskKey && (sfoFromGame_ || iconFromGame_) && IsDiskCacheable(info_->fileType)) {
+			SaveToDiskCache(diskKey);
+		}
+
 		// Time to update the flags.
 		std::unique_lock<std::mutex> lock(info_->lock);
 		info_->MarkReadyNoLock(flags_);
@@ -782,14 +975,125 @@ class GameInfoWorkItem : public Task {
 	}
 
 private:
+	// Takes whatever the disk cache has out of flags_.
+	void LoadFromDiskCache(const GameInfoDiskKey &key) {
+		GameInfoDiskEntry entry;
+		if (!ReadDiskCacheEntry(gamePath_, key, &entry))
+			return;
+
+		GameInfoFlags found = GameInfoFlags::FILE_TYPE;
+		{
+			std::lock_guard<std::mutex> lock(info_->lock);
+			info_->fileType = entry.fileType;
+			if ((flags_ & GameInfoFlags::PARAM_SFO) && !entry.paramSFO.empty()) {
+				info_->paramSFO.ReadSFO((const u8 *)entry.paramSFO.data(), entry.paramSFO.size());
+				info_->ParseParamSFO();
+				found |= GameInfoFlags::PARAM_SFO;
+			}
+			if ((flags_ & GameInfoFlags::ICON) && !entry.icon.empty()) {
+				info_->icon.data = std::move(entry.icon);
+				found |= GameInfoFlags::ICON;
+			}
+		}
+		if (found & GameInfoFlags::ICON) {
+			info_->icon.dataLoaded = true;
+		}
+		if (found & GameInfoFlags::PARAM_SFO) {
+			info_->hasConfig = g_Config.hasGameConfig(info_->id);
+		}
+
+		std::lock_guard<std::mutex> lock(info_->lock);
+		info_->MarkReadyNoLock(found);
+		flags_ &= ~found;
+	}
+
+	void SaveToDiskCache(const GameInfoDiskKey &key) {
+		// Keep what an earlier scan stored, if we only loaded part of it this time.
+		GameInfoDiskEntry entry;
+		if (!ReadDiskCacheEntry(gamePath_, key, &entry))
+			entry = GameInfoDiskEntry();
+
+		{
+			std::lock_guard<std::mutex> lock(info_->lock);
+			entry.fileType = info_->fileType;
+			if (sfoFromGame_) {
+				u8 *sfoData = nullptr;
+				size_t sfoSize = 0;
+				info_->paramSFO.WriteSFO(&sfoData, &sfoSize);
+				entry.paramSFO.assign((const char *)sfoData, sfoSize);
+				delete[] sfoData;
+			}
+			if (iconFromGame_) {
+				entry.icon = info_->icon.data;
+			}
+		}
+		WriteDiskCacheEntry(gamePath_, key, entry);
+	}
+
 	Path gamePath_;
 	std::shared_ptr<GameInfo> info_;
 	GameInfoFlags flags_{};
+	std::shared_ptr<GameInfoScanner> scanner_;
+	bool sfoFromGame_ = false;
+	bool iconFromGame_ = false;
 
 	DISALLOW_COPY_AND_ASSIGN(GameInfoWorkItem);
 };
 
-GameInfoCache::GameInfoCache() {
+void GameInfoScanner::Queue(const Path &gamePath, std::shared_ptr<GameInfo> &info, GameInfoFlags flags) {
+	std::lock_guard<std::mutex> guard(lock_);
+	bool merged = false;
+	for (auto &scan : pending_) {
+		if (scan.info == info) {
+			scan.flags |= flags;
+			merged = true;
+			break;
+		}
+	}
+	if (!merged)
+		pending_.push_back(PendingScan{ gamePath, info, flags });
+	PumpLocked();
+}
+
+void GameInfoScanner::Finished() {
+	std::lock_guard<std::mutex> guard(lock_);
+	active_--;
+	PumpLocked();
+}
+
+void GameInfoScanner::Clear() {
+	std::lock_guard<std::mutex> guard(lock_);
+	for (auto &scan : pending_) {
+		// Nobody is going to load these now.  They never ran, so they aren't ready, just no longer pending.
+		std::lock_guard<std::mutex> infoLock(scan.info->lock);
+		scan.info->pendingFlags &= ~scan.flags;
+	}
+	pending_.clear();
+}
+
+void GameInfoScanner::PumpLocked() {
+	while (active_ < MAX_PARALLEL_GAMEINFO_SCANS && !pending_.empty()) {
+		// GetInfo() is called every frame for what's on screen, so the most recently accessed
+		// are what the user is looking at.
+		size_t best = 0;
+		double bestTime = -1.0;
+		for (size_t i = 0; i < pending_.size(); ++i) {
+			std::lock_guard<std::mutex> infoLock(pending_[i].info->lock);
+			if (pending_[i].info->lastAccessedTime > bestTime) {
+				bestTime = pending_[i].info->lastAccessedTime;
+				best = i;
+			}
+		}
+		PendingScan scan = std::move(pending_[best]);
+		pending_[best] = std::move(pending_.back());
+		pending_.pop_back();
+
+		active_++;
+		g_threadManager.EnqueueTask(new GameInfoWorkItem(scan.gamePath, scan.info, scan.flags, shared_from_this()));
+	}
+}
+
+GameInfoCache::GameInfoCache() : scanner_(std::make_shared<GameInfoScanner>()) {
 	Init();
 }
 
@@ -805,6 +1109,7 @@ void GameInfoCache::Shutdown() {
 }
 
 void GameInfoCache::Clear() {
+	scanner_->Clear();
 	CancelAll();
 
 	std::lock_guard<std::mutex> lock(mapLock_);
@@ -894,19 +1199,18 @@ std::shared_ptr<GameInfo> GameInfoCache::GetInfo(Draw::DrawContext *draw, const
 		mapLock_.unlock();
 
 		info->FinishPendingTextureLoads(draw);
-		info->lastAccessedTime = time_now_d();
 		GameInfoFlags wanted = (GameInfoFlags)0;
 		{
 			// Careful now!
 			std::unique_lock<std::mutex> lock(info->lock);
+			info->lastAccessedTime = time_now_d();
 			GameInfoFlags hasFlags = info->hasFlags | info->pendingFlags;  // We don't want to re-fetch data that we have, so or in pendingFlags.
 			wanted = (GameInfoFlags)((int)wantFlags & ~(int)hasFlags);  // & is reserved for testing. ugh.
 			info->pendingFlags |= wanted;
 		}
 		if (wanted != (GameInfoFlags)0) {
 			// We're missing info that we want. Go get it!
-			GameInfoWorkItem *item = new GameInfoWorkItem(gamePath, info, wanted);
-			g_threadManager.EnqueueTask(item);
+			scanner_->Queue(gamePath, info, wanted);
 		}
 		return info;
 	}
@@ -918,7 +1222,6 @@ std::shared_ptr<GameInfo> GameInfoCache::GetInfo(Draw::DrawContext *draw, const
 	mapLock_.unlock();
 
 	// Just get all the stuff we wanted.
-	GameInfoWorkItem *item = new GameInfoWorkItem(gamePath, info, wantFlags);
-	g_threadManager.EnqueueTask(item);
+	scanner_->Queue(gamePath, info, wantFlags);
 	return info;
 }
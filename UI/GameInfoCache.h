@@ -159,6 +159,7 @@ class GameInfo {
 	std::string sndFileData;
 	std::atomic<bool> sndDataLoaded{};
 
+	// Protected by the mutex, since the scanner reads it from other threads to pick what to load next.
 	double lastAccessedTime = 0.0;
 
 	u64 gameSizeUncompressed = 0;
@@ -180,6 +181,8 @@ class GameInfo {
 	DISALLOW_COPY_AND_ASSIGN(GameInfo);
 };
 
+class GameInfoScanner;
+
 class GameInfoCache {
 public:
 	GameInfoCache();
@@ -207,6 +210,10 @@ class GameInfoCache {
 	// and if they get destructed while being in use, that's bad.
 	std::map<std::string, std::shared_ptr<GameInfo> > info_;
 	std::mutex mapLock_;
+
+	// Limits how many games are loaded at once, and picks the most recently requested
+	// (that is, visible) ones first. Shared with the work items, which may outlive us.
+	std::shared_ptr<GameInfoScanner> scanner_;
 };
 
 // This one can be global, no good reason not to.
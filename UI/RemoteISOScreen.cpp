@@ -50,7 +50,7 @@ using namespace UI;
 static const char *REPORT_HOSTNAME = "report.ppsspp.org";
 static const int REPORT_PORT = 80;
 
-static bool scanCancelled = false;
+static std::atomic<bool> scanCancelled{};
 static bool scanAborted = false;
 
 enum class ServerAllowStatus {
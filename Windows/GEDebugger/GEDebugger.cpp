@@ -1224,7 +1224,8 @@ BOOL CGEDebugger::DlgProc(UINT message, WPARAM wParam, LPARAM lParam) {
 		case IDC_GEDBG_RECORD:
 			GPURecord::RecordNextFrame([](const Path &path) {
 				// Opens a Windows Explorer window with the file, when done.
-				System_ShowFileInFolder(path);
+				if (!path.empty())
+					System_ShowFileInFolder(path);
 			});
 			break;
 
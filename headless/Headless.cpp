@@ -5,6 +5,7 @@
 // > --root pspautotests/tests/../ --compare --timeout=5 --graphics=software pspautotests/tests/cpu/cpu_alu/cpu_alu.prx
 
 #include "ppsspp_config.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <limits>
@@ -24,12 +25,15 @@
 #include <csignal>
 #endif
 #include "Common/CPUDetect.h"
+#include "Common/Data/Format/JSONWriter.h"
+#include "Common/File/DirListing.h"
 #include "Common/File/VFS/VFS.h"
 #include "Common/File/VFS/ZipFileReader.h"
 #include "Common/File/VFS/DirectoryReader.h"
 #include "Common/File/FileUtil.h"
 #include "Common/GraphicsContext.h"
 #include "Common/TimeUtil.h"
+#include "Common/StringUtils.h"
 #include "Common/Thread/ThreadManager.h"
 #include "Core/Config.h"
 #include "Core/ConfigValues.h"
@@ -37,9 +41,11 @@
 #include "Core/CoreTiming.h"
 #include "Core/System.h"
 #include "Core/WebServer.h"
+#include "Core/HLE/HLE.h"
 #include "Core/HLE/sceUtility.h"
 #include "Core/SaveState.h"
 #include "GPU/Common/FramebufferManagerCommon.h"
+#include "GPU/Debugger/Playback.h"
 #include "Log.h"
 #include "LogManager.h"
 
@@ -172,6 +178,11 @@ int printUsage(const char *progname, const char *reason)
 	fprintf(stderr, "  -j                    use jit (default)\n");
 	fprintf(stderr, "  -c, --compare         compare with output in file.expected\n");
 	fprintf(stderr, "  --bench               run multiple times and output speed\n");
+	fprintf(stderr, "  --bench-dumps=DIR     replay each GE dump (.ppdmp) in DIR and report timings as JSON\n");
+	fprintf(stderr, "                        uses software and null, unless --graphics is specified\n");
+	fprintf(stderr, "  --bench-runs=N        replay each dump N times per backend (default 5)\n");
+	fprintf(stderr, "  --bench-json=FILE     write the dump benchmark JSON to FILE instead of stdout\n");
+	fprintf(stderr, "  --syscall-profile     print syscall counts and timings after each test\n");
 	fprintf(stderr, "\nSee headless.txt for details.\n");
 
 	return 1;
@@ -180,6 +191,7 @@ int printUsage(const char *progname, const char *reason)
 static HeadlessHost *getHost(GPUCore gpuCore) {
 	switch (gpuCore) {
 	case GPUCORE_SOFTWARE:
+	case GPUCORE_NULL:
 		return new HeadlessHost();
 #ifdef HEADLESSHOST_CLASS
 	default:
@@ -197,8 +209,30 @@ struct AutoTestOptions {
 	bool compare : 1;
 	bool verbose : 1;
 	bool bench : 1;
+	bool syscallProfile : 1;
 };
 
+static void PrintSyscallProfile() {
+	std::vector<HLESyscallProfile> profile = hleGetSyscallProfile();
+	fprintf(stderr, "Syscall profile for %s:\n", currentTestName.c_str());
+	fprintf(stderr, "  %-40s %10s %12s %10s %10s\n", "function", "calls", "total ms", "avg us", "max us");
+	for (const auto &info : profile) {
+		std::string name = StringFromFormat("%s::%s", info.module, info.name);
+		fprintf(stderr, "  %-40s %10llu %12.3f %10.3f %10.3f\n", name.c_str(), (unsigned long long)info.calls, info.totalNs / 1000000.0, info.totalNs / 1000.0 / info.calls, info.maxNs / 1000.0);
+
+		// Compact log2 histogram, only the populated range.
+		int first = 0, last = HLE_SYSCALL_HISTOGRAM_BUCKETS - 1;
+		while (first < last && info.histogram[first] == 0)
+			first++;
+		while (last > first && info.histogram[last] == 0)
+			last--;
+		std::string buckets;
+		for (int b = first; b <= last; ++b)
+			buckets += StringFromFormat(" %u", info.histogram[b]);
+		fprintf(stderr, "    ns buckets from 2^%d:%s\n", first, buckets.c_str());
+	}
+}
+
 bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, const AutoTestOptions &opt) {
 	// Kinda ugly, trying to guesstimate the test name from filename...
 	currentTestName = GetTestName(coreParameter.fileToStart);
@@ -271,6 +305,9 @@ bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, const
 	}
 	PSP_EndHostFrame();
 
+	if (opt.syscallProfile)
+		PrintSyscallProfile();
+
 	if (draw) {
 		draw->BindFramebufferAsRenderTarget(nullptr, { Draw::RPAction::CLEAR, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE }, "Headless");
 		// Vulkan may get angry if we don't do a final present.
@@ -293,6 +330,193 @@ bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, const
 	return passed;
 }
 
+static const char *GPUCoreName(GPUCore core) {
+	switch (core) {
+	case GPUCORE_GLES: return "gles";
+	case GPUCORE_SOFTWARE: return "software";
+	case GPUCORE_DIRECTX9: return "directx9";
+	case GPUCORE_DIRECTX11: return "directx11";
+	case GPUCORE_VULKAN: return "vulkan";
+	case GPUCORE_NULL: return "null";
+	default: return "unknown";
+	}
+}
+
+static double MedianMs(std::vector<double> &seconds) {
+	if (seconds.empty())
+		return 0.0;
+	std::sort(seconds.begin(), seconds.end());
+	size_t mid = seconds.size() / 2;
+	double median = seconds.size() & 1 ? seconds[mid] : (seconds[mid - 1] + seconds[mid]) * 0.5;
+	return median * 1000.0;
+}
+
+// Order matches GPUPhase.  The software renderer rasterizes on other threads, so its RASTERIZE
+// phase is the time spent queueing for and waiting on them, not the rasterization itself.
+static const char *const phaseNames[] = { "vertexDecodeMs", "transformMs", "rasterizeWaitMs", "textureDecodeMs" };
+
+// Which phases actually have timing scopes on each backend, per frame and per draw.  The others
+// would always be zero, so they're left out of the JSON instead.
+static void MeasuredPhases(GPUCore core, std::vector<GPUPhase> *framePhases, std::vector<GPUPhase> *drawPhases) {
+	switch (core) {
+	case GPUCORE_SOFTWARE:
+		// The raster threads are waited on whenever something flushes, which is usually not the
+		// draw that queued the work.  So that's only meaningful per frame.
+		*drawPhases = { GPUPhase::VERTEX_DECODE, GPUPhase::TRANSFORM };
+		*framePhases = { GPUPhase::VERTEX_DECODE, GPUPhase::TRANSFORM, GPUPhase::RASTERIZE };
+		break;
+	case GPUCORE_NULL:
+		// Software without rasterization.
+		*drawPhases = { GPUPhase::VERTEX_DECODE, GPUPhase::TRANSFORM };
+		*framePhases = *drawPhases;
+		break;
+	default:
+		// Hardware backends: shaders do the rest.
+		*drawPhases = { GPUPhase::VERTEX_DECODE, GPUPhase::TEXTURE_DECODE };
+		*framePhases = *drawPhases;
+		break;
+	}
+}
+
+// Medians across runs of one frame's (or draw's) total and phase times, in milliseconds.
+static void MedianTimes(const std::vector<const GPUPhaseTimes *> &runs, double ms[1 + (int)GPUPhase::COUNT]) {
+	std::vector<double> values;
+	values.reserve(runs.size());
+	for (int i = 0; i <= (int)GPUPhase::COUNT; ++i) {
+		values.clear();
+		for (const GPUPhaseTimes *t : runs)
+			values.push_back(i == 0 ? t->total : t->phases[i - 1]);
+		ms[i] = MedianMs(values);
+	}
+}
+
+static bool BenchmarkDump(HeadlessHost *headlessHost, CoreParameter &coreParameter, const AutoTestOptions &opt, int runs, json::JsonWriter &json) {
+	std::vector<std::vector<GPURecord::ReplayFrameTiming>> results;
+	std::vector<double> runTotals;
+	for (int run = 0; run < runs; ++run) {
+		GPURecord::SetReplayTiming(true);
+		bool success = RunAutoTest(headlessHost, coreParameter, opt);
+		GPURecord::SetReplayTiming(false);
+		std::vector<GPURecord::ReplayFrameTiming> frames = GPURecord::TakeReplayTimings();
+		if (!success || frames.empty())
+			return false;
+
+		double total = 0.0;
+		for (const auto &frame : frames)
+			total += frame.frame.total;
+		runTotals.push_back(total);
+		results.push_back(std::move(frames));
+	}
+
+	// Replay is deterministic, so frames and draws line up across runs.
+	size_t frameCount = results[0].size();
+	for (const auto &frames : results)
+		frameCount = std::min(frameCount, frames.size());
+
+	std::vector<GPUPhase> framePhases, drawPhases;
+	MeasuredPhases(coreParameter.gpuCore, &framePhases, &drawPhases);
+
+	json.pushDict();
+	json.writeString("dump", coreParameter.fileToStart.GetFilename());
+	json.writeString("backend", GPUCoreName(coreParameter.gpuCore));
+	json.writeFloat("totalMs", MedianMs(runTotals));
+	json.pushArray("phasesMeasured");
+	for (GPUPhase phase : framePhases)
+		json.writeString(phaseNames[(int)phase]);
+	json.pop();
+	json.pushArray("drawFields");
+	json.writeString("ms");
+	for (GPUPhase phase : drawPhases)
+		json.writeString(phaseNames[(int)phase]);
+	json.pop();
+	json.pushArray("frames");
+
+	std::vector<const GPUPhaseTimes *> samples;
+	double ms[1 + (int)GPUPhase::COUNT];
+	for (size_t f = 0; f < frameCount; ++f) {
+		samples.clear();
+		size_t drawCount = results[0][f].draws.size();
+		for (const auto &frames : results) {
+			samples.push_back(&frames[f].frame);
+			drawCount = std::min(drawCount, frames[f].draws.size());
+		}
+		MedianTimes(samples, ms);
+
+		json.pushDict();
+		json.writeFloat("ms", ms[0]);
+		for (GPUPhase phase : framePhases)
+			json.writeFloat(phaseNames[(int)phase], ms[(int)phase + 1]);
+		json.writeInt("draws", (int)drawCount);
+		// Compact, one array per draw: see "drawFields".
+		json.pushArray("drawMs");
+		for (size_t d = 0; d < drawCount; ++d) {
+			samples.clear();
+			for (const auto &frames : results)
+				samples.push_back(&frames[f].draws[d]);
+			MedianTimes(samples, ms);
+
+			json.pushArray();
+			json.writeFloat(ms[0]);
+			for (GPUPhase phase : drawPhases)
+				json.writeFloat(ms[(int)phase + 1]);
+			json.pop();
+		}
+		json.pop();
+		json.pop();
+	}
+
+	json.pop();
+	json.pop();
+	return true;
+}
+
+// Replays every dump in dir on each backend, and reports median frame and draw timings as JSON.
+static bool RunDumpBenchmark(HeadlessHost *headlessHost, CoreParameter &coreParameter, AutoTestOptions opt, const Path &dir, const std::vector<GPUCore> &backends, int runs, const char *jsonFilename, std::vector<std::string> &failed) {
+	std::vector<File::FileInfo> dumps;
+	File::GetFilesInDir(dir, &dumps, "ppdmp");
+	if (dumps.empty()) {
+		fprintf(stderr, "No GE dumps found in %s\n", dir.c_str());
+		return false;
+	}
+
+	// Keeps the test output quiet, and skips failure screenshots.
+	opt.bench = true;
+	opt.compare = false;
+
+	json::JsonWriter json(json::JsonWriter::PRETTY);
+	json.begin();
+	json.writeInt("runs", runs);
+	json.pushArray("results");
+
+	const GPUCore originalCore = coreParameter.gpuCore;
+	for (GPUCore core : backends) {
+		coreParameter.gpuCore = core;
+		g_Config.bSoftwareRendering = core == GPUCORE_SOFTWARE || core == GPUCORE_NULL;
+		for (const File::FileInfo &dump : dumps) {
+			coreParameter.fileToStart = dump.fullName;
+			if (!BenchmarkDump(headlessHost, coreParameter, opt, runs, json)) {
+				fprintf(stderr, "Failed to replay %s on %s\n", dump.name.c_str(), GPUCoreName(core));
+				failed.push_back(StringFromFormat("%s (%s)", dump.name.c_str(), GPUCoreName(core)));
+			}
+		}
+	}
+	coreParameter.gpuCore = originalCore;
+	g_Config.bSoftwareRendering = originalCore == GPUCORE_SOFTWARE || originalCore == GPUCORE_NULL;
+
+	json.pop();
+	json.end();
+
+	if (!jsonFilename) {
+		printf("%s\n", json.str().c_str());
+		return true;
+	}
+	if (!File::WriteStringToFile(true, json.str(), Path(std::string(jsonFilename)))) {
+		fprintf(stderr, "Failed to write %s\n", jsonFilename);
+		return false;
+	}
+	return true;
+}
+
 std::vector<std::string> ReadFromListFile(const std::string &listFilename) {
 	std::vector<std::string> testFilenames;
 	char temp[2048]{};
@@ -337,6 +561,7 @@ int main(int argc, const char* argv[])
 	bool fullLog = false;
 	const char *stateToLoad = 0;
 	GPUCore gpuCore = GPUCORE_SOFTWARE;
+	bool gpuCoreSpecified = false;
 	CPUCore cpuCore = CPUCore::JIT;
 	int debuggerPort = -1;
 	bool newAtrac = false;
@@ -345,6 +570,9 @@ int main(int argc, const char* argv[])
 	const char *mountIso = nullptr;
 	const char *mountRoot = nullptr;
 	const char *screenshotFilename = nullptr;
+	const char *benchDumpDir = nullptr;
+	const char *benchJsonFilename = nullptr;
+	int benchRuns = 5;
 
 	for (int i = 1; i < argc; i++)
 	{
@@ -374,6 +602,8 @@ int main(int argc, const char* argv[])
 			testOptions.compare = true;
 		else if (!strcmp(argv[i], "--bench"))
 			testOptions.bench = true;
+		else if (!strcmp(argv[i], "--syscall-profile"))
+			testOptions.syscallProfile = true;
 		else if (!strcmp(argv[i], "-v") || !strcmp(argv[i], "--verbose"))
 			testOptions.verbose = true;
 		else if (!strcmp(argv[i], "--new-atrac"))
@@ -381,11 +611,14 @@ int main(int argc, const char* argv[])
 		else if (!strncmp(argv[i], "--graphics=", strlen("--graphics=")) && strlen(argv[i]) > strlen("--graphics="))
 		{
 			const char *gpuName = argv[i] + strlen("--graphics=");
+			gpuCoreSpecified = true;
 			if (!strcasecmp(gpuName, "gles"))
 				gpuCore = GPUCORE_GLES;
-			// There used to be a separate "null" rendering core - just use software.
-			else if (!strcasecmp(gpuName, "software") || !strcasecmp(gpuName, "null"))
+			else if (!strcasecmp(gpuName, "software"))
 				gpuCore = GPUCORE_SOFTWARE;
+			// Same as software, but skips rasterization - for CPU/HLE benchmarks.
+			else if (!strcasecmp(gpuName, "null"))
+				gpuCore = GPUCORE_NULL;
 			else if (!strcasecmp(gpuName, "directx9"))
 				gpuCore = GPUCORE_DIRECTX9;
 			else if (!strcasecmp(gpuName, "directx11"))
@@ -397,6 +630,7 @@ int main(int argc, const char* argv[])
 		}
 		// Default to GLES if no value selected.
 		else if (!strcmp(argv[i], "--graphics")) {
+			gpuCoreSpecified = true;
 #if PPSSPP_API(ANY_GL)
 			gpuCore = GPUCORE_GLES;
 #else
@@ -404,6 +638,12 @@ int main(int argc, const char* argv[])
 #endif
 		} else if (!strncmp(argv[i], "--screenshot=", strlen("--screenshot=")) && strlen(argv[i]) > strlen("--screenshot="))
 			screenshotFilename = argv[i] + strlen("--screenshot=");
+		else if (!strncmp(argv[i], "--bench-dumps=", strlen("--bench-dumps=")) && strlen(argv[i]) > strlen("--bench-dumps="))
+			benchDumpDir = argv[i] + strlen("--bench-dumps=");
+		else if (!strncmp(argv[i], "--bench-runs=", strlen("--bench-runs=")) && strlen(argv[i]) > strlen("--bench-runs="))
+			benchRuns = std::max(1, (int)strtol(argv[i] + strlen("--bench-runs="), nullptr, 10));
+		else if (!strncmp(argv[i], "--bench-json=", strlen("--bench-json=")) && strlen(argv[i]) > strlen("--bench-json="))
+			benchJsonFilename = argv[i] + strlen("--bench-json=");
 		else if (!strncmp(argv[i], "--timeout=", strlen("--timeout=")) && strlen(argv[i]) > strlen("--timeout="))
 			testOptions.timeout = strtod(argv[i] + strlen("--timeout="), nullptr);
 		else if (!strncmp(argv[i], "--max-mse=", strlen("--max-mse=")) && strlen(argv[i]) > strlen("--max-mse="))
@@ -423,7 +663,7 @@ int main(int argc, const char* argv[])
 	if (testFilenames.size() == 1 && testFilenames[0][0] == '@')
 		testFilenames = ReadFromListFile(testFilenames[0].substr(1));
 
-	if (testFilenames.empty())
+	if (testFilenames.empty() && !benchDumpDir)
 		return printUsage(argv[0], argc <= 1 ? NULL : "No executables specified");
 
 	LogManager::Init(&g_Config.bEnableLogging);
@@ -450,7 +690,7 @@ int main(int argc, const char* argv[])
 
 	CoreParameter coreParameter;
 	coreParameter.cpuCore = cpuCore;
-	coreParameter.gpuCore = glWorking ? gpuCore : GPUCORE_SOFTWARE;
+	coreParameter.gpuCore = glWorking || gpuCore == GPUCORE_NULL ? gpuCore : GPUCORE_SOFTWARE;
 	coreParameter.graphicsContext = graphicsContext;
 	coreParameter.enableSound = false;
 	coreParameter.mountIso = mountIso ? Path(std::string(mountIso)) : Path();
@@ -488,7 +728,8 @@ int main(int argc, const char* argv[])
 	g_Config.bEnableLogging = fullLog;
 	g_Config.bSoftwareSkinning = true;
 	g_Config.bVertexDecoderJit = true;
-	g_Config.bSoftwareRendering = coreParameter.gpuCore == GPUCORE_SOFTWARE;
+	// The null core is the software GE without rasterization, so it wants the same VRAM handling.
+	g_Config.bSoftwareRendering = coreParameter.gpuCore == GPUCORE_SOFTWARE || coreParameter.gpuCore == GPUCORE_NULL;
 	g_Config.bSoftwareRenderingJit = true;
 	g_Config.iSplineBezierQuality = 2;
 	g_Config.bHighQualityDepth = true;
@@ -534,7 +775,8 @@ int main(int argc, const char* argv[])
 	if (screenshotFilename)
 		headlessHost->SetComparisonScreenshot(Path(std::string(screenshotFilename)), testOptions.maxScreenshotError);
 	headlessHost->SetWriteFailureScreenshot(!teamCityMode && !getenv("GITHUB_ACTIONS") && !testOptions.bench);
-	headlessHost->SetWriteDebugOutput(!testOptions.compare && !testOptions.bench);
+	// The dump benchmark may write its JSON to stdout, so keep the guest's output out of it.
+	headlessHost->SetWriteDebugOutput(!testOptions.compare && !testOptions.bench && !benchDumpDir);
 
 #if PPSSPP_PLATFORM(ANDROID)
 	// For some reason the debugger installs it with this name?
@@ -553,6 +795,9 @@ int main(int argc, const char* argv[])
 
 	UpdateUIState(UISTATE_INGAME);
 
+	if (testOptions.syscallProfile)
+		hleSetSyscallProfilerEnabled(true);
+
 	if (debuggerPort > 0) {
 		g_Config.iRemoteISOPort = debuggerPort;
 		coreParameter.startBreak = true;
@@ -564,6 +809,17 @@ int main(int argc, const char* argv[])
 
 	std::vector<std::string> failedTests;
 	std::vector<std::string> passedTests;
+	if (benchDumpDir) {
+		std::vector<GPUCore> backends;
+		if (gpuCoreSpecified) {
+			backends.push_back(coreParameter.gpuCore);
+		} else {
+			backends.push_back(GPUCORE_SOFTWARE);
+			backends.push_back(GPUCORE_NULL);
+		}
+		if (!RunDumpBenchmark(headlessHost, coreParameter, testOptions, Path(std::string(benchDumpDir)), backends, benchRuns, benchJsonFilename, failedTests))
+			failedTests.push_back(benchDumpDir);
+	}
 	for (size_t i = 0; i < testFilenames.size(); ++i)
 	{
 		coreParameter.fileToStart = Path(testFilenames[i]);
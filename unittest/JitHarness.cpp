@@ -19,10 +19,13 @@
 
 #include "ppsspp_config.h"
 
+#include "Common/ExceptionHandlerSetup.h"
+#include "Common/MachineContext.h"
 #include "Common/System/NativeApp.h"
 #include "Common/System/System.h"
 #include "Common/TimeUtil.h"
 #include "Core/ConfigValues.h"
+#include "Core/Debugger/Breakpoints.h"
 #include "Core/Debugger/SymbolMap.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
@@ -31,6 +34,7 @@
 #include "Core/MIPS/MIPSAsm.h"
 #include "Core/MIPS/MIPSTables.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
+#include "Core/MemFault.h"
 #include "Core/MemMap.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
@@ -224,3 +228,186 @@ bool TestJit() {
 
 	return jit_speed >= interp_speed;
 }
+
+static void InterpreterStopEvent(u64 userdata, int cyclesLate) {
+	coreState = CORE_POWERDOWN;
+}
+
+struct InterpreterRunResult {
+	u32 r[32];
+	u32 pc, hi, lo;
+	s64 ticks;
+};
+
+// Runs from pc until the stop event, either through the predecoded loop or, with a breakpoint
+// somewhere that's never reached, the plain one that decodes every instruction.
+static InterpreterRunResult RunInterpreterFor(u32 pc, int cycles, int stopEvent, bool plain) {
+	if (plain)
+		CBreakPoints::AddBreakPoint(0);
+	MIPSInterpret_ClearCache();
+
+	memset(currentMIPS->r, 0, sizeof(currentMIPS->r));
+	currentMIPS->hi = 0;
+	currentMIPS->lo = 0;
+	currentMIPS->pc = pc;
+	currentMIPS->inDelaySlot = false;
+	const s64 start = (s64)CoreTiming::GetTicks();
+	CoreTiming::ScheduleEvent(cycles, stopEvent);
+	coreState = CORE_RUNNING;
+	while (coreState == CORE_RUNNING)
+		mipsr4k.RunLoopUntil(CoreTiming::GetTicks() + 1000000000ULL);
+
+	InterpreterRunResult result;
+	memcpy(result.r, currentMIPS->r, sizeof(result.r));
+	result.pc = currentMIPS->pc;
+	result.hi = currentMIPS->hi;
+	result.lo = currentMIPS->lo;
+	result.ticks = (s64)CoreTiming::GetTicks() - start;
+
+	if (plain)
+		CBreakPoints::ClearAllBreakPoints();
+	return result;
+}
+
+static double TimeInterpreter(u32 pc, bool plain) {
+	if (plain)
+		CBreakPoints::AddBreakPoint(0);
+	MIPSInterpret_ClearCache();
+
+	int total = 0;
+	double st = time_now_d();
+	do {
+		for (int j = 0; j < 100; ++j) {
+			currentMIPS->pc = pc;
+			coreState = CORE_RUNNING;
+			while (coreState == CORE_RUNNING)
+				mipsr4k.RunLoopUntil(CoreTiming::GetTicks() + 1000000000ULL);
+			++total;
+		}
+	} while (time_now_d() - st < 0.5);
+	double elapsed = time_now_d() - st;
+
+	if (plain)
+		CBreakPoints::ClearAllBreakPoints();
+	return total / elapsed;
+}
+
+// The predecoded interpreter loop must stop at exactly the same instruction as the plain one,
+// even in the middle of a long straight-line run.
+bool TestInterpreterPredecode() {
+	SetupJitHarness();
+	int stopEvent = CoreTiming::RegisterEvent("UnitTestInterpreterStop", &InterpreterStopEvent);
+
+	static const char *lines[] = {
+		"addiu r2, r2, 3",
+		"xor r3, r3, r2",
+		"sll r4, r3, 1",
+		"addu r5, r5, r4",
+		"mult r5, r3",
+		"mflo r6",
+		"sw r6, 0(r1)",
+		"lw r7, 0(r1)",
+		"subu r8, r7, r2",
+		"ori r9, r8, 0x55",
+	};
+	const int REPEATS = 60;
+
+	const u32 codeAddr = PSP_GetUserMemoryBase();
+	u32 addr = codeAddr;
+	bool success = MIPSAsm::MipsAssembleOpcode("lui r1, 0x0890", currentDebugMIPS, addr);
+	addr += 4;
+	const u32 loopAddr = addr;
+	for (int i = 0; i < REPEATS; ++i) {
+		for (size_t j = 0; j < ARRAY_SIZE(lines); ++j) {
+			success = success && MIPSAsm::MipsAssembleOpcode(lines[j], currentDebugMIPS, addr);
+			addr += 4;
+		}
+	}
+	// Loop forever for the comparison, the stop event ends it.
+	Memory::Write_U32(MIPS_MAKE_J(loopAddr), addr);
+	Memory::Write_U32(MIPS_MAKE_NOP(), addr + 4);
+	if (!success) {
+		printf("ERROR: %s\n", MIPSAsm::GetAssembleError().c_str());
+		DestroyJitHarness();
+		return false;
+	}
+
+	// Stop points before, inside, and well past the first straight run.
+	static const int stopCycles[] = { 1, 7, 100, 255, 257, 613, 1000, 4099 };
+	for (int cycles : stopCycles) {
+		InterpreterRunResult fast = RunInterpreterFor(codeAddr, cycles, stopEvent, false);
+		InterpreterRunResult plain = RunInterpreterFor(codeAddr, cycles, stopEvent, true);
+		if (memcmp(fast.r, plain.r, sizeof(fast.r)) != 0 || fast.pc != plain.pc || fast.hi != plain.hi || fast.lo != plain.lo || fast.ticks != plain.ticks) {
+			printf("Interpreter predecode: mismatch stopping after %d cycles (pc %08x vs %08x, ticks %lld vs %lld)\n", cycles, fast.pc, plain.pc, (long long)fast.ticks, (long long)plain.ticks);
+			for (int i = 0; i < 32; ++i) {
+				if (fast.r[i] != plain.r[i])
+					printf("  r%d: %08x vs %08x\n", i, fast.r[i], plain.r[i]);
+			}
+			success = false;
+		}
+	}
+
+	// Now time it, ending the block with a syscall instead.
+	Memory::Write_U32(MIPS_MAKE_SYSCALL("UnitTestFakeSyscalls", "UnitTestTerminator"), addr);
+	Memory::Write_U32(MIPS_MAKE_BREAK(1), addr + 4);
+	Memory::Write_U32(MIPS_MAKE_JR_RA(), addr + 8);
+	double fastSpeed = TimeInterpreter(codeAddr, false);
+	double plainSpeed = TimeInterpreter(codeAddr, true);
+	printf("Predecoded interpreter: %0.0f blocks/s, plain: %0.0f blocks/s (%0.2fx)\n", fastSpeed, plainSpeed, fastSpeed / plainSpeed);
+
+	DestroyJitHarness();
+	return success;
+}
+
+bool TestJitCodePageProtection() {
+#if defined(MACHINE_CONTEXT_SUPPORTED) && !defined(MASKED_PSP_MEMORY)
+	SetupJitHarness();
+	InstallExceptionHandler(&Memory::HandleFault);
+	g_Config.bFastMemory = true;
+	g_Config.bProtectJitCodePages = true;
+
+	const u32 codeAddr = PSP_GetUserMemoryBase();
+	u32 *p = (u32 *)Memory::GetPointer(codeAddr);
+	*p++ = MIPS_MAKE_ADDIU(MIPS_REG_V0, MIPS_REG_ZERO, 1);
+	*p++ = MIPS_MAKE_SYSCALL("UnitTestFakeSyscalls", "UnitTestTerminator");
+	*p++ = MIPS_MAKE_BREAK(1);
+	*p++ = MIPS_MAKE_JR_RA();
+
+	mipsr4k.UpdateCore(CPUCore::JIT);
+	currentMIPS->pc = codeAddr;
+	coreState = CORE_RUNNING;
+	while (coreState == CORE_RUNNING) {
+		mipsr4k.RunLoopUntil(1000000);
+	}
+
+	bool success = true;
+	JitBlockCacheDebugInterface *cache = MIPSComp::jit ? MIPSComp::jit->GetBlockCacheDebugInterface() : nullptr;
+	if (!cache || cache->GetBlockNumberFromStartAddress(codeAddr) < 0) {
+		printf("Code page protection: no block was compiled\n");
+		success = false;
+	} else {
+		// Write data next to the code through the uncached mirror. This faults, and the handler lets it through.
+		const u32 dataAddr = codeAddr + 0x100;
+		*(volatile u32 *)(Memory::base + (dataAddr | 0x40000000)) = 0x1337F00D;
+		if (Memory::Read_U32(dataAddr) != 0x1337F00D) {
+			printf("Code page protection: write through the mirror was lost\n");
+			success = false;
+		}
+
+		// The handler only queues the page, blocks are dropped on the emu thread.
+		Memory::MemFault_ProcessPendingCodeClears();
+		if (cache->GetBlockNumberFromStartAddress(codeAddr) >= 0) {
+			printf("Code page protection: block survived a write to its page\n");
+			success = false;
+		}
+	}
+
+	g_Config.bProtectJitCodePages = false;
+	UninstallExceptionHandler();
+	DestroyJitHarness();
+	return success;
+#else
+	// Code pages are never protected here.
+	return true;
+#endif
+}
@@ -18,3 +18,5 @@
 #pragma once
 
 bool TestJit();
+bool TestInterpreterPredecode();
+bool TestJitCodePageProtection();
@@ -1,7 +1,10 @@
 #include "ppsspp_config.h"
 #include <algorithm>
 
+#include "Common/File/FileUtil.h"
+#include "Common/File/Path.h"
 #include "Common/StringUtils.h"
+#include "Common/TimeUtil.h"
 
 #include "GPU/Common/ShaderId.h"
 #include "GPU/Common/ShaderCommon.h"
@@ -618,6 +621,172 @@ bool TestGeometryShaders() {
 }
 
 
+// Compiles a set of Vulkan shaders cold, then again through a SpirvCache saved to and loaded from
+// disk, like the Vulkan shader cache does on the next boot.
+bool TestSpirvCache() {
+	char *buffer = new char[65536];
+	GMRng rng;
+	Draw::Bugs bugs;
+	std::vector<std::pair<VkShaderStageFlagBits, std::string>> sources;
+
+	for (int i = 0; i < 200; i++) {
+		std::string genErrorString;
+		if (i & 1) {
+			FShaderID id;
+			id.d[0] = rng.R32();
+			id.d[1] = rng.R32();
+			if (GenerateFShader(id, buffer, ShaderLanguage::GLSL_VULKAN, bugs, &genErrorString))
+				sources.emplace_back(VK_SHADER_STAGE_FRAGMENT_BIT, buffer);
+		} else {
+			VShaderID id;
+			id.d[0] = rng.R32();
+			id.d[1] = rng.R32();
+			id.SetBits(VS_BIT_WEIGHT_FMTSCALE, 2, 0);
+			if (id.Bit(VS_BIT_IS_THROUGH))
+				id.SetBit(VS_BIT_USE_HW_TRANSFORM, 0);
+			if (!id.Bit(VS_BIT_USE_HW_TRANSFORM))
+				id.SetBit(VS_BIT_ENABLE_BONES, 0);
+			if (!id.Bit(VS_BIT_VERTEX_RANGE_CULLING) && GenerateVShader(id, buffer, ShaderLanguage::GLSL_VULKAN, bugs, &genErrorString))
+				sources.emplace_back(VK_SHADER_STAGE_VERTEX_BIT, buffer);
+		}
+	}
+	delete[] buffer;
+
+	SpirvCache cache;
+	std::vector<std::vector<uint32_t>> cold(sources.size());
+	double start = time_now_d();
+	for (size_t i = 0; i < sources.size(); i++) {
+		std::string errorMessage;
+		if (!GLSLtoSPV(sources[i].first, sources[i].second.c_str(), GLSLVariant::VULKAN, cold[i], &errorMessage)) {
+			printf("Error compiling shader:\n\n%s\n\n%s\n", LineNumberString(sources[i].second).c_str(), errorMessage.c_str());
+			return false;
+		}
+		cache.Put(SpirvCache::MakeKey(sources[i].first, sources[i].second.c_str()), cold[i]);
+	}
+	double coldTime = time_now_d() - start;
+
+	// The same source for a different stage must not hit.
+	if (!sources.empty() && cache.Contains(SpirvCache::MakeKey(VK_SHADER_STAGE_GEOMETRY_BIT, sources[0].second.c_str()))) {
+		printf("SPIR-V cache confused shader stages\n");
+		return false;
+	}
+
+	const Path filename("spirv_cache_test.bin");
+	FILE *f = File::OpenCFile(filename, "wb");
+	bool saved = f && cache.Save(f);
+	if (f)
+		fclose(f);
+
+	SpirvCache loaded;
+	f = File::OpenCFile(filename, "rb");
+	bool load = f && loaded.Load(f);
+	if (f)
+		fclose(f);
+	File::Delete(filename);
+	if (!saved || !load || loaded.size() != cache.size()) {
+		printf("SPIR-V cache failed to round trip (%d/%d entries)\n", (int)loaded.size(), (int)cache.size());
+		return false;
+	}
+
+	start = time_now_d();
+	for (size_t i = 0; i < sources.size(); i++) {
+		std::vector<uint32_t> spirv;
+		if (!loaded.Get(SpirvCache::MakeKey(sources[i].first, sources[i].second.c_str()), &spirv) || spirv != cold[i]) {
+			printf("SPIR-V cache missed or mismatched shader %d\n", (int)i);
+			return false;
+		}
+	}
+	double warmTime = time_now_d() - start;
+
+	printf("%d shaders compiled in %0.1f ms, from SPIR-V cache in %0.1f ms\n", (int)sources.size(), coldTime * 1000.0, warmTime * 1000.0);
+	return true;
+}
+
+bool TestShaderProfile() {
+	ShaderProfile profile;
+	VShaderID ids[3];
+	for (int i = 0; i < 3; i++)
+		ids[i].d[0] = i + 1;
+
+	// Two hits on frame 5, then a single early hit, then a single later one split across two runs.
+	ShaderUsage usage;
+	usage.Record(5);
+	usage.Record(6);
+	profile.Add(ShaderProfile::Kind::VERTEX_SHADER, &ids[0], sizeof(VShaderID), usage);
+	usage = ShaderUsage();
+	usage.Record(1);
+	profile.Add(ShaderProfile::Kind::VERTEX_SHADER, &ids[1], sizeof(VShaderID), usage);
+	usage = ShaderUsage();
+	profile.Add(ShaderProfile::Kind::VERTEX_SHADER, &ids[2], sizeof(VShaderID), usage);
+	usage.Record(9);
+	profile.Add(ShaderProfile::Kind::VERTEX_SHADER, &ids[2], sizeof(VShaderID), usage);
+
+	const Path filename("shader_profile_test.bin");
+	FILE *f = File::OpenCFile(filename, "wb");
+	bool saved = f && profile.Save(f, 1);
+	if (f)
+		fclose(f);
+
+	std::string data;
+	bool read = File::ReadBinaryFileToString(filename, &data);
+	File::Delete(filename);
+
+	const size_t keySizes[(int)ShaderProfile::Kind::COUNT] = { sizeof(VShaderID), sizeof(FShaderID), sizeof(GShaderID), 0 };
+	ShaderProfile wrongVersion;
+	if (!saved || !read || wrongVersion.Load((const uint8_t *)data.data(), data.size(), 2, keySizes)) {
+		printf("Shader profile failed to save or accepted the wrong version\n");
+		return false;
+	}
+	ShaderProfile loaded;
+	if (!loaded.Load((const uint8_t *)data.data(), data.size(), 1, keySizes) || loaded.Load((const uint8_t *)data.data(), data.size() - 1, 1, keySizes)) {
+		printf("Shader profile failed to load or accepted a truncated file\n");
+		return false;
+	}
+
+	// A key size that doesn't match the ID type is rejected, even a huge one that would overflow the size check.
+	ShaderProfile wrongKeySize;
+	std::string badKeySize = data;
+	const uint32_t keySizeOffset = 4 * 4;
+	const uint32_t oversized = 0xFFFFFFF8;
+	memcpy(&badKeySize[keySizeOffset], &oversized, sizeof(oversized));
+	const size_t otherKeySizes[(int)ShaderProfile::Kind::COUNT] = { sizeof(VShaderID) + 4, sizeof(FShaderID), sizeof(GShaderID), 0 };
+	if (wrongKeySize.Load((const uint8_t *)badKeySize.data(), badKeySize.size(), 1, keySizes) || wrongKeySize.Load((const uint8_t *)data.data(), data.size(), 1, otherKeySizes) || !wrongKeySize.empty()) {
+		printf("Shader profile accepted the wrong key size\n");
+		return false;
+	}
+
+	const auto sorted = loaded.Sorted(ShaderProfile::Kind::VERTEX_SHADER);
+	const int expected[3] = { 0, 1, 2 };
+	if (sorted.size() != 3 || loaded.size(ShaderProfile::Kind::FRAGMENT_SHADER) != 0) {
+		printf("Shader profile has %d vertex shaders, expected 3\n", (int)sorted.size());
+		return false;
+	}
+	for (int i = 0; i < 3; i++) {
+		if (memcmp(sorted[i].first.data(), &ids[expected[i]], sizeof(VShaderID)) != 0) {
+			printf("Shader profile sorted wrong at %d\n", i);
+			return false;
+		}
+	}
+	if (sorted[0].second.hits != 2 || sorted[0].second.firstFrame != 5 || sorted[2].second.firstFrame != 9) {
+		printf("Shader profile lost usage counts\n");
+		return false;
+	}
+
+	// Hits saturate instead of wrapping, both when recording and when merging profiles.
+	ShaderUsage hot;
+	hot.hits = 0xFFFFFFFE;
+	hot.Record(1);
+	hot.Record(2);
+	ShaderUsage merged = hot;
+	merged.Merge(hot);
+	if (hot.hits != 0xFFFFFFFF || merged.hits != 0xFFFFFFFF) {
+		printf("Shader usage hits wrapped\n");
+		return false;
+	}
+	return true;
+}
+
+
 bool TestShaderGenerators() {
 #if PPSSPP_PLATFORM(WINDOWS)
 	LoadD3D11();
@@ -651,5 +820,13 @@ bool TestShaderGenerators() {
 		return false;
 	}
 
+	if (!TestSpirvCache()) {
+		return false;
+	}
+
+	if (!TestShaderProfile()) {
+		return false;
+	}
+
 	return true;
 } 
@@ -1,6 +1,7 @@
 #include <thread>
 #include <vector>
 #include <cstdio>
+#include <cstring>
 
 #include "Common/Log.h"
 #include "Common/TimeUtil.h"
@@ -124,6 +125,193 @@ bool TestMultithreadedScheduling() {
 	return true;
 }
 
+// Small chunk of busywork, roughly the size of a software renderer bin task.
+static uint32_t SpinWork(int amount) {
+	volatile uint32_t x = 1;
+	for (int i = 0; i < amount; ++i)
+		x = x * 1664525 + 1013904223;
+	return x;
+}
+
+class SpinTask : public Task {
+public:
+	SpinTask(WaitableCounter *counter, int work, const char *kind = "SpinTask") : counter_(counter), work_(work), kind_(kind) {}
+	TaskType Type() const override { return TaskType::CPU_COMPUTE; }
+	TaskPriority Priority() const override { return TaskPriority::NORMAL; }
+	const char *Kind() const override { return kind_; }
+	void Run() override {
+		SpinWork(work_);
+		counter_->Count();
+	}
+private:
+	WaitableCounter *counter_;
+	int work_;
+	const char *kind_;
+};
+
+// Trace events are recorded just after a task runs, so wait for every thread to move past its last one.
+static void WaitForTraces(ThreadManager *threadMan) {
+	int threads = threadMan->GetNumLooperThreads();
+	WaitableCounter *counter = new WaitableCounter(threads);
+	for (int i = 0; i < threads; ++i)
+		threadMan->EnqueueTaskOnThread(i, new SpinTask(counter, 0, "Sync"));
+	counter->WaitAndRelease();
+}
+
+bool TestTaskTracing(ThreadManager *threadMan) {
+	const int TASKS = 256;
+
+	threadMan->StartTracing();
+	WaitableCounter *counter = new WaitableCounter(TASKS);
+	// Tasks put on a specific thread must stay there, even with idle siblings.
+	for (int i = 0; i < TASKS; ++i)
+		threadMan->EnqueueTaskOnThread(0, new SpinTask(counter, 2000));
+	counter->WaitAndRelease();
+	WaitForTraces(threadMan);
+	std::vector<TaskTraceEvent> events = threadMan->StopTracing();
+
+	int spinTasks = 0;
+	for (const TaskTraceEvent &ev : events) {
+		if (!ev.kind || strcmp(ev.kind, "SpinTask") != 0)
+			continue;
+		spinTasks++;
+		EXPECT_FALSE(ev.stolen);
+		EXPECT_EQ_INT(ev.thread, 0);
+		EXPECT_TRUE(ev.end >= ev.start);
+	}
+	EXPECT_EQ_INT(spinTasks, TASKS);
+
+	// Regular tasks can be stolen by idle threads.
+	threadMan->StartTracing();
+	counter = new WaitableCounter(TASKS);
+	for (int i = 0; i < TASKS; ++i)
+		threadMan->EnqueueTask(new SpinTask(counter, 20000));
+	counter->WaitAndRelease();
+	WaitForTraces(threadMan);
+	events = threadMan->StopTracing();
+
+	spinTasks = 0;
+	int stolen = 0;
+	for (const TaskTraceEvent &ev : events) {
+		if (!ev.kind || strcmp(ev.kind, "SpinTask") != 0)
+			continue;
+		spinTasks++;
+		if (ev.stolen)
+			stolen++;
+		EXPECT_TRUE(ev.end >= ev.start);
+		EXPECT_TRUE(ev.thread >= 0 && ev.thread < threadMan->GetNumLooperThreads());
+	}
+	EXPECT_EQ_INT(spinTasks, TASKS);
+	printf("Tracing: %d tasks, %d stolen\n", spinTasks, stolen);
+
+	// Shouldn't record anything once stopped.  The Sync tasks above may still have been traced.
+	WaitForTraces(threadMan);
+	threadMan->StopTracing();
+	counter = new WaitableCounter(1);
+	threadMan->EnqueueTask(new SpinTask(counter, 10));
+	counter->WaitAndRelease();
+	WaitForTraces(threadMan);
+	EXPECT_TRUE(threadMan->StopTracing().empty());
+	return true;
+}
+
+class NestedLoopTask : public Task {
+public:
+	NestedLoopTask(ThreadManager *threadMan, WaitableCounter *counter) : threadMan_(threadMan), counter_(counter) {}
+	TaskType Type() const override { return TaskType::CPU_COMPUTE; }
+	TaskPriority Priority() const override { return TaskPriority::NORMAL; }
+	void Run() override {
+		// Everything goes on this worker's deque, and it's blocked until they finish, so siblings must steal them all.
+		WaitableCounter *loop = ParallelRangeLoopWaitable(threadMan_, [](int l, int h) {
+			SpinWork((h - l) * 20);
+		}, 0, 4096, 64, TaskPriority::NORMAL);
+		loop->WaitAndRelease();
+		counter_->Count();
+	}
+private:
+	ThreadManager *threadMan_;
+	WaitableCounter *counter_;
+};
+
+// Needs at least two compute threads.
+static bool TestParallelLoopStealing(ThreadManager *threadMan) {
+	threadMan->StartTracing();
+	WaitableCounter *counter = new WaitableCounter(1);
+	threadMan->EnqueueTaskOnThread(0, new NestedLoopTask(threadMan, counter));
+	counter->WaitAndRelease();
+	WaitForTraces(threadMan);
+	std::vector<TaskTraceEvent> events = threadMan->StopTracing();
+
+	int loopTasks = 0;
+	int stolen = 0;
+	for (const TaskTraceEvent &ev : events) {
+		if (!ev.kind || strcmp(ev.kind, "ParallelRangeLoop") != 0)
+			continue;
+		loopTasks++;
+		if (ev.stolen)
+			stolen++;
+		EXPECT_TRUE(ev.thread != 0);
+	}
+	EXPECT_TRUE(loopTasks > 0);
+	EXPECT_EQ_INT(stolen, loopTasks);
+
+	// A slow chunk mustn't hold up the others queued behind it on the same thread.
+	const int RANGE = 4096;
+	std::atomic<int> others{ 0 };
+	bool timedOut = false;
+	WaitableCounter *loop = ParallelRangeLoopWaitable(threadMan, [&](int l, int h) {
+		if (l != 0) {
+			SpinWork((h - l) * 20);
+			others += h - l;
+			return;
+		}
+		double deadline = time_now_d() + 5.0;
+		while (others.load() < RANGE - h) {
+			if (time_now_d() > deadline) {
+				timedOut = true;
+				break;
+			}
+			std::this_thread::yield();
+		}
+	}, 0, RANGE, 64, TaskPriority::NORMAL);
+	loop->WaitAndRelease();
+	EXPECT_FALSE(timedOut);
+	return true;
+}
+
+// Prints how throughput of small tasks scales with the thread count, and checks that loops get balanced by stealing.
+bool TestThreadManagerScaling() {
+	const int TASKS = 20000;
+	const int LOOPS = 500;
+
+	for (int threads : { 1, 2, 4, 8, 16 }) {
+		ThreadManager manager;
+		manager.Init(threads, 1);
+
+		auto start = Instant::Now();
+		WaitableCounter *counter = new WaitableCounter(TASKS);
+		for (int i = 0; i < TASKS; ++i)
+			manager.EnqueueTask(new SpinTask(counter, 500));
+		counter->WaitAndRelease();
+		double taskTime = start.Elapsed();
+
+		// Fine-grained loops, like the ones the software renderer and texture scaling do.
+		start = Instant::Now();
+		for (int i = 0; i < LOOPS; ++i) {
+			ParallelRangeLoop(&manager, [](int l, int h) {
+				SpinWork((h - l) * 20);
+			}, 0, 4096, 64);
+		}
+		double loopTime = start.Elapsed();
+
+		printf("%2d threads: %d tasks in %0.3f s, %d loops in %0.3f s\n", threads, TASKS, taskTime, LOOPS, loopTime);
+		if (threads >= 2 && !TestParallelLoopStealing(&manager))
+			return false;
+		manager.Teardown();
+	}
+	return true;
+}
+
 bool TestThreadManager() {
 	ThreadManager manager;
 	manager.Init(8, 1);
@@ -152,5 +340,13 @@ bool TestThreadManager() {
 		return false;
 	}
 
+	if (!TestTaskTracing(&manager)) {
+		return false;
+	}
+
+	if (!TestThreadManagerScaling()) {
+		return false;
+	}
+
 	return true;
 }
@@ -1,8 +1,10 @@
+#include <cstring>
 #include <thread>
 #include <vector>
 
 #include "Common/Log.h"
 #include "Common/File/VFS/ZipFileReader.h"
+#include "Common/TimeUtil.h"
 
 #include "UnitTest.h"
 
@@ -41,15 +43,16 @@ static bool CheckContainsFile(const std::vector<File::FileInfo> &listing, const
 // in_root.txt
 
 // TODO: Also test the filter.
-bool TestZipFile() {
+static bool TestZipFile(bool allowMapping) {
 	// First, check things relative to root, with an empty internal path.
 	Path zipPath = Path("../source_assets/ziptest.zip");
 	if (!File::Exists(zipPath)) {
 		zipPath = Path("source_assets/ziptest.zip");
 	}
 
-	ZipFileReader *dir = ZipFileReader::Create(zipPath, "", true);
+	ZipFileReader *dir = ZipFileReader::Create(zipPath, "", true, allowMapping);
 	EXPECT_TRUE(dir != nullptr);
+	EXPECT_EQ_INT(dir->IsMapped(), allowMapping);
 
 	std::vector<File::FileInfo> listing;
 	EXPECT_TRUE(dir->GetFileListing("", &listing, nullptr));
@@ -67,7 +70,7 @@ bool TestZipFile() {
 	delete dir;
 
 	// Next, we'll destroy the reader and create a new one based in a subdirectory.
-	dir = ZipFileReader::Create(zipPath, "ziptest/data", true);
+	dir = ZipFileReader::Create(zipPath, "ziptest/data", true, allowMapping);
 	EXPECT_TRUE(dir != nullptr);
 	EXPECT_TRUE(dir->GetFileListing("", &listing, nullptr));
 	EXPECT_EQ_INT(listing.size(), 4);
@@ -82,13 +85,167 @@ bool TestZipFile() {
 	EXPECT_TRUE(dir->GetFileListing("b", &listing, nullptr));
 	EXPECT_TRUE(CheckContainsFile(listing, "in_b.txt"));
 	EXPECT_EQ_INT(listing.size(), 1);
+
+	File::FileInfo info;
+	EXPECT_TRUE(dir->GetFileInfo("BIG.txt", &info));
+	EXPECT_EQ_INT(info.size, 10);
+	EXPECT_FALSE(info.isDirectory);
+	EXPECT_FALSE(dir->GetFileInfo("missing.txt", &info));
+	size_t size = 0;
+	uint8_t *data = dir->ReadFile("big.txt", &size);
+	EXPECT_TRUE(data != nullptr);
+	EXPECT_EQ_INT(size, 10);
+	delete[] data;
 	delete dir;
 
 	return true;
 }
 
+static std::vector<uint8_t> GenerateZipTestData(size_t size, uint32_t seed) {
+	// Compressible, but not trivially so.
+	std::vector<uint8_t> data;
+	data.reserve(size + 64);
+	char line[64];
+	while (data.size() < size) {
+		seed = seed * 1103515245 + 12345;
+		int len = snprintf(line, sizeof(line), "entry %08x value %u\n", seed >> 8, (seed >> 16) & 0xFF);
+		data.insert(data.end(), line, line + len);
+	}
+	data.resize(size);
+	return data;
+}
+
+static bool ReadStreamed(ZipFileReader *reader, const char *name, size_t chunkSize, std::vector<uint8_t> *out) {
+	VFSFileReference *ref = reader->GetFile(name);
+	if (!ref)
+		return false;
+	size_t size = 0;
+	VFSOpenFile *file = reader->OpenFileForRead(ref, &size);
+	if (!file) {
+		reader->ReleaseFile(ref);
+		return false;
+	}
+	out->resize(size);
+	size_t pos = 0;
+	while (pos < size) {
+		size_t count = reader->Read(file, out->data() + pos, std::min(chunkSize, size - pos));
+		if (count == 0)
+			break;
+		pos += count;
+	}
+	reader->CloseFile(file);
+	reader->ReleaseFile(ref);
+	return pos == size;
+}
+
+// Checks that the mapped reader and libzip agree on a generated archive with stored and deflated
+// entries bigger than the block cache, and compares their throughput.
+static bool TestZipReaders() {
+	const Path zipPath("ziptest_generated.zip");
+	const char *names[] = { "deflated_big.bin", "dir/stored.bin", "dir/deflated_small.bin" };
+	std::vector<uint8_t> contents[3] = {
+		GenerateZipTestData(6 * 1024 * 1024 + 123, 1),
+		GenerateZipTestData(3 * 1024 * 1024 + 7, 2),
+		GenerateZipTestData(100 * 1024, 3),
+	};
+
+	int error = 0;
+	zip *zw = zip_open(zipPath.c_str(), ZIP_CREATE | ZIP_TRUNCATE, &error);
+	EXPECT_TRUE(zw != nullptr);
+	for (int i = 0; i < 3; ++i) {
+		zip_source_t *source = zip_source_buffer(zw, contents[i].data(), contents[i].size(), 0);
+		zip_int64_t index = zip_file_add(zw, names[i], source, ZIP_FL_OVERWRITE);
+		EXPECT_TRUE(index >= 0);
+		if (i == 1)
+			zip_set_file_compression(zw, index, ZIP_CM_STORE, 0);
+	}
+	EXPECT_EQ_INT(zip_close(zw), 0);
+
+	ZipFileReader *readers[2] = {
+		ZipFileReader::Create(zipPath, "", true, true),
+		ZipFileReader::Create(zipPath, "", true, false),
+	};
+	EXPECT_TRUE(readers[0] != nullptr && readers[0]->IsMapped());
+	EXPECT_TRUE(readers[1] != nullptr && !readers[1]->IsMapped());
+
+	for (ZipFileReader *reader : readers) {
+		std::vector<File::FileInfo> listing;
+		EXPECT_TRUE(reader->GetFileListing("dir", &listing, "bin"));
+		EXPECT_EQ_INT(listing.size(), 2);
+
+		for (int i = 0; i < 3; ++i) {
+			size_t size = 0;
+			uint8_t *data = reader->ReadFile(names[i], &size);
+			EXPECT_TRUE(data != nullptr);
+			EXPECT_EQ_INT(size, contents[i].size());
+			EXPECT_TRUE(memcmp(data, contents[i].data(), size) == 0);
+			delete[] data;
+
+			// Odd chunk sizes to straddle the block boundaries.
+			std::vector<uint8_t> streamed;
+			EXPECT_TRUE(ReadStreamed(reader, names[i], 12345, &streamed));
+			EXPECT_TRUE(streamed == contents[i]);
+		}
+	}
+
+	// Only the mapped reader allows several open files at once.
+	{
+		ZipFileReader *reader = readers[0];
+		std::vector<std::thread> threads;
+		bool results[4]{};
+		for (int t = 0; t < 4; ++t) {
+			threads.emplace_back([&, t] {
+				std::vector<uint8_t> streamed;
+				results[t] = ReadStreamed(reader, names[t & 1], 4096 + t * 1000, &streamed) && streamed == contents[t & 1];
+			});
+		}
+		for (auto &thread : threads)
+			thread.join();
+		for (bool result : results)
+			EXPECT_TRUE(result);
+
+		// Rewinding and reading backwards over the cache.
+		VFSFileReference *ref = reader->GetFile(names[0]);
+		size_t size = 0;
+		VFSOpenFile *file = reader->OpenFileForRead(ref, &size);
+		std::vector<uint8_t> buffer(size);
+		EXPECT_EQ_INT(reader->Read(file, buffer.data(), size), size);
+		reader->Rewind(file);
+		EXPECT_EQ_INT(reader->Read(file, buffer.data(), 1000), 1000);
+		EXPECT_TRUE(memcmp(buffer.data(), contents[0].data(), 1000) == 0);
+		reader->CloseFile(file);
+		reader->ReleaseFile(ref);
+	}
+
+	const char *modeNames[2] = { "mapped", "libzip" };
+	for (int m = 0; m < 2; ++m) {
+		size_t bytes = 0;
+		double start = time_now_d();
+		for (int iter = 0; iter < 4; ++iter) {
+			for (int i = 0; i < 3; ++i) {
+				std::vector<uint8_t> streamed;
+				ReadStreamed(readers[m], names[i], 64 * 1024, &streamed);
+				size_t size = 0;
+				delete[] readers[m]->ReadFile(names[i], &size);
+				bytes += streamed.size() + size;
+			}
+		}
+		double elapsed = time_now_d() - start;
+		printf("Zip read (%s): %.1f MB/s\n", modeNames[m], bytes / (1024.0 * 1024.0) / elapsed);
+	}
+
+	delete readers[0];
+	delete readers[1];
+	File::Delete(zipPath);
+	return true;
+}
+
 bool TestVFS() {
-	if (!TestZipFile())
+	if (!TestZipFile(true))
+		return false;
+	if (!TestZipFile(false))
+		return false;
+	if (!TestZipReaders())
 		return false;
 	return true;
 }
@@ -35,12 +35,16 @@
 #include "ppsspp_config.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <string>
 #include <sstream>
+#include <zstd.h>
 
 #if PPSSPP_PLATFORM(ANDROID)
 #include <jni.h>
@@ -51,13 +55,22 @@
 #include "Common/Data/Convert/SmallDataConvert.h"
 #include "Common/Data/Text/Parsers.h"
 #include "Common/Data/Text/WrapText.h"
+#include "Common/Data/Encoding/Compression.h"
 #include "Common/Data/Encoding/Utf8.h"
 #include "Common/File/Path.h"
+#include "Common/File/FileUtil.h"
 #include "Common/Input/InputState.h"
 #include "Common/Math/math_util.h"
+#include "Common/Net/HTTPClient.h"
+#include "Common/Net/HTTPServer.h"
+#include "Common/Net/Sinks.h"
+#include "Common/Net/WebsocketServer.h"
 #include "Common/Render/DrawBuffer.h"
+#include "Common/Serialize/Serializer.h"
+#include "Common/Serialize/SerializeFuncs.h"
 #include "Common/System/NativeApp.h"
 #include "Common/System/System.h"
+#include "Common/Thread/ThreadManager.h"
 #include "Common/Thread/ThreadUtil.h"
 #include "Common/Data/Format/IniFile.h"
 
@@ -66,15 +79,25 @@
 #include "Common/CPUDetect.h"
 #include "Common/Log.h"
 #include "Common/StringUtils.h"
+#include "Common/TimeUtil.h"
 #include "Core/Config.h"
+#include "Core/FileLoaders/HTTPFileLoader.h"
 #include "Common/File/VFS/VFS.h"
 #include "Common/File/VFS/DirectoryReader.h"
+#include "Core/FileSystems/DirectoryFileSystem.h"
 #include "Core/FileSystems/ISOFileSystem.h"
+#include "Core/FileSystems/MetaFileSystem.h"
+#include "Core/HW/SasAudio.h"
 #include "Core/MemMap.h"
 #include "Core/KeyMap.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
+#include "Core/System.h"
+#include "Core/Util/AudioFormat.h"
+#include "Core/Util/BlockAllocator.h"
 #include "GPU/Common/TextureDecoder.h"
 #include "GPU/Common/GPUStateUtils.h"
+#include "GPU/Debugger/Playback.h"
+#include "GPU/Debugger/RecordFormat.h"
 
 #include "Common/File/AndroidContentURI.h"
 
@@ -559,6 +582,357 @@ bool TestParseLBN() {
 	return true;
 }
 
+// A synthetic ISO in memory, with one huge directory (like a voice bank.)
+class MemoryBlockDevice : public BlockDevice {
+public:
+	MemoryBlockDevice(u32 numBlocks) : BlockDevice(nullptr), data_((size_t)numBlocks * 2048) {}
+
+	bool ReadBlock(int blockNumber, u8 *outPtr, bool uncached = false) override {
+		if ((u32)blockNumber >= GetNumBlocks())
+			return false;
+		memcpy(outPtr, &data_[(size_t)blockNumber * 2048], 2048);
+		return true;
+	}
+	u32 GetNumBlocks() const override { return (u32)(data_.size() / 2048); }
+	bool IsDisc() const override { return true; }
+
+	u8 *Block(u32 blockNumber) { return &data_[(size_t)blockNumber * 2048]; }
+
+private:
+	std::vector<u8> data_;
+};
+
+static void WriteISOPair32(u8 *dest, u32 value) {
+	for (int i = 0; i < 4; ++i) {
+		dest[i] = (u8)(value >> (i * 8));
+		dest[7 - i] = (u8)(value >> (i * 8));
+	}
+}
+
+// Appends a directory record, moving to the next sector if it doesn't fit.  Returns the new offset.
+static size_t WriteISODirRecord(MemoryBlockDevice *dev, u32 firstSector, size_t offset, const std::string &name, u32 lba, u32 size, bool dir) {
+	size_t recordSize = (33 + name.size() + 1) & ~1;
+	if ((offset % 2048) + recordSize > 2048)
+		offset = (offset + 2047) & ~2047;
+	u8 *rec = dev->Block(firstSector + (u32)(offset / 2048)) + (offset % 2048);
+	rec[0] = (u8)recordSize;
+	WriteISOPair32(rec + 2, lba);
+	WriteISOPair32(rec + 10, size);
+	rec[25] = dir ? 2 : 0;
+	rec[32] = (u8)name.size();
+	memcpy(rec + 33, name.data(), name.size());
+	return offset + recordSize;
+}
+
+static bool TestISOFileSystem() {
+	const int NUM_FILES = 4000;
+	const u32 ROOT_SECTOR = 20;
+	const u32 VOICE_SECTOR = 21;
+	const u32 DATA_SECTOR = 400;
+
+	MemoryBlockDevice *dev = new MemoryBlockDevice(DATA_SECTOR + 16);
+	u8 *desc = dev->Block(16);
+	desc[0] = 1;
+	memcpy(desc + 1, "CD001", 5);
+	WriteISOPair32(desc + 156 + 2, ROOT_SECTOR);
+	WriteISOPair32(desc + 156 + 10, 2048);
+
+	size_t offset = WriteISODirRecord(dev, ROOT_SECTOR, 0, std::string(1, '\0'), ROOT_SECTOR, 2048, true);
+	offset = WriteISODirRecord(dev, ROOT_SECTOR, offset, std::string(1, '\1'), ROOT_SECTOR, 2048, true);
+	WriteISODirRecord(dev, ROOT_SECTOR, offset, "VOICE", VOICE_SECTOR, 0, true);
+
+	offset = WriteISODirRecord(dev, VOICE_SECTOR, 0, std::string(1, '\0'), VOICE_SECTOR, 0, true);
+	offset = WriteISODirRecord(dev, VOICE_SECTOR, offset, std::string(1, '\1'), ROOT_SECTOR, 2048, true);
+	for (int i = 0; i < NUM_FILES; ++i)
+		offset = WriteISODirRecord(dev, VOICE_SECTOR, offset, StringFromFormat("V%05d.AT3", i), DATA_SECTOR, 100 + i, false);
+	u32 voiceSize = (u32)((offset + 2047) & ~2047);
+	EXPECT_TRUE(VOICE_SECTOR + voiceSize / 2048 <= DATA_SECTOR);
+	// Patch in the real size of the directory now that we know it.
+	WriteISOPair32(dev->Block(ROOT_SECTOR) + 68 + 10, voiceSize);
+
+	SequentialHandleAllocator hAlloc;
+	ISOFileSystem iso(&hAlloc, dev);
+
+	bool exists = false;
+	std::vector<PSPFileInfo> listing = iso.GetDirListing("/VOICE", &exists);
+	EXPECT_TRUE(exists);
+	EXPECT_EQ_INT((int)listing.size(), NUM_FILES);
+
+	for (int i = 0; i < NUM_FILES; i += 97) {
+		PSPFileInfo info = iso.GetFileInfo(StringFromFormat("/VOICE/V%05d.AT3", i));
+		EXPECT_TRUE(info.exists);
+		EXPECT_EQ_INT((int)info.size, 100 + i);
+	}
+	EXPECT_FALSE(iso.GetFileInfo("/VOICE/v00001.at3").exists);
+	EXPECT_FALSE(iso.GetFileInfo("/VOICE/MISSING.AT3").exists);
+	EXPECT_TRUE(iso.GetFileInfo("./VOICE/V00002.AT3").exists);
+
+	// Microbenchmark: open every file in the big directory, a few times over.
+	const int PASSES = 10;
+	double st = time_now_d();
+	for (int pass = 0; pass < PASSES; ++pass) {
+		for (int i = 0; i < NUM_FILES; ++i) {
+			int handle = iso.OpenFile(StringFromFormat("/VOICE/V%05d.AT3", i), FILEACCESS_READ);
+			EXPECT_TRUE(handle > 0);
+			iso.CloseFile(handle);
+		}
+	}
+	double elapsed = time_now_d() - st;
+	printf("ISOFileSystem: %d opens in a %d entry directory: %0.2f ms (%0.3f us/open)\n", NUM_FILES * PASSES, NUM_FILES, elapsed * 1000.0, elapsed * 1000000.0 / (NUM_FILES * PASSES));
+
+	st = time_now_d();
+	for (int pass = 0; pass < PASSES; ++pass)
+		listing = iso.GetDirListing("/VOICE");
+	elapsed = time_now_d() - st;
+	printf("ISOFileSystem: %d listings: %0.2f ms\n", PASSES, elapsed * 1000.0);
+	return true;
+}
+
+static bool TestSasMixing() {
+	// Odd counts and offsets to exercise the scalar tails and unaligned access.
+	const int MAX_COUNT = 259;
+	std::vector<int> samples(MAX_COUNT), envelope(MAX_COUNT);
+	std::vector<int> mix(MAX_COUNT * 2 + 1), send(MAX_COUNT * 2 + 1);
+	std::vector<int> refMix(MAX_COUNT * 2 + 1), refSend(MAX_COUNT * 2 + 1);
+	std::vector<s16> wet(MAX_COUNT * 2 + 1), out(MAX_COUNT * 2 + 1);
+
+	srand(1234);
+	for (int iter = 0; iter < 200; ++iter) {
+		int count = rand() % MAX_COUNT;
+		int start = rand() & 1;
+		int volumeLeft = rand() % 0x2001 - 0x1000;
+		int volumeRight = rand() % 0x2001 - 0x1000;
+		int effectLeft = rand() % 0x2001 - 0x1000;
+		int effectRight = rand() % 0x2001 - 0x1000;
+		for (int i = 0; i < MAX_COUNT; ++i) {
+			samples[i] = (s16)(rand() & 0xFFFF);
+			envelope[i] = rand() % 0x8001;
+		}
+		for (int i = 0; i < MAX_COUNT * 2 + 1; ++i) {
+			mix[i] = refMix[i] = (rand() & 0x3FFFF) - 0x20000;
+			send[i] = refSend[i] = (rand() & 0x3FFFF) - 0x20000;
+			wet[i] = (s16)(rand() & 0xFFFF);
+		}
+
+		for (int i = 0; i < count; ++i) {
+			int sample = ((samples[i] * envelope[i]) + (1 << 14)) >> 15;
+			refMix[start + i * 2] += (sample * volumeLeft) >> 12;
+			refMix[start + i * 2 + 1] += (sample * volumeRight) >> 12;
+			refSend[start + i * 2] += sample * effectLeft >> 12;
+			refSend[start + i * 2 + 1] += sample * effectRight >> 12;
+		}
+		SasMixScaledSamples(&mix[start], &send[start], &samples[0], &envelope[0], count, volumeLeft, volumeRight, effectLeft, effectRight);
+		EXPECT_TRUE(mix == refMix);
+		EXPECT_TRUE(send == refSend);
+
+		SasClampMixToS16(&out[start], &mix[start], &wet[start], count * 2);
+		for (int i = start; i < start + count * 2; ++i)
+			EXPECT_EQ_INT(out[i], clamp_s16(mix[i] + wet[i]));
+		SasClampMixToS16(&out[start], &mix[start], nullptr, count * 2);
+		for (int i = start; i < start + count * 2; ++i)
+			EXPECT_EQ_INT(out[i], clamp_s16(mix[i]));
+	}
+	return true;
+}
+
+// The list walking BlockAllocator used to do, kept as a reference for the indexed version.
+class ReferenceBlockAllocator {
+public:
+	ReferenceBlockAllocator(u32 grain) : grain_(grain) {}
+
+	void Init(u32 start, u32 size) {
+		rangeSize_ = size;
+		blocks_.clear();
+		blocks_.push_back(Block{ start, size, false });
+	}
+
+	u32 AllocAligned(u32 &size, u32 sizeGrain, u32 grain, bool fromTop) {
+		if (size == 0 || size > rangeSize_)
+			return -1;
+		if (grain < grain_)
+			grain = grain_;
+		if (sizeGrain < grain_)
+			sizeGrain = grain_;
+		size = (size + sizeGrain - 1) & ~(sizeGrain - 1);
+
+		for (size_t n = 0; n < blocks_.size(); ++n) {
+			size_t i = fromTop ? blocks_.size() - 1 - n : n;
+			Block b = blocks_[i];
+			u32 offset;
+			if (!fromTop) {
+				offset = b.start % grain;
+				if (offset != 0)
+					offset = grain - offset;
+			} else {
+				offset = (b.start + b.size - size) % grain;
+			}
+			u32 needed = offset + size;
+			if (b.taken || b.size < needed)
+				continue;
+
+			// Same splits as InsertFreeBefore() / InsertFreeAfter() produced.
+			std::vector<Block> parts;
+			if (!fromTop) {
+				u32 taken = b.size == needed ? b.size : needed;
+				if (offset >= grain_) {
+					parts.push_back(Block{ b.start, offset, false });
+					parts.push_back(Block{ b.start + offset, taken - offset, true });
+				} else {
+					parts.push_back(Block{ b.start, taken, true });
+				}
+				if (b.size != needed)
+					parts.push_back(Block{ b.start + needed, b.size - needed, false });
+			} else {
+				u32 takenStart = b.start + (b.size - needed);
+				if (b.size != needed)
+					parts.push_back(Block{ b.start, b.size - needed, false });
+				if (offset >= grain_) {
+					parts.push_back(Block{ takenStart, needed - offset, true });
+					parts.push_back(Block{ takenStart + needed - offset, offset, false });
+				} else {
+					parts.push_back(Block{ takenStart, needed, true });
+				}
+			}
+			blocks_.erase(blocks_.begin() + i);
+			blocks_.insert(blocks_.begin() + i, parts.begin(), parts.end());
+			for (const Block &part : parts) {
+				if (part.taken)
+					return part.start;
+			}
+		}
+		return -1;
+	}
+
+	u32 AllocAt(u32 position, u32 size) {
+		if (size > rangeSize_)
+			return -1;
+		u32 alignedPosition = position & ~(grain_ - 1);
+		u32 alignedSize = size + (position - alignedPosition);
+		alignedSize = (alignedSize + grain_ - 1) & ~(grain_ - 1);
+		int i = Find(alignedPosition);
+		if (i < 0 || blocks_[i].taken)
+			return -1;
+		Block b = blocks_[i];
+		if (b.start + b.size < alignedPosition + alignedSize)
+			return -1;
+		std::vector<Block> parts;
+		if (b.start != alignedPosition)
+			parts.push_back(Block{ b.start, alignedPosition - b.start, false });
+		parts.push_back(Block{ alignedPosition, alignedSize, true });
+		if (b.start + b.size > alignedPosition + alignedSize)
+			parts.push_back(Block{ alignedPosition + alignedSize, b.start + b.size - alignedPosition - alignedSize, false });
+		blocks_.erase(blocks_.begin() + i);
+		blocks_.insert(blocks_.begin() + i, parts.begin(), parts.end());
+		return position;
+	}
+
+	bool Free(u32 position, bool exact) {
+		int i = Find(position);
+		if (i < 0 || !blocks_[i].taken || (exact && blocks_[i].start != position))
+			return false;
+		blocks_[i].taken = false;
+		while (i > 0 && !blocks_[i - 1].taken) {
+			blocks_[i - 1].size += blocks_[i].size;
+			blocks_.erase(blocks_.begin() + i);
+			--i;
+		}
+		while (i + 1 < (int)blocks_.size() && !blocks_[i + 1].taken) {
+			blocks_[i].size += blocks_[i + 1].size;
+			blocks_.erase(blocks_.begin() + i + 1);
+		}
+		return true;
+	}
+
+	int Find(u32 addr) const {
+		for (size_t i = 0; i < blocks_.size(); ++i) {
+			if (blocks_[i].start <= addr && blocks_[i].start + blocks_[i].size > addr)
+				return (int)i;
+		}
+		return -1;
+	}
+
+	struct Block {
+		u32 start;
+		u32 size;
+		bool taken;
+	};
+	std::vector<Block> blocks_;
+
+private:
+	u32 grain_;
+	u32 rangeSize_ = 0;
+};
+
+static bool TestBlockAllocator() {
+	const u32 rangeStart = 0x08800000;
+	const u32 rangeSize = 0x00400000;
+	const u32 grains[] = { 0x10, 0x40, 0x100, 0x1000, 0x10000 };
+
+	for (u32 grain : { 0x10, 0x100 }) {
+		BlockAllocator alloc(grain);
+		ReferenceBlockAllocator ref(grain);
+		alloc.Init(rangeStart, rangeSize, false);
+		ref.Init(rangeStart, rangeSize);
+
+		std::vector<u32> allocated;
+		srand(1234);
+		for (int op = 0; op < 20000; ++op) {
+			int kind = rand() % 10;
+			if (kind < 5) {
+				// Mostly small allocations, sometimes big ones.
+				u32 size = rand() % 8 == 0 ? rand() % 0x40000 + 1 : rand() % 0x800 + 1;
+				u32 sizeGrain = grains[rand() % 3];
+				u32 alignGrain = grains[rand() % 5];
+				bool fromTop = (rand() & 1) != 0;
+				u32 size1 = size, size2 = size;
+				u32 addr = alloc.AllocAligned(size1, sizeGrain, alignGrain, fromTop);
+				u32 refAddr = ref.AllocAligned(size2, sizeGrain, alignGrain, fromTop);
+				EXPECT_EQ_HEX(addr, refAddr);
+				EXPECT_EQ_HEX(size1, size2);
+				if (addr != (u32)-1)
+					allocated.push_back(addr);
+			} else if (kind < 6) {
+				u32 position = rangeStart + (rand() % rangeSize & ~7);
+				u32 size = rand() % 0x1000 + 1;
+				u32 addr = alloc.AllocAt(position, size);
+				u32 refAddr = ref.AllocAt(position, size);
+				EXPECT_EQ_HEX(addr, refAddr);
+				if (addr != (u32)-1)
+					allocated.push_back(addr);
+			} else if (!allocated.empty()) {
+				size_t index = rand() % allocated.size();
+				u32 position = allocated[index];
+				allocated[index] = allocated.back();
+				allocated.pop_back();
+				bool exact = kind == 9;
+				bool freed = exact ? alloc.FreeExact(position) : alloc.Free(position);
+				EXPECT_EQ_INT(freed, ref.Free(position, exact));
+			}
+
+			if ((op & 63) == 0) {
+				EXPECT_EQ_HEX(alloc.GetTotalFreeBytes(), [&] {
+					u32 sum = 0;
+					for (auto &b : ref.blocks_)
+						sum += b.taken ? 0 : b.size;
+					return sum;
+				}());
+				u32 largest = 0;
+				for (auto &b : ref.blocks_) {
+					if (!b.taken)
+						largest = std::max(largest, b.size);
+					u32 addr = b.start + (b.size > 1 ? rand() % b.size : 0);
+					EXPECT_EQ_HEX(alloc.GetBlockStartFromAddress(addr), b.start);
+					EXPECT_EQ_HEX(alloc.GetBlockSizeFromAddress(addr), b.size);
+					EXPECT_EQ_INT(alloc.IsBlockFree(addr), !b.taken);
+				}
+				EXPECT_EQ_HEX(alloc.GetLargestFreeBlockSize(), largest);
+			}
+		}
+		alloc.Shutdown();
+	}
+	return true;
+}
+
 // So we can use EXPECT_TRUE, etc.
 struct AlignedMem {
 	AlignedMem(size_t sz, size_t alignment = 16) {
@@ -997,6 +1371,592 @@ bool TestIniFile() {
 	return true;
 }
 
+static std::string MakeTestDiscData(size_t size) {
+	std::string data;
+	data.resize(size);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = (char)(i * 7 + (i >> 12));
+	}
+	return data;
+}
+
+// Serves ranges of a file, like the remote ISO server does.  Range requests wait latencyMs first, if set.
+static void ServeTestDisc(http::Server &server, const Path &filename, long long size, const std::atomic<int> *latencyMs = nullptr) {
+	server.RegisterHandler("/disc", [filename, size, latencyMs](const http::ServerRequest &request) {
+		if (request.Method() == http::RequestHeader::HEAD) {
+			request.WriteHttpResponseHeader("1.1", 200, size, "application/octet-stream", "Accept-Ranges: bytes\r\n");
+			return;
+		}
+
+		std::string range;
+		long long begin = 0, last = 0;
+		if (!request.GetHeader("range", &range) || sscanf(range.c_str(), "bytes=%lld-%lld", &begin, &last) != 2) {
+			request.WriteHttpResponseHeader("1.1", 400, -1, "text/plain");
+			return;
+		}
+		if (latencyMs && *latencyMs > 0)
+			sleep_ms(*latencyMs);
+		char contentRange[256];
+		snprintf(contentRange, sizeof(contentRange), "Content-Range: bytes %lld-%lld/%lld\r\n", begin, last, size);
+		request.WriteHttpResponseHeader("1.1", 206, last - begin + 1, "application/octet-stream", contentRange);
+		request.SendFileRange(filename, begin, last - begin + 1);
+	});
+}
+
+// Many clients doing range requests over kept alive connections, like remote ISO streaming.
+static bool TestHTTPServer() {
+	const Path filename("http_server_test.bin");
+	const std::string data = MakeTestDiscData(4 * 1024 * 1024);
+	EXPECT_TRUE(File::WriteStringToFile(false, data, filename));
+
+	net::Init();
+	http::Server server(new NewThreadExecutor());
+	ServeTestDisc(server, filename, (long long)data.size());
+	EXPECT_TRUE(server.Listen(0, net::DNSType::IPV4));
+
+	std::atomic<bool> done{};
+	std::thread serverThread([&] {
+		while (!done)
+			server.RunSlice(0.1);
+	});
+
+	const int CLIENTS = 16;
+	const int REQUESTS = 32;
+	const long long RANGE_SIZE = 64 * 1024;
+	std::atomic<int> failures{};
+	std::atomic<int> connections{};
+	std::vector<std::thread> clients;
+
+	double start = time_now_d();
+	for (int c = 0; c < CLIENTS; ++c) {
+		clients.push_back(std::thread([&, c] {
+			net::Connection conn;
+			std::unique_ptr<net::InputSink> in;
+			std::unique_ptr<net::OutputSink> out;
+			for (int r = 0; r < REQUESTS; ++r) {
+				if (!in) {
+					if (!conn.Resolve("127.0.0.1", server.Port(), net::DNSType::IPV4) || !conn.Connect()) {
+						failures++;
+						return;
+					}
+					in.reset(new net::InputSink(conn.sock()));
+					out.reset(new net::OutputSink(conn.sock()));
+					connections++;
+				}
+
+				long long begin = ((long long)(c * REQUESTS + r) * 40961) % ((long long)data.size() - RANGE_SIZE);
+				out->Printf("GET /disc HTTP/1.1\r\nHost: localhost\r\nRange: bytes=%lld-%lld\r\n\r\n", begin, begin + RANGE_SIZE - 1);
+				out->Flush();
+
+				std::string line;
+				if (!in->ReadLine(line) || line.find(" 206 ") == line.npos) {
+					failures++;
+					return;
+				}
+				long long length = -1;
+				bool keepAlive = false;
+				while (in->ReadLine(line) && !line.empty()) {
+					std::transform(line.begin(), line.end(), line.begin(), tolower);
+					sscanf(line.c_str(), "content-length: %lld", &length);
+					if (line == "connection: keep-alive")
+						keepAlive = true;
+				}
+
+				std::string body;
+				body.resize(length < 0 ? 0 : (size_t)length);
+				if (length != RANGE_SIZE || !in->TakeExact(&body[0], body.size()) || body != data.substr(begin, RANGE_SIZE)) {
+					failures++;
+					return;
+				}
+				// Servers without keep-alive support close, so reconnect.
+				if (!keepAlive) {
+					in.reset();
+					out.reset();
+					conn.Disconnect();
+				}
+			}
+		}));
+	}
+	for (auto &client : clients) {
+		client.join();
+	}
+	double elapsed = time_now_d() - start;
+
+	printf("%d range requests over %d connections: %0.3f seconds (%0.1f MB/s)\n", CLIENTS * REQUESTS, (int)connections, elapsed, (CLIENTS * REQUESTS * RANGE_SIZE) / (elapsed * 1024.0 * 1024.0));
+
+	done = true;
+	serverThread.join();
+	server.Stop();
+	net::Shutdown();
+	File::Delete(filename);
+
+	EXPECT_EQ_INT((int)failures, 0);
+	return true;
+}
+
+static bool ReadWebSocketMessage(net::InputSink *in, int *opcode, std::vector<uint8_t> *payload) {
+	uint8_t header[2];
+	if (!in->TakeExact((char *)header, 2))
+		return false;
+	*opcode = header[0] & 0x0F;
+	uint64_t sz = header[1] & 0x7F;
+	int extra = sz == 126 ? 2 : (sz == 127 ? 8 : 0);
+	if (extra != 0) {
+		uint8_t ext[8];
+		if (!in->TakeExact((char *)ext, extra))
+			return false;
+		sz = 0;
+		for (int i = 0; i < extra; ++i)
+			sz = (sz << 8) | ext[i];
+	}
+	payload->resize((size_t)sz);
+	return sz == 0 || in->TakeExact((char *)payload->data(), payload->size());
+}
+
+// Requests and responses batched into single binary messages, like the debugger's binary mode.
+static bool TestWebSocketBatch() {
+	net::Init();
+	http::Server server(new NewThreadExecutor());
+	server.RegisterHandler("/ws", [](const http::ServerRequest &request) {
+		net::WebSocketServer *ws = net::WebSocketServer::CreateAsUpgrade(request, "test");
+		if (!ws)
+			return;
+		ws->SetBinaryHandler([&](const std::vector<uint8_t> &d) {
+			std::vector<std::pair<net::BatchRecordType, std::string>> records;
+			if (!net::WebSocketServer::ParseBatch(d, &records)) {
+				ws->Send(std::string("invalid"));
+				return;
+			}
+			ws->BeginBatch();
+			for (const auto &record : records) {
+				ws->AddFragment(false, std::string("echo:"));
+				ws->AddFragment(true, record.second);
+				ws->Send(record.second.data(), record.second.size());
+			}
+			ws->EndBatch((d[0] & net::BATCH_FLAG_ZLIB) != 0);
+		});
+		while (ws->Process(0.1f))
+			continue;
+		delete ws;
+	});
+	EXPECT_TRUE(server.Listen(0, net::DNSType::IPV4));
+
+	std::atomic<bool> done{};
+	std::thread serverThread([&] {
+		while (!done)
+			server.RunSlice(0.1);
+	});
+
+	int failures = 0;
+	net::Connection conn;
+	if (conn.Resolve("127.0.0.1", server.Port(), net::DNSType::IPV4) && conn.Connect()) {
+		net::InputSink in(conn.sock());
+		net::OutputSink out(conn.sock());
+		out.Push("GET /ws HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Protocol: test\r\n\r\n");
+		out.Flush();
+
+		std::string line;
+		if (!in.ReadLine(line) || line.find(" 101 ") == line.npos)
+			failures++;
+		while (in.ReadLine(line) && !line.empty())
+			continue;
+
+		const std::vector<std::string> requests = { "{\"event\":\"version\"}", std::string(4096, 'x'), "" };
+		for (uint8_t flags : { 0, (int)net::BATCH_FLAG_ZLIB }) {
+			std::string records;
+			for (const std::string &r : requests) {
+				records.push_back((char)net::BatchRecordType::TEXT);
+				for (int i = 0; i < 4; ++i)
+					records.push_back((char)(r.size() >> (i * 8)));
+				records += r;
+			}
+			std::string body = records;
+			if (flags & net::BATCH_FLAG_ZLIB)
+				compress_string(records, &body);
+
+			// Client frames must be masked, a zero mask leaves the data as is.
+			std::string frame;
+			frame.push_back((char)0x82);
+			frame.push_back((char)(0x80 | 126));
+			frame.push_back((char)((body.size() + 1) >> 8));
+			frame.push_back((char)((body.size() + 1) & 0xFF));
+			frame.append(4, '\0');
+			frame.push_back((char)flags);
+			frame += body;
+			out.Push(frame.data(), frame.size());
+			out.Flush();
+
+			int opcode = 0;
+			std::vector<uint8_t> payload;
+			std::vector<std::pair<net::BatchRecordType, std::string>> responses;
+			if (!ReadWebSocketMessage(&in, &opcode, &payload) || opcode != 2 || !net::WebSocketServer::ParseBatch(payload, &responses)) {
+				failures++;
+				break;
+			}
+			// The repetitive responses should have been worth deflating.
+			if ((payload[0] & net::BATCH_FLAG_ZLIB) != flags)
+				failures++;
+			if (responses.size() != requests.size() * 2) {
+				failures++;
+				break;
+			}
+			for (size_t i = 0; i < requests.size(); ++i) {
+				if (responses[i * 2].first != net::BatchRecordType::TEXT || responses[i * 2].second != "echo:" + requests[i])
+					failures++;
+				if (responses[i * 2 + 1].first != net::BatchRecordType::BINARY || responses[i * 2 + 1].second != requests[i])
+					failures++;
+			}
+		}
+
+		std::vector<std::pair<net::BatchRecordType, std::string>> ignored;
+		if (net::WebSocketServer::ParseBatch({ 0, 1, 9, 0, 0, 0 }, &ignored))
+			failures++;
+		conn.Disconnect();
+	} else {
+		failures++;
+	}
+
+	done = true;
+	serverThread.join();
+	server.Stop();
+	net::Shutdown();
+
+	EXPECT_EQ_INT(failures, 0);
+	return true;
+}
+
+// One connection and range request per read, which is what HTTPFileLoader used to do.  For comparison.
+static size_t ReadTestDiscUncached(int port, s64 pos, size_t size, char *dest) {
+	http::Client client;
+	if (!client.Resolve("127.0.0.1", port, net::DNSType::IPV4) || !client.Connect())
+		return 0;
+	char rangeHeader[128];
+	snprintf(rangeHeader, sizeof(rangeHeader), "Range: bytes=%lld-%lld\r\n", (long long)pos, (long long)(pos + size - 1));
+	std::atomic<bool> cancelled{};
+	net::RequestProgress progress(&cancelled);
+	net::Buffer readbuf, output;
+	std::vector<std::string> responseHeaders;
+	if (client.SendRequest("GET", http::RequestParams("/disc", "*/*"), rangeHeader, &progress) < 0 || client.ReadResponseHeaders(&readbuf, responseHeaders, &progress) != 206)
+		return 0;
+	if (client.ReadResponseEntity(&readbuf, responseHeaders, &output, &progress) != 0)
+		return 0;
+	size_t got = std::min(output.size(), size);
+	output.Take(got, dest);
+	client.Disconnect();
+	return got;
+}
+
+static bool TestHTTPFileLoader() {
+	const Path filename("http_loader_test.bin");
+	const std::string data = MakeTestDiscData(4 * 1024 * 1024 + 12345);
+	EXPECT_TRUE(File::WriteStringToFile(false, data, filename));
+
+	net::Init();
+	http::Server server(new NewThreadExecutor());
+	std::atomic<int> latencyMs{};
+	ServeTestDisc(server, filename, (long long)data.size(), &latencyMs);
+	EXPECT_TRUE(server.Listen(0, net::DNSType::IPV4));
+	const Path url(StringFromFormat("http://127.0.0.1:%d/disc", server.Port()));
+
+	std::atomic<bool> done{};
+	std::thread serverThread([&] {
+		while (!done)
+			server.RunSlice(0.1);
+	});
+
+	std::atomic<int> failures{};
+	typedef std::function<size_t(s64 pos, size_t size, char *dest)> ReadFunc;
+
+	// Sequential, like loading a game.  This is where read-ahead helps.
+	auto readSequential = [&](const ReadFunc &read) {
+		const size_t READ_SIZE = 32 * 1024;
+		std::string buf;
+		buf.resize(READ_SIZE);
+		double start = time_now_d();
+		for (size_t pos = 0; pos < data.size(); pos += READ_SIZE) {
+			size_t expected = std::min(READ_SIZE, data.size() - pos);
+			if (read(pos, READ_SIZE, &buf[0]) != expected || memcmp(&buf[0], &data[pos], expected) != 0)
+				failures++;
+		}
+		return time_now_d() - start;
+	};
+	// Then scattered reads from several threads at once, mostly not block aligned.
+	auto readScattered = [&](const ReadFunc &read) {
+		double start = time_now_d();
+		std::vector<std::thread> readers;
+		for (int t = 0; t < 4; ++t) {
+			readers.push_back(std::thread([&, t] {
+				std::string buf;
+				for (int i = 0; i < 64; ++i) {
+					size_t pos = ((size_t)(t * 64 + i) * 1000003) % data.size();
+					size_t size = std::min((size_t)(1 + i * 3001), data.size() - pos);
+					buf.resize(size);
+					if (read(pos, size, &buf[0]) != size || memcmp(&buf[0], &data[pos], size) != 0)
+						failures++;
+				}
+			}));
+		}
+		for (auto &reader : readers) {
+			reader.join();
+		}
+		return time_now_d() - start;
+	};
+	auto runLoader = [&](double *sequentialTime, double *scatteredTime) {
+		{
+			HTTPFileLoader loader(url);
+			if (loader.FileSize() != (s64)data.size())
+				failures++;
+			*sequentialTime = readSequential([&](s64 pos, size_t size, char *dest) { return loader.ReadAt(pos, size, dest); });
+		}
+		HTTPFileLoader loader(url);
+		*scatteredTime = readScattered([&](s64 pos, size_t size, char *dest) { return loader.ReadAt(pos, size, dest); });
+	};
+
+	double sequentialTime, scatteredTime;
+	runLoader(&sequentialTime, &scatteredTime);
+	printf("HTTPFileLoader: sequential %0.3f seconds, scattered %0.3f seconds\n", sequentialTime, scatteredTime);
+
+	// Benchmark against a request per read, with some latency like a real network.
+	latencyMs = 5;
+	runLoader(&sequentialTime, &scatteredTime);
+	const ReadFunc uncached = [&](s64 pos, size_t size, char *dest) {
+		return ReadTestDiscUncached(server.Port(), pos, std::min(size, (size_t)(data.size() - pos)), dest);
+	};
+	double uncachedSequentialTime = readSequential(uncached);
+	double uncachedScatteredTime = readScattered(uncached);
+	printf("HTTPFileLoader with %d ms latency: sequential %0.3f seconds (%0.3f with a request per read), scattered %0.3f seconds (%0.3f)\n", (int)latencyMs, sequentialTime, uncachedSequentialTime, scatteredTime, uncachedScatteredTime);
+
+	// Cancel a read that's waiting on the server, and make sure the loader still works afterward.
+	latencyMs = 500;
+	{
+		HTTPFileLoader loader(url);
+		if (loader.FileSize() != (s64)data.size())
+			failures++;
+		std::string buf;
+		buf.resize(4096);
+		double start = time_now_d();
+		std::thread reader([&] {
+			if (loader.ReadAt(1024 * 1024, buf.size(), &buf[0]) != 0)
+				failures++;
+		});
+		sleep_ms(50);
+		loader.Cancel();
+		reader.join();
+		if (time_now_d() - start >= 0.4) {
+			printf("HTTPFileLoader: cancel didn't interrupt the read\n");
+			failures++;
+		}
+
+		latencyMs = 0;
+		// A cancel with nothing going on doesn't affect later reads either.
+		loader.Cancel();
+		if (loader.ReadAt(1024 * 1024, buf.size(), &buf[0]) != buf.size() || memcmp(&buf[0], &data[1024 * 1024], buf.size()) != 0)
+			failures++;
+	}
+
+	done = true;
+	serverThread.join();
+	server.Stop();
+	net::Shutdown();
+	File::Delete(filename);
+
+	EXPECT_EQ_INT((int)failures, 0);
+	return true;
+}
+
+static std::vector<u8> CompressZstdFrame(const u8 *data, size_t size) {
+	std::vector<u8> frame(ZSTD_compressBound(size));
+	frame.resize(ZSTD_compress(frame.data(), frame.size(), data, size, ZSTD_CLEVEL_DEFAULT));
+	return frame;
+}
+
+static bool TestZstdFrames() {
+	std::vector<u8> data(9 * 1024 * 1024 + 123);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = (u8)((i * 7) ^ (i >> 13));
+	}
+
+	// New states are split into independent frames.
+	std::vector<u8> multi;
+	const size_t FRAME_SIZE = 4 * 1024 * 1024;
+	int frameCount = 0;
+	for (size_t pos = 0; pos < data.size(); pos += FRAME_SIZE) {
+		std::vector<u8> frame = CompressZstdFrame(&data[pos], std::min(FRAME_SIZE, data.size() - pos));
+		multi.insert(multi.end(), frame.begin(), frame.end());
+		frameCount++;
+	}
+	EXPECT_EQ_INT(frameCount, 3);
+
+	std::vector<u8> out(data.size());
+	EXPECT_EQ_INT((int)CChunkFileReader::DecompressZstdFrames(out.data(), out.size(), multi.data(), multi.size()), (int)data.size());
+	EXPECT_TRUE(out == data);
+
+	// Older states are a single frame.
+	std::vector<u8> single = CompressZstdFrame(data.data(), data.size());
+	std::fill(out.begin(), out.end(), 0);
+	EXPECT_EQ_INT((int)CChunkFileReader::DecompressZstdFrames(out.data(), out.size(), single.data(), single.size()), (int)data.size());
+	EXPECT_TRUE(out == data);
+
+	// A frame claiming more than fits in the destination must be rejected, not written past the end.
+	EXPECT_EQ_INT((int)CChunkFileReader::DecompressZstdFrames(out.data(), out.size() - 1, multi.data(), multi.size()), 0);
+	EXPECT_EQ_INT((int)CChunkFileReader::DecompressZstdFrames(out.data(), out.size() - 1, single.data(), single.size()), 0);
+	return true;
+}
+
+struct TestSaveState {
+	std::vector<u8> data;
+
+	void DoState(PointerWrap &p) {
+		auto s = p.Section("TestSaveState", 1);
+		if (!s)
+			return;
+		Do(p, data);
+	}
+};
+
+// Counts the zstd frames in a saved state, after its header.
+static int CountStateZstdFrames(const std::string &file) {
+	static const char ZSTD_MAGIC[] = { '\x28', '\xB5', '\x2F', '\xFD' };
+	size_t offset = file.find(std::string(ZSTD_MAGIC, sizeof(ZSTD_MAGIC)));
+	if (offset == file.npos)
+		return 0;
+	int count = 0;
+	while (offset < file.size()) {
+		size_t frameSize = ZSTD_findFrameCompressedSize(file.data() + offset, file.size() - offset);
+		if (ZSTD_isError(frameSize))
+			return 0;
+		offset += frameSize;
+		count++;
+	}
+	return count;
+}
+
+// Saves and loads a state big enough to be split into frames, through the real file format.
+static bool TestSaveStateFile() {
+	const Path filename("savestate_test.ppst");
+	TestSaveState state;
+	state.data.resize(9 * 1024 * 1024 + 123);
+	for (size_t i = 0; i < state.data.size(); ++i) {
+		state.data[i] = (u8)((i * 7) ^ (i >> 13));
+	}
+
+	// Once serially, then with frames compressed and decompressed on worker threads.
+	const bool startThreads = !g_threadManager.IsInitialized();
+	for (int pass = 0; pass < 2; ++pass) {
+		if (pass == 1 && startThreads)
+			g_threadManager.Init(4, 1);
+
+		EXPECT_EQ_INT((int)CChunkFileReader::Save(filename, "Test title", "v1.2.3", state), (int)CChunkFileReader::ERROR_NONE);
+
+		std::string file;
+		EXPECT_TRUE(File::ReadBinaryFileToString(filename, &file));
+		EXPECT_TRUE(file.size() < state.data.size());
+		EXPECT_EQ_INT(CountStateZstdFrames(file), 3);
+
+		std::string title;
+		EXPECT_EQ_INT((int)CChunkFileReader::GetFileTitle(filename, &title), (int)CChunkFileReader::ERROR_NONE);
+		EXPECT_TRUE(title == "Test title");
+
+		TestSaveState loaded;
+		std::string gitVersion, failureReason;
+		EXPECT_EQ_INT((int)CChunkFileReader::Load(filename, &gitVersion, loaded, &failureReason), (int)CChunkFileReader::ERROR_NONE);
+		EXPECT_TRUE(gitVersion == "v1.2.3");
+		EXPECT_TRUE(loaded.data == state.data);
+
+		// A truncated file must fail to load, not come back short.
+		EXPECT_TRUE(File::WriteStringToFile(false, file.substr(0, file.size() - 1000), filename));
+		EXPECT_FALSE(CChunkFileReader::Load(filename, &gitVersion, loaded, &failureReason) == CChunkFileReader::ERROR_NONE);
+	}
+
+	if (startThreads)
+		g_threadManager.Teardown();
+	File::Delete(filename);
+	return true;
+}
+
+static std::vector<u8> CompressDumpChunk(const std::vector<u8> &data) {
+	std::vector<u8> compressed(ZSTD_compressBound(data.size()));
+	compressed.resize(ZSTD_compress(compressed.data(), compressed.size(), data.data(), data.size(), 6));
+	return compressed;
+}
+
+template <typename T>
+static void AppendDumpBytes(std::vector<u8> &dest, const T &value) {
+	const u8 *p = (const u8 *)&value;
+	dest.insert(dest.end(), p, p + sizeof(T));
+}
+
+// Two frames that both use the same blob.  Frame 0 can be left undecodable, to show it isn't read.
+static std::string MakeChunkedGEDump(bool corruptFrame0, u32 frameCount, u32 blobSize) {
+	using namespace GPURecord;
+
+	std::vector<u8> file;
+	Header header{};
+	memcpy(header.magic, HEADER_MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	AppendDumpBytes(file, header);
+
+	// Memcpy to a non-VRAM address, which replays without needing a GPU.
+	std::vector<u8> frame;
+	AppendDumpBytes(frame, Command{ CommandType::MEMCPYDEST, 4, 0 });
+	AppendDumpBytes(frame, Command{ CommandType::MEMCPYDATA, 0, 0 });
+	AppendDumpBytes(frame, BlobRef{ 1, 0 });
+	AppendDumpBytes(frame, (u32)0x00010000);
+
+	std::vector<FrameIndexEntry> frames;
+	for (int i = 0; i < 2; ++i) {
+		std::vector<u8> chunk = CompressDumpChunk(frame);
+		if (i == 0 && corruptFrame0)
+			std::fill(chunk.begin(), chunk.end(), 0xCC);
+		frames.push_back(FrameIndexEntry{ file.size(), (u32)chunk.size(), 2, 1, 4 });
+		file.insert(file.end(), chunk.begin(), chunk.end());
+	}
+
+	std::vector<u8> blob(64);
+	for (size_t i = 0; i < blob.size(); ++i)
+		blob[i] = (u8)i;
+	std::vector<u8> chunk = CompressDumpChunk(blob);
+	BlobIndexEntry blobEntry{ file.size(), (u32)chunk.size(), blobSize };
+	file.insert(file.end(), chunk.begin(), chunk.end());
+
+	std::vector<u8> index;
+	for (const FrameIndexEntry &entry : frames)
+		AppendDumpBytes(index, entry);
+	AppendDumpBytes(index, blobEntry);
+	chunk = CompressDumpChunk(index);
+	ChunkedFooter footer{ file.size(), (u32)chunk.size(), frameCount, 1 };
+	memcpy(footer.magic, FOOTER_MAGIC, sizeof(footer.magic));
+	file.insert(file.end(), chunk.begin(), chunk.end());
+	AppendDumpBytes(file, footer);
+
+	return std::string((const char *)file.data(), file.size());
+}
+
+static bool TestChunkedGEDump() {
+	EXPECT_TRUE(File::WriteStringToFile(false, MakeChunkedGEDump(true, 2, 64), Path("ge_dump_test.ppdmp")));
+	// The footer claims far more frames than the index holds.
+	EXPECT_TRUE(File::WriteStringToFile(false, MakeChunkedGEDump(false, 0x10000000, 64), Path("ge_dump_frames.ppdmp")));
+	// The blob claims to expand far beyond what zstd can produce from its chunk.
+	EXPECT_TRUE(File::WriteStringToFile(false, MakeChunkedGEDump(false, 2, 0xFFFFFFF0), Path("ge_dump_blob.ppdmp")));
+
+	pspFileSystem.Mount("dumptest:", std::make_shared<DirectoryFileSystem>(&pspFileSystem, Path("."), FileSystemFlags::NONE));
+
+	EXPECT_EQ_INT(GPURecord::GetMountedReplayFrameCount("dumptest:/ge_dump_test.ppdmp"), 2);
+	// Frame 0 is garbage, so this only works if it's skipped.
+	EXPECT_TRUE(GPURecord::RunMountedReplayFrame("dumptest:/ge_dump_test.ppdmp", 1));
+	EXPECT_FALSE(GPURecord::RunMountedReplayFrame("dumptest:/ge_dump_test.ppdmp", 2));
+	EXPECT_FALSE(GPURecord::RunMountedReplayFrame("dumptest:/ge_dump_test.ppdmp", 0));
+
+	EXPECT_EQ_INT(GPURecord::GetMountedReplayFrameCount("dumptest:/ge_dump_frames.ppdmp"), -1);
+	EXPECT_EQ_INT(GPURecord::GetMountedReplayFrameCount("dumptest:/ge_dump_blob.ppdmp"), -1);
+
+	pspFileSystem.Unmount("dumptest:");
+	File::Delete(Path("ge_dump_test.ppdmp"));
+	File::Delete(Path("ge_dump_frames.ppdmp"));
+	File::Delete(Path("ge_dump_blob.ppdmp"));
+	return true;
+}
+
 typedef bool (*TestFunc)();
 struct TestItem {
 	const char *name;
@@ -1036,8 +1996,13 @@ TestItem availableTests[] = {
 	TEST_ITEM(Parsers),
 	TEST_ITEM(IRPassSimplify),
 	TEST_ITEM(Jit),
+	TEST_ITEM(InterpreterPredecode),
+	TEST_ITEM(JitCodePageProtection),
 	TEST_ITEM(MatrixTranspose),
 	TEST_ITEM(ParseLBN),
+	TEST_ITEM(ISOFileSystem),
+	TEST_ITEM(SasMixing),
+	TEST_ITEM(BlockAllocator),
 	TEST_ITEM(QuickTexHash),
 	TEST_ITEM(CLZ),
 	TEST_ITEM(MemMap),
@@ -1056,6 +2021,12 @@ TestItem availableTests[] = {
 	TEST_ITEM(VFS),
 	TEST_ITEM(Substitutions),
 	TEST_ITEM(IniFile),
+	TEST_ITEM(HTTPServer),
+	TEST_ITEM(HTTPFileLoader),
+	TEST_ITEM(WebSocketBatch),
+	TEST_ITEM(ZstdFrames),
+	TEST_ITEM(SaveStateFile),
+	TEST_ITEM(ChunkedGEDump),
 };
 
 int main(int argc, const char *argv[]) {